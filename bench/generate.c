@@ -0,0 +1,374 @@
+/* generate.c
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "generate.h"
+#include "strbuf.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARRAY_SIZE(arr) \
+        (sizeof (arr) / sizeof (arr[0]))
+
+/*
+ * Keep order in-sync with generate.h
+ */
+static const char *feature_names[N_FEATURES] = {
+  [FEATURE_HEADING]    = "heading",
+  [FEATURE_LIST]       = "list",
+  [FEATURE_QUOTE]      = "quote",
+  [FEATURE_PROSE]      = "prose",
+  [FEATURE_LINKS]      = "links",
+  [FEATURE_FOOTNOTES]  = "footnotes",
+  [FEATURE_CODE_C]     = "c",
+  [FEATURE_CODE_DIFF]  = "diff",
+  [FEATURE_CODE_PLAIN] = "plain",
+};
+
+static const char *words[] = {
+  "ocean", "marine", "species", "coral", "reef", "plankton", "whale",
+  "the", "of", "and", "a", "to", "in", "is", "that", "for", "it", "as",
+  "diverse", "ecosystem", "climate", "surface", "estimated", "known",
+  "protect", "erosion", "storm", "biodiversity", "sustainable", "resource",
+  "parser", "markdown", "document", "render", "output", "buffer", "line",
+};
+
+static const char *c_lines[] = {
+  "#include <stdio.h>",
+  "#define SIZE 0x400",
+  "static int",
+  "count_words (const char *str, size_t len)",
+  "{",
+  "  int count = 0; // running total",
+  "  for (size_t i = 0; i < len; i++)",
+  "    if (str[i] == ' ' && str[i + 1] != '\\0')",
+  "      count++;",
+  "  /* trailing word */",
+  "  return count + 1;",
+  "}",
+  "  printf (\"%d words in \\\"%s\\\"\\n\", count, str);",
+  "  char c = 'x';",
+  "  while (ptr != NULL && *ptr != '\\0')",
+  "  unsigned long mask = 0b1010 | 0xff;",
+};
+
+static const char *diff_lines[] = {
+  "@@ -12,7 +12,8 @@ parse_md (MDFile *file)",
+  "   size_t n_lines = 0;",
+  "-  uint len = 0;",
+  "+  size_t len = 0;",
+  "   while (read_line (&reader, md) != -1)",
+  "+    /* <normalized> & validated */",
+  "-    if (count > size)",
+  "     {",
+};
+
+typedef struct {
+  uint64_t state;
+  StrBuf buf;
+  size_t n_notes;
+} Generator;
+
+/* xorshift64* */
+static uint64_t
+next_random (Generator *gen)
+{
+  gen->state ^= gen->state >> 12;
+  gen->state ^= gen->state << 25;
+  gen->state ^= gen->state >> 27;
+
+  return gen->state * 2685821657736338717ULL;
+}
+
+static size_t
+random_below (Generator *gen,
+              size_t     n)
+{
+  return next_random (gen) % n;
+}
+
+static const char *
+random_word (Generator *gen)
+{
+  return words[random_below (gen, ARRAY_SIZE (words))];
+}
+
+static void
+append_words (Generator *gen,
+              size_t     n)
+{
+  for (size_t i = 0; i < n; i++)
+    {
+      if (i != 0)
+        strbuf_append_c (&gen->buf, ' ');
+      strbuf_append (&gen->buf, random_word (gen));
+    }
+}
+
+static void
+append_number (Generator *gen,
+               size_t     n)
+{
+  char num[24];
+
+  snprintf (num, sizeof (num), "%zu", n);
+  strbuf_append (&gen->buf, num);
+}
+
+/* prose with emphasis, inline code and the odd XML special char */
+static void
+append_sentence (Generator *gen)
+{
+  static const char *marks[][2] = {
+    { "*", "*" }, { "**", "**" }, { "***", "***" },
+    { "_", "_ " }, { "__", "__ " }, { "`", "`" },
+  };
+  size_t n_words = 6 + random_below (gen, 12);
+
+  for (size_t i = 0; i < n_words; i++)
+    {
+      if (i != 0)
+        strbuf_append_c (&gen->buf, ' ');
+
+      if (random_below (gen, 5) == 0)
+        {
+          size_t m = random_below (gen, ARRAY_SIZE (marks));
+
+          strbuf_append (&gen->buf, marks[m][0]);
+          append_words (gen, 1 + random_below (gen, 3));
+          strbuf_append (&gen->buf, marks[m][1]);
+        }
+      else
+        {
+          strbuf_append (&gen->buf, random_word (gen));
+        }
+
+      if (random_below (gen, 40) == 0)
+        strbuf_append (&gen->buf, " <&>");
+    }
+
+  strbuf_append (&gen->buf, ". ");
+}
+
+static void
+generate_feature (Generator *gen,
+                  Feature    feature)
+{
+  StrBuf *buf = &gen->buf;
+  size_t n;
+
+  switch (feature)
+    {
+      case FEATURE_HEADING:
+        strbuf_append_len (buf, "###", 1 + random_below (gen, 3));
+        strbuf_append_c (buf, ' ');
+        append_words (gen, 2 + random_below (gen, 5));
+        strbuf_append (buf, "\n\n");
+        break;
+
+      case FEATURE_LIST:
+        n = 2 + random_below (gen, 6);
+        for (size_t i = 0; i < n; i++)
+          {
+            strbuf_append (buf, "- ");
+            append_sentence (gen);
+            strbuf_append_c (buf, '\n');
+          }
+        strbuf_append_c (buf, '\n');
+        break;
+
+      case FEATURE_QUOTE:
+        strbuf_append (buf, "> ");
+        append_sentence (gen);
+        strbuf_append (buf, "\n\n");
+        break;
+
+      case FEATURE_PROSE:
+        n = 1 + random_below (gen, 4);
+        for (size_t i = 0; i < n; i++)
+          append_sentence (gen);
+        strbuf_append (buf, "\n\n");
+        break;
+
+      case FEATURE_LINKS:
+        append_words (gen, 3);
+        strbuf_append (buf, " [");
+        append_words (gen, 2);
+        strbuf_append (buf, "](https://example.com/");
+        strbuf_append (buf, random_word (gen));
+        strbuf_append (buf, ") and ![");
+        append_words (gen, 2);
+        strbuf_append (buf, "](images/");
+        strbuf_append (buf, random_word (gen));
+        strbuf_append (buf, ".png) ");
+        append_words (gen, 4);
+        strbuf_append (buf, "\n\n");
+        break;
+
+      case FEATURE_FOOTNOTES:
+        /* a new note, plus a reference to an earlier one */
+        gen->n_notes++;
+        append_words (gen, 5);
+        strbuf_append (buf, "[^n");
+        append_number (gen, gen->n_notes);
+        strbuf_append (buf, "] ");
+        append_words (gen, 3);
+        strbuf_append (buf, "[^n");
+        append_number (gen, 1 + random_below (gen, gen->n_notes));
+        strbuf_append (buf, "].\n\n[^n");
+        append_number (gen, gen->n_notes);
+        strbuf_append (buf, "]: ");
+        append_words (gen, 6);
+        strbuf_append (buf, "\n\n");
+        break;
+
+      case FEATURE_CODE_C:
+      case FEATURE_CODE_DIFF:
+      case FEATURE_CODE_PLAIN:
+        n = 4 + random_below (gen, 40);
+        strbuf_append (buf, feature == FEATURE_CODE_C    ? "```c\n" :
+                            feature == FEATURE_CODE_DIFF ? "```diff\n" : "```\n");
+        for (size_t i = 0; i < n; i++)
+          {
+            if (feature == FEATURE_CODE_C)
+              {
+                strbuf_append (buf, c_lines[random_below (gen, ARRAY_SIZE (c_lines))]);
+              }
+            else if (feature == FEATURE_CODE_DIFF)
+              {
+                strbuf_append (buf, diff_lines[random_below (gen, ARRAY_SIZE (diff_lines))]);
+              }
+            else
+              {
+                strbuf_append (buf, "2025-01-01T00:00:");
+                append_number (gen, random_below (gen, 60));
+                strbuf_append (buf, " INFO ");
+                append_words (gen, 6);
+              }
+            strbuf_append_c (buf, '\n');
+          }
+        strbuf_append (buf, "```\n\n");
+        break;
+
+      default:
+        break;
+    }
+}
+
+void
+generator_mix_default (GeneratorMix *mix)
+{
+  static const unsigned int weights[N_FEATURES] = {
+    [FEATURE_HEADING]    = 2,
+    [FEATURE_LIST]       = 2,
+    [FEATURE_QUOTE]      = 1,
+    [FEATURE_PROSE]      = 6,
+    [FEATURE_LINKS]      = 2,
+    [FEATURE_FOOTNOTES]  = 1,
+    [FEATURE_CODE_C]     = 1,
+    [FEATURE_CODE_DIFF]  = 1,
+    [FEATURE_CODE_PLAIN] = 1,
+  };
+
+  memcpy (mix->weights, weights, sizeof (weights));
+}
+
+/*
+ * generator_mix_parse
+ * @mix: weights to update
+ * @spec: e.g. "prose=4,c=0,footnotes=2"
+ *
+ * unnamed features keep their weight
+ */
+bool
+generator_mix_parse (GeneratorMix *mix,
+                     const char   *spec)
+{
+  while (*spec)
+    {
+      const char *eq, *end;
+      int i;
+
+      eq = strchr (spec, '=');
+      if (eq == NULL)
+        return false;
+
+      end = strchr (eq, ',');
+      if (end == NULL)
+        end = eq + strlen (eq);
+
+      for (i = 0; i < N_FEATURES; i++)
+        {
+          if (strlen (feature_names[i]) == (size_t) (eq - spec) &&
+              strncmp (feature_names[i], spec, eq - spec) == 0)
+            break;
+        }
+
+      if (i == N_FEATURES)
+        return false;
+
+      mix->weights[i] = strtoul (eq + 1, NULL, 10);
+
+      spec = *end ? end + 1 : end;
+    }
+
+  return true;
+}
+
+/*
+ * generate_markdown
+ * @seed: same seed, same document
+ * @size: approximate document size in bytes
+ * @mix: feature weights
+ * @len: (out) actual size
+ */
+char *
+generate_markdown (uint64_t            seed,
+                   size_t              size,
+                   const GeneratorMix *mix,
+                   size_t             *len)
+{
+  Generator gen = { 0 };
+  unsigned int total = 0;
+
+  gen.state = seed ? seed : 1;
+  strbuf_init (&gen.buf, size + 4096);
+
+  for (int i = 0; i < N_FEATURES; i++)
+    total += mix->weights[i];
+
+  strbuf_append (&gen.buf, "# Generated document\n\n");
+
+  while (total != 0 && gen.buf.len < size)
+    {
+      size_t pick = random_below (&gen, total);
+      int feature = 0;
+
+      while (pick >= mix->weights[feature])
+        pick -= mix->weights[feature++];
+
+      generate_feature (&gen, feature);
+    }
+
+  *len = gen.buf.len;
+
+  return strbuf_steal (&gen.buf);
+}
@@ -0,0 +1,56 @@
+/* generate.h
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Keep order in-sync with feature_names in generate.c
+ */
+typedef enum {
+  FEATURE_HEADING,
+  FEATURE_LIST,
+  FEATURE_QUOTE,
+  FEATURE_PROSE,       /* emphasis-dense paragraphs */
+  FEATURE_LINKS,       /* links and images */
+  FEATURE_FOOTNOTES,
+  FEATURE_CODE_C,
+  FEATURE_CODE_DIFF,
+  FEATURE_CODE_PLAIN,
+  N_FEATURES,
+} Feature;
+
+/* relative weight of every feature */
+typedef struct {
+  unsigned int weights[N_FEATURES];
+} GeneratorMix;
+
+
+void  generator_mix_default (GeneratorMix *mix);
+bool  generator_mix_parse   (GeneratorMix *mix,
+                             const char   *spec);
+char *generate_markdown     (uint64_t            seed,
+                             size_t              size,
+                             const GeneratorMix *mix,
+                             size_t             *len);
@@ -0,0 +1,520 @@
+/* main.c
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+/*
+ * md2html-bench
+ *
+ * Microbenchmarks and end-to-end runs over a seeded synthetic corpus;
+ * results go to stdout as JSON so runs can be compared across commits.
+ */
+
+#include "generate.h"
+#include "events.h"
+#include "footnotes.h"
+#include "html.h"
+#include "md.h"
+#include "params.h"
+#include "stats.h"
+#include "syntax.h"
+#include "uuid.h"
+#include "xml.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_SIZE        (4 * 1024 * 1024)
+#define DEFAULT_SEED        42
+#define DEFAULT_MIN_TIME_MS 500
+#define N_FOOTNOTES         100000
+
+typedef struct {
+  char   *doc;       /* generated markdown */
+  size_t  doc_len;
+
+  char  **lines;     /* doc split into NUL-terminated lines */
+  size_t  n_lines;
+
+  char   *c_code;    /* body of one big C code block */
+  size_t  c_code_len;
+  char   *diff;      /* body of one big diff code block */
+  size_t  diff_len;
+  char   *scratch;   /* writable copy / sanitize destination */
+
+  Footnotes *notes;
+} BenchInput;
+
+typedef size_t (*BenchFunc) (BenchInput *input);
+
+static const char *filter = NULL;
+static double min_time_ms = DEFAULT_MIN_TIME_MS;
+static bool first_result = true;
+
+static double
+now_ms (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+/*
+ * run_bench
+ * @name
+ * @func: one iteration; returns bytes processed
+ * @input
+ *
+ * repeats @func for at least min_time_ms and prints a JSON result
+ */
+static void
+run_bench (const char *name,
+           BenchFunc   func,
+           BenchInput *input)
+{
+  uint64_t allocs, alloc_bytes;
+  size_t bytes = 0, iterations = 0;
+  double start, elapsed;
+
+  if (filter != NULL && strstr (name, filter) == NULL)
+    return;
+
+  /* warm up */
+  func (input);
+
+  allocs = stats_get (STATS_COUNTER_ALLOCS);
+  alloc_bytes = stats_get (STATS_COUNTER_ALLOC_BYTES);
+  start = now_ms ();
+
+  do
+    {
+      bytes += func (input);
+      iterations++;
+      elapsed = now_ms () - start;
+    }
+  while (elapsed < min_time_ms);
+
+  allocs = stats_get (STATS_COUNTER_ALLOCS) - allocs;
+  alloc_bytes = stats_get (STATS_COUNTER_ALLOC_BYTES) - alloc_bytes;
+
+  printf ("%s\n    {\"name\":\"%s\",\"iterations\":%zu,\"bytes\":%zu,"
+          "\"mb_per_s\":%.2f,\"ns_per_byte\":%.3f,"
+          "\"allocs_per_iter\":%.1f,\"alloc_bytes_per_iter\":%.1f}",
+          first_result ? "" : ",", name, iterations, bytes / iterations,
+          bytes / (elapsed / 1e3) / (1024 * 1024),
+          elapsed * 1e6 / bytes,
+          (double) allocs / iterations, (double) alloc_bytes / iterations);
+  fflush (stdout);
+
+  first_result = false;
+}
+
+static size_t
+bench_find_md_unit_type (BenchInput *input)
+{
+  size_t bytes = 0;
+  volatile UnitType sink;
+
+  for (size_t i = 0; i < input->n_lines; i++)
+    {
+      sink = find_md_unit_type (input->lines[i]);
+      bytes += strlen (input->lines[i]);
+    }
+
+  (void) sink;
+  return bytes;
+}
+
+static size_t
+bench_format_text (BenchInput *input)
+{
+  size_t bytes = 0;
+
+  for (size_t i = 0; i < input->n_lines; i++)
+    {
+      char *line = input->lines[i];
+
+      if (find_md_unit_type (line) != UNIT_TYPE_TEXT)
+        continue;
+
+      free (format_text (line, input->notes, NULL));
+      bytes += strlen (line);
+    }
+
+  return bytes;
+}
+
+static size_t
+bench_highlight_keywords (BenchInput *input)
+{
+  free (syntax_highlight (input->c_code, LANG_C));
+
+  return input->c_code_len;
+}
+
+static size_t
+bench_highlight_diff (BenchInput *input)
+{
+  /* highlight_diff tokenizes in place */
+  memcpy (input->scratch, input->diff, input->diff_len + 1);
+  free (syntax_highlight (input->scratch, LANG_DIFF));
+
+  return input->diff_len;
+}
+
+static size_t
+bench_xml_sanitize_strcpy (BenchInput *input)
+{
+  xml_sanitize_strcpy (input->scratch, input->doc, input->doc_len);
+
+  return input->doc_len;
+}
+
+static size_t
+bench_footnotes_get_ref (BenchInput *input)
+{
+  char identifier[32];
+  size_t bytes = 0;
+
+  for (size_t i = 0; i < N_FOOTNOTES; i++)
+    {
+      int len;
+
+      len = snprintf (identifier, sizeof (identifier), "n%zu", (i * 7919) % N_FOOTNOTES);
+      if (footnotes_get_ref (input->notes, identifier) == NULL)
+        abort ();
+
+      bytes += len;
+    }
+
+  return bytes;
+}
+
+static size_t
+bench_footnotes_add (BenchInput *input)
+{
+  Footnotes *notes;
+  char identifier[32];
+
+  (void) input;
+
+  notes = footnotes_new ();
+
+  for (size_t i = 0; i < N_FOOTNOTES; i++)
+    {
+      snprintf (identifier, sizeof (identifier), "n%zu", i);
+      footnotes_add (notes, identifier, "text");
+    }
+
+  footnotes_free (notes);
+
+  return N_FOOTNOTES;
+}
+
+static size_t
+bench_end_to_end (BenchInput *input)
+{
+  Params params = { 0 };
+  MD *md;
+  HTML *html;
+
+  params.o_file = "/dev/null";
+  params.document = true;
+
+  md = parse_md_buffer (input->doc, input->doc_len);
+  html = html_from_md (md, &params);
+  flush_html (html);
+
+  html_free (html);
+  md_free (md);
+
+  return input->doc_len;
+}
+
+/* end_to_end with --minify */
+static size_t
+bench_end_to_end_minify (BenchInput *input)
+{
+  Params params = { 0 };
+  MD *md;
+  HTML *html;
+
+  params.o_file = "/dev/null";
+  params.document = true;
+  params.minify = true;
+
+  md = parse_md_buffer (input->doc, input->doc_len);
+  html = html_from_md (md, &params);
+  flush_html (html);
+
+  html_free (html);
+  md_free (md);
+
+  return input->doc_len;
+}
+
+static size_t
+bench_parse_md (BenchInput *input)
+{
+  Params params = { 0 };
+  MD *md;
+
+  md = parse_md_buffer (input->doc, input->doc_len);
+
+  /* HTML takes ownership of the content */
+  html_free (html_from_md (md, &params));
+  md_free (md);
+
+  return input->doc_len;
+}
+
+static void
+count_block (const MDBlock *block,
+             void          *user_data)
+{
+  (void) block;
+  (*(size_t *) user_data)++;
+}
+
+static void
+count_span (const MDSpan *span,
+            void         *user_data)
+{
+  (void) span;
+  (*(size_t *) user_data)++;
+}
+
+static void
+count_text (const char *text,
+            size_t      len,
+            void       *user_data)
+{
+  (void) text;
+  *(size_t *) user_data += len;
+}
+
+/* parse plus the event walk, i.e. end_to_end without the rendering */
+static size_t
+bench_md_walk (BenchInput *input)
+{
+  MDEvents events = {
+    .enter_block = count_block,
+    .enter_span  = count_span,
+    .text        = count_text,
+  };
+  Params params = { 0 };
+  size_t count = 0;
+  MD *md;
+
+  md = parse_md_buffer (input->doc, input->doc_len);
+  md_walk (md, &events, &count);
+
+  html_free (html_from_md (md, &params));
+  md_free (md);
+
+  return input->doc_len;
+}
+
+static char *
+code_block (uint64_t  seed,
+            size_t    size,
+            Feature   feature,
+            size_t   *len)
+{
+  GeneratorMix mix = { 0 };
+  StrBuf buf;
+  char *doc, *line;
+  size_t doc_len;
+
+  mix.weights[feature] = 1;
+  doc = generate_markdown (seed, size, &mix, &doc_len);
+
+  /* glue all block bodies together, leading newline included */
+  strbuf_init (&buf, doc_len);
+  strbuf_append_c (&buf, '\n');
+
+  for (line = strtok (doc, "\n"); line != NULL; line = strtok (NULL, "\n"))
+    {
+      if (line[0] == '#' || strncmp (line, "```", 3) == 0)
+        continue;
+
+      strbuf_append (&buf, line);
+      strbuf_append_c (&buf, '\n');
+    }
+
+  free (doc);
+  *len = buf.len;
+
+  return strbuf_steal (&buf);
+}
+
+static void
+input_init (BenchInput         *input,
+            uint64_t            seed,
+            size_t              size,
+            const GeneratorMix *mix)
+{
+  char identifier[32];
+  char *copy, *line;
+  size_t n = 0;
+
+  input->doc = generate_markdown (seed, size, mix, &input->doc_len);
+
+  /* lines */
+  copy = strdup (input->doc);
+  for (char *ptr = copy; *ptr; ptr++)
+    n += *ptr == '\n';
+
+  input->lines = malloc (sizeof (char *) * (n + 1));
+  input->n_lines = 0;
+
+  for (line = strtok (copy, "\n"); line != NULL; line = strtok (NULL, "\n"))
+    input->lines[input->n_lines++] = strdup (line);
+  free (copy);
+
+  input->c_code = code_block (seed, size, FEATURE_CODE_C, &input->c_code_len);
+  input->diff = code_block (seed, size, FEATURE_CODE_DIFF, &input->diff_len);
+
+  n = input->doc_len * 6;
+  if (n < input->diff_len + 1)
+    n = input->diff_len + 1;
+  input->scratch = malloc (n + 1);
+
+  /* the [^nK] references of the generated doc resolve against these */
+  input->notes = footnotes_new ();
+  for (size_t i = 0; i < N_FOOTNOTES; i++)
+    {
+      snprintf (identifier, sizeof (identifier), "n%zu", i);
+      footnotes_add (input->notes, identifier, "text");
+    }
+}
+
+static void
+input_free (BenchInput *input)
+{
+  for (size_t i = 0; i < input->n_lines; i++)
+    free (input->lines[i]);
+
+  free (input->lines);
+  free (input->doc);
+  free (input->c_code);
+  free (input->diff);
+  free (input->scratch);
+  footnotes_free (input->notes);
+}
+
+static void
+print_usage (char *binary)
+{
+  printf ("Usage: %s [OPTIONS]\n"
+  "Benchmark md2html on a synthetic markdown corpus\n"
+  "\n"
+  "Optional arguments:\n"
+  "  --size BYTES         size of the generated document\n"
+  "  --seed N             generator seed\n"
+  "  --mix SPEC           feature weights, e.g. prose=4,c=0,footnotes=2\n"
+  "                       (heading, list, quote, prose, links, footnotes,\n"
+  "                        c, diff, plain)\n"
+  "  --filter NAME        only run benchmarks whose name contains NAME\n"
+  "  --min-time MS        minimum time per benchmark\n"
+  "  --generate           write the generated document to stdout and exit\n"
+  "  -h, --help           display this message\n", binary);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  BenchInput input = { 0 };
+  GeneratorMix mix;
+  size_t size = DEFAULT_SIZE;
+  uint64_t seed = DEFAULT_SEED;
+  bool generate = false;
+
+  generator_mix_default (&mix);
+
+  for (int i = 1; i < argc; i++)
+    {
+      bool has_value = i + 1 < argc;
+
+      if (strcmp (argv[i], "--size") == 0 && has_value)
+        size = strtoull (argv[++i], NULL, 10);
+      else if (strcmp (argv[i], "--seed") == 0 && has_value)
+        seed = strtoull (argv[++i], NULL, 10);
+      else if (strcmp (argv[i], "--mix") == 0 && has_value)
+        {
+          if (!generator_mix_parse (&mix, argv[++i]))
+            {
+              fprintf (stderr, "%s: invalid mix '%s'\n", argv[0], argv[i]);
+              return 1;
+            }
+        }
+      else if (strcmp (argv[i], "--filter") == 0 && has_value)
+        filter = argv[++i];
+      else if (strcmp (argv[i], "--min-time") == 0 && has_value)
+        min_time_ms = strtod (argv[++i], NULL);
+      else if (strcmp (argv[i], "--generate") == 0)
+        generate = true;
+      else
+        {
+          print_usage (argv[0]);
+          return strcmp (argv[i], "-h") && strcmp (argv[i], "--help");
+        }
+    }
+
+  if (generate)
+    {
+      char *doc;
+      size_t len;
+
+      doc = generate_markdown (seed, size, &mix, &len);
+      fwrite (doc, 1, len, stdout);
+      free (doc);
+
+      return 0;
+    }
+
+  uuid_init ();
+  input_init (&input, seed, size, &mix);
+  stats_enable ();
+
+  printf ("{\"seed\":%lu,\"size\":%zu,\"results\":[",
+          (unsigned long) seed, input.doc_len);
+
+  run_bench ("find_md_unit_type", bench_find_md_unit_type, &input);
+  run_bench ("format_text", bench_format_text, &input);
+  run_bench ("highlight_keywords", bench_highlight_keywords, &input);
+  run_bench ("highlight_diff", bench_highlight_diff, &input);
+  run_bench ("xml_sanitize_strcpy", bench_xml_sanitize_strcpy, &input);
+  run_bench ("footnotes_get_ref", bench_footnotes_get_ref, &input);
+  run_bench ("footnotes_add", bench_footnotes_add, &input);
+  run_bench ("parse_md", bench_parse_md, &input);
+  run_bench ("md_walk", bench_md_walk, &input);
+  run_bench ("end_to_end", bench_end_to_end, &input);
+  run_bench ("end_to_end_minify", bench_end_to_end_minify, &input);
+
+  printf ("\n]}\n");
+
+  input_free (&input);
+
+  return 0;
+}
@@ -0,0 +1,84 @@
+#!/bin/bash
+
+# Rendering from a saved AST must match rendering from the source, and
+# a damaged AST must be refused rather than rendered.
+
+BINARY="./build/src/md2html"
+TESTS_FILE_DIR="./tests"
+TMP_DIR=$(mktemp -d)
+
+failed=0
+
+# footnote anchors get fresh uuids on every run
+mask () {
+	sed -E 's/[0-9a-f]{8}-[0-9a-f]{4}-[0-9a-f]{4}-[0-9a-f]{4}-[0-9a-f]{12}/UUID/g' $1
+}
+
+for md in "$TESTS_FILE_DIR"/*.md; do
+	$BINARY -i $md -o $TMP_DIR/source.html
+	$BINARY -i $md --emit-ast $TMP_DIR/doc.ast
+	$BINARY -i $TMP_DIR/doc.ast --from-ast -o $TMP_DIR/ast.html
+
+	if ! diff <(mask $TMP_DIR/source.html) <(mask $TMP_DIR/ast.html) > /dev/null; then
+		echo "$md: output differs when rendered from the AST"
+		failed=1
+	fi
+
+	# pipes can't be mapped
+	cat $TMP_DIR/doc.ast | $BINARY -i /dev/stdin --from-ast -o $TMP_DIR/ast.html
+	if ! diff <(mask $TMP_DIR/source.html) <(mask $TMP_DIR/ast.html) > /dev/null; then
+		echo "$md: output differs when the AST is read from stdin"
+		failed=1
+	fi
+done
+
+check_refused () {
+	$BINARY -i $TMP_DIR/bad.ast --from-ast -o $TMP_DIR/out.html 2> /dev/null
+	status=$?
+	if [ $status -ne 1 ] || [ -e $TMP_DIR/out.html ]; then
+		echo "$1: exit status $status"
+		failed=1
+	fi
+	rm -f $TMP_DIR/out.html
+}
+
+$BINARY -i $TESTS_FILE_DIR/footnotes.md --emit-ast $TMP_DIR/doc.ast
+size=$(stat -c %s $TMP_DIR/doc.ast)
+
+head -c $((size - 1)) $TMP_DIR/doc.ast > $TMP_DIR/bad.ast
+check_refused "truncated AST"
+
+cp $TESTS_FILE_DIR/footnotes.md $TMP_DIR/bad.ast
+check_refused "markdown passed as an AST"
+
+# bump the version
+{ head -c 8 $TMP_DIR/doc.ast; printf '\x63\x00\x00\x00'; tail -c +13 $TMP_DIR/doc.ast; } > $TMP_DIR/bad.ast
+check_refused "unknown AST version"
+
+# units of a one-block doc, patched in place
+printf '```\nint x;\n```\n' > $TMP_DIR/code.md
+$BINARY -i $TMP_DIR/code.md --emit-ast $TMP_DIR/code.ast
+patch_unit () {
+	python3 - $TMP_DIR/code.ast $TMP_DIR/bad.ast "$1" <<'PY'
+import struct, sys
+data = bytearray(open(sys.argv[1], "rb").read())
+n_units, n_notes, blob_size = struct.unpack_from("=QQQ", data, 16)
+unit = len(data) - blob_size - 32 * (n_units + n_notes)
+content, content_len = struct.unpack_from("=QQ", data, unit + 16)
+if sys.argv[3] == "empty":
+    struct.pack_into("=QQ", data, unit + 16, 2**64 - 1, 0)
+else:
+    data[len(data) - blob_size + content + 2] = 0
+open(sys.argv[2], "wb").write(data)
+PY
+}
+
+patch_unit empty
+check_refused "code block without content"
+
+patch_unit nul
+check_refused "NUL within a string"
+
+rm -rf $TMP_DIR
+
+exit $failed
@@ -0,0 +1,52 @@
+#!/bin/bash
+
+# --book renders chapters as one doc: a one-chapter book is the chapter
+# on its own, footnote identifiers are resolved within their chapter and
+# the notes are numbered through the book.
+
+BINARY="./build/src/md2html"
+TMP_DIR=$(mktemp -d)
+UUID='s/[0-9a-f]{8}-[0-9a-f]{4}-[0-9a-f]{4}-[0-9a-f]{4}-[0-9a-f]{12}/UUID/g'
+
+failed=0
+
+for md in tests/*.md; do
+	$BINARY -i $md -o $TMP_DIR/page.html
+	$BINARY -o $TMP_DIR/book.html --book $md
+	if ! cmp -s <(sed -E "$UUID" $TMP_DIR/page.html) <(sed -E "$UUID" $TMP_DIR/book.html); then
+		echo "$md: one-chapter book differs"
+		failed=1
+	fi
+done
+
+printf '# Book\none [^1], two [^a]\n\n[^1]: one\n[^a]: two\n' > $TMP_DIR/ch1.md
+printf '## Two\nthree [^1] and [^a]\n\n[^1]: three\n' > $TMP_DIR/ch2.md
+
+for jobs in 1 2; do
+	$BINARY -j $jobs -o $TMP_DIR/book.html -f html -f text=$TMP_DIR/book.txt \
+		--book $TMP_DIR/ch1.md $TMP_DIR/ch2.md
+
+	# [^a] of the second chapter is not the one of the first
+	expected="three [3] and [?]"
+	if ! grep -qF "$expected" $TMP_DIR/book.txt; then
+		echo "-j $jobs: references are not resolved per chapter"
+		failed=1
+	fi
+
+	if [ "$(grep -c '<p id="fn-' $TMP_DIR/book.html)" != 3 ] ||
+	   [ "$(grep -c '<title>Book</title>' $TMP_DIR/book.html)" != 1 ]; then
+		echo "-j $jobs: not one doc with three notes"
+		failed=1
+	fi
+done
+
+rm -f $TMP_DIR/book.html
+$BINARY -o $TMP_DIR/book.html --book $TMP_DIR/ch1.md $TMP_DIR/missing.md 2>/dev/null
+if [ $? -ne 1 ] || [ -f $TMP_DIR/book.html ]; then
+	echo "missing chapter: expected exit status 1 and no doc"
+	failed=1
+fi
+
+rm -rf $TMP_DIR
+
+exit $failed
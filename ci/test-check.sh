@@ -0,0 +1,67 @@
+#!/bin/bash
+
+# --check reports problems as FILE:LINE: message and writes nothing: the
+# sample docs are clean, a broken doc gets one line per problem, in line
+# order, and the exit status says whether there were any.
+
+BINARY="./build/src/md2html"
+TMP_DIR=$(mktemp -d)
+
+failed=0
+
+if ! $BINARY --check tests/*.md > $TMP_DIR/report; then
+	echo "sample docs: unexpected problems"
+	cat $TMP_DIR/report
+	failed=1
+fi
+
+mkdir $TMP_DIR/docs
+touch $TMP_DIR/docs/guide.md "$TMP_DIR/docs/my file.md"
+cat > $TMP_DIR/docs/broken.md <<'EOF'
+# Broken
+[guide](guide.md), [spaced](my%20file.md#top), [web](https://example.com), [top](#top)
+[gone](gone.md) and ![logo](img/logo.png)
+one[^1], two[^2]
+[^1]: one
+[^1]: one again
+```c
+int main (void) {
+EOF
+
+cat > $TMP_DIR/expected <<EOF
+$TMP_DIR/docs/broken.md:3: link target 'gone.md' doesn't exist
+$TMP_DIR/docs/broken.md:3: image 'img/logo.png' doesn't exist
+$TMP_DIR/docs/broken.md:4: footnote [^2] is not defined
+$TMP_DIR/docs/broken.md:6: footnote [^1] is defined again; the one on line 5 is used
+$TMP_DIR/docs/broken.md:7: code fence is never closed
+EOF
+
+for jobs in 1 3; do
+	$BINARY -j $jobs --check tests/*.md $TMP_DIR/docs/broken.md tests/*.md > $TMP_DIR/report
+	if [ $? -ne 1 ] || ! diff -u $TMP_DIR/expected $TMP_DIR/report; then
+		echo "-j $jobs: expected exit status 1 and the problems above"
+		failed=1
+	fi
+done
+
+# unclosed fence of a verbatim block, which points into the input
+printf 'text\n```\nopen\n' > $TMP_DIR/fence.md
+if [ "$($BINARY --check $TMP_DIR/fence.md)" != "$TMP_DIR/fence.md:2: code fence is never closed" ]; then
+	echo "unclosed verbatim fence: not reported"
+	failed=1
+fi
+
+$BINARY --check $TMP_DIR/missing.md > $TMP_DIR/report
+if [ $? -ne 1 ] || ! grep -q "^$TMP_DIR/missing.md: " $TMP_DIR/report; then
+	echo "missing file: expected exit status 1 and a report"
+	failed=1
+fi
+
+if [ -n "$(ls $TMP_DIR/docs | grep -v '\.md$')" ]; then
+	echo "--check wrote output"
+	failed=1
+fi
+
+rm -rf $TMP_DIR
+
+exit $failed
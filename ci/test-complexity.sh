@@ -0,0 +1,23 @@
+#!/bin/bash
+
+# Replays the fuzz corpus; every input must finish within its time budget
+# (see fuzz/fuzz.h), so a scan that turns quadratic again fails here.
+
+BUILD_DIR="./build/fuzz"
+CORPUS_DIR="./fuzz/corpus"
+
+failed=0
+
+for corpus in "$CORPUS_DIR"/*; do
+	target=$(basename $corpus)
+	$BUILD_DIR/replay-$target $corpus
+	if [ $? -ne 0 ]; then
+		failed=1
+	fi
+done
+
+if [ $failed -eq 1 ]; then
+	exit 1
+else
+	exit 0
+fi
@@ -0,0 +1,76 @@
+#!/bin/bash
+
+# gzip and zstd input is decompressed while it's parsed; the HTML must be
+# the same as for the plain file, and broken input must fail.
+
+BINARY="./build/src/md2html"
+TMP_DIR=$(mktemp -d)
+UUID='s/[0-9a-f]{8}-[0-9a-f]{4}-[0-9a-f]{4}-[0-9a-f]{4}-[0-9a-f]{12}/UUID/g'
+
+failed=0
+
+# footnote ids are random
+same () {
+	if ! cmp -s <(sed -E "$UUID" $1) <(sed -E "$UUID" $2); then
+		echo "$3: output differs"
+		failed=1
+	fi
+}
+
+fails () {
+	$BINARY -i $1 -o $TMP_DIR/out.html 2>/dev/null
+	if [ $? -ne 1 ]; then
+		echo "$2: expected exit status 1"
+		failed=1
+	fi
+}
+
+cat tests/*.md > $TMP_DIR/doc.md
+$BINARY -i $TMP_DIR/doc.md -o $TMP_DIR/plain.html
+
+codecs="gzip"
+if command -v zstd >/dev/null; then
+	codecs="$codecs zstd"
+fi
+
+for codec in $codecs; do
+	ext=$([ $codec = gzip ] && echo gz || echo zst)
+
+	$codec -c $TMP_DIR/doc.md > $TMP_DIR/doc.md.$ext
+
+	# optional at build time
+	if $BINARY -i $TMP_DIR/doc.md.$ext -o $TMP_DIR/out.html 2>&1 | grep -q "built without"; then
+		echo "$codec: not built in, skipped"
+		continue
+	fi
+
+	same $TMP_DIR/plain.html $TMP_DIR/out.html "$codec"
+
+	# streams of several members/frames, and input that can't be mapped
+	(head -c 1000 $TMP_DIR/doc.md | $codec -c; tail -c +1001 $TMP_DIR/doc.md | $codec -c) > $TMP_DIR/multi.$ext
+	$BINARY -i /dev/stdin -o $TMP_DIR/out.html < $TMP_DIR/multi.$ext
+	same $TMP_DIR/plain.html $TMP_DIR/out.html "$codec, concatenated"
+
+	head -c 500 $TMP_DIR/doc.md.$ext > $TMP_DIR/truncated.$ext
+	fails $TMP_DIR/truncated.$ext "$codec, truncated"
+
+	python3 -c "import sys; d = bytearray(open(sys.argv[1], 'rb').read()); d[len(d) // 2] ^= 0xff; sys.stdout.buffer.write(d)" \
+		$TMP_DIR/doc.md.$ext > $TMP_DIR/corrupt.$ext
+	fails $TMP_DIR/corrupt.$ext "$codec, corrupt"
+
+	# the compressed size is reported
+	$BINARY -i $TMP_DIR/doc.md.$ext -o $TMP_DIR/out.html --stats=json 2> $TMP_DIR/stats.json
+	if ! grep -q "\"compressed_bytes_in\":$(stat -c %s $TMP_DIR/doc.md.$ext)," $TMP_DIR/stats.json ||
+	   ! grep -q '"decompress_mb_s"' $TMP_DIR/stats.json; then
+		echo "$codec: --stats misses the decompression"
+		failed=1
+	fi
+done
+
+# plain input through a pipe
+$BINARY -i /dev/stdin -o $TMP_DIR/out.html < $TMP_DIR/doc.md
+same $TMP_DIR/plain.html $TMP_DIR/out.html "plain, piped"
+
+rm -rf $TMP_DIR
+
+exit $failed
@@ -0,0 +1,80 @@
+#!/bin/bash
+
+# --inline-css embeds the stylesheet, minified, in <style>; --css-cache
+# keeps the minified result on disk, along with the stylesheet it was
+# made from.
+
+BINARY="./build/src/md2html"
+TMP_DIR=$(mktemp -d)
+
+failed=0
+
+cat > $TMP_DIR/style.css <<'CSS'
+/* page */
+body {
+  margin: 0 auto;
+  font-family: "Helvetica Neue" , sans-serif;
+}
+a :hover, a:focus > b { color: red !important ; }
+@media screen and (min-width: 600px) { p { width: calc(100% - 2em); } }
+q::after { content: "</style> /* kept */"; }
+CSS
+
+MINIFIED='body{margin:0 auto;font-family:"Helvetica Neue",sans-serif}a :hover,a:focus>b{color:red !important}@media screen and (min-width:600px){p{width:calc(100% - 2em)}}q::after{content:"<\/style> /* kept */"}'
+
+printf '# Styled\ntext\n' > $TMP_DIR/doc.md
+
+check () {
+	if ! grep -qF "$1" $TMP_DIR/doc.html; then
+		echo "$2: missing: $1"
+		failed=1
+	fi
+}
+
+$BINARY -i $TMP_DIR/doc.md -o $TMP_DIR/doc.html -s $TMP_DIR/style.css --inline-css
+check "<style>$MINIFIED</style>" "inline"
+if grep -q '<link' $TMP_DIR/doc.html; then
+	echo "inline: stylesheet is linked too"
+	failed=1
+fi
+
+# the cache is filled on the first run and read on the second
+for run in first cached; do
+	$BINARY -i $TMP_DIR/doc.md -o $TMP_DIR/doc.html -s $TMP_DIR/style.css --css-cache $TMP_DIR/cache
+	check "<style>$MINIFIED</style>" "$run run"
+done
+
+if [ $(ls $TMP_DIR/cache | wc -l) -ne 1 ]; then
+	echo "expected one cached stylesheet"
+	failed=1
+fi
+
+cache=$(ls $TMP_DIR/cache/*.css)
+{ cat $TMP_DIR/style.css; echo -n 'p{}'; } > $cache
+$BINARY -i $TMP_DIR/doc.md -o $TMP_DIR/doc.html -s $TMP_DIR/style.css --css-cache $TMP_DIR/cache
+check "<style>p{}</style>" "cache hit"
+
+# a cache file of another source is not used, even under the same name
+{ tr 'a-z' 'b-za' < $TMP_DIR/style.css; echo -n 'p{}'; } > $cache
+$BINARY -i $TMP_DIR/doc.md -o $TMP_DIR/doc.html -s $TMP_DIR/style.css --css-cache $TMP_DIR/cache
+check "<style>$MINIFIED</style>" "cache file of another source"
+
+# a changed stylesheet is another cache entry
+echo 'p { color : blue ; }' > $TMP_DIR/style.css
+$BINARY -i $TMP_DIR/doc.md -o $TMP_DIR/doc.html -s $TMP_DIR/style.css --css-cache $TMP_DIR/cache
+check "<style>p{color:blue}</style>" "changed stylesheet"
+
+# a stylesheet that can't be read is an error
+$BINARY -i $TMP_DIR/doc.md -o $TMP_DIR/doc.html -s $TMP_DIR/none.css --inline-css 2>/dev/null
+if [ $? -ne 1 ]; then
+	echo "missing stylesheet: expected exit status 1"
+	failed=1
+fi
+
+# linked by default
+$BINARY -i $TMP_DIR/doc.md -o $TMP_DIR/doc.html -s style.css
+check '<link rel="stylesheet" href="style.css">' "default"
+
+rm -rf $TMP_DIR
+
+exit $failed
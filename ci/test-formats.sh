@@ -0,0 +1,41 @@
+#!/bin/bash
+
+# -f renders one parse into several formats: the html backend must match
+# the plain conversion, ansi must not pass the document's control
+# characters to the terminal, and a format that can't be written is an
+# error.
+
+BINARY="./build/src/md2html"
+TMP_DIR=$(mktemp -d)
+
+failed=0
+
+for md in tests/*.md; do
+	$BINARY -i $md -o $TMP_DIR/plain.html
+	$BINARY -i $md -f html=$TMP_DIR/html.html -f text=$TMP_DIR/out.txt -f ansi=$TMP_DIR/out.ansi
+	if [ $? -ne 0 ] || ! cmp -s $TMP_DIR/plain.html $TMP_DIR/html.html; then
+		echo "$md: -f html differs from the plain conversion"
+		failed=1
+	fi
+done
+
+# only the backend's own escape sequences; the others are replaced
+printf 'a\033[31mred\007\177\302\233 \ttab\n```\n\033]0;title\007\n```\n' > $TMP_DIR/controls.md
+$BINARY -i $TMP_DIR/controls.md -f ansi=$TMP_DIR/controls.ansi
+if [ "$(tr -d '\033\t\n' < $TMP_DIR/controls.ansi | LC_ALL=C tr -d '\040-\176\200-\377' | wc -c)" -ne 0 ] ||
+   [ "$(grep -o $'\033\\[[0-9;]*m' $TMP_DIR/controls.ansi | wc -l)" -ne "$(grep -o $'\033' $TMP_DIR/controls.ansi | wc -l)" ]; then
+	echo "ansi: control characters of the document written out"
+	failed=1
+fi
+
+for format in html text ansi; do
+	$BINARY -i tests/code.md -f $format=/dev/full 2> /dev/null
+	if [ $? -ne 1 ]; then
+		echo "-f $format=/dev/full: expected exit status 1"
+		failed=1
+	fi
+done
+
+rm -rf $TMP_DIR
+
+exit $failed
@@ -0,0 +1,51 @@
+#!/bin/bash
+
+# Convert a >4 GB document holding a >2 GB code block and check that
+# nothing got truncated on the way. Needs a large-memory box.
+#
+# CODE_MB and TEXT_MB scale the synthetic input down for a quick run.
+
+BINARY="$(realpath ./build/src/md2html)"
+CODE_MB=${CODE_MB:-2200}
+TEXT_MB=${TEXT_MB:-2200}
+
+workdir=$(mktemp -d)
+trap 'rm -rf "$workdir"' EXIT
+
+cd "$workdir"
+
+# 64 MB lines keep the unit count low
+line_mb=$(( TEXT_MB < 64 ? TEXT_MB : 64 ))
+
+{
+  echo '# Huge'
+  echo '```'
+  yes 'generated log line 0123456789' | head -n $(( CODE_MB * 1024 * 1024 / 30 ))
+  echo '```'
+  for (( i = 0; i < TEXT_MB / line_mb; i++ )); do
+    head -c $(( line_mb * 1024 * 1024 )) /dev/zero | tr '\0' 'a'
+    echo
+  done
+  echo 'end of document'
+} > huge.md
+
+$BINARY -i huge.md -o huge.html || exit 1
+
+# code block body passes through untouched
+lines_in=$(( CODE_MB * 1024 * 1024 / 30 ))
+code_out=$(grep -c '^generated log line 0123456789$' huge.html)
+
+if [ "$code_out" -ne "$lines_in" ]; then
+  echo "code block: expected $lines_in lines, got $code_out"
+  exit 1
+fi
+
+text_out=$(grep -c '^	a*<br>$' huge.html)
+if [ "$text_out" -ne $(( TEXT_MB / line_mb )) ]; then
+  echo "text: expected $(( TEXT_MB / line_mb )) lines, got $text_out"
+  exit 1
+fi
+
+grep -q 'end of document' huge.html || exit 1
+
+exit 0
@@ -0,0 +1,99 @@
+#!/bin/bash
+
+# --image-sizes reads the size of local PNG, JPEG, GIF and WebP images
+# from their headers; remote and missing images only get lazy loading.
+
+BINARY="./build/src/md2html"
+TMP_DIR=$(mktemp -d)
+
+failed=0
+
+mkdir $TMP_DIR/img
+
+python3 - $TMP_DIR/img <<'PY'
+import struct, sys, zlib
+
+out = sys.argv[1]
+
+def chunk(kind, data):
+    return struct.pack('>I', len(data)) + kind + data + struct.pack('>I', zlib.crc32(kind + data))
+
+png = b'\x89PNG\r\n\x1a\n' + chunk(b'IHDR', struct.pack('>IIBBBBB', 640, 480, 8, 2, 0, 0, 0))
+png += chunk(b'IDAT', zlib.compress(b'\0' * 10)) + chunk(b'IEND', b'')
+open(out + '/a.png', 'wb').write(png)
+
+open(out + '/b.gif', 'wb').write(b'GIF89a' + struct.pack('<HH', 33, 17) + b'\0' * 20)
+
+# a big EXIF segment in front of the frame header
+exif = b'Exif\0\0' + b'\0' * 60000
+jpeg = b'\xff\xd8' + b'\xff\xe1' + struct.pack('>H', len(exif) + 2) + exif
+jpeg += b'\xff\xc2' + struct.pack('>HBHHB', 11, 8, 1080, 1920, 1) + b'\x01\x11\x00'
+jpeg += b'\xff\xd9'
+open(out + '/c.jpg', 'wb').write(jpeg)
+
+def riff(chunk):
+    return b'RIFF' + struct.pack('<I', len(chunk) + 4) + b'WEBP' + chunk
+
+vp8x = b'VP8X' + struct.pack('<I', 10) + b'\0' * 4 + struct.pack('<I', 399)[:3] + struct.pack('<I', 299)[:3]
+open(out + '/d.webp', 'wb').write(riff(vp8x))
+
+vp8 = b'VP8 ' + struct.pack('<I', 10) + b'\0\0\0' + b'\x9d\x01\x2a' + struct.pack('<HH', 200, 100)
+open(out + '/e.webp', 'wb').write(riff(vp8))
+
+bits = (50 - 1) | ((70 - 1) << 14)
+vp8l = b'VP8L' + struct.pack('<I', 5) + b'\x2f' + struct.pack('<I', bits) + b'\0'
+open(out + '/f.webp', 'wb').write(riff(vp8l))
+
+open(out + '/g.png', 'wb').write(b'not an image')
+open(out + '/h i.png', 'wb').write(png)
+PY
+
+cat > $TMP_DIR/doc.md <<'MD'
+![png](img/a.png) ![gif](img/b.gif?v=2) ![jpeg](img/c.jpg#top)
+![webp](img/d.webp) ![lossy](img/e.webp) ![lossless](img/f.webp)
+![broken](img/g.png) ![missing](img/none.png) ![remote](https://example.com/a.png)
+![escaped](img/h%20i.png)
+MD
+
+check () {
+	if ! grep -qF "$1" $TMP_DIR/doc.html; then
+		echo "missing: $1"
+		failed=1
+	fi
+}
+
+for run in first cached; do
+	$BINARY -i $TMP_DIR/doc.md -o $TMP_DIR/doc.html --image-cache $TMP_DIR/images.cache
+	if [ $? -ne 0 ]; then
+		echo "$run run failed"
+		failed=1
+	fi
+
+	check '<img src="img/a.png" alt="png" width="640" height="480" loading="lazy" decoding="async">'
+	check '<img src="img/b.gif?v=2" alt="gif" width="33" height="17"'
+	check '<img src="img/c.jpg#top" alt="jpeg" width="1920" height="1080"'
+	check '<img src="img/d.webp" alt="webp" width="400" height="300"'
+	check '<img src="img/e.webp" alt="lossy" width="200" height="100"'
+	check '<img src="img/f.webp" alt="lossless" width="50" height="70"'
+	check '<img src="img/g.png" alt="broken" loading="lazy" decoding="async">'
+	check '<img src="img/none.png" alt="missing" loading="lazy" decoding="async">'
+	check '<img src="https://example.com/a.png" alt="remote" loading="lazy" decoding="async">'
+	check '<img src="img/h%20i.png" alt="escaped" width="640" height="480"'
+done
+
+# a changed image is probed again
+python3 -c "import sys; sys.stdout.buffer.write(b'GIF87a\x05\x00\x06\x00' + b'\0' * 20)" > $TMP_DIR/img/b.gif
+touch -d '+1 minute' $TMP_DIR/img/b.gif
+$BINARY -i $TMP_DIR/doc.md -o $TMP_DIR/doc.html --image-cache $TMP_DIR/images.cache
+check '<img src="img/b.gif?v=2" alt="gif" width="5" height="6"'
+
+# off by default
+$BINARY -i $TMP_DIR/doc.md -o $TMP_DIR/doc.html
+if grep -q 'loading=' $TMP_DIR/doc.html; then
+	echo "image attributes without --image-sizes"
+	failed=1
+fi
+
+rm -rf $TMP_DIR
+
+exit $failed
@@ -0,0 +1,73 @@
+#!/bin/bash
+
+# Search indexes: every heading gets an id the index can point at, and
+# merging is associative, so per-file indexes of a parallel build can be
+# combined in any grouping.
+
+BINARY="./build/src/md2html"
+TESTS_FILE_DIR="./tests"
+TMP_DIR=$(mktemp -d)
+
+failed=0
+indexes=()
+
+for md in "$TESTS_FILE_DIR"/*.md; do
+	name=$(basename $md .md)
+	$BINARY -i $md -o $TMP_DIR/$name.html --index $TMP_DIR/$name.idx
+	if [ $? -ne 0 ]; then
+		echo "$md: indexing failed"
+		failed=1
+	fi
+
+	sections=$(grep -c '^s' $TMP_DIR/$name.idx)
+	headings=$(grep -c '<h[123] id="' $TMP_DIR/$name.html)
+	anchors=$(grep -c '^s	0	[^	]' $TMP_DIR/$name.idx)
+	if [ $anchors -ne $headings ] || [ $sections -lt $headings ]; then
+		echo "$md: $headings headings, $anchors anchors in the index"
+		failed=1
+	fi
+
+	indexes+=($TMP_DIR/$name.idx)
+done
+
+half=$((${#indexes[@]} / 2))
+$BINARY --merge-index $TMP_DIR/all.idx "${indexes[@]}"
+$BINARY --merge-index $TMP_DIR/first.idx "${indexes[@]:0:$half}"
+$BINARY --merge-index $TMP_DIR/second.idx "${indexes[@]:$half}"
+$BINARY --merge-index $TMP_DIR/halves.idx $TMP_DIR/first.idx $TMP_DIR/second.idx
+
+if ! cmp -s $TMP_DIR/all.idx $TMP_DIR/halves.idx; then
+	echo "merging the halves differs from merging all indexes at once"
+	failed=1
+fi
+
+docs=$(grep -c '^d' $TMP_DIR/all.idx)
+if [ $docs -ne ${#indexes[@]} ]; then
+	echo "merged index has $docs docs, expected ${#indexes[@]}"
+	failed=1
+fi
+
+# terms ascend, so a bad input can't be merged silently
+{ head -1 ${indexes[0]}; grep -v '^t' ${indexes[0]} | tail -n +2; grep '^t' ${indexes[0]} | sort -r; } > $TMP_DIR/bad.idx
+$BINARY --merge-index $TMP_DIR/out.idx $TMP_DIR/bad.idx 2> /dev/null
+if [ $? -ne 1 ] || [ -e $TMP_DIR/out.idx ]; then
+	echo "unsorted index was merged"
+	failed=1
+fi
+
+# case is folded beyond ASCII, in terms and anchors alike
+printf '# Ärger über ÉCOLE\nÄRGER Straße STRASSE Ωμέγα ΩΜΈΓΑ Москва МОСКВА\n' > $TMP_DIR/utf8.md
+$BINARY -i $TMP_DIR/utf8.md -o $TMP_DIR/utf8.html --index $TMP_DIR/utf8.idx
+terms=$(grep '^t' $TMP_DIR/utf8.idx | cut -f 2 | tr '\n' ' ')
+if [ "$terms" != "strasse straße ärger école über ωμέγα москва " ]; then
+	echo "utf-8 terms not folded: $terms"
+	failed=1
+fi
+if ! grep -q 'id="ärger-über-école"' $TMP_DIR/utf8.html; then
+	echo "utf-8 heading anchor not folded"
+	failed=1
+fi
+
+rm -rf $TMP_DIR
+
+exit $failed
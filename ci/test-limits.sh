@@ -0,0 +1,79 @@
+#!/bin/bash
+
+# Each limit must stop the conversion with exit status 3 and leave no
+# partial output behind.
+
+BINARY="./build/src/md2html"
+TMP_DIR=$(mktemp -d)
+
+failed=0
+
+python3 -c "print('x' * 300000)" > $TMP_DIR/long-line.md
+python3 -c "print('[^x]: note'); print(' '.join(['[^x]'] * 5000))" > $TMP_DIR/referrers.md
+python3 -c "[print('[^n%d]: note' % i) for i in range(2000)]" > $TMP_DIR/footnotes.md
+python3 -c "[print('- item %d' % i) for i in range(200000)]" > $TMP_DIR/units.md
+
+check () {
+	$BINARY -i $TMP_DIR/$1 -o $TMP_DIR/out.html --limit $2
+	status=$?
+	if [ $status -ne 3 ] || [ -e $TMP_DIR/out.html ]; then
+		echo "$1 --limit $2: exit status $status"
+		failed=1
+	fi
+	rm -f $TMP_DIR/out.html
+}
+
+check long-line.md line=64k
+check long-line.md input=100k
+check referrers.md referrers=100
+check footnotes.md footnotes=10
+check units.md units=1000
+check units.md output=64k
+check units.md time=1
+
+# stdin goes through the FILE reader
+cat $TMP_DIR/long-line.md | $BINARY -i /dev/stdin -o $TMP_DIR/out.html --limit line=1k
+status=$?
+if [ $status -ne 3 ]; then
+	echo "stdin --limit line=1k: exit status $status"
+	failed=1
+fi
+
+# within the limits nothing changes
+$BINARY -i $TMP_DIR/units.md -o $TMP_DIR/out.html --limit line=1k --limit units=1m
+if [ $? -ne 0 ]; then
+	echo "units.md: conversion within limits failed"
+	failed=1
+fi
+
+# tar members are converted on a pool of workers; the one that goes
+# over a limit stops the stream
+cp tests/*.md $TMP_DIR/
+(cd $TMP_DIR && tar cf in.tar *.md)
+$BINARY --tar -j 3 -i $TMP_DIR/in.tar -o $TMP_DIR/out.tar --limit units=100k
+status=$?
+if [ $status -ne 3 ] || [ -e $TMP_DIR/out.tar ]; then
+	echo "--tar -j 3 --limit units=100k: exit status $status"
+	failed=1
+fi
+
+# chapters are parsed on a pool of workers; one over a limit stops the book
+rm -f $TMP_DIR/out.html
+$BINARY -j 3 -o $TMP_DIR/out.html --limit units=100k --book $TMP_DIR/*.md
+status=$?
+if [ $status -ne 3 ] || [ -e $TMP_DIR/out.html ]; then
+	echo "--book -j 3 --limit units=100k: exit status $status"
+	failed=1
+fi
+
+# --check reports the limit on the file that hit it, and only there
+$BINARY -j 3 --limit units=100k --check $TMP_DIR/*.md > $TMP_DIR/report
+status=$?
+if [ $status -ne 3 ] || [ "$(cat $TMP_DIR/report)" != "$TMP_DIR/units.md: units limit exceeded" ]; then
+	echo "--check -j 3 --limit units=100k: exit status $status"
+	failed=1
+fi
+
+rm -rf $TMP_DIR
+
+exit $failed
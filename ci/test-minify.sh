@@ -0,0 +1,43 @@
+#!/bin/bash
+
+# --minify may only drop the whitespace the formatter adds: outside of
+# <pre>, the body of every sample doc must match the formatted one once
+# tabs and newlines are taken out, and <pre> must match as it is.
+
+BINARY="./build/src/md2html"
+TESTS_FILE_DIR="./tests"
+TMP_DIR=$(mktemp -d)
+
+failed=0
+
+for md in "$TESTS_FILE_DIR"/*.md; do
+	$BINARY -i $md -o $TMP_DIR/formatted.html
+	$BINARY -i $md -o $TMP_DIR/minified.html --minify
+
+	if ! python3 - $TMP_DIR/formatted.html $TMP_DIR/minified.html <<'PY'
+import re, sys
+
+def body(path):
+    html = open(path, encoding="utf-8").read()
+    # footnote anchors get fresh uuids on every run
+    html = re.sub(r"[0-9a-f]{8}-[0-9a-f]{4}-[0-9a-f]{4}-[0-9a-f]{4}-[0-9a-f]{12}", "UUID", html)
+    html = html[html.index("<body>"):html.index("</body>")]
+    parts = re.split(r"(<pre>.*?</pre>)", html, flags=re.S)
+    return [p if p.startswith("<pre>") else re.sub(r"[\t\n]", "", p) for p in parts]
+
+sys.exit(body(sys.argv[1]) != body(sys.argv[2]))
+PY
+	then
+		echo "$md: --minify changes more than formatting whitespace"
+		failed=1
+	fi
+
+	if [ $(stat -c %s $TMP_DIR/minified.html) -ge $(stat -c %s $TMP_DIR/formatted.html) ]; then
+		echo "$md: --minify output isn't smaller"
+		failed=1
+	fi
+done
+
+rm -rf $TMP_DIR
+
+exit $failed
@@ -0,0 +1,119 @@
+#!/bin/bash
+
+# --ndjson answers each request line with a response line: the HTML is
+# that of a conversion of its own, with the options of the request; bad
+# requests get an error and don't stop the stream; an answer doesn't wait
+# for the next request, nor for a big doc ahead of it.
+
+BINARY="./build/src/md2html"
+TMP_DIR=$(mktemp -d)
+
+python3 - "$BINARY" "$TMP_DIR" tests/*.md <<'PY'
+import json, re, signal, subprocess, sys, time
+
+# a response that isn't flushed would hang the interactive check
+signal.alarm(120)
+
+binary, tmp, docs = sys.argv[1], sys.argv[2], sys.argv[3:]
+uuid = re.compile(r"[0-9a-f]{8}-[0-9a-f]{4}-[0-9a-f]{4}-[0-9a-f]{4}-[0-9a-f]{12}")
+failed = False
+
+def fail(message):
+    global failed
+    print(message)
+    failed = True
+
+def convert(md, args):
+    subprocess.run([binary, "-i", md, "-o", tmp + "/page.html"] + args, check=True)
+    return uuid.sub("UUID", open(tmp + "/page.html", encoding="utf-8").read())
+
+def ask(requests, args=[]):
+    lines = "".join(r if isinstance(r, str) else json.dumps(r) + "\n" for r in requests)
+    run = subprocess.run([binary, "--ndjson"] + args, input=lines.encode(),
+                         capture_output=True, timeout=60)
+    if run.returncode != 0:
+        fail("exit status %d: %s" % (run.returncode, run.stderr.decode()))
+    return [json.loads(line) for line in run.stdout.decode().splitlines()]
+
+variants = [
+    ({}, []),
+    ({"title": "Title", "minify": True}, ["-t", "Title", "--minify"]),
+    ({"document": False}, ["-d"]),
+]
+
+for jobs in ["1", "4"]:
+    requests = []
+    for md in docs:
+        for v, (options, _) in enumerate(variants):
+            requests.append({"id": [md, v], "markdown": open(md, encoding="utf-8").read(),
+                             "options": options})
+
+    responses = ask(requests, ["-j", jobs])
+    if sorted(json.dumps(r["id"]) for r in responses) != sorted(json.dumps(r["id"]) for r in requests):
+        fail("-j %s: not one response per request" % jobs)
+
+    for response in responses:
+        md, v = response["id"]
+        if uuid.sub("UUID", response.get("html", "")) != convert(md, variants[v][1]):
+            fail("-j %s: %s %s differs" % (jobs, md, variants[v][1]))
+        if set(response.get("timing_ms", {})) != {"queue", "parse", "render"}:
+            fail("-j %s: %s: no timing" % (jobs, md))
+
+responses = ask(['{"id":1,"markdown":"# a"}\n',
+                 'not json\n',
+                 '\n',
+                 '{"id":2,"markdown":"x","options":{"titel":"x"}}\n',
+                 '{"id":3}\n',
+                 '{"id":4,"markdown":"caf\\u00e9 \\ud83d\\ude00 \\ud800","options":{"document":false}}\n'])
+errors = {json.dumps(r["id"]): r.get("error") for r in responses}
+if errors != {"1": None, "null": "malformed JSON", "2": "unknown option 'titel'",
+              "3": "no markdown", "4": None}:
+    fail("bad requests: %s" % errors)
+if [r["html"] for r in responses if r["id"] == 4] != ["café 😀 \ufffd<br>\n"]:
+    fail("escapes not decoded")
+
+# answered before the next request comes
+proc = subprocess.Popen([binary, "--ndjson"], stdin=subprocess.PIPE, stdout=subprocess.PIPE)
+for i in range(3):
+    proc.stdin.write(b'{"id":%d,"markdown":"# %d"}\n' % (i, i))
+    proc.stdin.flush()
+    if json.loads(proc.stdout.readline())["id"] != i:
+        fail("interactive: wrong answer")
+proc.stdin.close()
+proc.wait(timeout=10)
+
+# small docs behind a big one are answered first
+big = "".join("line %d with *some* text\n" % i for i in range(200000))
+small = [{"id": i, "markdown": "# %d" % i} for i in range(10)]
+order = [r["id"] for r in ask([{"id": "big", "markdown": big}] + small, ["-j", "2"])]
+if order[-1] != "big":
+    fail("big doc holds up small ones: %s" % order)
+
+# a limit fails only the request that hits it
+responses = ask([{"id": 1, "markdown": "a"}, {"id": 2, "markdown": "a\n\nb\n\nc\n\nd"},
+                 {"id": 3, "markdown": "b"}], ["--limit", "units=2"])
+errors = {r["id"]: r.get("error") for r in responses}
+if errors != {1: None, 2: "units limit exceeded", 3: None}:
+    fail("units limit: %s" % errors)
+
+# and the time limit counts from each request, not from the start
+proc = subprocess.Popen([binary, "--ndjson", "--limit", "time=500"],
+                        stdin=subprocess.PIPE, stdout=subprocess.PIPE)
+for i in range(2):
+    if i > 0:
+        time.sleep(1)
+    proc.stdin.write(b'{"id":%d,"markdown":"# %d"}\n' % (i, i))
+    proc.stdin.flush()
+    if "html" not in json.loads(proc.stdout.readline()):
+        fail("time limit: request %d failed" % i)
+proc.stdin.close()
+if proc.wait(timeout=10) != 0:
+    fail("time limit: exit status %d" % proc.returncode)
+
+sys.exit(1 if failed else 0)
+PY
+failed=$?
+
+rm -rf $TMP_DIR
+
+exit $failed
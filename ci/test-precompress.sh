@@ -0,0 +1,72 @@
+#!/bin/bash
+
+# -z writes compressed copies of the HTML doc in the same pass; they must
+# decompress to the doc, and go away with it when a limit is hit.
+
+BINARY="./build/src/md2html"
+TMP_DIR=$(mktemp -d)
+
+failed=0
+
+cat tests/*.md > $TMP_DIR/doc.md
+
+check_copy () {
+	if ! $2 -dc $TMP_DIR/$1 2>/dev/null | cmp -s - $TMP_DIR/${1%.*}; then
+		echo "$1: doesn't decompress to the doc"
+		failed=1
+	fi
+}
+
+codecs="gzip"
+if command -v zstd >/dev/null; then
+	codecs="$codecs zstd"
+fi
+
+for codec in $codecs; do
+	ext=$([ $codec = gzip ] && echo gz || echo zst)
+
+	# optional at build time
+	if $BINARY -i $TMP_DIR/doc.md -o $TMP_DIR/doc.html -z $codec 2>&1 | grep -q "built without"; then
+		echo "$codec: not built in, skipped"
+		continue
+	fi
+
+	check_copy doc.html.$ext $codec
+
+	$BINARY -i $TMP_DIR/doc.md -o $TMP_DIR/low.html -z $codec=1
+	check_copy low.html.$ext $codec
+
+	# also with -f, for the html output
+	$BINARY -i $TMP_DIR/doc.md -f html=$TMP_DIR/fmt.html -f text=$TMP_DIR/fmt.txt -z $codec
+	check_copy fmt.html.$ext $codec
+	if [ -e $TMP_DIR/fmt.txt.$ext ]; then
+		echo "$codec: text output got a copy"
+		failed=1
+	fi
+
+	$BINARY -i $TMP_DIR/doc.md -o $TMP_DIR/limit.html -z $codec --limit output=1k 2>/dev/null
+	if [ -e $TMP_DIR/limit.html.$ext ]; then
+		echo "$codec: copy left behind after a limit"
+		failed=1
+	fi
+done
+
+# a dictionary trained on pages of a collection
+if command -v zstd >/dev/null &&
+   $BINARY --train-zstd-dict $TMP_DIR/site.dict tests/*.md tests/*.md 2>/dev/null; then
+	$BINARY -i $TMP_DIR/doc.md -o $TMP_DIR/dict.html -z zstd --zstd-dict $TMP_DIR/site.dict
+	if ! zstd -q -D $TMP_DIR/site.dict -dc $TMP_DIR/dict.html.zst | cmp -s - $TMP_DIR/dict.html; then
+		echo "zstd: copy made with a dictionary doesn't decompress to the doc"
+		failed=1
+	fi
+fi
+
+$BINARY -i $TMP_DIR/doc.md -o $TMP_DIR/doc.html -z brotli 2>/dev/null
+if [ $? -ne 1 ]; then
+	echo "unknown codec: expected exit status 1"
+	failed=1
+fi
+
+rm -rf $TMP_DIR
+
+exit $failed
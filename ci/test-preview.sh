@@ -0,0 +1,148 @@
+#!/bin/bash
+
+# --preview-server renders the pages of a directory as a conversion of
+# their own would; concurrent clients get the same pages, a page is
+# rendered once and then answered from the cache in microseconds, until
+# its file changes; ETags give 304s, and nothing outside the directory is
+# served.
+
+BINARY="./build/src/md2html"
+TMP_DIR=$(mktemp -d)
+
+mkdir -p $TMP_DIR/site/sub
+cp tests/*.md $TMP_DIR/site
+printf '# Sub\n\nsee [home](../)\n' > $TMP_DIR/site/sub/README.md
+printf 'body { margin: 0 }\n' > $TMP_DIR/site/style.css
+
+python3 - "$BINARY" "$TMP_DIR" <<'PY'
+import concurrent.futures, http.client, os, re, signal, socket, statistics, subprocess, sys
+
+# a request left unanswered would hang the test
+signal.alarm(120)
+
+binary, tmp = sys.argv[1], sys.argv[2]
+site = tmp + "/site"
+uuid = re.compile(r"[0-9a-f]{8}-[0-9a-f]{4}-[0-9a-f]{4}-[0-9a-f]{4}-[0-9a-f]{12}")
+failed = False
+
+def fail(message):
+    global failed
+    print(message)
+    failed = True
+
+def convert(md):
+    subprocess.run([binary, "-i", md, "-o", tmp + "/page.html"], check=True)
+    return uuid.sub("UUID", open(tmp + "/page.html", encoding="utf-8").read())
+
+def timing(response):
+    name, dur = re.match(r"(\w+);dur=([0-9.]+)", response.getheader("Server-Timing")).groups()
+    return name, float(dur)
+
+server = subprocess.Popen([binary, "--preview-server", "0", "-i", site, "-j", "4"],
+                          stderr=subprocess.PIPE, text=True)
+port = int(re.search(r":(\d+)/", server.stderr.readline()).group(1))
+
+def get(conn, path, headers={}, method="GET"):
+    conn.request(method, path, headers=headers)
+    response = conn.getresponse()
+    return response, response.read()
+
+pages = sorted(name for name in os.listdir(site) if name.endswith(".md"))
+expected = {name: convert(site + "/" + name) for name in pages}
+
+def client(round):
+    conn = http.client.HTTPConnection("127.0.0.1", port, timeout=30)
+    seen = []
+    for name in pages[round % len(pages):] + pages[:round % len(pages)]:
+        path = "/" + (name if round % 2 else name[:-3] + ".html")
+        response, body = get(conn, path)
+        if response.status != 200 or uuid.sub("UUID", body.decode()) != expected[name]:
+            fail("%s: differs from a conversion (%d)" % (path, response.status))
+        seen.append(timing(response))
+    conn.close()
+    return seen
+
+# concurrent clients, each on a keep-alive connection
+with concurrent.futures.ThreadPoolExecutor(8) as pool:
+    first = [t for ts in pool.map(client, range(8)) for t in ts]
+    again = [t for ts in pool.map(client, range(8)) for t in ts]
+
+renders = sum(1 for name, _ in first if name == "render")
+if renders < len(pages) or renders > 8 * len(pages):
+    fail("%d renders for %d pages" % (renders, len(pages)))
+hits = [dur for name, dur in again if name == "cache"]
+if len(hits) != len(again):
+    fail("second round: %d of %d from the cache" % (len(hits), len(again)))
+elif statistics.median(hits) >= 1.0:
+    fail("cache hits take %.3f ms" % statistics.median(hits))
+print("cache hit: median %.1f us, render: median %.1f us" %
+      (statistics.median(hits) * 1000,
+       statistics.median(dur for name, dur in first if name == "render") * 1000))
+
+conn = http.client.HTTPConnection("127.0.0.1", port, timeout=30)
+
+# unchanged: 304 without a body
+response, body = get(conn, "/footnotes.md")
+etag = response.getheader("ETag")
+response, body = get(conn, "/footnotes.md", {"If-None-Match": etag})
+if response.status != 304 or body != b"" or response.getheader("ETag") != etag:
+    fail("If-None-Match: %d" % response.status)
+
+# changed: rendered again, with a new ETag
+with open(site + "/footnotes.md", "a") as md:
+    md.write("\nadded\n")
+response, body = get(conn, "/footnotes.md", {"If-None-Match": etag})
+if (response.status != 200 or response.getheader("ETag") == etag or
+        timing(response)[0] != "render" or b"added" not in body):
+    fail("edited page not rendered again")
+
+# directories: their README.md, with a trailing slash
+response, body = get(conn, "/sub")
+if response.status != 301 or response.getheader("Location") != "/sub/":
+    fail("/sub: %d" % response.status)
+response, body = get(conn, "/sub/")
+if response.status != 200 or b"<h1>Sub</h1>" not in body:
+    fail("/sub/: %d" % response.status)
+
+# other files as they are
+response, body = get(conn, "/style.css")
+if (response.status != 200 or body != open(site + "/style.css", "rb").read() or
+        not response.getheader("Content-Type").startswith("text/css")):
+    fail("/style.css: %d" % response.status)
+
+response, body = get(conn, "/heading1.md", method="HEAD")
+if response.status != 200 or body != b"" or int(response.getheader("Content-Length")) == 0:
+    fail("HEAD: %d" % response.status)
+
+for path, status in [("/missing.md", 404), ("/../site/bullet.md", 404),
+                     ("/sub/%2e%2e/%2E%2E/site/bullet.md", 404), ("/bullet%00.md", 400)]:
+    response, body = get(conn, path)
+    if response.status != status:
+        fail("%s: %d, not %d" % (path, response.status, status))
+
+response, body = get(conn, "/bullet.md", method="POST")
+if response.status != 405:
+    fail("POST: %d" % response.status)
+conn.close()
+
+# pipelined requests are answered in order
+with socket.create_connection(("127.0.0.1", port), timeout=30) as sock:
+    sock.sendall(b"GET /missing HTTP/1.1\r\nHost: x\r\n\r\n"
+                 b"GET /heading1.md HTTP/1.1\r\nHost: x\r\nConnection: close\r\n\r\n")
+    data = b""
+    while chunk := sock.recv(65536):
+        data += chunk
+    if re.findall(rb"HTTP/1.1 (\d+)", data) != [b"404", b"200"]:
+        fail("pipelined: %s" % re.findall(rb"HTTP/1.1 \d+", data))
+
+server.send_signal(signal.SIGTERM)
+if server.wait(timeout=10) != 0:
+    fail("exit status %d" % server.returncode)
+
+sys.exit(1 if failed else 0)
+PY
+failed=$?
+
+rm -rf $TMP_DIR
+
+exit $failed
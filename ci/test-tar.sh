@@ -0,0 +1,90 @@
+#!/bin/bash
+
+# --tar converts the .md members of a tar stream; every page must be the
+# same as a conversion of its own, other members must come out as they
+# went in, in the same order, whatever the number of jobs.
+
+BINARY="./build/src/md2html"
+TMP_DIR=$(mktemp -d)
+UUID='s/[0-9a-f]{8}-[0-9a-f]{4}-[0-9a-f]{4}-[0-9a-f]{4}-[0-9a-f]{12}/UUID/g'
+LONG="$(printf 'd%.0s' {1..120})/$(printf 'n%.0s' {1..90})"
+
+failed=0
+
+fails () {
+	$BINARY --tar < $1 > $TMP_DIR/out.tar 2>/dev/null
+	if [ $? -ne 1 ]; then
+		echo "$2: expected exit status 1"
+		failed=1
+	fi
+}
+
+mkdir -p $TMP_DIR/src/docs/$LONG
+cp tests/*.md $TMP_DIR/src/docs/
+cp tests/$(ls tests | grep '\.md$' | head -n 1) $TMP_DIR/src/docs/$LONG.md
+head -c 3000 /dev/urandom > $TMP_DIR/src/docs/image.png
+head -c 3000000 /dev/urandom > $TMP_DIR/src/docs/video.webm
+
+for format in ustar gnu pax; do
+	# ustar can't hold the long name
+	if [ $format = ustar ]; then
+		exclude="--exclude=$(dirname $LONG)"
+	else
+		exclude=""
+	fi
+
+	tar cf $TMP_DIR/in.tar --format=$format $exclude -C $TMP_DIR/src docs
+
+	for jobs in 1 4; do
+		rm -rf $TMP_DIR/out
+		mkdir $TMP_DIR/out
+
+		if ! $BINARY --tar -j $jobs < $TMP_DIR/in.tar > $TMP_DIR/out.tar; then
+			echo "$format, -j $jobs: failed"
+			failed=1
+			continue
+		fi
+
+		if ! cmp -s <(tar tf $TMP_DIR/in.tar | sed 's/\.md$/.html/') <(tar tf $TMP_DIR/out.tar); then
+			echo "$format, -j $jobs: members differ"
+			failed=1
+		fi
+
+		tar xf $TMP_DIR/out.tar -C $TMP_DIR/out
+
+		for md in $(cd $TMP_DIR/src && find docs -name '*.md'); do
+			html=$TMP_DIR/out/${md%.md}.html
+			[ -f $html ] || continue
+
+			$BINARY -i $TMP_DIR/src/$md -o $TMP_DIR/page.html
+			if ! cmp -s <(sed -E "$UUID" $TMP_DIR/page.html) <(sed -E "$UUID" $html); then
+				echo "$format, -j $jobs: $md: output differs"
+				failed=1
+			fi
+		done
+
+		for asset in image.png video.webm; do
+			if ! cmp -s $TMP_DIR/src/docs/$asset $TMP_DIR/out/docs/$asset; then
+				echo "$format, -j $jobs: $asset differs"
+				failed=1
+			fi
+		done
+	done
+done
+
+# compressed streams are read through the same decoders
+gzip -c $TMP_DIR/in.tar | $BINARY --tar > $TMP_DIR/gz.tar
+if ! tar tf $TMP_DIR/gz.tar > /dev/null 2>&1; then
+	echo "gzip: not a valid tar stream"
+	failed=1
+fi
+
+head -c 10000 $TMP_DIR/in.tar > $TMP_DIR/truncated.tar
+fails $TMP_DIR/truncated.tar "truncated"
+
+head -c 2048 /dev/urandom > $TMP_DIR/random.tar
+fails $TMP_DIR/random.tar "not a tar stream"
+
+rm -rf $TMP_DIR
+
+exit $failed
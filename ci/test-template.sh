@@ -0,0 +1,66 @@
+#!/bin/bash
+
+# --template: a template that is the built-in wrapper gives the same
+# pages, placeholders are filled in wherever they are, and templates
+# that can't be filled in are refused.
+
+BINARY="./build/src/md2html"
+TMP_DIR=$(mktemp -d)
+UUID='s/[0-9a-f]{8}-[0-9a-f]{4}-[0-9a-f]{4}-[0-9a-f]{4}-[0-9a-f]{12}/UUID/g'
+
+failed=0
+
+fails () {
+	$BINARY -i tests/heading1.md -o $TMP_DIR/out.html --template $1 2>/dev/null
+	if [ $? -ne 1 ]; then
+		echo "$2: expected exit status 1"
+		failed=1
+	fi
+}
+
+printf '<!DOCTYPE html>\n<html lang="en">\n<head>\n\t<meta charset="UTF-8">\n\t<meta name="viewport" content="width=device-width, initial-scale=1.0">\n\t<title>{{title}}</title>\n</head>\n<body>\n{{content}}</body>\n</html>\n' \
+	> $TMP_DIR/builtin.html
+
+for md in tests/*.md; do
+	$BINARY -i $md -o $TMP_DIR/page.html
+	$BINARY -i $md -o $TMP_DIR/templated.html --template $TMP_DIR/builtin.html
+	if ! cmp -s <(sed -E "$UUID" $TMP_DIR/page.html) <(sed -E "$UUID" $TMP_DIR/templated.html); then
+		echo "$md: built-in template differs"
+		failed=1
+	fi
+done
+
+printf '<title>{{ title }}</title>{{stylesheet}}{{other}}\n<main>{{content}}</main><aside>{{footnotes}}</aside><p>{{title}}</p>\n' \
+	> $TMP_DIR/site.html
+$BINARY -i tests/footnotes.md -o $TMP_DIR/out.html -s site.css --template $TMP_DIR/site.html
+
+title=$(grep -m 1 '^# ' tests/footnotes.md | cut -c 3-)
+if ! grep -qF "<title>$title</title><link rel=\"stylesheet\" href=\"site.css\">{{other}}" $TMP_DIR/out.html ||
+   ! grep -qF "<p>$title</p>" $TMP_DIR/out.html ||
+   ! tr -d '\n' < $TMP_DIR/out.html | grep -q '</main><aside>.*<p id="fn-.*</aside>'; then
+	echo "placeholders are not filled in"
+	failed=1
+fi
+
+# every member of a tar stream gets it
+tar cf $TMP_DIR/in.tar tests/*.md
+$BINARY --tar --template $TMP_DIR/site.html < $TMP_DIR/in.tar > $TMP_DIR/out.tar
+if [ "$(tar xOf $TMP_DIR/out.tar | grep -c '^<title>')" != "$(ls tests/*.md | wc -l)" ]; then
+	echo "--tar: not every page is templated"
+	failed=1
+fi
+
+printf '{{footnotes}}{{content}}' > $TMP_DIR/notes-first.html
+fails $TMP_DIR/notes-first.html "footnotes before content"
+
+printf '<body></body>' > $TMP_DIR/no-content.html
+fails $TMP_DIR/no-content.html "no content"
+
+printf '{{content}}{{content}}' > $TMP_DIR/twice.html
+fails $TMP_DIR/twice.html "content twice"
+
+fails $TMP_DIR/missing.html "missing template"
+
+rm -rf $TMP_DIR
+
+exit $failed
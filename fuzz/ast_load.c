@@ -0,0 +1,92 @@
+/* ast_load.c
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "fuzz.h"
+#include "ast.h"
+#include "backend.h"
+#include "html.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define ARRAY_SIZE(arr) \
+        (sizeof (arr) / sizeof (arr[0]))
+
+static void
+discard (const char *buf,
+         size_t      len,
+         void       *user_data)
+{
+  (void) buf;
+  (void) len;
+  (void) user_data;
+}
+
+int
+LLVMFuzzerTestOneInput (const uint8_t *data,
+                        size_t         size)
+{
+  Params params = { 0 };
+  const char *error;
+  uint64_t start;
+  char *buf;
+  HTML *html;
+  MD *md;
+
+  params.o_file = "/dev/null";
+  params.document = true;
+
+  /* ast_load () wants the alignment a mapping has */
+  buf = malloc (size ? size : 1);
+  memcpy (buf, data, size);
+
+  start = fuzz_now_ns ();
+
+  md = ast_load (buf, size, &error);
+  if (md != NULL)
+    {
+      /* every backend walks the loaded doc; html_from_md () takes its
+       * content, so it comes last */
+      const Backend *backends[] = {
+        &backend_html, &backend_text, &backend_ansi, &backend_index,
+      };
+      Output *outs[ARRAY_SIZE (backends)];
+
+      for (size_t i = 0; i < ARRAY_SIZE (backends); i++)
+        outs[i] = output_new_func (discard, NULL);
+
+      backends_render (md, &params, backends, outs, ARRAY_SIZE (backends));
+
+      for (size_t i = 0; i < ARRAY_SIZE (backends); i++)
+        output_free (outs[i]);
+
+      html = html_from_md (md, &params);
+      flush_html (html);
+
+      html_free (html);
+      md_free (md);
+    }
+
+  fuzz_check_budget ("ast_load", start, size, 200);
+
+  free (buf);
+
+  return 0;
+}
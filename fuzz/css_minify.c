@@ -0,0 +1,49 @@
+/* css_minify.c
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#define _GNU_SOURCE
+
+#include "fuzz.h"
+#include "css.h"
+
+#include <string.h>
+
+int
+LLVMFuzzerTestOneInput (const uint8_t *data,
+                        size_t         size)
+{
+  size_t len;
+  uint64_t start;
+  char *css;
+
+  start = fuzz_now_ns ();
+
+  css = css_minify ((const char *) data, size, &len);
+
+  /* the result goes into a <style> element as it is */
+  if (len > size * 3 / 2 || memmem (css, len, "</", 2) != NULL)
+    abort ();
+
+  free (css);
+
+  fuzz_check_budget ("css_minify", start, size, 50);
+
+  return 0;
+}
@@ -0,0 +1,56 @@
+/* format_text.c
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "fuzz.h"
+#include "footnotes.h"
+#include "html.h"
+
+#include <string.h>
+
+int
+LLVMFuzzerTestOneInput (const uint8_t *data,
+                        size_t         size)
+{
+  static Footnotes *notes = NULL;
+  uint64_t start;
+  char *content;
+
+  /* [^1] and [^a] resolve, anything else does not */
+  if (notes == NULL)
+    {
+      notes = footnotes_new ();
+      footnotes_add (notes, "1", "first");
+      footnotes_add (notes, "a", "second");
+    }
+
+  content = malloc (size + 1);
+  memcpy (content, data, size);
+  content[size] = '\0';
+
+  start = fuzz_now_ns ();
+
+  free (format_text (content, notes, NULL));
+
+  fuzz_check_budget ("format_text", start, size, 200);
+
+  free (content);
+
+  return 0;
+}
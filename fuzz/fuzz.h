@@ -0,0 +1,82 @@
+/* fuzz.h
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+
+#pragma once
+
+/*
+ * Time budget shared by the fuzz targets
+ *
+ * An input may take FUZZ_BASE_NS plus the target's per-byte budget for
+ * every byte; anything slower is treated as a crash, so libFuzzer keeps
+ * it and the replay test fails on it.  The per-byte budgets are a few
+ * times the linear cost, well below what a quadratic scan costs on the
+ * 100 KB corpus inputs.  MD2HTML_FUZZ_SLOWDOWN multiplies every budget
+ * (instrumented builds are a lot slower).
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define FUZZ_BASE_NS (5 * 1000 * 1000)
+
+int LLVMFuzzerTestOneInput (const uint8_t *data,
+                            size_t         size);
+
+static inline uint64_t
+fuzz_now_ns (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static inline void
+fuzz_check_budget (const char *target,
+                   uint64_t    start_ns,
+                   size_t      size,
+                   uint64_t    ns_per_byte)
+{
+  static uint64_t slowdown = 0;
+  uint64_t elapsed, budget;
+
+  if (slowdown == 0)
+    {
+      const char *env = getenv ("MD2HTML_FUZZ_SLOWDOWN");
+
+      slowdown = env ? strtoull (env, NULL, 10) : 1;
+      if (slowdown == 0)
+        slowdown = 1;
+    }
+
+  elapsed = fuzz_now_ns () - start_ns;
+  budget = (FUZZ_BASE_NS + size * ns_per_byte) * slowdown;
+
+  if (elapsed > budget)
+    {
+      fprintf (stderr, "%s: slow input: %zu bytes took %.3f ms (budget %.3f ms)\n",
+               target, size, elapsed / 1e6, budget / 1e6);
+      abort ();
+    }
+}
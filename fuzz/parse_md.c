@@ -0,0 +1,50 @@
+/* parse_md.c
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "fuzz.h"
+#include "html.h"
+#include "md.h"
+
+int
+LLVMFuzzerTestOneInput (const uint8_t *data,
+                        size_t         size)
+{
+  Params params = { 0 };
+  uint64_t start;
+  HTML *html;
+  MD *md;
+
+  /* whole conversion; rendering is where the inline work happens */
+  params.o_file = "/dev/null";
+  params.document = true;
+
+  start = fuzz_now_ns ();
+
+  md = parse_md_buffer ((const char *) data, size);
+  html = html_from_md (md, &params);
+  flush_html (html);
+
+  html_free (html);
+  md_free (md);
+
+  fuzz_check_budget ("parse_md", start, size, 200);
+
+  return 0;
+}
@@ -0,0 +1,143 @@
+/* push_parse.c
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "fuzz.h"
+#include "html.h"
+#include "md.h"
+#include "md2html.h"
+#include "strbuf.h"
+#include "uuid.h"
+
+#include <string.h>
+
+/*
+ * differential: feeding the doc in random pieces through the push API
+ * has to give the same HTML as converting it at once
+ */
+
+static void
+append_output (const char *buf,
+               size_t      len,
+               void       *user_data)
+{
+  strbuf_append_len (user_data, buf, len);
+}
+
+static bool
+is_uuid (const char *str,
+         size_t      len)
+{
+  if (len < UUID_NUM_CHARACTERS)
+    return false;
+
+  for (int i = 0; i < UUID_NUM_CHARACTERS; i++)
+    {
+      bool dash = i == 8 || i == 13 || i == 18 || i == 23;
+
+      if (dash ? str[i] != '-'
+               : str[i] == '\0' || strchr ("0123456789abcdef", str[i]) == NULL)
+        return false;
+    }
+
+  return true;
+}
+
+/* uuids are random; blank them out before comparing */
+static void
+mask_uuids (StrBuf *buf)
+{
+  for (size_t i = 0; i < buf->len; i++)
+    {
+      if (is_uuid (buf->str + i, buf->len - i))
+        {
+          memset (buf->str + i, 'x', UUID_NUM_CHARACTERS);
+          i += UUID_NUM_CHARACTERS - 1;
+        }
+    }
+}
+
+int
+LLVMFuzzerTestOneInput (const uint8_t *data,
+                        size_t         size)
+{
+  Params params = { 0 };
+  MD2HTMLOptions options = { 0 };
+  const char *error;
+  StrBuf whole, pushed;
+  uint64_t start, seed;
+  MD2HTML *ctx;
+  Output *out;
+  HTML *html;
+  MD *md;
+
+  params.document = options.document = true;
+
+  strbuf_init (&whole, size + 256);
+  strbuf_init (&pushed, size + 256);
+
+  start = fuzz_now_ns ();
+
+  md = parse_md_buffer ((const char *) data, size);
+  html = html_from_md (md, &params);
+  out = output_new_func (append_output, &whole);
+  html_write (html, out);
+  output_free (out);
+  html_free (html);
+  md_free (md);
+
+  /* chunk sizes of 1..64 bytes, derived from the input */
+  seed = size * 0x9E3779B97F4A7C15ull + 1;
+  ctx = md2html_new (&options, append_output, &pushed, &error);
+
+  for (size_t pos = 0; pos < size;)
+    {
+      size_t n;
+
+      seed ^= seed << 13;
+      seed ^= seed >> 7;
+      seed ^= seed << 17;
+
+      n = 1 + seed % 64;
+      if (n > size - pos)
+        n = size - pos;
+
+      md2html_feed (ctx, (const char *) data + pos, n);
+      pos += n;
+    }
+
+  md2html_finish (ctx);
+  md2html_free (ctx);
+
+  fuzz_check_budget ("push_parse", start, size, 400);
+
+  mask_uuids (&whole);
+  mask_uuids (&pushed);
+
+  if (whole.len != pushed.len || memcmp (whole.str, pushed.str, whole.len) != 0)
+    {
+      fprintf (stderr, "push_parse: output differs from a whole-doc conversion\n");
+      abort ();
+    }
+
+  strbuf_free (&whole);
+  strbuf_free (&pushed);
+
+  return 0;
+}
@@ -0,0 +1,100 @@
+/* replay.c
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+/*
+ * Runs a fuzz target over files and directories of inputs without
+ * libFuzzer, so the corpus can be replayed by any compiler's build.
+ */
+
+#include "fuzz.h"
+
+#include <dirent.h>
+#include <stdbool.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "uuid.h"
+
+static bool
+replay_file (const char *path)
+{
+  uint8_t *data;
+  FILE *file;
+  long size;
+
+  file = fopen (path, "rb");
+  if (file == NULL)
+    {
+      fprintf (stderr, "%s: cannot open\n", path);
+      return false;
+    }
+
+  fseek (file, 0, SEEK_END);
+  size = ftell (file);
+  rewind (file);
+
+  data = malloc (size ? size : 1);
+  if (fread (data, 1, size, file) != (size_t) size)
+    size = 0;
+  fclose (file);
+
+  fprintf (stderr, "%s (%ld bytes)\n", path, size);
+  LLVMFuzzerTestOneInput (data, size);
+
+  free (data);
+
+  return true;
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  bool ok = true;
+
+  uuid_init ();
+
+  for (int i = 1; i < argc; i++)
+    {
+      struct stat st;
+      struct dirent *entry;
+      DIR *dir;
+
+      if (stat (argv[i], &st) != 0 || !S_ISDIR (st.st_mode))
+        {
+          ok &= replay_file (argv[i]);
+          continue;
+        }
+
+      dir = opendir (argv[i]);
+      while ((entry = readdir (dir)) != NULL)
+        {
+          char path[4096];
+
+          if (entry->d_name[0] == '.')
+            continue;
+
+          snprintf (path, sizeof (path), "%s/%s", argv[i], entry->d_name);
+          ok &= replay_file (path);
+        }
+      closedir (dir);
+    }
+
+  return ok ? 0 : 1;
+}
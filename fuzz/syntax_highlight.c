@@ -0,0 +1,58 @@
+/* syntax_highlight.c
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "fuzz.h"
+#include "lang.h"
+#include "syntax.h"
+
+#include <string.h>
+
+/*
+ * first byte picks the language, the rest is the code block body
+ */
+int
+LLVMFuzzerTestOneInput (const uint8_t *data,
+                        size_t         size)
+{
+  uint64_t start;
+  char *codeblk;
+  Lang lang;
+
+  if (size == 0)
+    return 0;
+
+  lang = data[0] % 2 ? LANG_DIFF : LANG_C;
+
+  /* code blocks start with a newline, see parse_md () */
+  codeblk = malloc (size + 1);
+  codeblk[0] = '\n';
+  memcpy (codeblk + 1, data + 1, size - 1);
+  codeblk[size] = '\0';
+
+  start = fuzz_now_ns ();
+
+  free (syntax_highlight (codeblk, lang));
+
+  fuzz_check_budget ("syntax_highlight", start, size, 1000);
+
+  free (codeblk);
+
+  return 0;
+}
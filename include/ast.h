@@ -0,0 +1,80 @@
+/* ast.h
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "md.h"
+#include "output.h"
+
+/*
+ * @AST
+ *
+ * parsed doc saved to disk so that it can be rendered again without
+ * parsing; the file is laid out to be used in place once mapped:
+ *
+ *   AstHeader
+ *   AstUnit[n_units]      in document order
+ *   AstNote[n_notes]      footnote definitions, by index
+ *   blob[blob_size]       strings, each followed by a NUL
+ *
+ * strings are (offset into blob, length) pairs; AST_NO_STRING marks a
+ * missing one. Integers are in host byte order, which byte_order tells
+ * apart. Bump AST_VERSION on any change to the layout.
+ */
+#define AST_MAGIC     "md2hast"
+#define AST_VERSION   1
+#define AST_NO_STRING UINT64_MAX
+
+typedef struct {
+  char     magic[8];
+  uint32_t version;
+  uint32_t byte_order;     /* 0x01020304 */
+  uint64_t n_units;
+  uint64_t n_notes;
+  uint64_t blob_size;
+
+  /* MD input info */
+  uint64_t n_bytes;
+  uint64_t n_invalid;
+  uint64_t invalid_offsets[MD_MAX_INVALID_OFFSETS];
+} AstHeader;
+
+typedef struct {
+  uint32_t type;           /* UnitType */
+  uint32_t lang;           /* Lang */
+  uint64_t line;
+  uint64_t content;
+  uint64_t content_len;
+} AstUnit;
+
+typedef struct {
+  uint64_t identifier;
+  uint64_t identifier_len;
+  uint64_t text;
+  uint64_t text_len;
+} AstNote;
+
+bool ast_write (MD          *md,
+                Output      *out);
+MD  *ast_load  (const char  *buf,
+                size_t       len,
+                const char **error);
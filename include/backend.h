@@ -0,0 +1,58 @@
+/* backend.h
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "events.h"
+#include "md.h"
+#include "output.h"
+#include "params.h"
+
+/*
+ * @Backend
+ *
+ * an output format: block and inline emitters for the events of
+ * md_walk (), plus state that lives for one document
+ */
+typedef struct Backend {
+  const char *name;
+  MDEvents    events;    /* called with the state returned by new */
+
+  void     *(*new)    (Output *out,
+                       Params *params,
+                       MD     *md);
+  /* writes what comes after the last block and frees the state */
+  void      (*finish) (void   *state);
+} Backend;
+
+extern const Backend backend_html;
+extern const Backend backend_text;
+extern const Backend backend_ansi;
+extern const Backend backend_index;    /* see index.h */
+
+const Backend *backend_find    (const char     *name);
+void           backends_render (MD             *md,
+                                Params         *params,
+                                const Backend **backends,
+                                Output        **outs,
+                                size_t          n_backends);
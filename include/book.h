@@ -0,0 +1,45 @@
+/* book.h
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include "md.h"
+
+/*
+ * books: markdown files rendered as one doc
+ *
+ * the files are parsed concurrently and merged in order with
+ * md_concat (); each keeps its own footnote identifiers, and the notes
+ * are numbered through the whole book
+ */
+
+struct Book;
+typedef struct Book Book;
+
+Book *book_parse   (char       **files,
+                    size_t       n_files,
+                    size_t       n_jobs,
+                    size_t      *bad,
+                    const char **error);
+MD   *book_chapter (Book        *book,
+                    size_t       i);
+MD   *book_merge   (Book        *book);
+void  book_free    (Book        *book);
@@ -0,0 +1,42 @@
+/* check.h
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/*
+ * validation without output: files are parsed and their inline content
+ * tokenized with md_walk (), nothing is rendered.  Problems are reported
+ * as FILE:LINE: message, the way compilers do
+ *
+ * - code fences that are never closed
+ * - footnote references without a definition, rendered as <sup>?</sup>
+ * - footnote identifiers defined twice; the first definition wins
+ * - links and images to local files that don't exist
+ */
+
+size_t check_files (char  **files,
+                    size_t  n_files,
+                    size_t  n_jobs,
+                    FILE   *report,
+                    bool   *limited);
@@ -0,0 +1,61 @@
+/* compress.h
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "output.h"
+
+/*
+ * precompressed copies of an output (index.html.gz, index.html.zst) for
+ * servers that send them as they are; they are encoded from the bytes
+ * the output flushes, in the same pass.  Codecs are optional at build
+ * time, as for input.h
+ */
+
+/*
+ * Keep order in-sync with codecs in compress.c
+ */
+typedef enum {
+  COMPRESS_GZIP,
+  COMPRESS_ZSTD,
+  N_COMPRESS_CODECS,
+} CompressCodec;
+
+typedef struct Precompress Precompress;
+
+bool         compress_parse      (const char    *spec,
+                                  CompressCodec *codec,
+                                  int           *level);
+bool         compress_supported  (CompressCodec  codec);
+const char  *compress_name       (CompressCodec  codec);
+bool         compress_open       (const char    *dict_file);
+void         compress_close      (void);
+bool         compress_train_dict (const char    *dict_file,
+                                  char         **inputs,
+                                  size_t         n_inputs,
+                                  const char   **error);
+
+Precompress *precompress_start   (Output        *out,
+                                  const char    *file_name,
+                                  const int      levels[N_COMPRESS_CODECS]);
+bool         precompress_finish  (Precompress   *pre,
+                                  bool           keep);
@@ -0,0 +1,39 @@
+/* css.h
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+/*
+ * stylesheets inlined into the document head
+ *
+ * a stylesheet is read and minified once per run; with a cache dir the
+ * minified result is also kept on disk along with the source, found by
+ * a hash of it, so later runs with the same source don't minify it again
+ */
+
+void        css_open   (const char *cache_dir);
+void        css_close  (void);
+const char *css_inline (const char *path,
+                        size_t     *len);
+char       *css_minify (const char *css,
+                        size_t      len,
+                        size_t     *out_len);
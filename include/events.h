@@ -0,0 +1,107 @@
+/* events.h
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+
+#pragma once
+
+#include <stddef.h>
+#include "footnotes.h"
+#include "lang.h"
+#include "md.h"
+
+/*
+ * SAX-style walk over a parsed doc: enter/leave events for blocks and
+ * inline spans, text in between.  Nothing gets rendered, so consumers
+ * that want the structure rather than HTML skip that cost.
+ */
+
+typedef enum {
+  BLOCK_TYPE_H1,
+  BLOCK_TYPE_H2,
+  BLOCK_TYPE_H3,
+  BLOCK_TYPE_LIST,        /* run of consecutive list items */
+  BLOCK_TYPE_LIST_ITEM,
+  BLOCK_TYPE_QUOTE,
+  BLOCK_TYPE_CODE,        /* text is the body, without the fences */
+  BLOCK_TYPE_PARAGRAPH,   /* a line of text */
+  BLOCK_TYPE_BLANK,       /* empty line */
+  BLOCK_TYPE_FOOTNOTES,   /* the definitions, after all other blocks */
+  BLOCK_TYPE_FOOTNOTE,    /* one definition; text is not formatted */
+} BlockType;
+
+typedef struct {
+  BlockType     type;
+  Lang          lang;   /* BLOCK_TYPE_CODE */
+  size_t        line;   /* source line, 0 for LIST and FOOTNOTES */
+  Reference    *note;   /* BLOCK_TYPE_FOOTNOTE */
+  const MDUnit *unit;   /* source unit; NULL for LIST and FOOTNOTE(S) */
+} MDBlock;
+
+typedef enum {
+  SPAN_TYPE_EM,
+  SPAN_TYPE_STRONG,
+  SPAN_TYPE_STRONG_EM,
+  SPAN_TYPE_CODE,
+  SPAN_TYPE_LINK,          /* text is the anchor */
+  SPAN_TYPE_IMAGE,         /* text is the alt text */
+  SPAN_TYPE_FOOTNOTE_REF,  /* no text */
+} SpanType;
+
+/* pointers are into the content being walked; not NUL-terminated */
+typedef struct {
+  SpanType    type;
+
+  const char *href;      /* LINK: target, IMAGE: source */
+  size_t      href_len;
+
+  const char *id;        /* FOOTNOTE_REF: identifier */
+  size_t      id_len;
+  Reference  *ref;       /* FOOTNOTE_REF: NULL if not defined */
+} MDSpan;
+
+/*
+ * @MDEvents
+ *
+ * any callback may be NULL; without span and text callbacks inline
+ * content isn't tokenized at all
+ */
+typedef struct {
+  void (*enter_block) (const MDBlock *block,
+                       void          *user_data);
+  void (*leave_block) (const MDBlock *block,
+                       void          *user_data);
+  void (*enter_span)  (const MDSpan  *span,
+                       void          *user_data);
+  void (*leave_span)  (const MDSpan  *span,
+                       void          *user_data);
+  void (*text)        (const char    *text,
+                       size_t         len,
+                       void          *user_data);
+} MDEvents;
+
+
+void md_walk        (MD             *md,
+                     const MDEvents *events,
+                     void           *user_data);
+void md_walk_inline (const char     *content,
+                     Footnotes      *notes,
+                     LimitState     *limits,
+                     const MDEvents *events,
+                     void           *user_data);
@@ -20,16 +20,20 @@
 
 #pragma once
 
+#include <stddef.h>
 #include "uuid.h"
 
 
 typedef struct Reference {
-  int     index;      /* indexing starts at 1 */
+  size_t  index;      /* indexing starts at 1 */
+  size_t  part;       /* namespace of the identifier, see footnotes_set_part () */
+  size_t  line;       /* source line of the definition, 0 if unknown */
   uuid_t  uuid;
   char   *identifier;
   char   *text;
 
-  int n_referrers;
+  size_t n_referrers;
+  size_t referrers_size; /* allocated referrers */
   uuid_t *referrers;
 } Reference;
 
@@ -38,16 +42,22 @@ typedef struct Footnotes Footnotes;
 
 
 Footnotes *footnotes_new       (void);
-void       footnotes_add       (Footnotes *refs,
+Reference *footnotes_add       (Footnotes *refs,
                                 char *identifier,
                                 char *text);
 void       footnotes_free      (Footnotes *refs);
-int        footnotes_get_count (Footnotes *refs);
+size_t     footnotes_get_count (Footnotes *refs);
+size_t     footnotes_get_referrer_count (Footnotes *refs);
 Reference *footnotes_get_ref   (Footnotes *refs,
                                 char *identifier);
 Reference *footnotes_get_ref_from_index (Footnotes *refs,
-                                         int index);
+                                         size_t index);
 void       footnotes_add_referrer (Footnotes *notes,
-                                   int        index,
+                                   size_t     index,
                                    uuid_t     uuid);
+void       footnotes_set_part  (Footnotes *notes,
+                                size_t     part);
+void       footnotes_merge     (Footnotes *notes,
+                                Footnotes *part_notes,
+                                size_t     part);
 
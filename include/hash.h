@@ -0,0 +1,153 @@
+/* hash.h
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/*
+ * FNV-1a; fast and good enough to spread keys over a table, but not
+ * collision resistant, so not for anything an attacker picks the keys of
+ */
+#define HASH_INIT 14695981039346656037ULL
+
+static inline uint64_t
+hash_bytes (uint64_t    hash,
+            const char *buf,
+            size_t      len)
+{
+  for (size_t i = 0; i < len; i++)
+    {
+      hash ^= (unsigned char) buf[i];
+      hash *= 1099511628211ULL;
+    }
+
+  return hash;
+}
+
+static inline uint64_t
+hash_str (uint64_t    hash,
+          const char *str)
+{
+  while (*str)
+    {
+      hash ^= (unsigned char) *str++;
+      hash *= 1099511628211ULL;
+    }
+
+  return hash;
+}
+
+/*
+ * @HashIndex
+ *
+ * open addressing hash index over the entries of an array the caller
+ * keeps; slots hold (position in the array + 1), 0 marks an empty slot
+ */
+typedef struct {
+  size_t *slots;
+  size_t  size;    /* power of 2 */
+} HashIndex;
+
+/* whether the entry at @pos has @key */
+typedef bool     (*HashIndexMatch) (size_t      pos,
+                                    const void *key,
+                                    const void *user_data);
+/* the hash the entry at @pos was added with */
+typedef uint64_t (*HashIndexHash)  (size_t      pos,
+                                    const void *user_data);
+
+/*
+ * hash_index_lookup
+ * @index: not empty
+ * @hash: of @key
+ *
+ * returns the slot holding the entry that matches @key, or the empty
+ * slot where it would be added
+ */
+static inline size_t *
+hash_index_lookup (const HashIndex *index,
+                   uint64_t         hash,
+                   HashIndexMatch   match,
+                   const void      *key,
+                   const void      *user_data)
+{
+  size_t mask = index->size - 1;
+  size_t i = hash & mask;
+
+  while (index->slots[i] != 0 && !match (index->slots[i] - 1, key, user_data))
+    i = (i + 1) & mask;
+
+  return &index->slots[i];
+}
+
+/*
+ * hash_index_reserve
+ * @index
+ * @n: entries in @index, before the one about to be added
+ * @min_size: first size, a power of 2
+ * @hash_of: rehashes the entries when the slots are reallocated
+ * @user_data: passed to @hash_of
+ *
+ * makes room for one more entry, keeping the load factor under 1/2
+ */
+static inline void
+hash_index_reserve (HashIndex     *index,
+                    size_t         n,
+                    size_t         min_size,
+                    HashIndexHash  hash_of,
+                    const void    *user_data)
+{
+  size_t *old = index->slots;
+  size_t old_size = index->size;
+
+  if (2 * (n + 1) <= index->size)
+    return;
+
+  index->size = old_size ? old_size << 1 : min_size;
+  index->slots = calloc (index->size, sizeof (size_t));
+
+  for (size_t i = 0; i < old_size; i++)
+    {
+      size_t mask = index->size - 1;
+      size_t j;
+
+      if (old[i] == 0)
+        continue;
+
+      /* entries are unique, so the first empty slot is theirs */
+      for (j = hash_of (old[i] - 1, user_data) & mask; index->slots[j] != 0; j = (j + 1) & mask)
+        ;
+      index->slots[j] = old[i];
+    }
+
+  free (old);
+}
+
+static inline void
+hash_index_free (HashIndex *index)
+{
+  free (index->slots);
+  index->slots = NULL;
+  index->size = 0;
+}
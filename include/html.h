@@ -25,11 +25,14 @@
 #include "params.h"
 #include "md.h"
 #include "lang.h"
+#include "output.h"
+#include "index.h"
+#include "template.h"
 
 /*
  * @HTMLFile
  */
-typedef FILE HTMLFile;
+typedef Output HTMLFile;
 
 typedef enum {
   HTML_TAG_H1,
@@ -45,11 +48,18 @@ typedef enum {
 typedef struct HTMLUnit {
   HTMLTag tag;
   char *content;
+  size_t content_len;
+  bool borrowed;     /* content points into the input mapping */
   char *uri;
 
   /* For codeblocks */
   Lang lang;
 
+  /* source */
+  UnitType type;
+  size_t line;
+  size_t part;
+
 } HTMLUnit;
 
 typedef struct HTML {
@@ -58,12 +68,22 @@ typedef struct HTML {
 
   /* css stylesheet */
   char *stylesheet;
+  const char *style;   /* inlined instead, see css.h; not owned */
+  size_t style_len;
 
   /* options */
   bool document;
+  const Template *template; /* instead of the built-in wrapper; not owned */
+  bool minify;       /* no formatting whitespace */
+  Anchors *anchors;  /* heading ids, only when indexing */
+  int compress_levels[N_COMPRESS_CODECS]; /* precompressed copies */
+
+  /* footnotes and limits of the markdown doc; not owned */
+  Footnotes *notes;
+  LimitState *limits;
 
   /* content */
-  uint n_lines;
+  size_t n_lines;
   HTMLUnit **html;
 } HTML;
 
@@ -71,4 +91,32 @@ typedef struct HTML {
 HTML *html_from_md (MD     *md,
                     Params *params);
 void  html_free    (HTML *html);
-void  flush_html   (HTML *html);
+bool  flush_html   (HTML *html);
+void  html_write   (HTML     *html,
+                    HTMLFile *file);
+
+/*
+ * unit at a time rendering, for docs that are still being parsed
+ */
+HTML     *html_new              (Params    *params,
+                                 MD        *md);
+HTMLUnit *html_unit_new         (MDUnit    *md_unit);
+void      html_unit_view        (HTMLUnit     *unit,
+                                 const MDUnit *md_unit);
+void      html_unit_free        (HTMLUnit  *unit);
+bool      html_unit_is_resolved (HTMLUnit  *unit,
+                                 Footnotes *footnotes);
+void      html_write_begin      (HTMLFile  *file,
+                                 HTML      *html,
+                                 HTMLUnit  *first);
+void      html_write_unit       (HTMLFile  *file,
+                                 HTML      *html,
+                                 HTMLUnit  *prev,
+                                 HTMLUnit  *unit,
+                                 HTMLUnit  *next);
+void      html_write_end        (HTMLFile  *file,
+                                 HTML      *html);
+
+char *format_text  (char       *content,
+                    Footnotes  *footnotes,
+                    LimitState *limits);
@@ -0,0 +1,64 @@
+/* image.h
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * image dimensions, for <img width height>
+ *
+ * only the header of PNG, JPEG, GIF and WebP files is read; results are
+ * cached by path, and checked against the file's mtime and size
+ */
+
+/* checked inline so that disabled probing costs a branch */
+extern bool image_probing;
+
+void image_open         (const char          *base_dir,
+                         const char          *cache_file);
+bool image_close        (void);
+bool image_size_        (const char          *src,
+                         size_t               len,
+                         unsigned            *width,
+                         unsigned            *height);
+bool image_probe_buffer (const unsigned char *buf,
+                         size_t               len,
+                         unsigned            *width,
+                         unsigned            *height);
+
+/*
+ * image_size
+ * @src: <img src>, relative to the base dir given to image_open ()
+ * @len
+ * @width
+ * @height
+ *
+ * returns false for remote and unreadable images, and for unknown formats
+ */
+static inline bool
+image_size (const char *src,
+            size_t      len,
+            unsigned   *width,
+            unsigned   *height)
+{
+  return image_probing && image_size_ (src, len, width, height);
+}
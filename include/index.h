@@ -0,0 +1,65 @@
+/* index.h
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "output.h"
+
+/*
+ * @Index
+ *
+ * search index written next to the HTML doc by backend_index; terms
+ * point at sections, a section being a heading anchor of a doc (or
+ * the top of the doc, for text before its first heading).  Terms and
+ * anchors are lower case: ASCII, plus the Latin, Greek and Cyrillic
+ * letters of UTF-8 text; other characters are kept as they are.
+ *
+ * one record per line, fields separated by tabs:
+ *
+ *   md2html-index 1 docs N sections M
+ *   d  HREF  TITLE                      N of these, doc ids count from 0
+ *   s  DOC  ANCHOR  HEADING             M of these, section ids likewise
+ *   t  TERM  SECTION SECTION ...        sorted by term, ascending ids
+ *
+ * so indexes can be merged in one streaming pass, see index_merge ()
+ */
+#define INDEX_VERSION 1
+
+/*
+ * @Anchors
+ *
+ * ids for the headings of a doc, unique within the doc
+ */
+struct Anchors;
+typedef struct Anchors Anchors;
+
+Anchors    *anchors_new  (void);
+const char *anchors_next (Anchors    *anchors,
+                          const char *heading,
+                          size_t      len);
+void        anchors_free (Anchors    *anchors);
+
+bool index_merge (Output  *out,
+                  FILE   **inputs,
+                  size_t   n_inputs,
+                  size_t  *bad_input);
@@ -0,0 +1,36 @@
+/* input.h
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#pragma once
+
+#include "md.h"
+
+/*
+ * markdown input, decompressed on the fly
+ *
+ * gzip and zstd files are recognized by their magic bytes and read
+ * through a decompressing stream, a piece at a time; other files are
+ * read as they are.  Codecs are optional at build time (HAVE_ZLIB,
+ * HAVE_ZSTD)
+ */
+
+MDFile     *input_open  (const char  *path,
+                         const char **error);
+const char *input_error (MDFile      *file);
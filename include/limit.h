@@ -0,0 +1,78 @@
+/* limit.h
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* exit status of a conversion stopped by a limit */
+#define LIMIT_EXIT_CODE 3
+
+/*
+ * Keep order in-sync with limit_names in limit.c
+ */
+typedef enum {
+  LIMIT_NONE,
+  LIMIT_INPUT_BYTES,     /* bytes read by parse_md */
+  LIMIT_LINE_LENGTH,     /* bytes in a single input line */
+  LIMIT_UNITS,           /* parsed units, footnotes excluded */
+  LIMIT_FOOTNOTES,       /* footnote definitions */
+  LIMIT_REFERRERS,       /* footnote references, all footnotes together */
+  LIMIT_OUTPUT_BYTES,    /* bytes written by flush_html */
+  LIMIT_TIME_MS,         /* wall clock since the conversion began */
+  N_LIMITS,
+} Limit;
+
+/*
+ * @LimitState
+ *
+ * one conversion against the limits: the first one it hit, and when it
+ * began.  Each doc has its own (MD.limits), so a doc of a stream or a
+ * book chapter doesn't stop the others.  The values are set once per
+ * process, before converting, see limit_set ()
+ */
+typedef struct {
+  Limit    exceeded;     /* first limit hit, sticky */
+  uint64_t start_ms;     /* LIMIT_TIME_MS counts from here */
+} LimitState;
+
+/* checked inline so that unlimited conversions cost a branch */
+extern bool limit_timed;
+
+bool        limit_parse        (const char *spec,
+                                Limit      *limit,
+                                uint64_t   *value);
+void        limit_set          (Limit       limit,
+                                uint64_t    value);
+uint64_t    limit_get          (Limit       limit);
+void        limit_state_init   (LimitState *state);
+bool        limit_check        (LimitState *state,
+                                Limit       limit,
+                                uint64_t    value);
+bool        limit_check_time_  (LimitState *state);
+const char *limit_name         (Limit       limit);
+
+static inline bool
+limit_check_time (LimitState *state)
+{
+  return !limit_timed || limit_check_time_ (state);
+}
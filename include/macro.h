@@ -27,20 +27,20 @@
 #define TABSPACE  "\t"
 
 #define INSERT_NEWLINE(file) \
-        fwrite (NEWLINE, sizeof(char), 1, file);
+        output_write (file, NEWLINE, 1);
 
 #define INSERT_TABSPACE(file) \
-        fwrite (TABSPACE, sizeof (char), 1, file);
+        output_write (file, TABSPACE, 1);
 
 #define INSERT_LINEBREAK(file) \
-        fwrite (LINEBREAK, sizeof (char), 4, file);
+        output_write (file, LINEBREAK, 4);
 
-#define UL_TOP_LEVEL_START(file)                               \
-        fwrite (TABSPACE, sizeof (char), 1, file);             \
-        fwrite ("<ul>", sizeof (char), strlen ("<ul>"), file); \
-        fwrite (NEWLINE, sizeof (char), 1, file);
+#define UL_TOP_LEVEL_START(file)                      \
+        output_write (file, TABSPACE, 1);             \
+        output_write (file, "<ul>", strlen ("<ul>")); \
+        output_write (file, NEWLINE, 1);
 
-#define UL_TOP_LEVEL_END(file)                                   \
-        fwrite (NEWLINE, sizeof (char), 1, file);                \
-        fwrite (TABSPACE, sizeof (char), 1, file);               \
-        fwrite ("</ul>", sizeof (char), strlen ("</ul>"), file);
+#define UL_TOP_LEVEL_END(file)                          \
+        output_write (file, NEWLINE, 1);                \
+        output_write (file, TABSPACE, 1);               \
+        output_write (file, "</ul>", strlen ("</ul>"));
@@ -23,11 +23,12 @@
 
 #include "lang.h"
 #include "footnotes.h"
+#include "limit.h"
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdio.h>
 
-typedef unsigned int uint;
-
 /*
  * @MDFile
  */
@@ -49,24 +50,68 @@ typedef enum {
 typedef struct MDUnit{
   UnitType type;
   char *content;
+  size_t content_len;
+  bool borrowed;     /* content points into the input buffer; not owned,
+                      * not NUL-terminated */
   char *uri;
 
   /* For codeblocks */
   Lang lang;
 
+  size_t line;       /* source line, starting at 1 */
+  size_t part;       /* input file of a book, see md_concat (); else 0 */
+
   struct MDUnit *next;
 } MDUnit;
 
+#define MD_MAX_INVALID_OFFSETS 8
+
 typedef struct {
-  uint n_lines;
+  size_t n_lines;
+
+  /* input */
+  size_t n_bytes;            /* bytes read from the input */
+  size_t n_invalid;          /* malformed UTF-8 sequences */
+  size_t invalid_offsets[MD_MAX_INVALID_OFFSETS]; /* byte offsets of the first few */
+  size_t open_fence;         /* line of a code block that is never
+                              * closed, 0 if none */
 
   /* Linked List */
   MDUnit *elements;
+  MDUnit *unit_block;        /* backs all the units when they were
+                              * allocated together, see ast_load () */
 
   /* footnotes */
   Footnotes *notes;
+
+  /* the limits this doc hit while being parsed or rendered */
+  LimitState limits;
 } MD;
 
 
-MD  *parse_md (MDFile *file);
+UnitType    find_md_unit_type (char    *line);
+const char *md_unit_type_name (UnitType type);
+const char *md_lang_name      (Lang     lang);
+
+MD  *parse_md        (MDFile     *file);
+MD  *parse_md_buffer (const char *buf,
+                      size_t      len);
+MD  *md_concat       (MD        **parts,
+                      size_t      n_parts);
 void md_free (MD *md);
+
+/*
+ * @MDParser
+ *
+ * push parser; the doc is fed in arbitrary pieces
+ */
+typedef struct MDParser MDParser;
+
+MDParser *md_parser_new       (void);
+bool      md_parser_feed      (MDParser   *parser,
+                               const char *buf,
+                               size_t      len);
+MD       *md_parser_finish    (MDParser   *parser);
+MD       *md_parser_get_md    (MDParser   *parser);
+MDUnit   *md_parser_next_unit (MDParser   *parser);
+void      md_parser_free      (MDParser   *parser);
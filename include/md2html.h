@@ -0,0 +1,62 @@
+/* md2html.h
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * @MD2HTML
+ *
+ * push API: the markdown doc is fed in pieces as it arrives and the
+ * HTML comes out through a callback as blocks complete
+ *
+ * A block is held back until the one after it has been parsed (lists
+ * and line breaks depend on it) and while it refers to a footnote that
+ * isn't defined yet; the output is the same as converting the whole
+ * doc at once.
+ */
+typedef struct MD2HTML MD2HTML;
+
+typedef void (*MD2HTMLFunc) (const char *html,
+                             size_t      len,
+                             void       *user_data);
+
+typedef struct {
+  const char *title;       /* NULL for the first h1, or "Document" */
+  const char *stylesheet;  /* href of a css file, or NULL */
+  bool        inline_css;  /* read and embed the stylesheet instead, see css.h */
+  bool        document;    /* wrap in the HTML document template */
+  const char *template_file; /* page template instead, see template.h */
+  bool        minify;      /* no formatting whitespace */
+} MD2HTMLOptions;
+
+
+MD2HTML *md2html_new    (const MD2HTMLOptions *options,
+                         MD2HTMLFunc           func,
+                         void                 *user_data,
+                         const char          **error);
+bool     md2html_feed   (MD2HTML              *ctx,
+                         const char           *buf,
+                         size_t                len);
+bool     md2html_finish (MD2HTML              *ctx);
+void     md2html_free   (MD2HTML              *ctx);
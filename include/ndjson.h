@@ -0,0 +1,41 @@
+/* ndjson.h
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdio.h>
+#include "output.h"
+#include "params.h"
+
+/*
+ * newline-delimited JSON streams
+ *
+ * each line read is a request, {"id": ..., "markdown": "...",
+ * "options": {...}}; each line written is the response to one,
+ * {"id": ..., "html": "...", "timing_ms": {...}} or {"id": ...,
+ * "error": "..."}.  Documents are converted on a pool of threads and
+ * answered as they are done, not in the order they came
+ */
+
+bool ndjson_convert (FILE        *in,
+                     Output      *out,
+                     Params      *params,
+                     const char **error);
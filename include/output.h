@@ -0,0 +1,59 @@
+/* output.h
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * @Output
+ *
+ * buffered writer over a file descriptor; small writes are copied into
+ * a chunk, large ones are referenced in place and everything goes out
+ * in writev () batches
+ */
+struct Output;
+typedef struct Output Output;
+
+typedef void (*OutputFunc) (const char *buf,
+                            size_t      len,
+                            void       *user_data);
+
+
+Output *output_new       (int         fd);
+Output *output_new_func  (OutputFunc  func,
+                          void       *user_data);
+bool    output_tee       (Output     *out,
+                          OutputFunc  func,
+                          void       *user_data);
+void    output_write     (Output     *out,
+                          const char *str,
+                          size_t      len);
+void    output_write_ref (Output     *out,
+                          const char *str,
+                          size_t      len);
+void    output_printf    (Output     *out,
+                          const char *format,
+                          ...) __attribute__ ((format (printf, 2, 3)));
+bool    output_flush     (Output     *out);
+size_t  output_get_bytes (Output     *out);
+bool    output_free      (Output     *out);
@@ -22,6 +22,9 @@
 #pragma once
 
 #include <stdbool.h>
+#include "stats.h"
+#include "limit.h"
+#include "compress.h"
 
 
 typedef struct Params {
@@ -31,8 +34,51 @@ typedef struct Params {
   char *title;       /* HTML doc title */
 
   char *css_file;  /* set inline css equal to contents of .css file */
+  bool inline_css;   /* embed css_file minified instead of linking it */
+  char *css_cache;   /* keeps minified css across runs; implies inline_css */
 
   bool document;     /* adds HTML document template code; defaults to true */
+  char *template_file; /* page template instead of the built-in one, see template.h */
+  bool minify;       /* leave out formatting whitespace */
+
+  StatsFormat stats; /* print per-stage statistics on exit */
+  char *trace_file;  /* write a Chrome trace-event timeline */
+  uint64_t limits[N_LIMITS]; /* resource limits; 0 is unlimited */
+
+  char **formats;    /* NAME[=FILE] outputs rendered from one parse */
+  size_t n_formats;
+
+  char *ast_file;    /* save the parsed doc here instead of rendering */
+  bool from_ast;     /* input is a saved doc, see ast.h */
+
+  char *index_file;  /* search index of the HTML doc, see index.h */
+  bool image_sizes;  /* <img> gets width/height of local images, lazy loading */
+  char *image_cache; /* keeps image sizes across runs; implies image_sizes */
+
+  int compress_levels[N_COMPRESS_CODECS]; /* precompressed copies; 0 for none */
+  char *zstd_dict;   /* dictionary for the .zst copy */
+
+  bool tar;          /* convert the .md members of a tar stream */
+  bool ndjson;       /* answer JSON requests, see ndjson.h */
+  int preview_port;  /* serve i_file (a directory) over HTTP, see preview.h;
+                      * -1 for none */
+  size_t jobs;       /* threads converting members, requests or pages,
+                      * parsing chapters or checking files; 0 for online
+                      * CPUs */
+
+  char **book_inputs; /* chapters rendered as one doc, instead of i_file */
+  size_t n_book_inputs;
+
+  char **check_inputs; /* validate these instead of converting, see check.h */
+  size_t n_check_inputs;
+
+  char *merge_file;  /* merge indexes into this one instead of converting */
+  char **merge_inputs;
+  size_t n_merge_inputs;
+
+  char *train_file;  /* train a zstd dictionary instead of converting */
+  char **train_inputs;
+  size_t n_train_inputs;
 
   bool version;      /* output version information */
   bool help;         /* display usage message */
@@ -0,0 +1,40 @@
+/* preview.h
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include "params.h"
+
+/*
+ * live preview: a directory of markdown served as HTML over HTTP on
+ * localhost
+ *
+ * rendered pages are kept in memory, least recently used first out, and
+ * are valid while the mtime and size of their file stay the same; those
+ * also make the ETag, so unchanged pages are answered with 304.  Cache
+ * hits are answered right away, misses are rendered on a pool of threads
+ */
+
+bool preview_serve (const char  *root,
+                    int          port,
+                    Params      *params,
+                    const char  *binary,
+                    const char **error);
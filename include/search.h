@@ -0,0 +1,85 @@
+/* search.h
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+/*
+ * @Search
+ *
+ * memoized strstr () for scanners that look for a closing pattern from
+ * every candidate opening position
+ *
+ * The last answer covers [from, found]: there is no match between the
+ * two, so any later start inside that range gets the same answer (and a
+ * failed search fails for any later start too).  Starts only move
+ * forward, so each pattern scans the text once instead of once per
+ * opening position.
+ */
+
+/* rejects a match; must not depend on where the search started */
+typedef bool (*SearchFilter) (const char *match);
+
+typedef struct {
+  const char   *pattern;
+  SearchFilter  filter;
+
+  const char   *from;
+  const char   *found;  /* NULL if nothing matches at or after from */
+} Search;
+
+static inline void
+search_init (Search       *search,
+             const char   *pattern,
+             SearchFilter  filter)
+{
+  search->pattern = pattern;
+  search->filter = filter;
+  search->from = NULL;
+  search->found = NULL;
+}
+
+static inline char *
+search_find (Search     *search,
+             const char *start)
+{
+  const char *found = start;
+
+  if (search->from != NULL && start >= search->from &&
+      (search->found == NULL || start <= search->found))
+    return (char *) search->found;
+
+  while ((found = strstr (found, search->pattern)) != NULL)
+    {
+      if (search->filter == NULL || search->filter (found))
+        break;
+
+      found++;
+    }
+
+  search->from = start;
+  search->found = found;
+
+  return (char *) found;
+}
@@ -0,0 +1,96 @@
+/* stats.h
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "lang.h"
+#include "md.h"
+
+typedef enum {
+  STATS_FORMAT_NONE,
+  STATS_FORMAT_TEXT,
+  STATS_FORMAT_JSON,
+} StatsFormat;
+
+/*
+ * Keep order in-sync with stage_names in stats.c
+ */
+typedef enum {
+  STATS_STAGE_PARSE,          /* parse_md, includes decompress */
+  STATS_STAGE_DECOMPRESS,     /* compressed input, see input.h */
+  STATS_STAGE_HTML,           /* html_from_md */
+  STATS_STAGE_FLUSH,          /* flush_html, includes the stages below */
+  STATS_STAGE_FORMAT,         /* format_text */
+  STATS_STAGE_HIGHLIGHT,      /* syntax_highlight, one per Lang */
+  STATS_STAGE_FOOTNOTES = STATS_STAGE_HIGHLIGHT + LANG_NONE,
+  STATS_STAGE_COMPRESS,       /* precompressed copies, see compress.h */
+  N_STATS_STAGES,
+} StatsStage;
+
+#define STATS_STAGE_HIGHLIGHT_LANG(lang) \
+        ((StatsStage) (STATS_STAGE_HIGHLIGHT + (lang)))
+
+typedef enum {
+  STATS_COUNTER_BYTES_IN,
+  STATS_COUNTER_BYTES_OUT,
+  STATS_COUNTER_ALLOCS,
+  STATS_COUNTER_ALLOC_BYTES,
+  STATS_COUNTER_COMPRESSED_IN,
+  STATS_COUNTER_DECOMPRESSED,
+  N_STATS_COUNTERS,
+} StatsCounter;
+
+typedef struct {
+  uint64_t wall_ns;
+  uint64_t cpu_ns;
+} StatsTimer;
+
+/* checked inline so that disabled stats cost a branch */
+extern bool stats_enabled;
+
+void     stats_enable       (void);
+void     stats_timer_start_ (StatsTimer  *timer);
+void     stats_timer_stop_  (StatsTimer  *timer,
+                             StatsStage   stage);
+void     stats_add          (StatsCounter counter,
+                             uint64_t     value);
+uint64_t stats_get          (StatsCounter counter);
+void     stats_count_md     (MD          *md);
+void     stats_print        (FILE        *file,
+                             StatsFormat  format);
+
+static inline void
+stats_timer_start (StatsTimer *timer)
+{
+  if (stats_enabled)
+    stats_timer_start_ (timer);
+}
+
+static inline void
+stats_timer_stop (StatsTimer *timer,
+                  StatsStage  stage)
+{
+  if (stats_enabled)
+    stats_timer_stop_ (timer, stage);
+}
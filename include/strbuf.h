@@ -0,0 +1,75 @@
+/* strbuf.h
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+
+#pragma once
+
+#include <stddef.h>
+#include <string.h>
+
+/*
+ * @StrBuf
+ *
+ * growable NUL-terminated string; sizes are size_t all the way
+ */
+typedef struct StrBuf {
+  char   *str;
+  size_t  len;
+  size_t  size;
+} StrBuf;
+
+
+void  strbuf_init    (StrBuf *buf,
+                      size_t  size);
+void  strbuf_grow    (StrBuf *buf,
+                      size_t  extra);
+char *strbuf_steal   (StrBuf *buf);
+void  strbuf_free    (StrBuf *buf);
+
+static inline void
+strbuf_append_len (StrBuf     *buf,
+                   const char *str,
+                   size_t      len)
+{
+  if (buf->len + len >= buf->size)
+    strbuf_grow (buf, len);
+
+  memcpy (buf->str + buf->len, str, len);
+  buf->len += len;
+  buf->str[buf->len] = '\0';
+}
+
+static inline void
+strbuf_append (StrBuf     *buf,
+               const char *str)
+{
+  strbuf_append_len (buf, str, strlen (str));
+}
+
+static inline void
+strbuf_append_c (StrBuf *buf,
+                 char    c)
+{
+  if (buf->len + 1 >= buf->size)
+    strbuf_grow (buf, 1);
+
+  buf->str[buf->len++] = c;
+  buf->str[buf->len] = '\0';
+}
@@ -0,0 +1,42 @@
+/* tar.h
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include "limit.h"
+#include "md.h"
+#include "output.h"
+#include "params.h"
+
+/*
+ * tar streams of markdown documents
+ *
+ * a tar stream is read in one pass; its .md members are converted in
+ * memory on a pool of threads and written back as .html members, in
+ * the order they came, while other members pass through as they are
+ */
+
+bool tar_convert (MDFile      *in,
+                  Output      *out,
+                  Params      *params,
+                  const char  *binary,
+                  Limit       *exceeded,
+                  const char **error);
@@ -0,0 +1,64 @@
+/* template.h
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * page templates
+ *
+ * an HTML file with {{title}}, {{stylesheet}}, {{content}} and
+ * {{footnotes}} placeholders takes the place of the built-in document
+ * wrapper.  It's compiled once into literal segments, each followed by
+ * a slot, and every doc of a run is written from the compiled form.
+ * Other {{...}} are left as they are
+ */
+
+typedef enum {
+  TEMPLATE_SLOT_TITLE,
+  TEMPLATE_SLOT_STYLESHEET,  /* the <link> or <style> element */
+  TEMPLATE_SLOT_CONTENT,     /* exactly once */
+  TEMPLATE_SLOT_FOOTNOTES,   /* after the content; right after it if missing */
+  TEMPLATE_SLOT_NONE,        /* end of the template */
+} TemplateSlot;
+
+typedef struct {
+  const char   *text;        /* literal text before the slot */
+  size_t        len;
+  TemplateSlot  slot;
+} TemplateSegment;
+
+typedef struct {
+  char            *source;
+  TemplateSegment *segments;
+  size_t           n_segments;
+  size_t           content;  /* segment of the content slot */
+  bool             has_footnotes;
+} Template;
+
+Template       *template_compile (const char  *source,
+                                  size_t       len,
+                                  const char **error);
+void            template_free    (Template    *template);
+const Template *template_get     (const char  *path,
+                                  const char **error);
+void            template_close   (void);
@@ -0,0 +1,81 @@
+/* trace.h
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Chrome trace-event / Perfetto timeline of a conversion
+ *
+ * Spans are kept in memory and written out by trace_close ()
+ */
+
+typedef struct {
+  uint64_t start_ns;
+} TraceSpan;
+
+/* checked inline so that disabled tracing costs a branch */
+extern bool trace_enabled;
+
+bool     trace_open      (const char *file_name);
+bool     trace_close     (void);
+uint64_t trace_now_      (void);
+void     trace_end_      (TraceSpan  *span,
+                          const char *name,
+                          const char *type,
+                          const char *lang,
+                          size_t      line);
+
+static inline void
+trace_begin (TraceSpan *span)
+{
+  if (trace_enabled)
+    span->start_ns = trace_now_ ();
+}
+
+/*
+ * trace_end_args
+ * @span: started by trace_begin ()
+ * @name: span name; must be a string literal
+ * @type: unit type or NULL
+ * @lang: code block language or NULL
+ * @line: source line or 0
+ */
+static inline void
+trace_end_args (TraceSpan  *span,
+                const char *name,
+                const char *type,
+                const char *lang,
+                size_t      line)
+{
+  if (trace_enabled)
+    trace_end_ (span, name, type, lang, line);
+}
+
+static inline void
+trace_end (TraceSpan  *span,
+           const char *name)
+{
+  trace_end_args (span, name, NULL, NULL, 0);
+}
@@ -22,9 +22,13 @@
 #pragma once
 
 #include <stddef.h>
+#include "strbuf.h"
 
 const char *xml_char_replace    (char c);
 size_t      xml_sanitize_strcpy (char   *dest,
                                  char   *src,
                                  size_t  n);
 
+void        xml_sanitize_append (StrBuf *buf,
+                                 const char *src,
+                                 size_t  n);
@@ -0,0 +1,102 @@
+/* alloc.c
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+/*
+ * Allocation accounting for --stats
+ *
+ * Linked with -Wl,--wrap=... (see src/CMakeLists.txt) so that every
+ * allocation made by md2html itself is counted; allocations made
+ * inside libc (e.g. by getline) are not.
+ */
+
+#include "stats.h"
+
+#include <stddef.h>
+#include <string.h>
+
+void *__real_malloc  (size_t size);
+void *__real_calloc  (size_t nmemb,
+                      size_t size);
+void *__real_realloc (void  *ptr,
+                      size_t size);
+
+void *
+__wrap_malloc (size_t size)
+{
+  if (stats_enabled)
+    {
+      stats_add (STATS_COUNTER_ALLOCS, 1);
+      stats_add (STATS_COUNTER_ALLOC_BYTES, size);
+    }
+
+  return __real_malloc (size);
+}
+
+void *
+__wrap_calloc (size_t nmemb,
+               size_t size)
+{
+  if (stats_enabled)
+    {
+      stats_add (STATS_COUNTER_ALLOCS, 1);
+      stats_add (STATS_COUNTER_ALLOC_BYTES, nmemb * size);
+    }
+
+  return __real_calloc (nmemb, size);
+}
+
+void *
+__wrap_realloc (void  *ptr,
+                size_t size)
+{
+  if (stats_enabled)
+    {
+      stats_add (STATS_COUNTER_ALLOCS, 1);
+      stats_add (STATS_COUNTER_ALLOC_BYTES, size);
+    }
+
+  return __real_realloc (ptr, size);
+}
+
+char *
+__wrap_strdup (const char *str)
+{
+  size_t len = strlen (str) + 1;
+  char *dup;
+
+  dup = __wrap_malloc (len);
+  memcpy (dup, str, len);
+
+  return dup;
+}
+
+char *
+__wrap_strndup (const char *str,
+                size_t      n)
+{
+  size_t len = strnlen (str, n);
+  char *dup;
+
+  dup = __wrap_malloc (len + 1);
+  memcpy (dup, str, len);
+  dup[len] = '\0';
+
+  return dup;
+}
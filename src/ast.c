@@ -0,0 +1,319 @@
+/* ast.c
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "ast.h"
+#include "limit.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define AST_BYTE_ORDER 0x01020304
+
+/*
+ * blob_add
+ * @blob_size: running size of the blob
+ * @str: may be NULL
+ * @len
+ *
+ * returns the offset @str gets in the blob
+ */
+static uint64_t
+blob_add (uint64_t   *blob_size,
+          const char *str,
+          size_t      len)
+{
+  uint64_t offset = *blob_size;
+
+  if (str == NULL)
+    return AST_NO_STRING;
+
+  *blob_size += len + 1;
+
+  return offset;
+}
+
+static void
+write_string (Output     *out,
+              const char *str,
+              size_t      len)
+{
+  if (str == NULL)
+    return;
+
+  output_write_ref (out, str, len);
+  output_write (out, "", 1);
+}
+
+/*
+ * ast_write
+ * @md: parsed doc; content must not have been released yet
+ * @out
+ *
+ * serializes @md, see @AST for the layout; @md is referenced until
+ * @out is flushed
+ */
+bool
+ast_write (MD     *md,
+           Output *out)
+{
+  AstHeader header = { 0 };
+  uint64_t blob_size = 0;
+
+  memcpy (header.magic, AST_MAGIC, sizeof (header.magic));
+  header.version = AST_VERSION;
+  header.byte_order = AST_BYTE_ORDER;
+  header.n_notes = footnotes_get_count (md->notes);
+  header.n_bytes = md->n_bytes;
+  header.n_invalid = md->n_invalid;
+  for (size_t i = 0; i < md->n_invalid && i < MD_MAX_INVALID_OFFSETS; i++)
+    header.invalid_offsets[i] = md->invalid_offsets[i];
+
+  for (MDUnit *unit = md->elements; unit != NULL; unit = unit->next)
+    {
+      header.n_units++;
+      blob_add (&header.blob_size, unit->content, unit->content_len);
+    }
+
+  for (size_t i = 0; i < header.n_notes; i++)
+    {
+      Reference *ref = footnotes_get_ref_from_index (md->notes, i);
+
+      if (ref->identifier != NULL)
+        blob_add (&header.blob_size, ref->identifier, strlen (ref->identifier));
+      if (ref->text != NULL)
+        blob_add (&header.blob_size, ref->text, strlen (ref->text));
+    }
+
+  output_write (out, (const char *) &header, sizeof (header));
+
+  /* the tables go in the same order as the strings they point at */
+  for (MDUnit *unit = md->elements; unit != NULL; unit = unit->next)
+    {
+      AstUnit entry = {
+        .type = unit->type,
+        .lang = unit->lang,
+        .line = unit->line,
+        .content = blob_add (&blob_size, unit->content, unit->content_len),
+        .content_len = unit->content != NULL ? unit->content_len : 0,
+      };
+
+      output_write (out, (const char *) &entry, sizeof (entry));
+    }
+
+  for (size_t i = 0; i < header.n_notes; i++)
+    {
+      Reference *ref = footnotes_get_ref_from_index (md->notes, i);
+      AstNote entry = { 0 };
+
+      entry.identifier_len = ref->identifier ? strlen (ref->identifier) : 0;
+      entry.identifier = blob_add (&blob_size, ref->identifier, entry.identifier_len);
+      entry.text_len = ref->text ? strlen (ref->text) : 0;
+      entry.text = blob_add (&blob_size, ref->text, entry.text_len);
+
+      output_write (out, (const char *) &entry, sizeof (entry));
+    }
+
+  for (MDUnit *unit = md->elements; unit != NULL; unit = unit->next)
+    write_string (out, unit->content, unit->content_len);
+
+  for (size_t i = 0; i < header.n_notes; i++)
+    {
+      Reference *ref = footnotes_get_ref_from_index (md->notes, i);
+
+      if (ref->identifier != NULL)
+        write_string (out, ref->identifier, strlen (ref->identifier));
+      if (ref->text != NULL)
+        write_string (out, ref->text, strlen (ref->text));
+    }
+
+  return output_flush (out);
+}
+
+/*
+ * blob_string
+ *
+ * returns the string at @offset if it lies within the blob and is
+ * NUL-terminated right after @len bytes, "" for AST_NO_STRING, or NULL
+ * if it's corrupt; renderers take both the length and the NUL for it
+ */
+static const char *
+blob_string (const char *blob,
+             uint64_t    blob_size,
+             uint64_t    offset,
+             uint64_t    len)
+{
+  if (offset == AST_NO_STRING)
+    return len == 0 ? "" : NULL;
+
+  if (offset >= blob_size || len >= blob_size - offset || blob[offset + len] != '\0' ||
+      memchr (blob + offset, '\0', len) != NULL)
+    return NULL;
+
+  return blob + offset;
+}
+
+static MD *
+md_new_empty (const LimitState *limits)
+{
+  MD *md;
+
+  md = calloc (1, sizeof (MD));
+  md->notes = footnotes_new ();
+  md->limits = *limits;
+
+  return md;
+}
+
+/*
+ * ast_load
+ * @buf: AST file contents, 8-byte aligned, e.g. a memory mapped file
+ * @len: size of @buf
+ * @error: set to the reason when NULL is returned
+ *
+ * validates @buf and turns it into an MD doc; unit content mostly
+ * points into @buf (see MDUnit.borrowed), so it has to outlive the MD
+ * and HTML docs. Like parse_md (), a limit leaves a partial (empty) doc.
+ */
+MD *
+ast_load (const char  *buf,
+          size_t       len,
+          const char **error)
+{
+  const AstHeader *header = (const AstHeader *) buf;
+  const AstUnit *units;
+  const AstNote *notes;
+  const char *blob;
+  size_t left;
+  MD *md;
+  MDUnit **tail;
+  LimitState limits;
+
+  limit_state_init (&limits);
+  if (!limit_check (&limits, LIMIT_INPUT_BYTES, len))
+    return md_new_empty (&limits);
+
+  if (len < sizeof (AstHeader) || memcmp (header->magic, AST_MAGIC, sizeof (header->magic)) != 0)
+    {
+      *error = "not an AST file";
+      return NULL;
+    }
+
+  if (header->byte_order != AST_BYTE_ORDER)
+    {
+      *error = "AST was written with another byte order";
+      return NULL;
+    }
+
+  if (header->version != AST_VERSION)
+    {
+      *error = "unsupported AST version";
+      return NULL;
+    }
+
+  /* every table has to fit, without overflowing */
+  left = len - sizeof (AstHeader);
+  if (header->n_units > left / sizeof (AstUnit) ||
+      header->n_notes > (left - header->n_units * sizeof (AstUnit)) / sizeof (AstNote) ||
+      header->blob_size != left - header->n_units * sizeof (AstUnit)
+                                - header->n_notes * sizeof (AstNote))
+    {
+      *error = "truncated or corrupt AST";
+      return NULL;
+    }
+
+  if (!limit_check (&limits, LIMIT_UNITS, header->n_units) ||
+      !limit_check (&limits, LIMIT_FOOTNOTES, header->n_notes))
+    return md_new_empty (&limits);
+
+  units = (const AstUnit *) (header + 1);
+  notes = (const AstNote *) (units + header->n_units);
+  blob = (const char *) (notes + header->n_notes);
+
+  for (uint64_t i = 0; i < header->n_units; i++)
+    {
+      /* a code block has at least its opening newline */
+      if (units[i].type > UNIT_TYPE_NONE || units[i].lang > LANG_NONE ||
+          (units[i].type == UNIT_TYPE_CODE_BLOCK && units[i].content_len == 0) ||
+          blob_string (blob, header->blob_size, units[i].content, units[i].content_len) == NULL)
+        {
+          *error = "corrupt AST unit";
+          return NULL;
+        }
+    }
+
+  for (uint64_t i = 0; i < header->n_notes; i++)
+    {
+      if (blob_string (blob, header->blob_size, notes[i].identifier, notes[i].identifier_len) == NULL ||
+          blob_string (blob, header->blob_size, notes[i].text, notes[i].text_len) == NULL)
+        {
+          *error = "corrupt AST footnote";
+          return NULL;
+        }
+    }
+
+  md = md_new_empty (&limits);
+  md->n_lines = header->n_units;
+  md->n_bytes = header->n_bytes;
+  md->n_invalid = header->n_invalid;
+  memcpy (md->invalid_offsets, header->invalid_offsets, sizeof (md->invalid_offsets));
+
+  /* one allocation for the whole list */
+  md->unit_block = calloc (header->n_units ? header->n_units : 1, sizeof (MDUnit));
+
+  tail = &md->elements;
+  for (uint64_t i = 0; i < header->n_units; i++)
+    {
+      MDUnit *unit = &md->unit_block[i];
+
+      unit->type = units[i].type;
+      unit->lang = units[i].lang;
+      unit->line = units[i].line;
+      if (units[i].content != AST_NO_STRING)
+        {
+          const char *content = blob + units[i].content;
+
+          unit->content_len = units[i].content_len;
+
+          /* highlighters need a private copy, same as in parse_md () */
+          if (unit->type == UNIT_TYPE_CODE_BLOCK &&
+              unit->lang != LANG_NONE && unit->lang != LANG_HTML)
+            {
+              unit->content = strndup (content, unit->content_len);
+            }
+          else
+            {
+              unit->content = (char *) content;
+              unit->borrowed = true;
+            }
+        }
+
+      *tail = unit;
+      tail = &unit->next;
+    }
+
+  for (uint64_t i = 0; i < header->n_notes; i++)
+    {
+      footnotes_add (md->notes,
+                     notes[i].identifier == AST_NO_STRING ? NULL : (char *) blob + notes[i].identifier,
+                     notes[i].text == AST_NO_STRING ? NULL : (char *) blob + notes[i].text);
+    }
+
+  return md;
+}
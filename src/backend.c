@@ -0,0 +1,234 @@
+/* backend.c
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "backend.h"
+#include "html.h"
+#include "limit.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static const Backend *backends[] = {
+  &backend_html,
+  &backend_text,
+  &backend_ansi,
+};
+
+/*
+ * html
+ *
+ * drives the regular HTML renderer a unit at a time, so the output is
+ * the same as flush_html ()'s
+ */
+typedef struct {
+  Output       *out;
+  HTML         *html;   /* options and footnotes; holds no units */
+
+  bool          begun;
+  HTMLUnit      prev;
+  bool          has_prev;
+} HTMLBackend;
+
+static void *
+html_backend_new (Output *out,
+                  Params *params,
+                  MD     *md)
+{
+  HTMLBackend *backend;
+
+  backend = calloc (1, sizeof (HTMLBackend));
+  backend->out = out;
+  backend->html = html_new (params, md);
+
+  return backend;
+}
+
+static void
+html_backend_enter_block (const MDBlock *block,
+                          void          *user_data)
+{
+  HTMLBackend *backend = user_data;
+  HTMLUnit unit, next;
+
+  /* lists and footnotes are taken care of by the renderer */
+  if (block->unit == NULL)
+    return;
+
+  html_unit_view (&unit, block->unit);
+  if (block->unit->next != NULL)
+    html_unit_view (&next, block->unit->next);
+
+  if (!backend->begun)
+    {
+      html_write_begin (backend->out, backend->html, &unit);
+      backend->begun = true;
+    }
+
+  html_write_unit (backend->out, backend->html,
+                   backend->has_prev ? &backend->prev : NULL,
+                   &unit,
+                   block->unit->next != NULL ? &next : NULL);
+
+  backend->prev = unit;
+  backend->has_prev = true;
+
+  limit_check (backend->html->limits, LIMIT_OUTPUT_BYTES, output_get_bytes (backend->out));
+}
+
+static void
+html_backend_finish (void *state)
+{
+  HTMLBackend *backend = state;
+
+  if (backend->html->limits->exceeded == LIMIT_NONE)
+    {
+      if (!backend->begun)
+        html_write_begin (backend->out, backend->html, NULL);
+
+      html_write_end (backend->out, backend->html);
+    }
+
+  html_free (backend->html);
+  free (backend);
+}
+
+const Backend backend_html = {
+  .name = "html",
+  .events = {
+    .enter_block = html_backend_enter_block,
+  },
+  .new = html_backend_new,
+  .finish = html_backend_finish,
+};
+
+/*
+ * fan-out: one walk feeds every backend
+ */
+typedef struct {
+  const Backend **backends;
+  void          **states;
+  size_t          n_backends;
+} Tee;
+
+#define TEE_FORWARD(tee, callback, ...)                              \
+        for (size_t i = 0; i < (tee)->n_backends; i++)               \
+          {                                                          \
+            if ((tee)->backends[i]->events.callback)                 \
+              (tee)->backends[i]->events.callback (__VA_ARGS__,      \
+                                                   (tee)->states[i]); \
+          }
+
+static void
+tee_enter_block (const MDBlock *block,
+                 void          *user_data)
+{
+  TEE_FORWARD ((Tee *) user_data, enter_block, block);
+}
+
+static void
+tee_leave_block (const MDBlock *block,
+                 void          *user_data)
+{
+  TEE_FORWARD ((Tee *) user_data, leave_block, block);
+}
+
+static void
+tee_enter_span (const MDSpan *span,
+                void         *user_data)
+{
+  TEE_FORWARD ((Tee *) user_data, enter_span, span);
+}
+
+static void
+tee_leave_span (const MDSpan *span,
+                void         *user_data)
+{
+  TEE_FORWARD ((Tee *) user_data, leave_span, span);
+}
+
+static void
+tee_text (const char *text,
+          size_t      len,
+          void       *user_data)
+{
+  TEE_FORWARD ((Tee *) user_data, text, text, len);
+}
+
+const Backend *
+backend_find (const char *name)
+{
+  for (size_t i = 0; i < sizeof (backends) / sizeof (backends[0]); i++)
+    {
+      if (strcmp (backends[i]->name, name) == 0)
+        return backends[i];
+    }
+
+  return NULL;
+}
+
+/*
+ * backends_render
+ * @md: parsed doc
+ * @params: output options
+ * @backends: formats to render
+ * @outs: one output per backend
+ * @n_backends
+ *
+ * renders @md in every format from a single walk; inline content is
+ * tokenized once, and only if a backend wants inline events
+ */
+void
+backends_render (MD             *md,
+                 Params         *params,
+                 const Backend **backends,
+                 Output        **outs,
+                 size_t          n_backends)
+{
+  MDEvents events = {
+    .enter_block = tee_enter_block,
+    .leave_block = tee_leave_block,
+  };
+  Tee tee;
+
+  tee.backends = backends;
+  tee.states = malloc (sizeof (void *) * n_backends);
+  tee.n_backends = n_backends;
+
+  for (size_t i = 0; i < n_backends; i++)
+    {
+      const MDEvents *e = &backends[i]->events;
+
+      tee.states[i] = backends[i]->new (outs[i], params, md);
+
+      if (e->enter_span || e->leave_span || e->text)
+        {
+          events.enter_span = tee_enter_span;
+          events.leave_span = tee_leave_span;
+          events.text = tee_text;
+        }
+    }
+
+  md_walk (md, &events, &tee);
+
+  for (size_t i = 0; i < n_backends; i++)
+    backends[i]->finish (tee.states[i]);
+
+  free (tee.states);
+}
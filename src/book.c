@@ -0,0 +1,218 @@
+/* book.c
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "book.h"
+#include "input.h"
+#include "stats.h"
+#include "trace.h"
+#include "limit.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+typedef struct {
+  const char *file;
+  MD *md;
+  const char *error;
+
+  /* code blocks of md may point into it */
+  void *map;
+  size_t map_len;
+} Chapter;
+
+struct Book {
+  Chapter *chapters;
+  size_t n_chapters;
+  _Atomic size_t next;   /* chapter to parse next */
+
+  MD *md;                /* merged */
+};
+
+/* runs on a worker */
+static void
+parse_chapter (Chapter *chapter)
+{
+  StatsTimer timer;
+  TraceSpan span;
+  MDFile *file;
+  struct stat st;
+
+  file = input_open (chapter->file, &chapter->error);
+  if (file == NULL)
+    return;
+
+  stats_timer_start (&timer);
+  trace_begin (&span);
+
+  /* same as a single doc: regular files are mapped, not copied */
+  if (fstat (fileno (file), &st) == 0 && S_ISREG (st.st_mode) && st.st_size > 0)
+    {
+      chapter->map = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno (file), 0);
+      if (chapter->map == MAP_FAILED)
+        chapter->map = NULL;
+      else
+        chapter->map_len = st.st_size;
+    }
+
+  if (chapter->map != NULL)
+    chapter->md = parse_md_buffer (chapter->map, chapter->map_len);
+  else
+    chapter->md = parse_md (file);
+
+  trace_end (&span, "parse_md");
+  stats_timer_stop (&timer, STATS_STAGE_PARSE);
+
+  chapter->error = input_error (file);
+  fclose (file);
+}
+
+static void *
+worker (void *user_data)
+{
+  Book *book = user_data;
+  size_t i;
+
+  while ((i = atomic_fetch_add (&book->next, 1)) < book->n_chapters)
+    parse_chapter (&book->chapters[i]);
+
+  return NULL;
+}
+
+/*
+ * book_parse
+ * @files: chapters, in order
+ * @n_files
+ * @n_jobs: threads parsing them; online CPUs if 0
+ * @bad: set to the chapter that failed
+ * @error: set when NULL is returned
+ *
+ * a chapter that can't be read, or is corrupt, fails the whole book
+ */
+Book *
+book_parse (char       **files,
+            size_t       n_files,
+            size_t       n_jobs,
+            size_t      *bad,
+            const char **error)
+{
+  Book *book = calloc (1, sizeof (Book));
+  pthread_t *workers;
+
+  book->chapters = calloc (n_files, sizeof (Chapter));
+  book->n_chapters = n_files;
+  for (size_t i = 0; i < n_files; i++)
+    book->chapters[i].file = files[i];
+
+  if (n_jobs == 0)
+    {
+      long n = sysconf (_SC_NPROCESSORS_ONLN);
+
+      n_jobs = n > 0 ? (size_t) n : 1;
+    }
+  if (n_jobs > n_files)
+    n_jobs = n_files;
+
+  workers = calloc (n_jobs, sizeof (pthread_t));
+  for (size_t i = 0; i < n_jobs; i++)
+    pthread_create (&workers[i], NULL, worker, book);
+  for (size_t i = 0; i < n_jobs; i++)
+    pthread_join (workers[i], NULL);
+  free (workers);
+
+  for (size_t i = 0; i < n_files; i++)
+    {
+      if (book->chapters[i].error != NULL)
+        {
+          *bad = i;
+          *error = book->chapters[i].error;
+          book_free (book);
+          return NULL;
+        }
+    }
+
+  return book;
+}
+
+/*
+ * book_chapter
+ * @book
+ * @i
+ *
+ * the parsed chapter @i, until book_merge ()
+ */
+MD *
+book_chapter (Book   *book,
+              size_t  i)
+{
+  return book->chapters[i].md;
+}
+
+/*
+ * book_merge
+ * @book
+ *
+ * returns the chapters as one doc; it's freed with @book.  Limits apply
+ * to the whole book
+ */
+MD *
+book_merge (Book *book)
+{
+  MD **parts = calloc (book->n_chapters, sizeof (MD *));
+
+  for (size_t i = 0; i < book->n_chapters; i++)
+    {
+      parts[i] = book->chapters[i].md;
+      book->chapters[i].md = NULL;
+    }
+
+  book->md = md_concat (parts, book->n_chapters);
+  free (parts);
+
+  limit_check (&book->md->limits, LIMIT_INPUT_BYTES, book->md->n_bytes);
+  limit_check (&book->md->limits, LIMIT_UNITS, book->md->n_lines);
+  limit_check (&book->md->limits, LIMIT_FOOTNOTES, footnotes_get_count (book->md->notes));
+
+  return book->md;
+}
+
+void
+book_free (Book *book)
+{
+  for (size_t i = 0; i < book->n_chapters; i++)
+    {
+      Chapter *chapter = &book->chapters[i];
+
+      if (chapter->md != NULL)
+        md_free (chapter->md);
+      if (chapter->map != NULL)
+        munmap (chapter->map, chapter->map_len);
+    }
+
+  if (book->md != NULL)
+    md_free (book->md);
+
+  free (book->chapters);
+  free (book);
+}
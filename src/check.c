@@ -0,0 +1,404 @@
+/* check.c
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#define _GNU_SOURCE
+
+#include "check.h"
+#include "events.h"
+#include "input.h"
+#include "limit.h"
+#include "stats.h"
+#include "trace.h"
+#include "url.h"
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+typedef struct {
+  size_t line;       /* 0 for the file as a whole */
+  size_t seq;        /* keeps the order of problems on one line */
+  char *message;
+} Problem;
+
+typedef struct {
+  const char *file;
+  Problem *problems;
+  size_t n_problems;
+  Limit limit;       /* hit while parsing or walking it */
+} CheckFile;
+
+typedef struct {
+  CheckFile *files;
+  size_t n_files;
+  _Atomic size_t next;   /* file to check next */
+} Check;
+
+/* walk over one doc */
+typedef struct {
+  CheckFile *check;
+  char *dir;         /* relative link targets start here */
+  size_t line;       /* of the block being walked */
+} Walk;
+
+static void
+add_problem (CheckFile  *check,
+             size_t      line,
+             const char *format,
+             ...)
+{
+  Problem *problem;
+  va_list args;
+
+  check->problems = realloc (check->problems,
+                             sizeof (Problem) * (check->n_problems + 1));
+  problem = &check->problems[check->n_problems];
+  problem->line = line;
+  problem->seq = check->n_problems++;
+
+  va_start (args, format);
+  if (vasprintf (&problem->message, format, args) < 0)
+    problem->message = NULL;
+  va_end (args);
+}
+
+static int
+compare_problems (const void *a,
+                  const void *b)
+{
+  const Problem *pa = a, *pb = b;
+
+  if (pa->line != pb->line)
+    return pa->line < pb->line ? -1 : 1;
+
+  return pa->seq < pb->seq ? -1 : pa->seq > pb->seq;
+}
+
+/*
+ * target_path
+ * @dir: of the markdown file
+ * @href: link target or image source
+ * @len
+ * @path: set to the file @href names, percent-decoded
+ * @path_size
+ *
+ * returns false for targets that aren't local files, i.e. URLs with a
+ * scheme or a host, site-absolute ones and fragments of the page itself
+ */
+static bool
+target_path (const char *dir,
+             const char *href,
+             size_t      len,
+             char       *path,
+             size_t      path_size)
+{
+  size_t end = 0;
+  size_t n;
+
+  if (len == 0 || href[0] == '/')
+    return false;
+
+  /* the query and the fragment aren't part of the file name */
+  while (end < len && href[end] != '?' && href[end] != '#')
+    {
+      /* a scheme, e.g. https: or mailto: */
+      if (href[end] == ':')
+        return false;
+      end++;
+    }
+
+  if (end == 0)
+    return false;
+
+  if (strcmp (dir, ".") == 0)
+    n = 0;
+  else if ((n = snprintf (path, path_size, "%s/", dir)) >= path_size)
+    return false;
+
+  if (n + end >= path_size)
+    return false;
+
+  return url_decode (path + n, href, end) >= 0;
+}
+
+static void
+check_target (Walk         *walk,
+              const MDSpan *span)
+{
+  char path[PATH_MAX];
+  struct stat st;
+
+  if (!target_path (walk->dir, span->href, span->href_len, path, sizeof (path)))
+    return;
+
+  if (stat (path, &st) != 0)
+    {
+      add_problem (walk->check, walk->line, "%s '%.*s' doesn't exist",
+                   span->type == SPAN_TYPE_IMAGE ? "image" : "link target",
+                   (int) span->href_len, span->href);
+    }
+}
+
+static void
+walk_enter_block (const MDBlock *block,
+                  void          *user_data)
+{
+  Walk *walk = user_data;
+
+  if (block->line != 0)
+    walk->line = block->line;
+}
+
+static void
+walk_enter_span (const MDSpan *span,
+                 void         *user_data)
+{
+  Walk *walk = user_data;
+
+  switch (span->type)
+    {
+      case SPAN_TYPE_FOOTNOTE_REF:
+        if (span->ref == NULL)
+          {
+            add_problem (walk->check, walk->line, "footnote [^%.*s] is not defined",
+                         (int) span->id_len, span->id);
+          }
+        break;
+      case SPAN_TYPE_LINK:
+      case SPAN_TYPE_IMAGE:
+        check_target (walk, span);
+        break;
+      default:
+        break;
+    }
+}
+
+/* no text callback: only spans are looked at */
+static const MDEvents check_events = {
+  .enter_block = walk_enter_block,
+  .enter_span  = walk_enter_span,
+};
+
+static void
+check_md (CheckFile *check,
+          MD        *md)
+{
+  const char *slash = strrchr (check->file, '/');
+  Walk walk = { .check = check };
+  size_t n_notes;
+
+  if (slash == NULL)
+    walk.dir = strdup (".");
+  else if (slash == check->file)
+    walk.dir = strdup ("/");
+  else
+    walk.dir = strndup (check->file, slash - check->file);
+
+  md_walk (md, &check_events, &walk);
+  free (walk.dir);
+
+  if (md->open_fence != 0)
+    add_problem (check, md->open_fence, "code fence is never closed");
+
+  n_notes = footnotes_get_count (md->notes);
+  footnotes_set_part (md->notes, 0);
+
+  for (size_t i = 0; i < n_notes; i++)
+    {
+      Reference *ref = footnotes_get_ref_from_index (md->notes, i);
+      Reference *first;
+
+      if (ref->identifier == NULL)
+        {
+          add_problem (check, ref->line, "footnote definition has no identifier");
+          continue;
+        }
+
+      first = footnotes_get_ref (md->notes, ref->identifier);
+      if (first != ref)
+        {
+          add_problem (check, ref->line,
+                       "footnote [^%s] is defined again; the one on line %zu is used",
+                       ref->identifier, first->line);
+        }
+    }
+
+  for (size_t i = 0; i < md->n_invalid && i < MD_MAX_INVALID_OFFSETS; i++)
+    add_problem (check, 0, "invalid UTF-8 at byte offset %zu", md->invalid_offsets[i]);
+
+  if (md->n_invalid > MD_MAX_INVALID_OFFSETS)
+    {
+      add_problem (check, 0, "%zu more invalid UTF-8 sequences",
+                   md->n_invalid - MD_MAX_INVALID_OFFSETS);
+    }
+}
+
+/* runs on a worker */
+static void
+check_file (CheckFile *check)
+{
+  StatsTimer timer;
+  TraceSpan span;
+  MDFile *file;
+  struct stat st;
+  const char *error = NULL;
+  void *map = NULL;
+  size_t map_len = 0;
+  MD *md;
+
+  file = input_open (check->file, &error);
+  if (file == NULL)
+    {
+      add_problem (check, 0, "%s", error);
+      return;
+    }
+
+  stats_timer_start (&timer);
+  trace_begin (&span);
+
+  /* same as a single doc: regular files are mapped, not copied */
+  if (fstat (fileno (file), &st) == 0 && S_ISREG (st.st_mode) && st.st_size > 0)
+    {
+      map = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno (file), 0);
+      if (map == MAP_FAILED)
+        map = NULL;
+      else
+        map_len = st.st_size;
+    }
+
+  if (map != NULL)
+    md = parse_md_buffer (map, map_len);
+  else
+    md = parse_md (file);
+
+  trace_end (&span, "parse_md");
+  stats_timer_stop (&timer, STATS_STAGE_PARSE);
+  stats_count_md (md);
+
+  error = input_error (file);
+  if (error != NULL)
+    add_problem (check, 0, "%s", error);
+  else if (md->limits.exceeded == LIMIT_NONE)
+    check_md (check, md);
+
+  /* what was parsed is only part of the doc; the other files go on */
+  check->limit = md->limits.exceeded;
+  if (check->limit != LIMIT_NONE)
+    add_problem (check, 0, "%s limit exceeded", limit_name (check->limit));
+
+  md_free (md);
+  if (map != NULL)
+    munmap (map, map_len);
+  fclose (file);
+}
+
+static void *
+worker (void *user_data)
+{
+  Check *check = user_data;
+  size_t i;
+
+  while ((i = atomic_fetch_add (&check->next, 1)) < check->n_files)
+    check_file (&check->files[i]);
+
+  return NULL;
+}
+
+/*
+ * check_files
+ * @files
+ * @n_files
+ * @n_jobs: threads checking them; online CPUs if 0
+ * @report: problems are written here, in the order of @files and
+ *          their lines
+ * @limited: set to whether a file hit a limit; it's a problem of that
+ *           file and isn't checked any further
+ *
+ * returns the number of problems found; a file that can't be read is
+ * one
+ */
+size_t
+check_files (char   **files,
+             size_t   n_files,
+             size_t   n_jobs,
+             FILE    *report,
+             bool    *limited)
+{
+  Check check = { .n_files = n_files };
+  pthread_t *workers;
+  size_t n_problems = 0;
+
+  check.files = calloc (n_files, sizeof (CheckFile));
+  for (size_t i = 0; i < n_files; i++)
+    check.files[i].file = files[i];
+
+  if (n_jobs == 0)
+    {
+      long n = sysconf (_SC_NPROCESSORS_ONLN);
+
+      n_jobs = n > 0 ? (size_t) n : 1;
+    }
+  if (n_jobs > n_files)
+    n_jobs = n_files;
+
+  workers = calloc (n_jobs, sizeof (pthread_t));
+  for (size_t i = 0; i < n_jobs; i++)
+    pthread_create (&workers[i], NULL, worker, &check);
+  for (size_t i = 0; i < n_jobs; i++)
+    pthread_join (workers[i], NULL);
+  free (workers);
+
+  *limited = false;
+  for (size_t i = 0; i < n_files; i++)
+    {
+      CheckFile *file = &check.files[i];
+
+      /* problems is NULL for a clean file */
+      if (file->n_problems > 1)
+        qsort (file->problems, file->n_problems, sizeof (Problem), compare_problems);
+
+      for (size_t j = 0; j < file->n_problems; j++)
+        {
+          Problem *problem = &file->problems[j];
+
+          if (problem->line != 0)
+            fprintf (report, "%s:%zu: %s\n", file->file, problem->line, problem->message);
+          else
+            fprintf (report, "%s: %s\n", file->file, problem->message);
+
+          free (problem->message);
+        }
+
+      n_problems += file->n_problems;
+      *limited = *limited || file->limit != LIMIT_NONE;
+      free (file->problems);
+    }
+
+  free (check.files);
+
+  return n_problems;
+}
@@ -0,0 +1,589 @@
+/* compress.c
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "compress.h"
+#include "stats.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#include <zdict.h>
+#endif
+
+#define COMPRESS_BUFFER_SIZE (64 * 1024)
+
+/* zstd's own default, enough for a collection of small pages */
+#define COMPRESS_DICT_SIZE   (110 * 1024)
+
+#define ZSTD_LEVEL_MAX       22
+
+/*
+ * Keep order in-sync with compress.h
+ */
+static const struct {
+  const char *name;
+  const char *extension;
+  int         default_level;
+  int         max_level;
+} codecs[N_COMPRESS_CODECS] = {
+  [COMPRESS_GZIP] = { "gzip", ".gz",  9,  9 },
+  [COMPRESS_ZSTD] = { "zstd", ".zst", 19, ZSTD_LEVEL_MAX },
+};
+
+/*
+ * @Encoder
+ *
+ * one precompressed file, fed through output_tee ()
+ */
+typedef struct {
+  CompressCodec  codec;
+  char          *path;
+  int            fd;
+  bool           error;
+  unsigned char  buf[COMPRESS_BUFFER_SIZE];
+
+#ifdef HAVE_ZLIB
+  z_stream       gz;
+#endif
+#ifdef HAVE_ZSTD
+  ZSTD_CCtx     *zstd;
+#endif
+} Encoder;
+
+struct Precompress {
+  Encoder *encoders[N_COMPRESS_CODECS];
+  size_t   n_encoders;
+};
+
+/* --zstd-dict, shared by the outputs of a run */
+static struct {
+  pthread_mutex_t lock;
+  char   *dict;
+  size_t  dict_len;
+
+#ifdef HAVE_ZSTD
+  /* digested once per level */
+  ZSTD_CDict *cdicts[ZSTD_LEVEL_MAX + 1];
+#endif
+} shared = {
+  .lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+/*
+ * compress_parse
+ * @spec: CODEC[=LEVEL], e.g. "gzip" or "zstd=12"
+ * @codec: return location for the codec
+ * @level: return location for the level; the codec's default if not given
+ *
+ * returns false if @spec is malformed or the level out of range
+ */
+bool
+compress_parse (const char    *spec,
+                CompressCodec *codec,
+                int           *level)
+{
+  const char *eq = strchr (spec, '=');
+  size_t len = eq ? (size_t) (eq - spec) : strlen (spec);
+  char *end;
+
+  for (int i = 0; i < N_COMPRESS_CODECS; i++)
+    {
+      if (strlen (codecs[i].name) != len || strncmp (spec, codecs[i].name, len) != 0)
+        continue;
+
+      *codec = i;
+
+      if (eq == NULL)
+        {
+          *level = codecs[i].default_level;
+          return true;
+        }
+
+      if (eq[1] < '0' || eq[1] > '9')
+        return false;
+
+      *level = strtol (eq + 1, &end, 10);
+
+      return *end == '\0' && *level >= 1 && *level <= codecs[i].max_level;
+    }
+
+  return false;
+}
+
+bool
+compress_supported (CompressCodec codec)
+{
+  switch (codec)
+    {
+#ifdef HAVE_ZLIB
+      case COMPRESS_GZIP:
+        return true;
+#endif
+#ifdef HAVE_ZSTD
+      case COMPRESS_ZSTD:
+        return true;
+#endif
+      default:
+        return false;
+    }
+}
+
+const char *
+compress_name (CompressCodec codec)
+{
+  return codecs[codec].name;
+}
+
+static char *
+read_file (const char *path,
+           size_t     *len)
+{
+  struct stat st;
+  char *buf = NULL;
+  int fd;
+
+  fd = open (path, O_RDONLY);
+  if (fd < 0)
+    return NULL;
+
+  if (fstat (fd, &st) == 0 && S_ISREG (st.st_mode))
+    {
+      buf = malloc (st.st_size + 1);
+      if (read (fd, buf, st.st_size) == st.st_size)
+        {
+          *len = st.st_size;
+        }
+      else
+        {
+          free (buf);
+          buf = NULL;
+        }
+    }
+
+  close (fd);
+
+  return buf;
+}
+
+/*
+ * compress_open
+ * @dict_file: zstd dictionary for the .zst outputs, or NULL
+ *
+ * returns false if the dictionary can't be read
+ */
+bool
+compress_open (const char *dict_file)
+{
+  if (dict_file == NULL)
+    return true;
+
+  shared.dict = read_file (dict_file, &shared.dict_len);
+
+  return shared.dict != NULL;
+}
+
+void
+compress_close (void)
+{
+  pthread_mutex_lock (&shared.lock);
+
+#ifdef HAVE_ZSTD
+  for (int i = 0; i <= ZSTD_LEVEL_MAX; i++)
+    {
+      ZSTD_freeCDict (shared.cdicts[i]);
+      shared.cdicts[i] = NULL;
+    }
+#endif
+
+  free (shared.dict);
+  shared.dict = NULL;
+  shared.dict_len = 0;
+
+  pthread_mutex_unlock (&shared.lock);
+}
+
+/*
+ * compress_train_dict
+ * @dict_file: where to write the dictionary
+ * @inputs: sample files, e.g. pages of a collection
+ * @n_inputs
+ * @error: set when false is returned
+ *
+ * trains a zstd dictionary for --zstd-dict
+ */
+bool
+compress_train_dict (const char  *dict_file,
+                     char       **inputs,
+                     size_t       n_inputs,
+                     const char **error)
+{
+#ifdef HAVE_ZSTD
+  char *samples = NULL;
+  size_t *sizes = calloc (n_inputs, sizeof (size_t));
+  size_t len = 0;
+  char *dict = malloc (COMPRESS_DICT_SIZE);
+  size_t dict_len = 0;
+  FILE *file;
+
+  *error = NULL;
+
+  for (size_t i = 0; i < n_inputs && *error == NULL; i++)
+    {
+      char *buf = read_file (inputs[i], &sizes[i]);
+
+      if (buf == NULL)
+        {
+          *error = "cannot read a sample";
+          break;
+        }
+
+      samples = realloc (samples, len + sizes[i]);
+      memcpy (samples + len, buf, sizes[i]);
+      len += sizes[i];
+      free (buf);
+    }
+
+  if (*error == NULL)
+    {
+      dict_len = ZDICT_trainFromBuffer (dict, COMPRESS_DICT_SIZE, samples, sizes, n_inputs);
+      if (ZDICT_isError (dict_len))
+        *error = ZDICT_getErrorName (dict_len);
+    }
+
+  if (*error == NULL)
+    {
+      file = fopen (dict_file, "w");
+      if (file == NULL ||
+          fwrite (dict, 1, dict_len, file) != dict_len ||
+          fclose (file) != 0)
+        *error = "cannot write the dictionary";
+    }
+
+  free (samples);
+  free (sizes);
+  free (dict);
+
+  return *error == NULL;
+#else
+  (void) dict_file;
+  (void) inputs;
+  (void) n_inputs;
+
+  *error = "built without zstd";
+
+  return false;
+#endif
+}
+
+/*
+ * encoders
+ */
+
+static void
+encoder_emit (Encoder *encoder,
+              size_t   len)
+{
+  const unsigned char *buf = encoder->buf;
+
+  while (len > 0 && !encoder->error)
+    {
+      ssize_t written = write (encoder->fd, buf, len);
+
+      if (written < 0)
+        {
+          if (errno != EINTR)
+            encoder->error = true;
+          continue;
+        }
+
+      buf += written;
+      len -= written;
+    }
+}
+
+#ifdef HAVE_ZLIB
+static void
+encode_gzip (Encoder    *encoder,
+             const char *buf,
+             size_t      len,
+             bool        end)
+{
+  z_stream *gz = &encoder->gz;
+
+  gz->next_in = (unsigned char *) buf;
+  gz->avail_in = len;
+
+  /* a full output buffer may have more to come */
+  do
+    {
+      gz->next_out = encoder->buf;
+      gz->avail_out = sizeof (encoder->buf);
+
+      deflate (gz, end ? Z_FINISH : Z_NO_FLUSH);
+      encoder_emit (encoder, sizeof (encoder->buf) - gz->avail_out);
+    }
+  while (gz->avail_out == 0);
+}
+#endif
+
+#ifdef HAVE_ZSTD
+static void
+encode_zstd (Encoder    *encoder,
+             const char *buf,
+             size_t      len,
+             bool        end)
+{
+  ZSTD_inBuffer in = { buf, len, 0 };
+  size_t remaining;
+
+  do
+    {
+      ZSTD_outBuffer out = { encoder->buf, sizeof (encoder->buf), 0 };
+
+      remaining = ZSTD_compressStream2 (encoder->zstd, &out, &in,
+                                        end ? ZSTD_e_end : ZSTD_e_continue);
+      if (ZSTD_isError (remaining))
+        {
+          encoder->error = true;
+          return;
+        }
+
+      encoder_emit (encoder, out.pos);
+    }
+  while (end ? remaining != 0 : in.pos < in.size);
+}
+#endif
+
+static void
+encode (Encoder    *encoder,
+        const char *buf,
+        size_t      len,
+        bool        end)
+{
+  StatsTimer timer;
+
+  stats_timer_start (&timer);
+
+  switch (encoder->codec)
+    {
+#ifdef HAVE_ZLIB
+      case COMPRESS_GZIP:
+        /* avail_in is an unsigned int */
+        for (; len > UINT_MAX; buf += UINT_MAX, len -= UINT_MAX)
+          encode_gzip (encoder, buf, UINT_MAX, false);
+        encode_gzip (encoder, buf, len, end);
+        break;
+#endif
+#ifdef HAVE_ZSTD
+      case COMPRESS_ZSTD:
+        encode_zstd (encoder, buf, len, end);
+        break;
+#endif
+      default:
+        break;
+    }
+
+  stats_timer_stop (&timer, STATS_STAGE_COMPRESS);
+}
+
+/* OutputFunc */
+static void
+encoder_write (const char *buf,
+               size_t      len,
+               void       *user_data)
+{
+  Encoder *encoder = user_data;
+
+  if (!encoder->error)
+    encode (encoder, buf, len, false);
+}
+
+#ifdef HAVE_ZSTD
+static ZSTD_CDict *
+get_cdict (int level)
+{
+  ZSTD_CDict *cdict;
+
+  pthread_mutex_lock (&shared.lock);
+
+  if (shared.cdicts[level] == NULL)
+    shared.cdicts[level] = ZSTD_createCDict (shared.dict, shared.dict_len, level);
+  cdict = shared.cdicts[level];
+
+  pthread_mutex_unlock (&shared.lock);
+
+  return cdict;
+}
+#endif
+
+/* returns false if the codec isn't built in or fails to start */
+static bool
+encoder_init (Encoder *encoder,
+              int      level)
+{
+  switch (encoder->codec)
+    {
+#ifdef HAVE_ZLIB
+      case COMPRESS_GZIP:
+        /* 16: gzip header and trailer */
+        return deflateInit2 (&encoder->gz, level, Z_DEFLATED, 15 + 16, 8,
+                             Z_DEFAULT_STRATEGY) == Z_OK;
+#endif
+#ifdef HAVE_ZSTD
+      case COMPRESS_ZSTD:
+        encoder->zstd = ZSTD_createCCtx ();
+        if (encoder->zstd == NULL)
+          return false;
+
+        ZSTD_CCtx_setParameter (encoder->zstd, ZSTD_c_checksumFlag, 1);
+
+        /* the dictionary carries its level */
+        if (shared.dict != NULL)
+          return !ZSTD_isError (ZSTD_CCtx_refCDict (encoder->zstd, get_cdict (level)));
+
+        return !ZSTD_isError (ZSTD_CCtx_setParameter (encoder->zstd,
+                                                      ZSTD_c_compressionLevel,
+                                                      level));
+#endif
+      default:
+        (void) level;
+        return false;
+    }
+}
+
+static void
+encoder_end (Encoder *encoder)
+{
+  switch (encoder->codec)
+    {
+#ifdef HAVE_ZLIB
+      case COMPRESS_GZIP:
+        deflateEnd (&encoder->gz);
+        break;
+#endif
+#ifdef HAVE_ZSTD
+      case COMPRESS_ZSTD:
+        ZSTD_freeCCtx (encoder->zstd);
+        break;
+#endif
+      default:
+        break;
+    }
+}
+
+/*
+ * precompress_start
+ * @out: output to follow; its bytes are compressed as it flushes them
+ * @file_name: of the output; the copies get the codec's extension
+ * @levels: of each codec, 0 for none
+ *
+ * returns NULL if no codec has a level
+ */
+Precompress *
+precompress_start (Output     *out,
+                   const char *file_name,
+                   const int   levels[N_COMPRESS_CODECS])
+{
+  Precompress *pre = NULL;
+
+  for (int i = 0; i < N_COMPRESS_CODECS; i++)
+    {
+      Encoder *encoder;
+
+      if (levels[i] == 0)
+        continue;
+
+      if (pre == NULL)
+        pre = calloc (1, sizeof (Precompress));
+
+      encoder = calloc (1, sizeof (Encoder));
+      encoder->codec = i;
+      encoder->path = malloc (strlen (file_name) + strlen (codecs[i].extension) + 1);
+      strcpy (stpcpy (encoder->path, file_name), codecs[i].extension);
+      encoder->fd = open (encoder->path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+
+      if (encoder->fd < 0 || !encoder_init (encoder, levels[i]) ||
+          !output_tee (out, encoder_write, encoder))
+        encoder->error = true;
+
+      pre->encoders[pre->n_encoders++] = encoder;
+    }
+
+  return pre;
+}
+
+/*
+ * precompress_finish
+ * @pre: may be NULL
+ * @keep: false to remove the copies, e.g. once a limit is hit
+ *
+ * ends the copies; call it after the output is flushed for the last
+ * time.  Returns false if a copy couldn't be written; it's removed
+ */
+bool
+precompress_finish (Precompress *pre,
+                    bool         keep)
+{
+  bool ok = true;
+
+  if (pre == NULL)
+    return true;
+
+  for (size_t i = 0; i < pre->n_encoders; i++)
+    {
+      Encoder *encoder = pre->encoders[i];
+
+      if (!encoder->error && keep)
+        encode (encoder, NULL, 0, true);
+
+      if (encoder->fd >= 0)
+        {
+          encoder_end (encoder);
+          if (close (encoder->fd) != 0)
+            encoder->error = true;
+        }
+
+      /* a stale copy would be served instead of the new page */
+      if (encoder->error || !keep)
+        unlink (encoder->path);
+
+      ok = ok && !encoder->error;
+
+      free (encoder->path);
+      free (encoder);
+    }
+
+  free (pre);
+
+  return ok;
+}
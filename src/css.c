@@ -0,0 +1,497 @@
+/* css.c
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#define _GNU_SOURCE
+
+#include "css.h"
+#include "hash.h"
+#include "strbuf.h"
+
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* part of the cache file names; bump it when the minified output changes */
+#define CSS_CACHE_VERSION 2
+
+/*
+ * minifier
+ */
+static inline bool
+is_space (char c)
+{
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
+
+/*
+ * whitespace next to these never matters; ':' is handled apart, as a
+ * space before it is significant in selectors ("a :hover")
+ */
+static inline bool
+is_separator (char c)
+{
+  return c == '{' || c == '}' || c == ';' || c == ',' || c == '>';
+}
+
+/* "</style" would end the <style> element early */
+static inline void
+append_c (StrBuf *buf,
+          char    c)
+{
+  if (c == '/' && buf->len > 0 && buf->str[buf->len - 1] == '<')
+    strbuf_append_c (buf, '\\');
+
+  strbuf_append_c (buf, c);
+}
+
+/*
+ * find_stop
+ *
+ * position of the first '{', ';' or '}' at or after @i, outside strings
+ * and comments; @len if there is none
+ */
+static size_t
+find_stop (const char *css,
+           size_t      i,
+           size_t      len)
+{
+  while (i < len && css[i] != '{' && css[i] != ';' && css[i] != '}')
+    {
+      if (css[i] == '/' && i + 1 < len && css[i + 1] == '*')
+        {
+          const char *end = memmem (css + i + 2, len - i - 2, "*/", 2);
+
+          i = end != NULL ? (size_t) (end - css) + 2 : len;
+        }
+      else if (css[i] == '"' || css[i] == '\'')
+        {
+          char quote = css[i];
+
+          for (i++; i < len && css[i] != quote && css[i] != '\n'; i++)
+            {
+              if (css[i] == '\\')
+                i++;
+            }
+          i++;
+        }
+      else
+        {
+          i += css[i] == '\\' ? 2 : 1;
+        }
+    }
+
+  return i < len ? i : len;
+}
+
+/*
+ * css_minify
+ * @css: stylesheet source
+ * @len
+ * @out_len: length of the result
+ *
+ * drops comments, the whitespace that doesn't separate tokens and the
+ * last ';' of a block; strings and escapes are copied as they are.
+ * the result is safe to put in a <style> element
+ */
+char *
+css_minify (const char *css,
+            size_t      len,
+            size_t     *out_len)
+{
+  StrBuf buf;
+  bool space = false;
+  size_t i = 0;
+  size_t stop = 0;    /* see find_stop (); each stop is found once */
+
+  strbuf_init (&buf, len + 1);
+
+  while (i < len)
+    {
+      char c = css[i];
+
+      if (c == '/' && i + 1 < len && css[i + 1] == '*')
+        {
+          const char *end = memmem (css + i + 2, len - i - 2, "*/", 2);
+
+          /* a comment separates tokens like whitespace does */
+          i = end != NULL ? (size_t) (end - css) + 2 : len;
+          space = true;
+          continue;
+        }
+
+      if (is_space (c))
+        {
+          space = true;
+          i++;
+          continue;
+        }
+
+      /* ':' ends a property name unless a selector goes on to a '{' */
+      if (space && c == ':')
+        {
+          if (stop <= i)
+            stop = find_stop (css, i, len);
+          space = stop < len && css[stop] == '{';
+        }
+
+      if (space && buf.len > 0 && !is_separator (c) &&
+          !is_separator (buf.str[buf.len - 1]) && buf.str[buf.len - 1] != ':')
+        strbuf_append_c (&buf, ' ');
+      space = false;
+
+      if (c == '"' || c == '\'')
+        {
+          /* an unclosed string ends at the newline */
+          strbuf_append_c (&buf, c);
+          for (i++; i < len && css[i] != c && css[i] != '\n';)
+            {
+              if (css[i] == '\\' && i + 1 < len)
+                {
+                  strbuf_append_len (&buf, css + i, 2);
+                  i += 2;
+                }
+              else
+                {
+                  append_c (&buf, css[i++]);
+                }
+            }
+
+          if (i < len && css[i] == c)
+            strbuf_append_c (&buf, css[i++]);
+        }
+      else if (c == '\\' && i + 1 < len)
+        {
+          /* "\ " is part of an identifier */
+          strbuf_append_len (&buf, css + i, 2);
+          i += 2;
+        }
+      else if (c == '}' && buf.len > 0 && buf.str[buf.len - 1] == ';')
+        {
+          buf.str[buf.len - 1] = '}';
+          i++;
+        }
+      else
+        {
+          append_c (&buf, c);
+          i++;
+        }
+    }
+
+  *out_len = buf.len;
+
+  return strbuf_steal (&buf);
+}
+
+/*
+ * cache
+ *
+ * entries stay until css_close (), so the HTML docs of a run can point
+ * at them; a changed file gets a new entry.  the hash only picks the
+ * entry or cache file to look at: sources are compared before their
+ * minified result is reused, in memory and on disk
+ */
+typedef struct CssEntry {
+  char     *path;
+  int64_t   mtime_sec;
+  int64_t   mtime_nsec;
+  int64_t   size;
+  uint64_t  hash;       /* of src */
+  char     *src;
+
+  char     *css;        /* minified */
+  size_t    len;
+
+  struct CssEntry *next;
+} CssEntry;
+
+static struct {
+  char *cache_dir;
+
+  pthread_mutex_t lock;
+  CssEntry *entries;    /* newest first */
+} styles = {
+  .lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static bool
+cache_path (char     *path,
+            size_t    size,
+            uint64_t  hash,
+            int64_t   len)
+{
+  return snprintf (path, size, "%s/css-%d-%016" PRIx64 "-%" PRId64 ".css",
+                   styles.cache_dir, CSS_CACHE_VERSION, hash, len) < (int) size;
+}
+
+/*
+ * cache_load
+ *
+ * a cache file holds the source followed by its minified result;
+ * returns the result if the file's source is @src
+ */
+static char *
+cache_load (const char *src,
+            int64_t     size,
+            uint64_t    hash,
+            size_t     *len)
+{
+  char path[PATH_MAX];
+  struct stat st;
+  char *css;
+  int fd;
+
+  if (styles.cache_dir == NULL || !cache_path (path, sizeof (path), hash, size))
+    return NULL;
+
+  fd = open (path, O_RDONLY);
+  if (fd < 0)
+    return NULL;
+
+  css = NULL;
+  if (fstat (fd, &st) == 0 && S_ISREG (st.st_mode) && st.st_size >= size)
+    {
+      css = malloc (st.st_size + 1);
+      if (read (fd, css, st.st_size) == st.st_size && memcmp (css, src, size) == 0)
+        {
+          *len = st.st_size - size;
+          memmove (css, css + size, *len);
+          css[*len] = '\0';
+        }
+      else
+        {
+          free (css);
+          css = NULL;
+        }
+    }
+
+  close (fd);
+
+  return css;
+}
+
+static void
+cache_save (const char *src,
+            int64_t     size,
+            uint64_t    hash,
+            const char *css,
+            size_t      len)
+{
+  char path[PATH_MAX];
+  char tmp[PATH_MAX];
+  FILE *file;
+  bool ok;
+
+  if (styles.cache_dir == NULL || !cache_path (path, sizeof (path), hash, size) ||
+      snprintf (tmp, sizeof (tmp), "%s.%d.tmp", path, (int) getpid ()) >= (int) sizeof (tmp))
+    return;
+
+  mkdir (styles.cache_dir, 0777);
+
+  file = fopen (tmp, "w");
+  if (file == NULL)
+    return;
+
+  ok = fwrite (src, 1, size, file) == (size_t) size &&
+       fwrite (css, 1, len, file) == len;
+  ok = fclose (file) == 0 && ok;
+
+  /* a concurrent run sees no file or a whole one */
+  if (!ok || rename (tmp, path) != 0)
+    unlink (tmp);
+}
+
+static CssEntry *
+entry_find (const char  *path,
+            struct stat *st)
+{
+  for (CssEntry *entry = styles.entries; entry != NULL; entry = entry->next)
+    {
+      if (strcmp (entry->path, path) == 0)
+        {
+          if (entry->mtime_sec == st->st_mtim.tv_sec &&
+              entry->mtime_nsec == st->st_mtim.tv_nsec &&
+              entry->size == st->st_size)
+            return entry;
+
+          /* older entries of the path are older still */
+          return NULL;
+        }
+    }
+
+  return NULL;
+}
+
+static CssEntry *
+entry_find_src (const char *src,
+                int64_t     size,
+                uint64_t    hash)
+{
+  for (CssEntry *entry = styles.entries; entry != NULL; entry = entry->next)
+    {
+      if (entry->hash == hash && entry->size == size &&
+          memcmp (entry->src, src, size) == 0)
+        return entry;
+    }
+
+  return NULL;
+}
+
+static CssEntry *
+entry_add (const char  *path,
+           struct stat *st,
+           const char  *src)
+{
+  CssEntry *entry, *same;
+
+  entry = calloc (1, sizeof (CssEntry));
+  entry->path = strdup (path);
+  entry->mtime_sec = st->st_mtim.tv_sec;
+  entry->mtime_nsec = st->st_mtim.tv_nsec;
+  entry->size = st->st_size;
+  entry->hash = hash_bytes (HASH_INIT, src, st->st_size);
+  entry->src = malloc (st->st_size + 1);
+  memcpy (entry->src, src, st->st_size);
+
+  /* the same stylesheet under another path, or unchanged after a touch */
+  same = entry_find_src (src, entry->size, entry->hash);
+  if (same != NULL)
+    {
+      entry->css = strndup (same->css, same->len);
+      entry->len = same->len;
+    }
+  else
+    {
+      entry->css = cache_load (src, entry->size, entry->hash, &entry->len);
+    }
+
+  if (entry->css == NULL)
+    {
+      entry->css = css_minify (src, st->st_size, &entry->len);
+      cache_save (src, entry->size, entry->hash, entry->css, entry->len);
+    }
+
+  entry->next = styles.entries;
+  styles.entries = entry;
+
+  return entry;
+}
+
+/*
+ * css_open
+ * @cache_dir: keeps minified stylesheets across runs, or NULL; created
+ * if it doesn't exist
+ */
+void
+css_open (const char *cache_dir)
+{
+  pthread_mutex_lock (&styles.lock);
+  free (styles.cache_dir);
+  styles.cache_dir = cache_dir ? strdup (cache_dir) : NULL;
+  pthread_mutex_unlock (&styles.lock);
+}
+
+/*
+ * css_close
+ *
+ * frees the stylesheets; what css_inline () returned is no longer valid
+ */
+void
+css_close (void)
+{
+  CssEntry *entry, *next;
+
+  pthread_mutex_lock (&styles.lock);
+
+  for (entry = styles.entries; entry != NULL; entry = next)
+    {
+      next = entry->next;
+      free (entry->path);
+      free (entry->src);
+      free (entry->css);
+      free (entry);
+    }
+
+  styles.entries = NULL;
+  free (styles.cache_dir);
+  styles.cache_dir = NULL;
+
+  pthread_mutex_unlock (&styles.lock);
+}
+
+/*
+ * css_inline
+ * @path: stylesheet to read
+ * @len: length of the result
+ *
+ * returns the minified stylesheet, read and minified on first use;
+ * NULL if it can't be read.  the result is valid until css_close ()
+ */
+const char *
+css_inline (const char *path,
+            size_t     *len)
+{
+  CssEntry *entry = NULL;
+  struct stat st;
+  int fd;
+
+  pthread_mutex_lock (&styles.lock);
+
+  fd = open (path, O_RDONLY);
+  if (fd >= 0 && fstat (fd, &st) == 0 && S_ISREG (st.st_mode))
+    {
+      entry = entry_find (path, &st);
+
+      if (entry == NULL && st.st_size == 0)
+        {
+          entry = entry_add (path, &st, "");
+        }
+      else if (entry == NULL)
+        {
+          void *map = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+          if (map != MAP_FAILED)
+            {
+              entry = entry_add (path, &st, map);
+              munmap (map, st.st_size);
+            }
+        }
+    }
+
+  if (fd >= 0)
+    close (fd);
+
+  pthread_mutex_unlock (&styles.lock);
+
+  if (entry == NULL)
+    return NULL;
+
+  *len = entry->len;
+
+  return entry->css;
+}
@@ -0,0 +1,375 @@
+/* events.c
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "events.h"
+#include "limit.h"
+#include "search.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARRAY_SIZE(arr) \
+        (sizeof (arr) / sizeof (arr[0]))
+
+struct emphasis {
+  const char *start_pattern;
+  const char *end_pattern; /* end_pattern is needed here because
+                            * the ending underscores need a whitespace
+                            * at the end to be valid */
+  SpanType    type;
+};
+
+static const struct emphasis emphases[] = {
+  { "***", "***",  SPAN_TYPE_STRONG_EM },
+  { "**",  "**",   SPAN_TYPE_STRONG    },
+  { "*",   "*",    SPAN_TYPE_EM        },
+  { "___", "___ ", SPAN_TYPE_STRONG_EM },
+  { "__",  "__ ",  SPAN_TYPE_STRONG    },
+  { "_",   "_ ",   SPAN_TYPE_EM        },
+  { "`",   "`",    SPAN_TYPE_CODE      },
+};
+
+/*
+ * @Walker
+ *
+ * plain text is passed on in runs, not a character at a time
+ */
+typedef struct {
+  const MDEvents *events;
+  void           *user_data;
+
+  const char     *run;  /* start of the pending plain text */
+} Walker;
+
+static void
+emit_text (Walker     *walker,
+           const char *text,
+           size_t      len)
+{
+  if (len != 0 && walker->events->text)
+    walker->events->text (text, len, walker->user_data);
+}
+
+static void
+flush_run (Walker     *walker,
+           const char *end)
+{
+  emit_text (walker, walker->run, end - walker->run);
+  walker->run = end;
+}
+
+static void
+emit_span (Walker       *walker,
+           const MDSpan *span,
+           const char   *text,
+           size_t        len)
+{
+  if (walker->events->enter_span)
+    walker->events->enter_span (span, walker->user_data);
+
+  emit_text (walker, text, len);
+
+  if (walker->events->leave_span)
+    walker->events->leave_span (span, walker->user_data);
+}
+
+static void
+enter_block (Walker        *walker,
+             const MDBlock *block)
+{
+  if (walker->events->enter_block)
+    walker->events->enter_block (block, walker->user_data);
+}
+
+static void
+leave_block (Walker        *walker,
+             const MDBlock *block)
+{
+  if (walker->events->leave_block)
+    walker->events->leave_block (block, walker->user_data);
+}
+
+/*
+ * md_walk_inline
+ * @content: NUL-terminated text of a unit
+ * @notes: resolves [^id] references
+ * @limits: of the doc; stops once one is hit, NULL for none
+ * @events
+ * @user_data: passed to @events
+ *
+ * the inline tokenizer: emphasis, code, links, images and footnote
+ * references.  Span contents are not tokenized any further
+ */
+void
+md_walk_inline (const char     *content,
+                Footnotes      *notes,
+                LimitState     *limits,
+                const MDEvents *events,
+                void           *user_data)
+{
+  Walker walker = { events, user_data, content };
+  const char *ptr = content;
+  size_t n_emphases = ARRAY_SIZE (emphases);
+  Search ends[ARRAY_SIZE (emphases)];
+  Search link_mid, link_end, note_end;
+
+  /* every opener looks for its closer from scratch; memoize so unclosed
+   * openers don't rescan the rest of the text each time */
+  for (size_t i = 0; i < n_emphases; i++)
+    search_init (&ends[i], emphases[i].end_pattern, NULL);
+
+  search_init (&link_mid, "](", NULL);
+  search_init (&link_end, ")", NULL);
+  search_init (&note_end, "]", NULL);
+
+  /* stop once any limit is hit; the caller gives up anyway */
+  while (*ptr && (limits == NULL || limits->exceeded == LIMIT_NONE))
+    {
+      bool in_regx = false;
+
+      /* spans only start at these; skip plain text in one go */
+      ptr += strcspn (ptr, "*_`![");
+      if (*ptr == '\0')
+        break;
+
+      for (size_t i = 0; i < n_emphases; i++)
+        {
+          size_t offset = strlen (emphases[i].start_pattern);
+
+          if (strncmp (ptr, emphases[i].start_pattern, offset) == 0)
+            {
+              const char *start, *end;
+
+              start = ptr + offset;
+              end = search_find (&ends[i], start);
+
+              if (end != NULL)
+                {
+                  MDSpan span = { .type = emphases[i].type };
+
+                  flush_run (&walker, ptr);
+                  emit_span (&walker, &span, start, end - start);
+
+                  ptr = walker.run = end + offset;
+                  in_regx = true;
+                }
+            }
+        }
+
+      if (in_regx)
+        {
+          continue;
+        }
+      else if (*ptr == '!' && *(ptr + 1) == '[')
+        {
+          const char *alt_start = ptr + 2;
+          const char *alt_end = search_find (&link_mid, alt_start);
+
+          if (alt_end)
+            {
+              const char *src_start = alt_end + 2;
+              const char *src_end = search_find (&link_end, src_start);
+
+              if (src_end)
+                {
+                  MDSpan span = {
+                    .type = SPAN_TYPE_IMAGE,
+                    .href = src_start,
+                    .href_len = src_end - src_start,
+                  };
+
+                  flush_run (&walker, ptr);
+                  emit_span (&walker, &span, alt_start, alt_end - alt_start);
+
+                  ptr = walker.run = src_end + 1;
+
+                  continue;
+                }
+            }
+        }
+      else if (*ptr == '[' && *(ptr + 1) == '^')
+        {
+          const char *id_start = ptr + 2;
+          const char *id_end = search_find (&note_end, id_start);
+
+          if (id_end)
+            {
+              MDSpan span = {
+                .type = SPAN_TYPE_FOOTNOTE_REF,
+                .id = id_start,
+                .id_len = id_end - id_start,
+              };
+              char *id;
+
+              id = calloc (span.id_len + 1, sizeof (char));
+              strncpy (id, id_start, span.id_len);
+              span.ref = footnotes_get_ref (notes, id);
+              free (id);
+
+              flush_run (&walker, ptr);
+              emit_span (&walker, &span, NULL, 0);
+
+              ptr = walker.run = id_end + 1;
+
+              continue;
+            }
+        }
+      else if (*ptr == '[')
+        {
+          const char *anc_start = ptr + 1;
+          const char *anc_end = search_find (&link_mid, anc_start);
+
+          if (anc_end)
+            {
+              const char *href_start = anc_end + 2;
+              const char *href_end = search_find (&link_end, href_start);
+
+              if (href_end)
+                {
+                  MDSpan span = {
+                    .type = SPAN_TYPE_LINK,
+                    .href = href_start,
+                    .href_len = href_end - href_start,
+                  };
+
+                  flush_run (&walker, ptr);
+                  emit_span (&walker, &span, anc_start, anc_end - anc_start);
+
+                  ptr = walker.run = href_end + 1;
+
+                  continue;
+                }
+            }
+        }
+
+      ptr++;
+    }
+
+  flush_run (&walker, ptr);
+}
+
+static BlockType
+find_block_type (UnitType type)
+{
+  switch (type)
+    {
+      case UNIT_TYPE_H1:
+        return BLOCK_TYPE_H1;
+      case UNIT_TYPE_H2:
+        return BLOCK_TYPE_H2;
+      case UNIT_TYPE_H3:
+        return BLOCK_TYPE_H3;
+      case UNIT_TYPE_BULLET:
+        return BLOCK_TYPE_LIST_ITEM;
+      case UNIT_TYPE_QUOTE:
+        return BLOCK_TYPE_QUOTE;
+      case UNIT_TYPE_CODE_BLOCK:
+        return BLOCK_TYPE_CODE;
+      case UNIT_TYPE_NONE:
+        return BLOCK_TYPE_BLANK;
+      default:
+        return BLOCK_TYPE_PARAGRAPH;
+    }
+}
+
+/*
+ * md_walk
+ * @md: parsed doc
+ * @events
+ * @user_data: passed to @events
+ *
+ * walks the blocks of @md in order, then the footnote definitions
+ */
+void
+md_walk (MD             *md,
+         const MDEvents *events,
+         void           *user_data)
+{
+  Walker walker = { events, user_data, NULL };
+  MDBlock list = { .type = BLOCK_TYPE_LIST, .lang = LANG_NONE };
+  bool in_list = false;
+  bool want_inline;
+  size_t n_notes;
+
+  want_inline = events->enter_span || events->leave_span || events->text;
+
+  for (MDUnit *unit = md->elements; unit != NULL; unit = unit->next)
+    {
+      MDBlock block = {
+        .type = find_block_type (unit->type),
+        .lang = unit->lang,
+        .line = unit->line,
+        .unit = unit,
+      };
+
+      if (md->limits.exceeded != LIMIT_NONE || !limit_check_time (&md->limits))
+        return;
+
+      if (in_list && block.type != BLOCK_TYPE_LIST_ITEM)
+        {
+          leave_block (&walker, &list);
+          in_list = false;
+        }
+      else if (!in_list && block.type == BLOCK_TYPE_LIST_ITEM)
+        {
+          enter_block (&walker, &list);
+          in_list = true;
+        }
+
+      enter_block (&walker, &block);
+
+      /* code block content starts with the newline of the opening fence */
+      if (unit->content != NULL && block.type == BLOCK_TYPE_CODE)
+        emit_text (&walker, unit->content + 1, unit->content_len - 1);
+      else if (unit->content != NULL && want_inline)
+        {
+          footnotes_set_part (md->notes, unit->part);
+          md_walk_inline (unit->content, md->notes, &md->limits, events, user_data);
+        }
+
+      leave_block (&walker, &block);
+    }
+
+  if (in_list)
+    leave_block (&walker, &list);
+
+  n_notes = footnotes_get_count (md->notes);
+  if (n_notes != 0)
+    {
+      MDBlock notes = { .type = BLOCK_TYPE_FOOTNOTES, .lang = LANG_NONE };
+
+      enter_block (&walker, &notes);
+
+      for (size_t i = 0; i < n_notes; i++)
+        {
+          MDBlock note = { .type = BLOCK_TYPE_FOOTNOTE, .lang = LANG_NONE };
+
+          note.note = footnotes_get_ref_from_index (md->notes, i);
+
+          enter_block (&walker, &note);
+          if (note.note->text != NULL)
+            emit_text (&walker, note.note->text, strlen (note.note->text));
+          leave_block (&walker, &note);
+        }
+
+      leave_block (&walker, &notes);
+    }
+}
@@ -19,18 +19,78 @@
  */
 
 #include "footnotes.h"
+#include "hash.h"
 
 #include <stdlib.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <string.h>
 
 
+#define INITIAL_REFS_SIZE      16
+#define INITIAL_REFERRERS_SIZE 4
+
 struct Footnotes {
-  int n_refs; /* number of references */
+  size_t n_refs; /* number of references */
+  size_t refs_size; /* allocated references */
   Reference *refs;  /* refs */
+  size_t n_referrers; /* referrers of all refs together */
+  size_t part;        /* identifiers are added and looked up in this part */
+
+  HashIndex index;    /* over the identifiers of refs, by part */
 };
 
 
+typedef struct {
+  size_t      part;
+  const char *identifier;
+} RefKey;
+
+static uint64_t
+hash_identifier (size_t      part,
+                 const char *identifier)
+{
+  /* starting from the part */
+  return hash_str (HASH_INIT ^ part, identifier);
+}
+
+static bool
+ref_matches (size_t      pos,
+             const void *key,
+             const void *user_data)
+{
+  const Reference *ref = &((const Footnotes *) user_data)->refs[pos];
+  const RefKey *ref_key = key;
+
+  return ref->part == ref_key->part && strcmp (ref_key->identifier, ref->identifier) == 0;
+}
+
+static uint64_t
+ref_hash (size_t      pos,
+          const void *user_data)
+{
+  const Reference *ref = &((const Footnotes *) user_data)->refs[pos];
+
+  return hash_identifier (ref->part, ref->identifier);
+}
+
+/*
+ * index_lookup
+ *
+ * returns the slot holding @identifier of @part, or the empty slot
+ * where it would be inserted
+ */
+static size_t *
+index_lookup (Footnotes  *notes,
+              size_t      part,
+              const char *identifier)
+{
+  RefKey key = { part, identifier };
+
+  return hash_index_lookup (&notes->index, hash_identifier (part, identifier),
+                            ref_matches, &key, notes);
+}
+
 Footnotes *
 footnotes_new (void)
 {
@@ -39,45 +99,85 @@ footnotes_new (void)
   notes = calloc (1, sizeof (Footnotes));
 
   notes->n_refs = 0;
+  notes->refs_size = 0;
   notes->refs = NULL;
+  notes->n_referrers = 0;
+  notes->part = 0;
+  notes->index.size = 0;
+  notes->index.slots = NULL;
 
   return notes;
 }
 
 static void
 reference_init (Reference *ref,
-                int        index,
+                size_t     index,
                 char      *identifier,
                 char      *text)
 {
   ref->index = index;
-  ref->identifier = strdup (identifier);
-  ref->text = strdup (text);
+  ref->part = 0;
+  ref->line = 0;
+  ref->identifier = identifier ? strdup (identifier) : NULL;
+  ref->text = text ? strdup (text) : NULL;
   uuid_generate_random (ref->uuid);
   ref->n_referrers = 0;
+  ref->referrers_size = 0;
   ref->referrers = NULL;
 }
 
-void
+static Reference *
+append_ref (Footnotes *notes)
+{
+  size_t index = ++notes->n_refs;
+
+  if (index > notes->refs_size)
+    {
+      notes->refs_size = notes->refs_size ? notes->refs_size << 1
+                                           : INITIAL_REFS_SIZE;
+      notes->refs = realloc (notes->refs,
+                             sizeof (Reference) * notes->refs_size);
+    }
+
+  return &notes->refs[index - 1];
+}
+
+static void
+index_add (Footnotes *notes,
+           Reference *ref)
+{
+  size_t *slot;
+
+  if (ref->identifier == NULL)
+    return;
+
+  hash_index_reserve (&notes->index, ref->index - 1, INITIAL_REFS_SIZE * 2, ref_hash, notes);
+
+  /* first definition wins on duplicate identifiers */
+  slot = index_lookup (notes, ref->part, ref->identifier);
+  if (*slot == 0)
+    *slot = ref->index;
+}
+
+Reference *
 footnotes_add (Footnotes *notes,
                char *identifier,
                char *text)
 {
-  int index;
+  Reference *ref = append_ref (notes);
 
-  index = ++notes->n_refs;
+  reference_init (ref, notes->n_refs, identifier, text);
+  ref->part = notes->part;
 
-  notes->refs = realloc (notes->refs,
-                        sizeof (Reference) * index);
+  index_add (notes, ref);
 
-  reference_init (&notes->refs[index - 1],
-                  index, identifier, text);
+  return ref;
 }
 
 void
 footnotes_free (Footnotes *notes)
 {
-  for (int i = 0; i < notes->n_refs; i++)
+  for (size_t i = 0; i < notes->n_refs; i++)
     {
       Reference *ref = &notes->refs[i];
 
@@ -87,38 +187,44 @@ footnotes_free (Footnotes *notes)
     }
 
   free (notes->refs);
+  hash_index_free (&notes->index);
   free (notes);
 }
 
-int
+size_t
 footnotes_get_count (Footnotes *notes)
 {
   return notes->n_refs;
 }
 
+size_t
+footnotes_get_referrer_count (Footnotes *notes)
+{
+  return notes->n_referrers;
+}
+
 Reference *
 footnotes_get_ref (Footnotes *notes,
                    char *identifier)
 {
-  if (identifier == NULL)
+  size_t slot;
+
+  if (identifier == NULL || notes->index.size == 0)
     return NULL;
 
-  for (int i = 0; i < notes->n_refs; i++)
-    {
-      Reference *ref = &notes->refs[i];
+  slot = *index_lookup (notes, notes->part, identifier);
 
-      if (strcmp (identifier, ref->identifier) == 0)
-        return ref;
-    }
+  if (slot == 0)
+    return NULL;
 
-  return NULL;
+  return &notes->refs[slot - 1];
 }
 
 Reference *
 footnotes_get_ref_from_index (Footnotes *notes,
-                              int        index)
+                              size_t     index)
 {
-  if (index > notes->n_refs)
+  if (index >= notes->n_refs)
     return NULL;
 
   return &notes->refs[index];
@@ -126,15 +232,65 @@ footnotes_get_ref_from_index (Footnotes *notes,
 
 void
 footnotes_add_referrer (Footnotes *notes,
-                        int        index,
+                        size_t     index,
                         uuid_t     uuid)
 {
   Reference *ref = NULL;
 
   ref = footnotes_get_ref_from_index (notes, index - 1);
+  notes->n_referrers++;
 
-  ref->referrers = realloc (ref->referrers,
-                            sizeof (uuid_t) * ++ref->n_referrers);
+  if (++ref->n_referrers > ref->referrers_size)
+    {
+      ref->referrers_size = ref->referrers_size ? ref->referrers_size << 1
+                                                : INITIAL_REFERRERS_SIZE;
+      ref->referrers = realloc (ref->referrers,
+                                sizeof (uuid_t) * ref->referrers_size);
+    }
 
   strncpy (ref->referrers[ref->n_referrers - 1], uuid, sizeof (uuid_t));
 }
+
+/*
+ * footnotes_set_part
+ * @notes
+ * @part: e.g. a chapter of a book
+ *
+ * identifiers added and looked up from now on belong to @part, so the
+ * same identifier in two parts names two notes
+ */
+void
+footnotes_set_part (Footnotes *notes,
+                    size_t     part)
+{
+  notes->part = part;
+}
+
+/*
+ * footnotes_merge
+ * @notes
+ * @part_notes: emptied; its notes are moved over
+ * @part: the notes of @part_notes go in this part
+ *
+ * appends the notes of @part_notes, numbered after those of @notes
+ */
+void
+footnotes_merge (Footnotes *notes,
+                 Footnotes *part_notes,
+                 size_t     part)
+{
+  for (size_t i = 0; i < part_notes->n_refs; i++)
+    {
+      Reference *ref = append_ref (notes);
+
+      *ref = part_notes->refs[i];
+      ref->index = notes->n_refs;
+      ref->part = part;
+      notes->n_referrers += ref->n_referrers;
+
+      index_add (notes, ref);
+    }
+
+  part_notes->n_refs = 0;
+  part_notes->n_referrers = 0;
+}
@@ -19,19 +19,29 @@
  */
 
 
+#include <fcntl.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <unistd.h>
 #include "html.h"
 #include "macro.h"
 #include "syntax.h"
+#include "strbuf.h"
+#include "events.h"
+#include "stats.h"
+#include "trace.h"
+#include "limit.h"
+#include "image.h"
+#include "css.h"
+#include "compress.h"
 
 /*
  * utility macros
  */
 
 #define FWRITE_STR(str, file) \
-        fwrite (str, sizeof (char), strlen (str), file);
+        output_write (file, str, strlen (str));
 
 /*
  * @default HTML values
@@ -61,9 +71,6 @@ static html_tags tags[] = {
   {HTML_TAG_NEWLINE, NULL, NULL},
 };
 
-/* local reference */
-static Footnotes *footnotes = NULL;
-
 /*
  * html_init
  * @html
@@ -71,8 +78,7 @@ static Footnotes *footnotes = NULL;
  * allocates memory to HTML object
  */
 static void
-html_init (HTML **html,
-           uint  n_lines)
+html_init (HTML **html)
 {
   *html = malloc (sizeof (HTML));
 
@@ -87,9 +93,16 @@ html_init (HTML **html,
   (*html)->title = NULL;
 
   (*html)->stylesheet = NULL;
+  (*html)->style = NULL;
+  (*html)->style_len = 0;
   (*html)->document = true;
-  (*html)->n_lines = n_lines;
-  (*html)->html = malloc (n_lines * sizeof (HTMLUnit));
+  (*html)->template = NULL;
+  (*html)->minify = false;
+  (*html)->anchors = NULL;
+  memset ((*html)->compress_levels, 0, sizeof ((*html)->compress_levels));
+  (*html)->notes = NULL;
+  (*html)->n_lines = 0;
+  (*html)->html = NULL;
 }
 
 static HTMLTag
@@ -118,6 +131,34 @@ find_html_tag (UnitType type)
   return HTML_TAG_NONE;
 }
 
+/*
+ * html_unit_view
+ * @unit: filled in
+ * @md_unit
+ *
+ * @unit refers to the content of @md_unit, without taking it over
+ */
+void
+html_unit_view (HTMLUnit     *unit,
+                const MDUnit *md_unit)
+{
+  memset (unit, 0, sizeof (HTMLUnit));
+
+  unit->tag = find_html_tag (md_unit->type);
+
+  /* strdup is expensive;
+   * refer to the same string */
+  unit->content = md_unit->content;
+  unit->content_len = md_unit->content_len;
+  unit->borrowed = md_unit->borrowed;
+
+  unit->uri = md_unit->uri;
+  unit->lang = md_unit->lang;
+  unit->type = md_unit->type;
+  unit->line = md_unit->line;
+  unit->part = md_unit->part;
+}
+
 /*
  * html_unit_init
  * @html_unit
@@ -130,7 +171,6 @@ html_unit_init (HTMLUnit **unit,
                 MDUnit   **md_unit)
 {
   *unit = (HTMLUnit *) malloc (sizeof (HTMLUnit));
-  memset(*unit, 0, sizeof(HTMLUnit));
 
   // malloc fails
   if (*unit == NULL)
@@ -139,55 +179,72 @@ html_unit_init (HTMLUnit **unit,
       return;
     }
 
-  (*unit)->tag = find_html_tag ((*md_unit)->type);
-
-  /* strdup is expensive;
-   * refer to the same string */
-  if ((*md_unit)->content != NULL)
-    (*unit)->content = (*md_unit)->content;
-
-  (*unit)->uri = (*md_unit)->uri;
-  (*unit)->lang = (*md_unit)->lang;
+  html_unit_view (*unit, *md_unit);
 
   /* move forward */
   *md_unit = (*md_unit)->next;
 }
 
+static void
+init_title (HTML     *html,
+            HTMLUnit *unit)
+{
+  if (html->title == NULL)
+    {
+      if (unit != NULL && unit->tag == HTML_TAG_H1)
+        html->title = strdup (unit->content);
+      else
+        html->title = strdup (__DEFAULT_HTML_TITLE__);
+    }
+}
+
+/* the <link> or <style> element, if there is a stylesheet */
+static void
+write_stylesheet (HTMLFile *file,
+                  HTML     *html)
+{
+  if (html->style)
+    {
+      FWRITE_STR ("<style>", file);
+      output_write (file, html->style, html->style_len);
+      FWRITE_STR ("</style>", file);
+    }
+  else if (html->stylesheet)
+    {
+      output_printf (file, "<link rel=\"stylesheet\" href=\"%s\">", html->stylesheet);
+    }
+}
+
 /*
  * init_template
  * @file: HTMLFile
+ * @html
+ * @unit: first unit of the doc, or NULL; an h1 becomes the title
  *
  * inject template HTML code in a file
  */
 static void
 init_template (HTMLFile *file,
-               HTML     *html)
+               HTML     *html,
+               HTMLUnit *unit)
 {
-  HTMLUnit *unit = NULL;
+  init_title (html, unit);
 
-  if (html->title == NULL)
-    {
-      if (html->html != NULL && (unit = html->html[0]) && unit->tag == HTML_TAG_H1)
-        html->title = strdup (unit->content);
-      else
-        html->title = strdup (__DEFAULT_HTML_TITLE__);
-    }
-
-  fprintf (file,
+  output_printf (file,
     "<!DOCTYPE html>\n"
     "<html lang=\"en\">\n"
     "<head>\n"
     "\t<meta charset=\"UTF-8\">\n"
     "\t<meta name=\"viewport\" content=\"width=device-width, initial-scale=1.0\">\n");
 
-  if (html->stylesheet)
+  if (html->style || html->stylesheet)
     {
-      fprintf (file,
-               "\t<link rel=\"stylesheet\" href=\"%s\">\n",
-               html->stylesheet);
+      FWRITE_STR ("\t", file);
+      write_stylesheet (file, html);
+      FWRITE_STR ("\n", file);
     }
 
-  fprintf (file,
+  output_printf (file,
     "\t<title>%s</title>\n"
     "</head>\n"
     "<body>\n", html->title);
@@ -196,54 +253,155 @@ init_template (HTMLFile *file,
 static void
 final_template (HTMLFile *file)
 {
-  fprintf (file,
+  output_printf (file,
     "</body>\n"
     "</html>\n");
 }
 
 /*
- * html_from_md
- * @md: markdown doc
- * @file_name: custom file name
+ * init_template_minified
  *
- * converts markdown doc into html
- * also takes *ownership* of content
+ * same as init_template (), without the formatting whitespace
  */
-HTML*
-html_from_md (MD     *md,
-              Params *params)
+static void
+init_template_minified (HTMLFile *file,
+                        HTML     *html,
+                        HTMLUnit *unit)
+{
+  init_title (html, unit);
+
+  FWRITE_STR ("<!DOCTYPE html><html lang=\"en\"><head><meta charset=\"UTF-8\">"
+              "<meta name=\"viewport\" content=\"width=device-width,initial-scale=1\">",
+              file);
+
+  write_stylesheet (file, html);
+
+  output_printf (file, "<title>%s</title></head><body>", html->title);
+}
+
+static void
+final_template_minified (HTMLFile *file)
+{
+  FWRITE_STR ("</body></html>", file);
+}
+
+/*
+ * html_unit_new
+ * @md_unit
+ *
+ * takes *ownership* of the content of @md_unit
+ */
+HTMLUnit *
+html_unit_new (MDUnit *md_unit)
+{
+  HTMLUnit *unit = NULL;
+
+  html_unit_init (&unit, &md_unit);
+
+  return unit;
+}
+
+void
+html_unit_free (HTMLUnit *unit)
+{
+  if (unit->content != NULL && !unit->borrowed)
+    free (unit->content);
+
+  free (unit);
+}
+
+/*
+ * html_new
+ * @params: output options
+ * @md: doc whose footnotes and limits are used; not owned
+ *
+ * creates an HTML doc without units, see html_write_unit ()
+ */
+HTML *
+html_new (Params *params,
+          MD     *md)
 {
-  uint i = 0;
-  MDUnit *unit = NULL;
   HTML *html = NULL;
 
-  html_init (&html, md->n_lines);
+  html_init (&html);
 
   /* css */
   if (params->css_file)
     html->stylesheet = strdup (params->css_file);
 
+  /* falls back to the <link> if the file can't be read */
+  if (params->css_file && params->inline_css)
+    html->style = css_inline (params->css_file, &html->style_len);
+
   html->document = params->document;
+  html->minify = params->minify;
+
+  /* falls back to the built-in wrapper if it can't be compiled */
+  if (params->template_file && params->document)
+    {
+      const char *error;
+
+      html->template = template_get (params->template_file, &error);
+    }
+  memcpy (html->compress_levels, params->compress_levels, sizeof (html->compress_levels));
+
+  /* the search index points at headings */
+  if (params->index_file != NULL)
+    html->anchors = anchors_new ();
 
   /* custom file_name */
   if (params->o_file != NULL)
-    html->file_name = strdup (params->o_file);
+    {
+      free (html->file_name);
+      html->file_name = strdup (params->o_file);
+    }
 
   if (params->title != NULL)
     html->title = strdup (params->title);
 
+  html->notes = md->notes;
+  html->limits = &md->limits;
+
+  return html;
+}
+
+/*
+ * html_from_md
+ * @md: markdown doc
+ * @params: output options
+ *
+ * converts markdown doc into html
+ * also takes *ownership* of content: the units of @md are left without
+ * it, for md_free ()
+ */
+HTML*
+html_from_md (MD     *md,
+              Params *params)
+{
+  size_t i = 0;
+  MDUnit *unit = NULL;
+  HTML *html = NULL;
+
+  html = html_new (params, md);
+
+  html->n_lines = md->n_lines;
+  html->html = malloc (md->n_lines * sizeof (HTMLUnit *));
+
   unit = md->elements;
   while (unit != NULL)
     {
       HTMLUnit *html_unit = NULL;
+      MDUnit *md_unit = unit;
 
       html_unit_init (&html_unit, &unit);
 
+      md_unit->content = NULL;
+      md_unit->content_len = 0;
+      md_unit->borrowed = false;
+
       html->html[i++] = html_unit;
     }
 
-  footnotes = md->notes;
-
   return html;
 }
 
@@ -257,20 +415,17 @@ void
 html_free (HTML *html)
 {
   /* free HTML units */
-  for (uint i = 0; i < html->n_lines; i++)
-    {
-      HTMLUnit *unit = html->html[i];
-
-      if (unit->content != NULL)
-        free (unit->content);
-
-      free (unit);
-    }
+  for (size_t i = 0; i < html->n_lines; i++)
+    html_unit_free (html->html[i]);
 
   if (html->title != NULL)
     free (html->title);
+  if (html->stylesheet != NULL)
+    free (html->stylesheet);
   if (html->file_name != NULL)
     free (html->file_name);
+  if (html->anchors != NULL)
+    anchors_free (html->anchors);
 
   free (html->html);
   free (html);
@@ -298,174 +453,190 @@ tag_is_list (HTMLTag tag)
   return tag == HTML_TAG_LI;
 }
 
-#define OFFSET 400
-
-struct fmt {
-  const char *start_pattern;
-  const char *end_pattern; /* end_pattern is needed here because
-                            * the ending underscores need a whitespace
-                            * at the end to be valid */
-  const char *start_tag;
-  const char *end_tag;
-} regx[] = {
-  { "***", "***",  "<b><i>", "</i></b>" },
-  { "**",  "**",   "<b>",    "</b>"     },
-  { "*",   "*",    "<i>",    "</i>"     },
-  { "___", "___ ", "<b><i>", "</i></b>" },
-  { "__",  "__ ",  "<b>",    "</b>"     },
-  { "_",   "_ ",   "<i>",    "</i>"     },
-  { "`",   "`",    "<code>", "</code>"  },
-};
+/*
+ * inline HTML, driven by md_walk_inline ()
+ */
+typedef struct {
+  StrBuf      buf;
+  Footnotes  *notes;
+  LimitState *limits;
+} InlineHTML;
 
+/*
+ * Keep order in-sync with SpanType in events.h
+ */
+static const char *span_tags[][2] = {
+  [SPAN_TYPE_EM]        = { "<i>",    "</i>"     },
+  [SPAN_TYPE_STRONG]    = { "<b>",    "</b>"     },
+  [SPAN_TYPE_STRONG_EM] = { "<b><i>", "</i></b>" },
+  [SPAN_TYPE_CODE]      = { "<code>", "</code>"  },
+};
 
-static char *
-format_text (char *content)
+static void
+append_footnote_ref (InlineHTML *inline_html,
+                     Reference  *ref)
 {
-  char *replaced = NULL;
-  char *ptr = NULL;
-  size_t size = 256;
-  size_t len = 0, write;
-  size_t n_regex = sizeof (regx) / sizeof (regx[0]);
+  StrBuf *buf = &inline_html->buf;
+  uuid_t uuid;
+  char index[24];
 
-  replaced = malloc (sizeof (char) * size);
-  ptr = content;
-
-  while (*ptr)
+  if (ref == NULL ||
+      !limit_check (inline_html->limits, LIMIT_REFERRERS,
+                    footnotes_get_referrer_count (inline_html->notes) + 1))
     {
-      bool in_regx = false;
+      strbuf_append (buf, "<a href=\"#\"><sup>?</sup></a>");
+      return;
+    }
 
-      for (size_t i = 0; i < n_regex; i++)
-        {
-          int offset = strlen (regx[i].start_pattern);
+  uuid_generate_random (uuid);
+  snprintf (index, sizeof (index), "%zu", ref->index);
 
-          if (strncmp (ptr, regx[i].start_pattern, offset) == 0) {
-              char *start, *end;
+  strbuf_append (buf, "<a href=\"#fn-");
+  strbuf_append (buf, ref->uuid);
+  strbuf_append (buf, "\" id=\"fnref-");
+  strbuf_append (buf, uuid);
+  strbuf_append (buf, "\"><sup>");
+  strbuf_append (buf, index);
+  strbuf_append (buf, "</sup></a>");
 
-              start = ptr + offset;
-              end = strstr (start, regx[i].end_pattern);
+  footnotes_add_referrer (inline_html->notes, ref->index, uuid);
+}
 
-              if (end != NULL)
-                {
-                  write = sprintf (replaced + len, "%s%.*s%s",
-                                                   regx[i].start_tag,
-                                                   (int)(end - start), start,
-                                                   regx[i].end_tag);
+static void
+inline_enter_span (const MDSpan *span,
+                   void         *user_data)
+{
+  InlineHTML *inline_html = user_data;
+  StrBuf *buf = &inline_html->buf;
 
-                  len += write;
-                  ptr = end + offset;
-                  in_regx = true;
-                }
-            }
-        }
+  switch (span->type)
+    {
+      case SPAN_TYPE_LINK:
+        strbuf_append (buf, "<a href=\"");
+        strbuf_append_len (buf, span->href, span->href_len);
+        strbuf_append (buf, "\">");
+        break;
+      case SPAN_TYPE_IMAGE:
+        strbuf_append (buf, "<img src=\"");
+        strbuf_append_len (buf, span->href, span->href_len);
+        strbuf_append (buf, "\" alt=\"");
+        break;
+      case SPAN_TYPE_FOOTNOTE_REF:
+        append_footnote_ref (inline_html, span->ref);
+        break;
+      default:
+        strbuf_append (buf, span_tags[span->type][0]);
+        break;
+    }
+}
 
-      if (in_regx)
-        {
-          continue;
-        }
-      else if (*ptr == '!' && *(ptr + 1) == '[')
-        {
-          char *alt_start = ptr + 2;
-          char *alt_end = strstr (alt_start, "](");
+/* sized so that the page doesn't shift once the image is in */
+static void
+append_image_attributes (StrBuf       *buf,
+                         const MDSpan *span)
+{
+  unsigned width, height;
+  char size[64];
 
-          if (alt_end)
-            {
-              char *src_start = alt_end + 2;
-              char *src_end = strchr (src_start, ')');
-
-              if (src_end)
-                {
-                  write = sprintf (replaced + len, "<img src=\"%.*s\" alt=\"%.*s\">",
-                                                   (int) (src_end - src_start), src_start,
-                                                   (int) (alt_end - alt_start), alt_start);
-                  len += write;
-                  ptr = src_end + 1;
-
-                  continue;
-                }
-            }
-        }
-      else if (*ptr == '[' && * (ptr + 1) == '^')
-        {
-          char *id_start = ptr + 2;
-          char *id_end;
+  if (image_size (span->href, span->href_len, &width, &height))
+    {
+      snprintf (size, sizeof (size), " width=\"%u\" height=\"%u\"", width, height);
+      strbuf_append (buf, size);
+    }
 
-          id_end = strchr (id_start, ']');
+  strbuf_append (buf, " loading=\"lazy\" decoding=\"async\"");
+}
 
-          if (id_end)
-            {
-              char *id = NULL;
-              int id_len;
-              Reference *ref;
+static void
+inline_leave_span (const MDSpan *span,
+                   void         *user_data)
+{
+  InlineHTML *inline_html = user_data;
+  StrBuf *buf = &inline_html->buf;
 
-              id_len = id_end - id_start;
-              ptr += id_len + 3;
+  switch (span->type)
+    {
+      case SPAN_TYPE_LINK:
+        strbuf_append (buf, "</a>");
+        break;
+      case SPAN_TYPE_IMAGE:
+        strbuf_append (buf, "\"");
+        if (image_probing)
+          append_image_attributes (buf, span);
+        strbuf_append (buf, ">");
+        break;
+      case SPAN_TYPE_FOOTNOTE_REF:
+        break;
+      default:
+        strbuf_append (buf, span_tags[span->type][1]);
+        break;
+    }
+}
 
+static void
+inline_text (const char *text,
+             size_t      len,
+             void       *user_data)
+{
+  InlineHTML *inline_html = user_data;
 
-              id = calloc (id_len + 1, sizeof (char));
-              strncpy (id, id_start, id_len);
+  strbuf_append_len (&inline_html->buf, text, len);
+}
 
-              ref = footnotes_get_ref (footnotes, id);
-              if (ref != NULL)
-                {
-                  uuid_t uuid;
-                  uuid_generate_random (uuid);
+static const MDEvents inline_html_events = {
+  .enter_span = inline_enter_span,
+  .leave_span = inline_leave_span,
+  .text       = inline_text,
+};
 
-                  write = sprintf (replaced + len, "<a href=\"#fn-%s\" id=\"fnref-%s\">"
-                                                    "<sup>%d</sup>"
-                                                    "</a>",
-                                                    ref->uuid, uuid, ref->index);
+/*
+ * format_text
+ * @content: text of a unit
+ * @footnotes: resolves [^id] references; referrers get recorded
+ * @limits: of the doc, for LIMIT_REFERRERS; NULL for none
+ *
+ * returns the inline HTML for @content
+ */
+char *
+format_text (char       *content,
+             Footnotes  *footnotes,
+             LimitState *limits)
+{
+  InlineHTML inline_html;
 
-                  footnotes_add_referrer (footnotes, ref->index, uuid);
-                }
-              else
-                {
-                  write = sprintf (replaced + len, "<a href=\"#\"><sup>?</sup></a>");
-                }
+  strbuf_init (&inline_html.buf, 256);
+  inline_html.notes = footnotes;
+  inline_html.limits = limits;
 
-              free (id);
-              len += write;
-            }
-        }
-      else if (*ptr == '[')
-        {
-          char *anc_start = ptr + 1;
-          char *anc_end = strstr (anc_start, "](");
+  md_walk_inline (content, footnotes, limits, &inline_html_events, &inline_html);
 
-          if (anc_end)
-            {
-              char *href_start = anc_end + 2;
-              char *href_end = strchr (href_start, ')');
-
-              if (href_end)
-                {
-                  write = sprintf (replaced + len, "<a href=\"%.*s\">%.*s</a>",
-                                          (int) (href_end - href_start), href_start,
-                                          (int) (anc_end - anc_start), anc_start);
-                  len += write;
-                  ptr = href_end + 1;
-
-                  continue;
-                }
-            }
-        }
+  /* give ownership */
+  return strbuf_steal (&inline_html.buf);
+}
 
-      replaced[len++] = *ptr++;
-      if (len + OFFSET >= size)
-        {
-          size <<= 1;
-          replaced = realloc (replaced, size);
-        }
+/* back links to every reference of @ref */
+static void
+flush_referrers (HTMLFile  *file,
+                 Reference *ref)
+{
+  for (size_t j = 0; j < ref->n_referrers; j++)
+    {
+      if (j != 0)
+        output_printf (file,
+                       "<a href=\"#fnref-%s\">↩︎<sup>%zu</sup></a>",
+                       ref->referrers[j], j + 1);
+      else
+        output_printf (file,
+                       "<a href=\"#fnref-%s\">↩︎</a>",
+                       ref->referrers[j]);
     }
-
-  replaced[len] = '\0';
-  /* give ownership */
-  return replaced;
 }
 
 static void
-flush_footnotes (HTMLFile *file)
+flush_footnotes (HTMLFile  *file,
+                 Footnotes *footnotes)
 {
-  int n_refs;
+  size_t n_refs;
 
   n_refs = footnotes_get_count (footnotes);
 
@@ -474,31 +645,49 @@ flush_footnotes (HTMLFile *file)
 
   FWRITE_STR ("\n\t<hr>\n", file);
 
-  for (int i = 0; i < n_refs; i++)
+  for (size_t i = 0; i < n_refs; i++)
     {
       Reference *ref;
 
       ref = footnotes_get_ref_from_index (footnotes, i);
 
       INSERT_TABSPACE (file);
-      fprintf (file, "<p id=\"fn-%s\">"
-                     "\t\t%d. %s",
-                     ref->uuid, ref->index, ref->text);
+      output_printf (file, "<p id=\"fn-%s\">"
+                           "\t\t%zu. %s",
+                           ref->uuid, ref->index, ref->text);
 
-      for (int j = 0; j < ref->n_referrers; j++)
-        {
-          if (j != 0)
-            fprintf (file,
-                     "<a href=\"#fnref-%s\">↩︎<sup>%d</sup></a>",
-                     ref->referrers[j], j + 1);
-          else
-            fprintf (file,
-                     "<a href=\"#fnref-%s\">↩︎</a>",
-                     ref->referrers[j]);
-        }
+      flush_referrers (file, ref);
+
+      output_printf (file, "</p>\n");
+
+    }
+}
 
-      fprintf (file, "</p>\n");
+static void
+flush_footnotes_minified (HTMLFile  *file,
+                          Footnotes *footnotes)
+{
+  size_t n_refs;
+
+  n_refs = footnotes_get_count (footnotes);
+
+  if (n_refs == 0)
+    return;
+
+  FWRITE_STR ("<hr>", file);
+
+  for (size_t i = 0; i < n_refs; i++)
+    {
+      Reference *ref;
 
+      ref = footnotes_get_ref_from_index (footnotes, i);
+
+      output_printf (file, "<p id=\"fn-%s\">%zu. %s",
+                     ref->uuid, ref->index, ref->text);
+
+      flush_referrers (file, ref);
+
+      FWRITE_STR ("</p>", file);
     }
 }
 
@@ -508,8 +697,14 @@ syntax_highlight_block (char     *codeblk,
                         HTMLFile *file)
 {
   char *highlighted = NULL;
+  StatsTimer timer;
+  TraceSpan span;
 
+  stats_timer_start (&timer);
+  trace_begin (&span);
   highlighted = syntax_highlight (codeblk, lang);
+  trace_end_args (&span, "syntax_highlight", NULL, md_lang_name (lang), 0);
+  stats_timer_stop (&timer, STATS_STAGE_HIGHLIGHT_LANG (lang));
 
   if (highlighted != NULL)
     {
@@ -520,10 +715,19 @@ syntax_highlight_block (char     *codeblk,
 
 static void
 flush_content (HTMLFile *file,
+               HTML     *html,
                HTMLUnit *unit)
 {
-  if (tags[unit->tag].start_tag)
-    FWRITE_STR (tags[unit->tag].start_tag, file);
+  if (html->anchors != NULL && unit->tag <= HTML_TAG_H3)
+    {
+      output_printf (file, "<h%d id=\"%s\">", unit->tag - HTML_TAG_H1 + 1,
+                     anchors_next (html->anchors, unit->content ? unit->content : "",
+                                   unit->content_len));
+    }
+  else if (tags[unit->tag].start_tag)
+    {
+      FWRITE_STR (tags[unit->tag].start_tag, file);
+    }
 
   if (unit->content)
     {
@@ -531,7 +735,8 @@ flush_content (HTMLFile *file,
         {
           if (unit->lang == LANG_NONE || unit->lang == LANG_HTML)
             {
-              FWRITE_STR (unit->content, file);
+              /* stays valid until html_free (); no copy */
+              output_write_ref (file, unit->content, unit->content_len);
             }
           else
             {
@@ -541,8 +746,12 @@ flush_content (HTMLFile *file,
       else
         {
           char *replaced = NULL;
+          StatsTimer timer;
 
-          replaced = format_text (unit->content);
+          stats_timer_start (&timer);
+          footnotes_set_part (html->notes, unit->part);
+          replaced = format_text (unit->content, html->notes, html->limits);
+          stats_timer_stop (&timer, STATS_STAGE_FORMAT);
           FWRITE_STR (replaced, file);
 
           free (replaced);
@@ -556,14 +765,11 @@ flush_content (HTMLFile *file,
 static void
 pre_format (HTMLFile *file,
             HTML     *html,
-            int       index)
+            HTMLUnit *prev,
+            HTMLUnit *unit)
 {
-  HTMLUnit *unit = NULL;
-
-  unit = html->html[index];
-
   if (unit->tag == HTML_TAG_LI &&
-      (index == 0 || html->html[index - 1]->tag != HTML_TAG_LI))
+      (prev == NULL || prev->tag != HTML_TAG_LI))
     {
       UL_TOP_LEVEL_START (file);
     }
@@ -578,15 +784,10 @@ pre_format (HTMLFile *file,
     }
 }
 
-static void
-post_format (HTMLFile *file,
-             HTML     *html,
-             uint      index)
+static inline bool
+needs_linebreak (HTMLUnit *prev,
+                 HTMLUnit *unit)
 {
-  HTMLUnit *unit = NULL;
-
-  unit = html->html[index];
-
   /*
    * Do not add <br>
    *  1. after a heading
@@ -594,14 +795,23 @@ post_format (HTMLFile *file,
    *  3. if previous element was a heading
    *
    */
-  if (!(tag_is_heading (unit->tag)  ||
-        tag_is_code_block (unit->tag) ||
-        tag_is_list (unit->tag) ||
-       ((index != 0) && unit->tag == HTML_TAG_NEWLINE && tag_is_heading (html->html[index - 1]->tag))))
+  return !(tag_is_heading (unit->tag)  ||
+           tag_is_code_block (unit->tag) ||
+           tag_is_list (unit->tag) ||
+          (prev != NULL && unit->tag == HTML_TAG_NEWLINE && tag_is_heading (prev->tag)));
+}
+
+static void
+post_format (HTMLFile *file,
+             HTMLUnit *prev,
+             HTMLUnit *unit,
+             HTMLUnit *next)
+{
+  if (needs_linebreak (prev, unit))
     INSERT_LINEBREAK (file);
 
   if (unit->tag == HTML_TAG_LI &&
-      (index == html->n_lines - 1 || html->html[index + 1]->tag != HTML_TAG_LI))
+      (next == NULL || next->tag != HTML_TAG_LI))
     {
       UL_TOP_LEVEL_END (file);
     }
@@ -610,38 +820,294 @@ post_format (HTMLFile *file,
 }
 
 /*
- * flush_html
- * @html: HTML doc
+ * write_unit_minified
  *
- * flushed HTML doc into a html file
+ * same as pre_format (), flush_content () and post_format (), minus
+ * the formatting whitespace; <br> and lists are kept, they show
+ */
+static void
+write_unit_minified (HTMLFile *file,
+                     HTML     *html,
+                     HTMLUnit *prev,
+                     HTMLUnit *unit,
+                     HTMLUnit *next)
+{
+  if (unit->tag == HTML_TAG_LI &&
+      (prev == NULL || prev->tag != HTML_TAG_LI))
+    FWRITE_STR ("<ul>", file);
+
+  flush_content (file, html, unit);
+
+  if (needs_linebreak (prev, unit))
+    INSERT_LINEBREAK (file);
+
+  if (unit->tag == HTML_TAG_LI &&
+      (next == NULL || next->tag != HTML_TAG_LI))
+    FWRITE_STR ("</ul>", file);
+}
+
+static void
+write_footnotes (HTMLFile *file,
+                 HTML     *html)
+{
+  StatsTimer timer;
+  TraceSpan span;
+
+  stats_timer_start (&timer);
+  trace_begin (&span);
+  if (html->minify)
+    flush_footnotes_minified (file, html->notes);
+  else
+    flush_footnotes (file, html->notes);
+  trace_end (&span, "footnotes");
+  stats_timer_stop (&timer, STATS_STAGE_FOOTNOTES);
+}
+
+/*
+ * write_segments
+ * @file
+ * @html: html->template is set
+ * @from: first segment
+ * @to: after the last one
+ *
+ * the content slot is left for the units
+ */
+static void
+write_segments (HTMLFile *file,
+                HTML     *html,
+                size_t    from,
+                size_t    to)
+{
+  for (size_t i = from; i < to; i++)
+    {
+      const TemplateSegment *segment = &html->template->segments[i];
+
+      output_write (file, segment->text, segment->len);
+
+      switch (segment->slot)
+        {
+          case TEMPLATE_SLOT_TITLE:
+            output_write (file, html->title, strlen (html->title));
+            break;
+          case TEMPLATE_SLOT_STYLESHEET:
+            write_stylesheet (file, html);
+            break;
+          case TEMPLATE_SLOT_FOOTNOTES:
+            write_footnotes (file, html);
+            break;
+          default:
+            break;
+        }
+    }
+}
+
+/*
+ * html_write_begin
+ * @file
+ * @html
+ * @first: first unit of the doc, or NULL if it's empty
+ *
+ * writes the document template head, if enabled
  */
 void
-flush_html (HTML *html)
+html_write_begin (HTMLFile *file,
+                  HTML     *html,
+                  HTMLUnit *first)
 {
-  HTMLFile *file = NULL;
+  if (!html->document)
+    return;
 
-  file = fopen (html->file_name, "w+");
+  if (html->template)
+    {
+      init_title (html, first);
+      write_segments (file, html, 0, html->template->content + 1);
+    }
+  else if (html->minify)
+    init_template_minified (file, html, first);
+  else
+    init_template (file, html, first);
+}
+
+/*
+ * html_write_unit
+ * @file
+ * @html
+ * @prev: unit before @unit, or NULL
+ * @unit
+ * @next: unit after @unit, or NULL
+ *
+ * lists and line breaks depend on the neighbouring units
+ */
+void
+html_write_unit (HTMLFile *file,
+                 HTML     *html,
+                 HTMLUnit *prev,
+                 HTMLUnit *unit,
+                 HTMLUnit *next)
+{
+  TraceSpan span;
+
+  trace_begin (&span);
+
+  if (html->minify)
+    {
+      write_unit_minified (file, html, prev, unit, next);
+    }
+  else
+    {
+      pre_format (file, html, prev, unit);
+      flush_content (file, html, unit);
+      post_format (file, prev, unit, next);
+    }
+
+  trace_end_args (&span, "block", md_unit_type_name (unit->type),
+                  unit->tag == HTML_TAG_CODE_BLOCK ? md_lang_name (unit->lang) : NULL,
+                  unit->line);
+}
+
+/*
+ * html_write_end
+ * @file
+ * @html
+ *
+ * writes the footnotes and the document template tail
+ */
+void
+html_write_end (HTMLFile *file,
+                HTML     *html)
+{
+  if (html->template)
+    {
+      if (!html->template->has_footnotes)
+        write_footnotes (file, html);
+
+      write_segments (file, html, html->template->content + 1,
+                      html->template->n_segments);
+      return;
+    }
+
+  write_footnotes (file, html);
 
   if (html->document)
-    init_template (file, html);
+    {
+      if (html->minify)
+        final_template_minified (file);
+      else
+        final_template (file);
+    }
+}
+
+/*
+ * html_unit_is_resolved
+ * @unit
+ * @footnotes
+ *
+ * returns false while @unit refers to a footnote that isn't defined
+ * (yet); rendering it now would number the reference wrong
+ */
+bool
+html_unit_is_resolved (HTMLUnit  *unit,
+                       Footnotes *footnotes)
+{
+  const char *ptr;
 
-  for (uint i = 0; i < html->n_lines; i++)
+  if (unit->content == NULL || unit->tag == HTML_TAG_CODE_BLOCK)
+    return true;
+
+  ptr = unit->content;
+  while ((ptr = strstr (ptr, "[^")) != NULL)
     {
-      HTMLUnit *unit = NULL;
+      const char *id_start = ptr + 2;
+      const char *id_end = strchr (id_start, ']');
+      char *id;
+      bool found;
 
-      unit = html->html[i];
+      if (id_end == NULL)
+        break;
 
-      pre_format (file, html, i);
+      id = strndup (id_start, id_end - id_start);
+      found = footnotes_get_ref (footnotes, id) != NULL;
+      free (id);
 
-      flush_content (file, unit);
+      if (!found)
+        return false;
 
-      post_format (file, html, i);
+      ptr = id_end + 1;
     }
 
-  flush_footnotes (file);
+  return true;
+}
 
-  if (html->document)
-    final_template (file);
+/*
+ * html_write
+ * @html: HTML doc
+ * @file
+ *
+ * writes the whole HTML doc; limits are checked between blocks
+ */
+void
+html_write (HTML     *html,
+            HTMLFile *file)
+{
+  html_write_begin (file, html, html->n_lines ? html->html[0] : NULL);
+
+  for (size_t i = 0; i < html->n_lines; i++)
+    {
+      if (html->limits->exceeded != LIMIT_NONE || !limit_check_time (html->limits))
+        break;
+
+      html_write_unit (file, html,
+                       i > 0 ? html->html[i - 1] : NULL,
+                       html->html[i],
+                       i + 1 < html->n_lines ? html->html[i + 1] : NULL);
+
+      limit_check (html->limits, LIMIT_OUTPUT_BYTES, output_get_bytes (file));
+    }
+
+  if (html->limits->exceeded == LIMIT_NONE)
+    {
+      html_write_end (file, html);
+      limit_check (html->limits, LIMIT_OUTPUT_BYTES, output_get_bytes (file));
+    }
+}
+
+/*
+ * flush_html
+ * @html: HTML doc
+ *
+ * flushed HTML doc into a html file, plus its precompressed copies
+ * (html->compress_levels) encoded in the same pass
+ *
+ * if a limit is hit the partial file is removed and html->limits
+ * tells which
+ *
+ * returns false if the file or a copy couldn't be written
+ */
+bool
+flush_html (HTML *html)
+{
+  HTMLFile *file = NULL;
+  Precompress *pre;
+  bool ok;
+  int fd;
+
+  fd = open (html->file_name, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd < 0)
+    return false;
+
+  file = output_new (fd);
+  pre = precompress_start (file, html->file_name, html->compress_levels);
+
+  html_write (html, file);
+
+  stats_add (STATS_COUNTER_BYTES_OUT, output_get_bytes (file));
+
+  ok = output_free (file);
+  ok = precompress_finish (pre, html->limits->exceeded == LIMIT_NONE) && ok;
+  close (fd);
+
+  if (html->limits->exceeded != LIMIT_NONE)
+    unlink (html->file_name);
 
-  fclose (file);
+  return ok;
 }
@@ -0,0 +1,579 @@
+/* image.c
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "image.h"
+#include "hash.h"
+#include "url.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define IMAGE_CACHE_HEADER   "md2html-image-cache 1"
+#define INITIAL_ENTRIES_SIZE 64
+
+/* markers to walk past before giving up on a JPEG */
+#define JPEG_MAX_SEGMENTS    512
+
+bool image_probing = false;
+
+/*
+ * @Source
+ *
+ * image bytes, from a buffer or read from a file as needed
+ */
+typedef struct {
+  const unsigned char *buf;
+  size_t               len;
+  int                  fd;
+} Source;
+
+static size_t
+source_read (Source        *src,
+             uint64_t       offset,
+             unsigned char *out,
+             size_t         n)
+{
+  ssize_t got;
+
+  if (src->buf != NULL)
+    {
+      if (offset >= src->len)
+        return 0;
+
+      n = n < src->len - offset ? n : src->len - offset;
+      memcpy (out, src->buf + offset, n);
+
+      return n;
+    }
+
+  got = pread (src->fd, out, n, offset);
+
+  return got > 0 ? (size_t) got : 0;
+}
+
+static inline uint32_t
+be16 (const unsigned char *p)
+{
+  return (uint32_t) p[0] << 8 | p[1];
+}
+
+static inline uint32_t
+be32 (const unsigned char *p)
+{
+  return (uint32_t) p[0] << 24 | (uint32_t) p[1] << 16 | (uint32_t) p[2] << 8 | p[3];
+}
+
+static inline uint32_t
+le16 (const unsigned char *p)
+{
+  return (uint32_t) p[1] << 8 | p[0];
+}
+
+static inline uint32_t
+le24 (const unsigned char *p)
+{
+  return (uint32_t) p[2] << 16 | (uint32_t) p[1] << 8 | p[0];
+}
+
+static inline uint32_t
+le32 (const unsigned char *p)
+{
+  return (uint32_t) p[3] << 24 | le24 (p);
+}
+
+/*
+ * probe_jpeg
+ *
+ * walks the segments up to the first frame header; big ones like EXIF
+ * are skipped over, not read
+ */
+static bool
+probe_jpeg (Source   *src,
+            unsigned *width,
+            unsigned *height)
+{
+  uint64_t offset = 2;
+
+  for (int i = 0; i < JPEG_MAX_SEGMENTS; i++)
+    {
+      unsigned char m[7];
+      unsigned char marker;
+
+      if (source_read (src, offset, m, 4) != 4 || m[0] != 0xFF)
+        return false;
+
+      marker = m[1];
+
+      /* fill byte */
+      if (marker == 0xFF)
+        {
+          offset++;
+          continue;
+        }
+
+      /* no length */
+      if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD8))
+        {
+          offset += 2;
+          continue;
+        }
+
+      /* end of image, or a scan before any frame header */
+      if (marker == 0xD9 || marker == 0xDA || be16 (m + 2) < 2)
+        return false;
+
+      /* SOF0..15, except DHT, JPG and DAC */
+      if (marker >= 0xC0 && marker <= 0xCF &&
+          marker != 0xC4 && marker != 0xC8 && marker != 0xCC)
+        {
+          if (source_read (src, offset + 4, m, 5) != 5)
+            return false;
+
+          *height = be16 (m + 1);
+          *width = be16 (m + 3);
+
+          return true;
+        }
+
+      offset += 2 + be16 (m + 2);
+    }
+
+  return false;
+}
+
+static bool
+probe_source (Source   *src,
+              unsigned *width,
+              unsigned *height)
+{
+  static const unsigned char png[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+  unsigned char header[30] = { 0 };
+  size_t len;
+
+  *width = *height = 0;
+  len = source_read (src, 0, header, sizeof (header));
+
+  if (len >= 24 && memcmp (header, png, 8) == 0 && memcmp (header + 12, "IHDR", 4) == 0)
+    {
+      *width = be32 (header + 16);
+      *height = be32 (header + 20);
+    }
+  else if (len >= 10 && (memcmp (header, "GIF87a", 6) == 0 || memcmp (header, "GIF89a", 6) == 0))
+    {
+      *width = le16 (header + 6);
+      *height = le16 (header + 8);
+    }
+  else if (len >= 16 && memcmp (header, "RIFF", 4) == 0 && memcmp (header + 8, "WEBP", 4) == 0)
+    {
+      if (len >= 30 && memcmp (header + 12, "VP8X", 4) == 0)
+        {
+          *width = 1 + le24 (header + 24);
+          *height = 1 + le24 (header + 27);
+        }
+      else if (len >= 30 && memcmp (header + 12, "VP8 ", 4) == 0 &&
+               header[23] == 0x9D && header[24] == 0x01 && header[25] == 0x2A)
+        {
+          *width = le16 (header + 26) & 0x3FFF;
+          *height = le16 (header + 28) & 0x3FFF;
+        }
+      else if (len >= 25 && memcmp (header + 12, "VP8L", 4) == 0 && header[20] == 0x2F)
+        {
+          uint32_t bits = le32 (header + 21);
+
+          *width = 1 + (bits & 0x3FFF);
+          *height = 1 + ((bits >> 14) & 0x3FFF);
+        }
+    }
+  else if (len >= 2 && header[0] == 0xFF && header[1] == 0xD8)
+    {
+      probe_jpeg (src, width, height);
+    }
+
+  return *width != 0 && *height != 0;
+}
+
+/*
+ * image_probe_buffer
+ * @buf: start of an image file
+ * @len
+ * @width
+ * @height
+ *
+ * returns false for unknown formats
+ */
+bool
+image_probe_buffer (const unsigned char *buf,
+                    size_t               len,
+                    unsigned            *width,
+                    unsigned            *height)
+{
+  Source src = { .buf = buf, .len = len, .fd = -1 };
+
+  return probe_source (&src, width, height);
+}
+
+/*
+ * cache
+ */
+typedef struct {
+  char     *path;
+  int64_t   mtime_sec;
+  int64_t   mtime_nsec;
+  int64_t   size;       /* -1: can't be read */
+  unsigned  width;      /* 0: not an image */
+  unsigned  height;
+  bool      checked;    /* stat ()-ed during this run */
+} ImageEntry;
+
+static struct {
+  char *base_dir;
+  char *cache_file;
+  bool  dirty;
+
+  pthread_mutex_t lock;
+  ImageEntry *entries;
+  size_t n_entries;
+  size_t entries_size;
+
+  HashIndex index;    /* over the paths of entries */
+} images = {
+  .lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static bool
+entry_matches (size_t      pos,
+               const void *key,
+               const void *user_data)
+{
+  (void) user_data;
+
+  return strcmp (images.entries[pos].path, key) == 0;
+}
+
+static uint64_t
+entry_hash (size_t      pos,
+            const void *user_data)
+{
+  (void) user_data;
+
+  return hash_str (HASH_INIT, images.entries[pos].path);
+}
+
+static size_t *
+index_lookup (const char *path)
+{
+  return hash_index_lookup (&images.index, hash_str (HASH_INIT, path),
+                            entry_matches, path, NULL);
+}
+
+static ImageEntry *
+entry_find (const char *path)
+{
+  size_t slot;
+
+  if (images.index.size == 0)
+    return NULL;
+
+  slot = *index_lookup (path);
+
+  return slot != 0 ? &images.entries[slot - 1] : NULL;
+}
+
+static ImageEntry *
+entry_add (const char *path)
+{
+  ImageEntry *entry;
+
+  if (images.n_entries == images.entries_size)
+    {
+      images.entries_size = images.entries_size ? images.entries_size << 1
+                                                : INITIAL_ENTRIES_SIZE;
+      images.entries = realloc (images.entries,
+                                sizeof (ImageEntry) * images.entries_size);
+    }
+
+  hash_index_reserve (&images.index, images.n_entries, INITIAL_ENTRIES_SIZE * 2,
+                      entry_hash, NULL);
+
+  entry = &images.entries[images.n_entries++];
+  memset (entry, 0, sizeof (ImageEntry));
+  entry->path = strdup (path);
+  *index_lookup (path) = images.n_entries;
+
+  return entry;
+}
+
+static void
+cache_load (const char *cache_file)
+{
+  FILE *file;
+  char *line = NULL;
+  size_t line_size = 0;
+  ssize_t len;
+
+  file = fopen (cache_file, "r");
+  if (file == NULL)
+    return;
+
+  /* anything else gets overwritten */
+  len = getline (&line, &line_size, file);
+  if (len > 0 && strncmp (line, IMAGE_CACHE_HEADER "\n", len) == 0)
+    {
+      while (getline (&line, &line_size, file) > 0)
+        {
+          ImageEntry *entry;
+          char *tab = strchr (line, '\t');
+          long long sec, nsec, size;
+          unsigned width, height;
+
+          if (tab == NULL || tab == line)
+            continue;
+
+          *tab = '\0';
+          if (sscanf (tab + 1, "%lld\t%lld\t%lld\t%u\t%u",
+                      &sec, &nsec, &size, &width, &height) != 5 ||
+              entry_find (line) != NULL)
+            continue;
+
+          entry = entry_add (line);
+          entry->mtime_sec = sec;
+          entry->mtime_nsec = nsec;
+          entry->size = size;
+          entry->width = width;
+          entry->height = height;
+        }
+    }
+
+  free (line);
+  fclose (file);
+}
+
+/*
+ * image_open
+ * @base_dir: relative image paths start here, i.e. the HTML doc's dir
+ * @cache_file: results of earlier runs, or NULL
+ *
+ * enables probing; an unreadable cache file is treated as empty
+ */
+void
+image_open (const char *base_dir,
+            const char *cache_file)
+{
+  images.base_dir = strdup (base_dir);
+  images.cache_file = cache_file ? strdup (cache_file) : NULL;
+
+  if (cache_file != NULL)
+    cache_load (cache_file);
+
+  image_probing = true;
+}
+
+static bool
+cache_save (void)
+{
+  char tmp[PATH_MAX];
+  FILE *file;
+  bool ok;
+
+  if (snprintf (tmp, sizeof (tmp), "%s.tmp", images.cache_file) >= (int) sizeof (tmp))
+    return false;
+
+  file = fopen (tmp, "w");
+  if (file == NULL)
+    return false;
+
+  fprintf (file, "%s\n", IMAGE_CACHE_HEADER);
+  for (size_t i = 0; i < images.n_entries; i++)
+    {
+      ImageEntry *entry = &images.entries[i];
+
+      if (entry->size < 0)
+        continue;
+
+      fprintf (file, "%s\t%lld\t%lld\t%lld\t%u\t%u\n", entry->path,
+               (long long) entry->mtime_sec, (long long) entry->mtime_nsec,
+               (long long) entry->size, entry->width, entry->height);
+    }
+
+  ok = fclose (file) == 0;
+
+  /* a concurrent run sees the old cache or the new one */
+  if (ok)
+    ok = rename (tmp, images.cache_file) == 0;
+  else
+    unlink (tmp);
+
+  return ok;
+}
+
+/*
+ * image_close
+ *
+ * writes the cache file if anything changed, and disables probing;
+ * returns false if the cache file couldn't be written
+ */
+bool
+image_close (void)
+{
+  bool ok = true;
+
+  if (!image_probing)
+    return true;
+
+  if (images.cache_file != NULL && images.dirty)
+    ok = cache_save ();
+
+  for (size_t i = 0; i < images.n_entries; i++)
+    free (images.entries[i].path);
+
+  free (images.entries);
+  hash_index_free (&images.index);
+  free (images.base_dir);
+  free (images.cache_file);
+
+  images.base_dir = images.cache_file = NULL;
+  images.dirty = false;
+  images.entries = NULL;
+  images.n_entries = images.entries_size = 0;
+  image_probing = false;
+
+  return ok;
+}
+
+/*
+ * resolve_path
+ *
+ * sets @path to the file @src names, percent-decoded like check.c's
+ * links; returns false for images that aren't local files, i.e. URLs
+ * with a scheme or a host, site-absolute ones and data: URIs
+ */
+static bool
+resolve_path (const char *src,
+              size_t      len,
+              char       *path,
+              size_t      path_size)
+{
+  size_t end = 0;
+  size_t n;
+
+  if (len == 0 || src[0] == '/')
+    return false;
+
+  /* the query and the fragment aren't part of the file name */
+  while (end < len && src[end] != '?' && src[end] != '#')
+    {
+      /* a scheme, e.g. https: or data: */
+      if (src[end] == ':' || src[end] == '\t' || src[end] == '\n' || src[end] == '\0')
+        return false;
+      end++;
+    }
+
+  if (end == 0)
+    return false;
+
+  if (strcmp (images.base_dir, ".") == 0)
+    n = 0;
+  else if ((n = snprintf (path, path_size, "%s/", images.base_dir)) >= path_size)
+    return false;
+
+  if (n + end >= path_size)
+    return false;
+
+  return url_decode (path + n, src, end) >= 0;
+}
+
+static void
+entry_probe (ImageEntry  *entry,
+             struct stat *st)
+{
+  Source src = { .buf = NULL, .len = 0 };
+
+  entry->mtime_sec = st->st_mtim.tv_sec;
+  entry->mtime_nsec = st->st_mtim.tv_nsec;
+  entry->size = st->st_size;
+  entry->width = entry->height = 0;
+
+  src.fd = open (entry->path, O_RDONLY);
+  if (src.fd < 0)
+    {
+      entry->size = -1;
+      return;
+    }
+
+  probe_source (&src, &entry->width, &entry->height);
+  close (src.fd);
+
+  images.dirty = true;
+}
+
+bool
+image_size_ (const char *src,
+             size_t      len,
+             unsigned   *width,
+             unsigned   *height)
+{
+  char path[PATH_MAX];
+  ImageEntry *entry;
+  bool ok;
+
+  if (!resolve_path (src, len, path, sizeof (path)))
+    return false;
+
+  pthread_mutex_lock (&images.lock);
+
+  entry = entry_find (path);
+  if (entry == NULL)
+    entry = entry_add (path);
+
+  /* once per run, however often the image is used */
+  if (!entry->checked)
+    {
+      struct stat st;
+
+      if (stat (path, &st) != 0 || !S_ISREG (st.st_mode))
+        {
+          entry->size = -1;
+          entry->width = entry->height = 0;
+        }
+      else if (entry->size != st.st_size ||
+               entry->mtime_sec != st.st_mtim.tv_sec ||
+               entry->mtime_nsec != st.st_mtim.tv_nsec)
+        {
+          entry_probe (entry, &st);
+        }
+
+      entry->checked = true;
+    }
+
+  *width = entry->width;
+  *height = entry->height;
+  ok = *width != 0 && *height != 0;
+
+  pthread_mutex_unlock (&images.lock);
+
+  return ok;
+}
@@ -0,0 +1,1102 @@
+/* index.c
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "index.h"
+#include "backend.h"
+#include "hash.h"
+#include "limit.h"
+#include "strbuf.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#define INITIAL_INDEX_SIZE 64
+
+/* longer runs of letters are hashes, base64 and the like */
+#define INDEX_MIN_TERM 2
+#define INDEX_MAX_TERM 64
+
+#define DEFAULT_TITLE  "Document"
+
+/*
+ * Anchors
+ */
+struct Anchors {
+  char    **ids;
+  size_t    n_ids;
+  size_t    ids_size;
+
+  HashIndex taken;    /* over ids */
+  StrBuf    buf;
+};
+
+Anchors *
+anchors_new (void)
+{
+  Anchors *anchors;
+
+  anchors = calloc (1, sizeof (Anchors));
+  strbuf_init (&anchors->buf, 64);
+
+  return anchors;
+}
+
+static bool
+id_matches (size_t      pos,
+            const void *key,
+            const void *user_data)
+{
+  const Anchors *anchors = user_data;
+
+  return strcmp (anchors->ids[pos], key) == 0;
+}
+
+static uint64_t
+id_hash (size_t      pos,
+         const void *user_data)
+{
+  const Anchors *anchors = user_data;
+
+  return hash_str (HASH_INIT, anchors->ids[pos]);
+}
+
+/*
+ * taken_lookup
+ *
+ * returns the slot of @id in anchors->taken, or the empty slot where
+ * it would be added
+ */
+static size_t *
+taken_lookup (Anchors    *anchors,
+              const char *id)
+{
+  return hash_index_lookup (&anchors->taken, hash_str (HASH_INIT, id),
+                            id_matches, id, anchors);
+}
+
+static inline bool
+is_word_char (unsigned char c)
+{
+  /* non-ASCII bytes are kept, so are whole UTF-8 sequences */
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+         (c >= '0' && c <= '9') || c >= 0x80;
+}
+
+static inline char
+to_lower (unsigned char c)
+{
+  return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+}
+
+/*
+ * @FoldRange
+ *
+ * upper case letters beyond ASCII and the distance to their lower case;
+ * with @alternating, only every other code point from @first is upper
+ * case.  Covers Latin-1, Latin Extended-A and B, Greek and Coptic,
+ * Cyrillic and Latin Extended Additional, sorted for a binary search;
+ * other scripts are kept as they are.  U+0130 (İ) folds to a plain i
+ */
+typedef struct {
+  uint32_t first;
+  uint32_t last;
+  int32_t  delta;
+  bool     alternating;
+} FoldRange;
+
+static const FoldRange fold_ranges[] = {
+  { 0x00c0, 0x00d6,    32, false },
+  { 0x00d8, 0x00de,    32, false },
+  { 0x0100, 0x012e,     1, true  },
+  { 0x0130, 0x0130,  -199, false },
+  { 0x0132, 0x0136,     1, true  },
+  { 0x0139, 0x0147,     1, true  },
+  { 0x014a, 0x0176,     1, true  },
+  { 0x0178, 0x0178,  -121, false },
+  { 0x0179, 0x017d,     1, true  },
+  { 0x0181, 0x0181,   210, false },
+  { 0x0182, 0x0184,     1, true  },
+  { 0x0186, 0x0186,   206, false },
+  { 0x0187, 0x0187,     1, false },
+  { 0x0189, 0x018a,   205, false },
+  { 0x018b, 0x018b,     1, false },
+  { 0x018e, 0x018e,    79, false },
+  { 0x018f, 0x018f,   202, false },
+  { 0x0190, 0x0190,   203, false },
+  { 0x0191, 0x0191,     1, false },
+  { 0x0193, 0x0193,   205, false },
+  { 0x0194, 0x0194,   207, false },
+  { 0x0196, 0x0196,   211, false },
+  { 0x0197, 0x0197,   209, false },
+  { 0x0198, 0x0198,     1, false },
+  { 0x019c, 0x019c,   211, false },
+  { 0x019d, 0x019d,   213, false },
+  { 0x019f, 0x019f,   214, false },
+  { 0x01a0, 0x01a4,     1, true  },
+  { 0x01a6, 0x01a6,   218, false },
+  { 0x01a7, 0x01a7,     1, false },
+  { 0x01a9, 0x01a9,   218, false },
+  { 0x01ac, 0x01ac,     1, false },
+  { 0x01ae, 0x01ae,   218, false },
+  { 0x01af, 0x01af,     1, false },
+  { 0x01b1, 0x01b2,   217, false },
+  { 0x01b3, 0x01b5,     1, true  },
+  { 0x01b7, 0x01b7,   219, false },
+  { 0x01b8, 0x01b8,     1, false },
+  { 0x01bc, 0x01bc,     1, false },
+  { 0x01c4, 0x01c4,     2, false },
+  { 0x01c5, 0x01c5,     1, false },
+  { 0x01c7, 0x01c7,     2, false },
+  { 0x01c8, 0x01c8,     1, false },
+  { 0x01ca, 0x01ca,     2, false },
+  { 0x01cb, 0x01db,     1, true  },
+  { 0x01de, 0x01ee,     1, true  },
+  { 0x01f1, 0x01f1,     2, false },
+  { 0x01f2, 0x01f4,     1, true  },
+  { 0x01f6, 0x01f6,   -97, false },
+  { 0x01f7, 0x01f7,   -56, false },
+  { 0x01f8, 0x021e,     1, true  },
+  { 0x0220, 0x0220,  -130, false },
+  { 0x0222, 0x0232,     1, true  },
+  { 0x023a, 0x023a, 10795, false },
+  { 0x023b, 0x023b,     1, false },
+  { 0x023d, 0x023d,  -163, false },
+  { 0x023e, 0x023e, 10792, false },
+  { 0x0241, 0x0241,     1, false },
+  { 0x0243, 0x0243,  -195, false },
+  { 0x0244, 0x0244,    69, false },
+  { 0x0245, 0x0245,    71, false },
+  { 0x0246, 0x024e,     1, true  },
+  { 0x0370, 0x0372,     1, true  },
+  { 0x0376, 0x0376,     1, false },
+  { 0x037f, 0x037f,   116, false },
+  { 0x0386, 0x0386,    38, false },
+  { 0x0388, 0x038a,    37, false },
+  { 0x038c, 0x038c,    64, false },
+  { 0x038e, 0x038f,    63, false },
+  { 0x0391, 0x03a1,    32, false },
+  { 0x03a3, 0x03ab,    32, false },
+  { 0x03cf, 0x03cf,     8, false },
+  { 0x03d8, 0x03ee,     1, true  },
+  { 0x03f4, 0x03f4,   -60, false },
+  { 0x03f7, 0x03f7,     1, false },
+  { 0x03f9, 0x03f9,    -7, false },
+  { 0x03fa, 0x03fa,     1, false },
+  { 0x03fd, 0x03ff,  -130, false },
+  { 0x0400, 0x040f,    80, false },
+  { 0x0410, 0x042f,    32, false },
+  { 0x0460, 0x0480,     1, true  },
+  { 0x048a, 0x04be,     1, true  },
+  { 0x04c0, 0x04c0,    15, false },
+  { 0x04c1, 0x04cd,     1, true  },
+  { 0x04d0, 0x052e,     1, true  },
+  { 0x1e00, 0x1e94,     1, true  },
+  { 0x1e9e, 0x1e9e, -7615, false },
+  { 0x1ea0, 0x1efe,     1, true  },
+};
+
+static uint32_t
+fold_code_point (uint32_t c)
+{
+  size_t low = 0;
+  size_t high = sizeof (fold_ranges) / sizeof (fold_ranges[0]);
+
+  while (low < high)
+    {
+      size_t mid = low + (high - low) / 2;
+      const FoldRange *range = &fold_ranges[mid];
+
+      if (c < range->first)
+        {
+          high = mid;
+        }
+      else if (c > range->last)
+        {
+          low = mid + 1;
+        }
+      else
+        {
+          if (range->alternating && (c - range->first) % 2 != 0)
+            break;
+          return c + range->delta;
+        }
+    }
+
+  return c;
+}
+
+/*
+ * append_folded
+ * @buf
+ * @str: at a word character
+ * @len: bytes left at @str
+ *
+ * appends the lower case of the character at @str and returns the bytes
+ * it took; ASCII and two- and three-byte UTF-8 sequences are folded,
+ * anything else is copied a byte at a time
+ */
+static size_t
+append_folded (StrBuf     *buf,
+               const char *str,
+               size_t      len)
+{
+  const unsigned char *s = (const unsigned char *) str;
+  uint32_t c, lower;
+  size_t n;
+
+  if (s[0] < 0x80)
+    {
+      strbuf_append_c (buf, to_lower (s[0]));
+      return 1;
+    }
+
+  if ((s[0] & 0xe0) == 0xc0 && len >= 2 && (s[1] & 0xc0) == 0x80)
+    {
+      c = (s[0] & 0x1f) << 6 | (s[1] & 0x3f);
+      n = 2;
+    }
+  else if ((s[0] & 0xf0) == 0xe0 && len >= 3 &&
+           (s[1] & 0xc0) == 0x80 && (s[2] & 0xc0) == 0x80)
+    {
+      c = (s[0] & 0x0f) << 12 | (s[1] & 0x3f) << 6 | (s[2] & 0x3f);
+      n = 3;
+    }
+  else
+    {
+      strbuf_append_c (buf, s[0]);
+      return 1;
+    }
+
+  /* unchanged sequences, overlong ones included, are copied as they are */
+  lower = fold_code_point (c);
+  if (lower == c)
+    {
+      strbuf_append_len (buf, str, n);
+    }
+  else if (lower < 0x80)
+    {
+      strbuf_append_c (buf, lower);
+    }
+  else if (lower < 0x800)
+    {
+      strbuf_append_c (buf, 0xc0 | lower >> 6);
+      strbuf_append_c (buf, 0x80 | (lower & 0x3f));
+    }
+  else
+    {
+      strbuf_append_c (buf, 0xe0 | lower >> 12);
+      strbuf_append_c (buf, 0x80 | ((lower >> 6) & 0x3f));
+      strbuf_append_c (buf, 0x80 | (lower & 0x3f));
+    }
+
+  return n;
+}
+
+/*
+ * anchors_next
+ * @anchors
+ * @heading: raw heading content
+ * @len
+ *
+ * returns an id for @heading: its words lower-cased (see append_folded
+ * ()) and joined by '-',
+ * with a "-N" suffix if an earlier heading has it already. Stays valid
+ * until anchors_free ().
+ */
+const char *
+anchors_next (Anchors    *anchors,
+              const char *heading,
+              size_t      len)
+{
+  StrBuf *buf = &anchors->buf;
+  size_t base_len;
+  char *id;
+
+  buf->len = 0;
+  buf->str[0] = '\0';
+
+  for (size_t i = 0; i < len;)
+    {
+      if (!is_word_char (heading[i]))
+        {
+          i++;
+          continue;
+        }
+
+      if (buf->len > 0 && !is_word_char (heading[i - 1]))
+        strbuf_append_c (buf, '-');
+
+      i += append_folded (buf, heading + i, len - i);
+    }
+
+  if (buf->len == 0)
+    strbuf_append (buf, "section");
+
+  base_len = buf->len;
+  for (size_t n = 2; anchors->taken.size != 0 && *taken_lookup (anchors, buf->str) != 0; n++)
+    {
+      char suffix[32];
+
+      buf->len = base_len;
+      snprintf (suffix, sizeof (suffix), "-%zu", n);
+      strbuf_append (buf, suffix);
+    }
+
+  if (anchors->n_ids == anchors->ids_size)
+    {
+      anchors->ids_size = anchors->ids_size ? anchors->ids_size << 1 : 16;
+      anchors->ids = realloc (anchors->ids, sizeof (char *) * anchors->ids_size);
+    }
+
+  hash_index_reserve (&anchors->taken, anchors->n_ids, INITIAL_INDEX_SIZE, id_hash, anchors);
+
+  id = strdup (buf->str);
+  anchors->ids[anchors->n_ids++] = id;
+  *taken_lookup (anchors, id) = anchors->n_ids;
+
+  return id;
+}
+
+void
+anchors_free (Anchors *anchors)
+{
+  for (size_t i = 0; i < anchors->n_ids; i++)
+    free (anchors->ids[i]);
+
+  free (anchors->ids);
+  hash_index_free (&anchors->taken);
+  strbuf_free (&anchors->buf);
+  free (anchors);
+}
+
+/*
+ * index backend
+ */
+typedef struct {
+  char   *term;
+  size_t *sections;    /* ascending, no duplicates */
+  size_t  n_sections;
+  size_t  sections_size;
+} Term;
+
+typedef struct {
+  const char *anchor;  /* "" for the top of the doc */
+  char       *heading;
+} Section;
+
+typedef struct {
+  Output   *out;
+  char     *href;
+  char     *title;
+  LimitState *limits;  /* of the doc; not owned */
+
+  Anchors  *anchors;   /* same ids as the HTML doc gets */
+  Section  *sections;
+  size_t    n_sections;
+  size_t    sections_size;
+
+  Term     *terms;
+  size_t    n_terms;
+  size_t    terms_size;
+  HashIndex term_index;    /* over terms */
+
+  bool      first_block;
+  bool      indexing;  /* inside a block whose text is indexed */
+  bool      in_heading;
+  StrBuf    heading;
+  StrBuf    word;
+  bool      word_too_long;
+} IndexBackend;
+
+static void *
+index_new (Output *out,
+           Params *params,
+           MD     *md)
+{
+  IndexBackend *backend;
+
+  backend = calloc (1, sizeof (IndexBackend));
+  backend->out = out;
+  backend->limits = &md->limits;
+  /* postings point at the HTML doc */
+  backend->href = strdup (params->o_file ? params->o_file : "index.html");
+  backend->title = params->title ? strdup (params->title) : NULL;
+  backend->anchors = anchors_new ();
+  backend->first_block = true;
+  strbuf_init (&backend->heading, 64);
+  strbuf_init (&backend->word, INDEX_MAX_TERM + 1);
+
+  return backend;
+}
+
+static void
+add_section (IndexBackend *backend,
+             const char   *anchor)
+{
+  if (backend->n_sections == backend->sections_size)
+    {
+      backend->sections_size = backend->sections_size ? backend->sections_size << 1 : 16;
+      backend->sections = realloc (backend->sections,
+                                   sizeof (Section) * backend->sections_size);
+    }
+
+  backend->sections[backend->n_sections].anchor = anchor;
+  backend->sections[backend->n_sections].heading = NULL;
+  backend->n_sections++;
+}
+
+static bool
+term_matches (size_t      pos,
+              const void *key,
+              const void *user_data)
+{
+  const IndexBackend *backend = user_data;
+
+  return strcmp (backend->terms[pos].term, key) == 0;
+}
+
+static uint64_t
+term_hash (size_t      pos,
+           const void *user_data)
+{
+  const IndexBackend *backend = user_data;
+
+  return hash_str (HASH_INIT, backend->terms[pos].term);
+}
+
+/*
+ * term_lookup
+ *
+ * returns the slot of @word in backend->term_index, or the empty slot
+ * where it would be added
+ */
+static size_t *
+term_lookup (IndexBackend *backend,
+             const char   *word)
+{
+  return hash_index_lookup (&backend->term_index, hash_str (HASH_INIT, word),
+                            term_matches, word, backend);
+}
+
+static void
+add_term (IndexBackend *backend,
+          const char   *word)
+{
+  size_t *slot;
+  Term *term;
+  size_t section;
+
+  /* text before the first heading */
+  if (backend->n_sections == 0)
+    add_section (backend, "");
+
+  section = backend->n_sections - 1;
+
+  hash_index_reserve (&backend->term_index, backend->n_terms, INITIAL_INDEX_SIZE, term_hash, backend);
+
+  slot = term_lookup (backend, word);
+  if (*slot == 0)
+    {
+      if (backend->n_terms == backend->terms_size)
+        {
+          backend->terms_size = backend->terms_size ? backend->terms_size << 1 : 256;
+          backend->terms = realloc (backend->terms, sizeof (Term) * backend->terms_size);
+        }
+
+      term = &backend->terms[backend->n_terms];
+      memset (term, 0, sizeof (Term));
+      term->term = strdup (word);
+      *slot = ++backend->n_terms;
+    }
+  else
+    {
+      term = &backend->terms[*slot - 1];
+    }
+
+  if (term->n_sections > 0 && term->sections[term->n_sections - 1] == section)
+    return;
+
+  if (term->n_sections == term->sections_size)
+    {
+      term->sections_size = term->sections_size ? term->sections_size << 1 : 4;
+      term->sections = realloc (term->sections, sizeof (size_t) * term->sections_size);
+    }
+
+  term->sections[term->n_sections++] = section;
+}
+
+static void
+flush_word (IndexBackend *backend)
+{
+  if (!backend->word_too_long && backend->word.len >= INDEX_MIN_TERM)
+    add_term (backend, backend->word.str);
+
+  backend->word.len = 0;
+  backend->word.str[0] = '\0';
+  backend->word_too_long = false;
+}
+
+static void
+index_enter_block (const MDBlock *block,
+                   void          *user_data)
+{
+  IndexBackend *backend = user_data;
+
+  flush_word (backend);
+
+  /* same rule as the HTML doc's <title> */
+  if (backend->first_block && backend->title == NULL &&
+      block->type == BLOCK_TYPE_H1 && block->unit->content != NULL)
+    backend->title = strndup (block->unit->content, block->unit->content_len);
+  backend->first_block = false;
+
+  switch (block->type)
+    {
+      case BLOCK_TYPE_H1:
+      case BLOCK_TYPE_H2:
+      case BLOCK_TYPE_H3:
+        add_section (backend, anchors_next (backend->anchors,
+                                            block->unit->content ? block->unit->content : "",
+                                            block->unit->content_len));
+        backend->in_heading = true;
+        backend->indexing = true;
+        backend->heading.len = 0;
+        backend->heading.str[0] = '\0';
+        break;
+      case BLOCK_TYPE_PARAGRAPH:
+      case BLOCK_TYPE_LIST_ITEM:
+      case BLOCK_TYPE_QUOTE:
+        backend->indexing = true;
+        break;
+      default:
+        /* code and footnotes aren't searched */
+        backend->indexing = false;
+        break;
+    }
+}
+
+static void
+index_leave_block (const MDBlock *block,
+                   void          *user_data)
+{
+  IndexBackend *backend = user_data;
+
+  (void) block;
+
+  flush_word (backend);
+
+  if (backend->in_heading)
+    {
+      backend->sections[backend->n_sections - 1].heading = strdup (backend->heading.str);
+      backend->in_heading = false;
+    }
+
+  backend->indexing = false;
+}
+
+static void
+index_text (const char *text,
+            size_t      len,
+            void       *user_data)
+{
+  IndexBackend *backend = user_data;
+
+  if (!backend->indexing)
+    return;
+
+  if (backend->in_heading)
+    strbuf_append_len (&backend->heading, text, len);
+
+  for (size_t i = 0; i < len;)
+    {
+      if (!is_word_char (text[i]))
+        {
+          flush_word (backend);
+          i++;
+        }
+      else if (backend->word.len >= INDEX_MAX_TERM)
+        {
+          backend->word_too_long = true;
+          i++;
+        }
+      else
+        {
+          i += append_folded (&backend->word, text + i, len - i);
+          if (backend->word.len > INDEX_MAX_TERM)
+            backend->word_too_long = true;
+        }
+    }
+}
+
+/* fields can't hold the separators */
+static void
+write_field (Output     *out,
+             const char *str)
+{
+  const char *start = str;
+
+  for (; *str; str++)
+    {
+      if (*str == '\t' || *str == '\n' || *str == '\r')
+        {
+          output_write (out, start, str - start);
+          output_write (out, " ", 1);
+          start = str + 1;
+        }
+    }
+
+  output_write (out, start, str - start);
+}
+
+static int
+compare_terms (const void *a,
+               const void *b)
+{
+  return strcmp ((*(const Term **) a)->term, (*(const Term **) b)->term);
+}
+
+static void
+index_write (IndexBackend *backend)
+{
+  Output *out = backend->out;
+  Term **sorted;
+
+  output_printf (out, "md2html-index %d docs 1 sections %zu\n",
+                 INDEX_VERSION, backend->n_sections);
+
+  output_write (out, "d\t", 2);
+  write_field (out, backend->href);
+  output_write (out, "\t", 1);
+  write_field (out, backend->title ? backend->title : DEFAULT_TITLE);
+  output_write (out, "\n", 1);
+
+  for (size_t i = 0; i < backend->n_sections; i++)
+    {
+      Section *section = &backend->sections[i];
+
+      output_write (out, "s\t0\t", 4);
+      write_field (out, section->anchor);
+      output_write (out, "\t", 1);
+      write_field (out, section->heading ? section->heading : "");
+      output_write (out, "\n", 1);
+    }
+
+  sorted = malloc (sizeof (Term *) * (backend->n_terms ? backend->n_terms : 1));
+  for (size_t i = 0; i < backend->n_terms; i++)
+    sorted[i] = &backend->terms[i];
+
+  qsort (sorted, backend->n_terms, sizeof (Term *), compare_terms);
+
+  for (size_t i = 0; i < backend->n_terms; i++)
+    {
+      Term *term = sorted[i];
+
+      output_printf (out, "t\t%s\t", term->term);
+      for (size_t j = 0; j < term->n_sections; j++)
+        output_printf (out, j ? " %zu" : "%zu", term->sections[j]);
+      output_write (out, "\n", 1);
+    }
+
+  free (sorted);
+}
+
+static void
+index_finish (void *state)
+{
+  IndexBackend *backend = state;
+
+  flush_word (backend);
+
+  if (backend->limits->exceeded == LIMIT_NONE)
+    index_write (backend);
+
+  for (size_t i = 0; i < backend->n_sections; i++)
+    free (backend->sections[i].heading);
+
+  for (size_t i = 0; i < backend->n_terms; i++)
+    {
+      free (backend->terms[i].term);
+      free (backend->terms[i].sections);
+    }
+
+  free (backend->sections);
+  free (backend->terms);
+  hash_index_free (&backend->term_index);
+  anchors_free (backend->anchors);
+  strbuf_free (&backend->heading);
+  strbuf_free (&backend->word);
+  free (backend->href);
+  free (backend->title);
+  free (backend);
+}
+
+const Backend backend_index = {
+  .name = "index",
+  .events = {
+    .enter_block = index_enter_block,
+    .leave_block = index_leave_block,
+    .text = index_text,
+  },
+  .new = index_new,
+  .finish = index_finish,
+};
+
+/*
+ * index_merge
+ */
+typedef struct {
+  FILE    *file;
+  char    *line;
+  size_t   line_size;
+  char    *term;       /* current record, split in place */
+  char    *ids;
+  StrBuf   prev;       /* terms have to ascend */
+
+  size_t   n_docs;
+  size_t   n_sections;
+  size_t   section_offset;
+} MergeInput;
+
+/* reads the next record, without its newline */
+static bool
+merge_read (MergeInput *input)
+{
+  ssize_t len;
+
+  len = getline (&input->line, &input->line_size, input->file);
+  if (len <= 0)
+    return false;
+
+  if (input->line[len - 1] == '\n')
+    input->line[len - 1] = '\0';
+
+  return true;
+}
+
+/*
+ * merge_split_term
+ *
+ * splits a term record; false if it isn't one, or if it doesn't come
+ * after the previous term
+ */
+static bool
+merge_split_term (MergeInput *input)
+{
+  char *tab;
+
+  if (strncmp (input->line, "t\t", 2) != 0)
+    return false;
+
+  input->term = input->line + 2;
+  tab = strchr (input->term, '\t');
+  if (tab == NULL)
+    return false;
+
+  *tab = '\0';
+  input->ids = tab + 1;
+
+  if (input->prev.len > 0 && strcmp (input->prev.str, input->term) >= 0)
+    return false;
+
+  input->prev.len = 0;
+  strbuf_append (&input->prev, input->term);
+
+  return true;
+}
+
+static bool
+merge_write_ids (Output     *out,
+                 MergeInput *input,
+                 bool        first)
+{
+  char *ptr = input->ids;
+
+  while (*ptr)
+    {
+      char *end;
+      unsigned long long id;
+
+      id = strtoull (ptr, &end, 10);
+      if (end == ptr || id >= input->n_sections || (*end != ' ' && *end != '\0'))
+        return false;
+
+      output_printf (out, first ? "%llu" : " %llu", id + input->section_offset);
+      first = false;
+
+      ptr = *end ? end + 1 : end;
+    }
+
+  return true;
+}
+
+/* heap order: term, then input order so that ids keep ascending */
+static bool
+merge_before (MergeInput **heap,
+              size_t       a,
+              size_t       b)
+{
+  int cmp = strcmp (heap[a]->term, heap[b]->term);
+
+  return cmp < 0 || (cmp == 0 && heap[a] < heap[b]);
+}
+
+static void
+heap_swap (MergeInput **heap,
+           size_t       a,
+           size_t       b)
+{
+  MergeInput *tmp = heap[a];
+
+  heap[a] = heap[b];
+  heap[b] = tmp;
+}
+
+static void
+heap_push (MergeInput **heap,
+           size_t      *n,
+           MergeInput  *input)
+{
+  size_t i = (*n)++;
+
+  heap[i] = input;
+  while (i > 0 && merge_before (heap, i, (i - 1) / 2))
+    {
+      heap_swap (heap, i, (i - 1) / 2);
+      i = (i - 1) / 2;
+    }
+}
+
+static MergeInput *
+heap_pop (MergeInput **heap,
+          size_t      *n)
+{
+  MergeInput *top = heap[0];
+  size_t i = 0;
+
+  heap[0] = heap[--(*n)];
+
+  for (;;)
+    {
+      size_t child = 2 * i + 1;
+
+      if (child >= *n)
+        break;
+      if (child + 1 < *n && merge_before (heap, child + 1, child))
+        child++;
+      if (!merge_before (heap, child, i))
+        break;
+
+      heap_swap (heap, i, child);
+      i = child;
+    }
+
+  return top;
+}
+
+/* the header lines, and the totals for the merged one */
+static bool
+merge_headers (Output     *out,
+               MergeInput *merge,
+               size_t      n_inputs,
+               size_t     *bad_input)
+{
+  size_t n_docs = 0, n_sections = 0;
+
+  for (size_t i = 0; i < n_inputs; i++)
+    {
+      MergeInput *input = &merge[i];
+      int version, end = 0;
+
+      *bad_input = i;
+      if (!merge_read (input) ||
+          sscanf (input->line, "md2html-index %d docs %zu sections %zu%n",
+                  &version, &input->n_docs, &input->n_sections, &end) != 3 ||
+          input->line[end] != '\0' || version != INDEX_VERSION)
+        return false;
+
+      n_docs += input->n_docs;
+      n_sections += input->n_sections;
+    }
+
+  output_printf (out, "md2html-index %d docs %zu sections %zu\n",
+                 INDEX_VERSION, n_docs, n_sections);
+
+  return true;
+}
+
+/* docs and sections, renumbered; leaves each input at its first term */
+static bool
+merge_sections (Output      *out,
+                MergeInput  *merge,
+                size_t       n_inputs,
+                MergeInput **heap,
+                size_t      *n_heap,
+                size_t      *bad_input)
+{
+  size_t n_docs = 0, n_sections = 0;
+
+  for (size_t i = 0; i < n_inputs; i++)
+    {
+      MergeInput *input = &merge[i];
+      size_t docs = 0, sections = 0;
+      bool more;
+
+      *bad_input = i;
+      input->section_offset = n_sections;
+
+      while ((more = merge_read (input)))
+        {
+          if (strncmp (input->line, "d\t", 2) == 0)
+            {
+              output_write (out, input->line, strlen (input->line));
+              output_write (out, "\n", 1);
+              docs++;
+            }
+          else if (strncmp (input->line, "s\t", 2) == 0)
+            {
+              char *end;
+              unsigned long long doc;
+
+              doc = strtoull (input->line + 2, &end, 10);
+              if (end == input->line + 2 || *end != '\t' || doc >= input->n_docs)
+                return false;
+
+              output_printf (out, "s\t%llu%s\n", doc + n_docs, end);
+              sections++;
+            }
+          else
+            {
+              break;
+            }
+        }
+
+      if (docs != input->n_docs || sections != input->n_sections)
+        return false;
+
+      if (more)
+        {
+          if (!merge_split_term (input))
+            return false;
+          heap_push (heap, n_heap, input);
+        }
+
+      n_docs += docs;
+      n_sections += sections;
+    }
+
+  return true;
+}
+
+static bool
+merge_terms (Output      *out,
+             MergeInput  *merge,
+             MergeInput **heap,
+             size_t       n_heap,
+             size_t      *bad_input)
+{
+  StrBuf term;
+  bool ok = true;
+
+  strbuf_init (&term, 64);
+
+  while (ok && n_heap > 0)
+    {
+      MergeInput *input = heap_pop (heap, &n_heap);
+      bool first = true;
+
+      term.len = 0;
+      strbuf_append (&term, input->term);
+      output_printf (out, "t\t%s\t", term.str);
+
+      /* the same term from every input that has it, in input order */
+      for (;;)
+        {
+          *bad_input = input - merge;
+          ok = merge_write_ids (out, input, first);
+          first = false;
+
+          if (ok && merge_read (input))
+            {
+              ok = merge_split_term (input);
+              if (ok)
+                heap_push (heap, &n_heap, input);
+            }
+
+          if (!ok || n_heap == 0 || strcmp (heap[0]->term, term.str) != 0)
+            break;
+
+          input = heap_pop (heap, &n_heap);
+        }
+
+      output_write (out, "\n", 1);
+    }
+
+  strbuf_free (&term);
+
+  return ok;
+}
+
+/*
+ * index_merge
+ * @out
+ * @inputs: indexes, see @Index
+ * @n_inputs
+ * @bad_input: set to the input at fault when false is returned
+ *
+ * writes one index holding the docs of all @inputs, in order; terms
+ * are merged in a single pass, so memory doesn't grow with the index
+ */
+bool
+index_merge (Output  *out,
+             FILE   **inputs,
+             size_t   n_inputs,
+             size_t  *bad_input)
+{
+  MergeInput *merge;
+  MergeInput **heap;
+  size_t n_heap = 0;
+  bool ok;
+
+  merge = calloc (n_inputs ? n_inputs : 1, sizeof (MergeInput));
+  heap = malloc (sizeof (MergeInput *) * (n_inputs ? n_inputs : 1));
+
+  for (size_t i = 0; i < n_inputs; i++)
+    {
+      merge[i].file = inputs[i];
+      strbuf_init (&merge[i].prev, 64);
+    }
+
+  ok = merge_headers (out, merge, n_inputs, bad_input) &&
+       merge_sections (out, merge, n_inputs, heap, &n_heap, bad_input) &&
+       merge_terms (out, merge, heap, n_heap, bad_input);
+
+  for (size_t i = 0; i < n_inputs; i++)
+    {
+      free (merge[i].line);
+      strbuf_free (&merge[i].prev);
+    }
+
+  free (merge);
+  free (heap);
+
+  return ok;
+}
@@ -0,0 +1,390 @@
+/* input.c
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#define _GNU_SOURCE
+
+#include "input.h"
+#include "stats.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+/* compressed bytes read at a time; also the stdio buffer of the stream */
+#define INPUT_BUFFER_SIZE (64 * 1024)
+
+/*
+ * zstd's default: frames that need a bigger window (zstd --long=31) are
+ * refused instead of taking up to 2 GiB
+ */
+#define INPUT_ZSTD_WINDOW_LOG_MAX 27
+
+typedef enum {
+  CODEC_NONE,
+  CODEC_GZIP,
+  CODEC_ZSTD,
+} Codec;
+
+/*
+ * @Stream
+ *
+ * cookie of the FILE handed to the parser; decodes one buffer of input
+ * at a time, so memory use doesn't grow with the document
+ */
+typedef struct {
+  FILE          *file;
+  Codec          codec;
+
+  unsigned char  in[INPUT_BUFFER_SIZE];
+  size_t         in_pos;
+  size_t         in_len;
+
+  /* between gzip members or zstd frames, where the input may end */
+  bool           at_end;
+
+#ifdef HAVE_ZLIB
+  z_stream       gz;
+#endif
+#ifdef HAVE_ZSTD
+  ZSTD_DCtx     *zstd;
+#endif
+} Stream;
+
+/* why the last failed read of this thread failed */
+static _Thread_local const char *read_error;
+
+static Codec
+detect_codec (const unsigned char *buf,
+              size_t               len)
+{
+  if (len >= 2 && buf[0] == 0x1f && buf[1] == 0x8b)
+    return CODEC_GZIP;
+
+  if (len >= 4 && buf[0] == 0x28 && buf[1] == 0xb5 && buf[2] == 0x2f && buf[3] == 0xfd)
+    return CODEC_ZSTD;
+
+  return CODEC_NONE;
+}
+
+static const char *
+decode_none (Stream *stream,
+             char   *buf,
+             size_t  size,
+             size_t *n)
+{
+  *n = stream->in_len - stream->in_pos < size ? stream->in_len - stream->in_pos
+                                              : size;
+  memcpy (buf, stream->in + stream->in_pos, *n);
+  stream->in_pos += *n;
+
+  return NULL;
+}
+
+#ifdef HAVE_ZLIB
+static const char *
+decode_gzip (Stream *stream,
+             char   *buf,
+             size_t  size,
+             size_t *n)
+{
+  z_stream *gz = &stream->gz;
+  int ret;
+
+  /* another member follows */
+  if (stream->at_end)
+    {
+      inflateReset (gz);
+      stream->at_end = false;
+    }
+
+  gz->next_in = stream->in + stream->in_pos;
+  gz->avail_in = stream->in_len - stream->in_pos;
+  gz->next_out = (unsigned char *) buf;
+  gz->avail_out = size < UINT_MAX ? size : UINT_MAX;
+
+  ret = inflate (gz, Z_NO_FLUSH);
+
+  *n = (unsigned char *) gz->next_out - (unsigned char *) buf;
+  stream->in_pos = stream->in_len - gz->avail_in;
+
+  if (ret == Z_STREAM_END)
+    stream->at_end = true;
+  else if (ret != Z_OK && ret != Z_BUF_ERROR)
+    return gz->msg != NULL ? gz->msg : "invalid gzip data";
+
+  return NULL;
+}
+#endif
+
+#ifdef HAVE_ZSTD
+static const char *
+decode_zstd (Stream *stream,
+             char   *buf,
+             size_t  size,
+             size_t *n)
+{
+  ZSTD_inBuffer in = { stream->in, stream->in_len, stream->in_pos };
+  ZSTD_outBuffer out = { buf, size, 0 };
+  size_t ret;
+
+  ret = ZSTD_decompressStream (stream->zstd, &out, &in);
+
+  *n = out.pos;
+  stream->in_pos = in.pos;
+
+  if (ZSTD_isError (ret))
+    return ZSTD_getErrorName (ret);
+
+  /* 0 once a frame is decoded and flushed */
+  stream->at_end = ret == 0;
+
+  return NULL;
+}
+#endif
+
+static const char *
+stream_decode (Stream *stream,
+               char   *buf,
+               size_t  size,
+               size_t *n)
+{
+  switch (stream->codec)
+    {
+#ifdef HAVE_ZLIB
+      case CODEC_GZIP:
+        return decode_gzip (stream, buf, size, n);
+#endif
+#ifdef HAVE_ZSTD
+      case CODEC_ZSTD:
+        return decode_zstd (stream, buf, size, n);
+#endif
+      default:
+        return decode_none (stream, buf, size, n);
+    }
+}
+
+static const char *
+stream_fill (Stream *stream)
+{
+  stream->in_pos = 0;
+  stream->in_len = fread (stream->in, 1, sizeof (stream->in), stream->file);
+
+  if (stream->in_len == 0 && ferror (stream->file))
+    return strerror (errno);
+
+  if (stream->codec != CODEC_NONE)
+    stats_add (STATS_COUNTER_COMPRESSED_IN, stream->in_len);
+
+  return NULL;
+}
+
+static ssize_t
+stream_read (void   *cookie,
+             char   *buf,
+             size_t  size)
+{
+  Stream *stream = cookie;
+  const char *error = NULL;
+  StatsTimer timer;
+  size_t n = 0;
+
+  stats_timer_start (&timer);
+
+  while (n == 0 && error == NULL)
+    {
+      if (stream->in_pos == stream->in_len)
+        {
+          error = stream_fill (stream);
+          if (error != NULL)
+            break;
+
+          if (stream->in_len == 0)
+            {
+              if (!stream->at_end)
+                error = "unexpected end of compressed data";
+              break;
+            }
+        }
+
+      error = stream_decode (stream, buf, size, &n);
+    }
+
+  if (stream->codec != CODEC_NONE)
+    {
+      stats_add (STATS_COUNTER_DECOMPRESSED, n);
+      stats_timer_stop (&timer, STATS_STAGE_DECOMPRESS);
+    }
+
+  if (error != NULL)
+    {
+      read_error = error;
+      errno = EIO;
+      return -1;
+    }
+
+  return n;
+}
+
+static int
+stream_close (void *cookie)
+{
+  Stream *stream = cookie;
+  int ret;
+
+#ifdef HAVE_ZLIB
+  if (stream->codec == CODEC_GZIP)
+    inflateEnd (&stream->gz);
+#endif
+#ifdef HAVE_ZSTD
+  if (stream->codec == CODEC_ZSTD)
+    ZSTD_freeDCtx (stream->zstd);
+#endif
+
+  ret = fclose (stream->file);
+  free (stream);
+
+  return ret;
+}
+
+/* returns an error if the codec isn't built in */
+static const char *
+stream_init (Stream *stream)
+{
+  switch (stream->codec)
+    {
+      case CODEC_GZIP:
+#ifdef HAVE_ZLIB
+        /* 16: gzip header and trailer, no zlib or raw deflate */
+        if (inflateInit2 (&stream->gz, 15 + 16) != Z_OK)
+          return "cannot start gzip decoder";
+        return NULL;
+#else
+        return "gzip input, but built without zlib";
+#endif
+      case CODEC_ZSTD:
+#ifdef HAVE_ZSTD
+        stream->zstd = ZSTD_createDCtx ();
+        if (stream->zstd == NULL ||
+            ZSTD_isError (ZSTD_DCtx_setParameter (stream->zstd, ZSTD_d_windowLogMax,
+                                                  INPUT_ZSTD_WINDOW_LOG_MAX)))
+          {
+            ZSTD_freeDCtx (stream->zstd);
+            return "cannot start zstd decoder";
+          }
+        return NULL;
+#else
+        return "zstd input, but built without zstd";
+#endif
+      default:
+        /* plain input never ends early */
+        stream->at_end = true;
+        return NULL;
+    }
+}
+
+/*
+ * input_open
+ * @path: markdown file, possibly gzip or zstd compressed
+ * @error: set when NULL is returned
+ *
+ * opens @path for parse_md (); compressed files are decompressed as
+ * they are read.  Plain files that can seek are returned as they are,
+ * so they can still be mapped
+ */
+MDFile *
+input_open (const char  *path,
+            const char **error)
+{
+  cookie_io_functions_t io = {
+    .read = stream_read,
+    .close = stream_close,
+  };
+  Stream *stream;
+  MDFile *file;
+
+  file = fopen (path, "r");
+  if (file == NULL)
+    {
+      *error = strerror (errno);
+      return NULL;
+    }
+
+  /* the magic bytes stay in the buffer and are decoded from there */
+  stream = calloc (1, sizeof (Stream));
+  stream->file = file;
+  stream->in_len = fread (stream->in, 1, 4, file);
+  stream->codec = detect_codec (stream->in, stream->in_len);
+
+  if (stream->codec == CODEC_NONE && fseek (file, 0, SEEK_SET) == 0)
+    {
+      free (stream);
+      return file;
+    }
+
+  if (stream->codec != CODEC_NONE)
+    stats_add (STATS_COUNTER_COMPRESSED_IN, stream->in_len);
+
+  *error = stream_init (stream);
+  if (*error != NULL)
+    {
+      free (stream);
+      fclose (file);
+      return NULL;
+    }
+
+  file = fopencookie (stream, "r", io);
+  if (file == NULL)
+    {
+      *error = strerror (errno);
+      stream_close (stream);
+      return NULL;
+    }
+
+  setvbuf (file, NULL, _IOFBF, INPUT_BUFFER_SIZE);
+
+  return file;
+}
+
+/*
+ * input_error
+ * @file: opened with input_open ()
+ *
+ * returns why reading @file failed, or NULL if it didn't; corrupt and
+ * truncated compressed input fails, rather than reading as a shorter doc
+ */
+const char *
+input_error (MDFile *file)
+{
+  if (!ferror (file))
+    return NULL;
+
+  return read_error != NULL ? read_error : "read error";
+}
@@ -0,0 +1,171 @@
+/* limit.c
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+
+#include "limit.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+bool limit_timed = false;
+
+/* 0 means unlimited; read-only once converting starts */
+static uint64_t limits[N_LIMITS];
+
+/*
+ * Keep order in-sync with limit.h
+ */
+static const char *limit_names[N_LIMITS] = {
+  [LIMIT_NONE]         = "none",
+  [LIMIT_INPUT_BYTES]  = "input",
+  [LIMIT_LINE_LENGTH]  = "line",
+  [LIMIT_UNITS]        = "units",
+  [LIMIT_FOOTNOTES]    = "footnotes",
+  [LIMIT_REFERRERS]    = "referrers",
+  [LIMIT_OUTPUT_BYTES] = "output",
+  [LIMIT_TIME_MS]      = "time",
+};
+
+static uint64_t
+clock_ms (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*
+ * limit_parse
+ * @spec: NAME=VALUE, e.g. "line=64k" or "time=500"
+ * @limit: return location for the limit
+ * @value: return location for its value
+ *
+ * sizes take an optional k, m or g suffix; time is in milliseconds
+ *
+ * returns false if @spec is malformed
+ */
+bool
+limit_parse (const char *spec,
+             Limit      *limit,
+             uint64_t   *value)
+{
+  const char *eq;
+  char *end;
+
+  *limit = LIMIT_NONE;
+
+  eq = strchr (spec, '=');
+  if (eq == NULL || eq[1] < '0' || eq[1] > '9')
+    return false;
+
+  for (int i = LIMIT_NONE + 1; i < N_LIMITS; i++)
+    {
+      size_t len = strlen (limit_names[i]);
+
+      if ((size_t) (eq - spec) == len && strncmp (spec, limit_names[i], len) == 0)
+        *limit = i;
+    }
+
+  if (*limit == LIMIT_NONE)
+    return false;
+
+  *value = strtoull (eq + 1, &end, 10);
+
+  if (*limit != LIMIT_TIME_MS)
+    {
+      switch (*end)
+        {
+        case 'k': *value <<= 10; end++; break;
+        case 'm': *value <<= 20; end++; break;
+        case 'g': *value <<= 30; end++; break;
+        default: break;
+        }
+    }
+
+  return *end == '\0';
+}
+
+void
+limit_set (Limit    limit,
+           uint64_t value)
+{
+  limits[limit] = value;
+
+  if (limit == LIMIT_TIME_MS)
+    limit_timed = value != 0;
+}
+
+uint64_t
+limit_get (Limit limit)
+{
+  return limits[limit];
+}
+
+/*
+ * limit_state_init
+ * @state
+ *
+ * a conversion that hit no limit yet; starts its clock for
+ * LIMIT_TIME_MS
+ */
+void
+limit_state_init (LimitState *state)
+{
+  state->exceeded = LIMIT_NONE;
+  state->start_ms = clock_ms ();
+}
+
+/*
+ * limit_check
+ * @state: of the conversion; NULL checks nothing
+ * @limit
+ * @value: amount that is about to be used
+ *
+ * returns false (and records @limit as exceeded in @state) if @value is
+ * over it
+ */
+bool
+limit_check (LimitState *state,
+             Limit       limit,
+             uint64_t    value)
+{
+  if (state == NULL || limits[limit] == 0 || value <= limits[limit])
+    return true;
+
+  if (state->exceeded == LIMIT_NONE)
+    state->exceeded = limit;
+
+  return false;
+}
+
+bool
+limit_check_time_ (LimitState *state)
+{
+  return state == NULL || limit_check (state, LIMIT_TIME_MS, clock_ms () - state->start_ms);
+}
+
+const char *
+limit_name (Limit limit)
+{
+  return limit_names[limit];
+}
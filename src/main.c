@@ -19,11 +19,34 @@
  */
 
 
+#include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "params.h"
+#include "backend.h"
+#include "ast.h"
+#include "index.h"
+#include "image.h"
+#include "css.h"
+#include "input.h"
+#include "compress.h"
+#include "tar.h"
+#include "book.h"
+#include "check.h"
+#include "ndjson.h"
+#include "preview.h"
+#include "template.h"
 #include "md.h"
 #include "html.h"
 #include "uuid.h"
+#include "stats.h"
+#include "trace.h"
+#include "limit.h"
 
 
 #define VERSION "0.1.0"
@@ -41,25 +64,554 @@ print_usage (char *binary)
   "Generate equivalent HTML of md\n"
   "\n"
   "Mandatory arguments:\n"
-  "  -i, --input                input markdown file"
+  "  -i, --input                input markdown file, may be gzip or zstd\n"
+  "                             compressed"
   "\n"
   "Optional arguments:\n"
   "  -o, --output               name of output HTML doc\n"
   "  -t, --title                title of output HTML doc\n"
   "  -d, --disable-document     disable injecting HTML document template code\n"
+  "      --template FILE        wrap the doc in FILE instead; {{title}},\n"
+  "                             {{stylesheet}}, {{content}} and {{footnotes}}\n"
+  "                             are filled in\n"
   "  -s, --stylesheet           include css file\n"
+  "      --inline-css           embed the stylesheet, minified, instead of\n"
+  "                             linking it\n"
+  "      --css-cache DIR        keep minified stylesheets in DIR across runs;\n"
+  "                             implies --inline-css\n"
+  "      --minify               leave out whitespace that is only formatting\n"
+  "  -f, --format NAME[=FILE]   render as html, text or ansi instead; repeat to\n"
+  "                             get several formats from one parse. FILE\n"
+  "                             defaults to the output doc for html, else stdout\n"
+  "      --emit-ast FILE        save the parsed doc to FILE instead of rendering\n"
+  "      --from-ast             input is a doc saved with --emit-ast\n"
+  "      --index FILE           write a search index of the doc to FILE; headings\n"
+  "                             get ids for it to point at\n"
+  "      --image-sizes          give local images width and height, read from\n"
+  "                             their headers, and load them lazily\n"
+  "      --image-cache FILE     keep image sizes in FILE across runs; implies\n"
+  "                             --image-sizes\n"
+  "  -z, --compress CODEC[=LEVEL]\n"
+  "                             also write the HTML doc compressed, as FILE.gz\n"
+  "                             (gzip, level 1-9, default 9) or FILE.zst (zstd,\n"
+  "                             1-22, default 19); repeat for both\n"
+  "      --zstd-dict FILE       compress FILE.zst with the zstd dictionary FILE\n"
+  "      --tar                  convert the .md members of a tar stream (-i,\n"
+  "                             else stdin) to .html members on stdout, or -o;\n"
+  "                             other members are copied\n"
+  "      --ndjson               read JSON requests, a line each, from stdin (or\n"
+  "                             -i) and answer each with a line of JSON on\n"
+  "                             stdout (or -o), as they are done\n"
+  "      --preview-server PORT  serve the markdown of -i DIR (default .) as HTML\n"
+  "                             on http://127.0.0.1:PORT/ until interrupted;\n"
+  "                             -j sets the threads rendering pages\n"
+  "  -j, --jobs N               convert N members at a time with --tar;\n"
+  "                             defaults to the number of CPUs\n"
+  "      --book IN...           render the chapters IN, parsed concurrently, as\n"
+  "                             one doc with one set of footnotes; -j sets the\n"
+  "                             number of threads\n"
+  "      --check IN...          validate IN without writing anything: code\n"
+  "                             fences, footnotes and local link targets.\n"
+  "                             Problems go to stdout as IN:LINE: message,\n"
+  "                             exit status 1 if any; -j sets the threads\n"
+  "      --train-zstd-dict OUT IN...\n"
+  "                             train a zstd dictionary on the pages IN and exit\n"
+  "      --merge-index OUT IN...\n"
+  "                             merge search indexes IN into OUT and exit\n"
+  "      --stats[=json]         print per-stage statistics to stderr on exit\n"
+  "      --trace FILE           write a Chrome trace-event timeline to FILE\n"
+  "      --limit NAME=VALUE     stop with exit status 3 once NAME goes over VALUE;\n"
+  "                             input, line, output (bytes, k/m/g suffix), units,\n"
+  "                             footnotes, referrers or time (ms); every doc,\n"
+  "                             tar member or checked file on its own\n"
   "  -h, --help                 display this message\n"
   "  -v, --version              output version information\n", binary);
 }
 
+/*
+ * parse_format
+ * @binary
+ * @params
+ * @spec: NAME[=FILE]
+ * @file: set to FILE, or the default for NAME
+ */
+static const Backend *
+parse_format (char        *binary,
+              Params      *params,
+              const char  *spec,
+              const char **file)
+{
+  const char *eq = strchr (spec, '=');
+  size_t name_len = eq ? (size_t) (eq - spec) : strlen (spec);
+  char name[32] = { 0 };
+  const Backend *backend;
+
+  if (name_len < sizeof (name))
+    memcpy (name, spec, name_len);
+
+  backend = backend_find (name);
+  if (backend == NULL)
+    {
+      fprintf (stderr, "%s: %s: unknown format\n", binary, spec);
+      return NULL;
+    }
+
+  if (eq != NULL)
+    *file = eq + 1;
+  else if (backend == &backend_html)
+    *file = params->o_file ? params->o_file : "index.html";
+  else
+    *file = "-";
+
+  return backend;
+}
+
+/*
+ * render_formats
+ * @binary
+ * @params: params->formats lists the outputs, html if none; plus
+ *          params->index_file
+ * @md: parsed doc
+ *
+ * returns false if a format is unknown or its file can't be opened
+ */
+static bool
+render_formats (char   *binary,
+                Params *params,
+                MD     *md)
+{
+  size_t n_specs = params->n_formats ? params->n_formats : 1;
+  size_t n = n_specs + (params->index_file != NULL);
+  const Backend **backends = calloc (n, sizeof (Backend *));
+  Output **outs = calloc (n, sizeof (Output *));
+  const char **files = calloc (n, sizeof (char *));
+  int *fds = calloc (n, sizeof (int));
+  Precompress **pres = calloc (n, sizeof (Precompress *));
+  size_t n_open = 0;
+  bool ok = true;
+
+  for (size_t i = 0; i < n && ok; i++)
+    {
+      if (i == n_specs)
+        {
+          backends[i] = &backend_index;
+          files[i] = params->index_file;
+        }
+      else
+        {
+          backends[i] = parse_format (binary, params,
+                                      params->n_formats ? params->formats[i] : "html",
+                                      &files[i]);
+        }
+
+      if (backends[i] == NULL)
+        {
+          ok = false;
+          break;
+        }
+
+      for (size_t j = 0; j < i; j++)
+        {
+          if (backends[j] == backends[i])
+            {
+              fprintf (stderr, "%s: %s: format given twice\n", binary, backends[i]->name);
+              ok = false;
+            }
+        }
+
+      if (!ok)
+        break;
+
+      if (strcmp (files[i], "-") == 0)
+        fds[i] = STDOUT_FILENO;
+      else
+        fds[i] = open (files[i], O_WRONLY | O_CREAT | O_TRUNC, 0666);
+
+      if (fds[i] < 0)
+        {
+          fprintf (stderr, "%s: %s: cannot open\n", binary, files[i]);
+          ok = false;
+          break;
+        }
+
+      outs[i] = output_new (fds[i]);
+      n_open++;
+
+      if (backends[i] == &backend_html && fds[i] != STDOUT_FILENO)
+        pres[i] = precompress_start (outs[i], files[i], params->compress_levels);
+    }
+
+  if (ok)
+    backends_render (md, params, backends, outs, n);
+
+  for (size_t i = 0; i < n_open; i++)
+    {
+      stats_add (STATS_COUNTER_BYTES_OUT, output_get_bytes (outs[i]));
+      if (!output_free (outs[i]))
+        {
+          fprintf (stderr, "%s: %s: cannot write\n", binary,
+                   fds[i] == STDOUT_FILENO ? "stdout" : files[i]);
+          ok = false;
+        }
+
+      if (!precompress_finish (pres[i], md->limits.exceeded == LIMIT_NONE))
+        {
+          fprintf (stderr, "%s: %s: cannot write compressed copy\n", binary, files[i]);
+          ok = false;
+        }
+
+      if (fds[i] != STDOUT_FILENO)
+        {
+          close (fds[i]);
+
+          /* same as flush_html () */
+          if (md->limits.exceeded != LIMIT_NONE)
+            unlink (files[i]);
+        }
+    }
+
+  free (backends);
+  free (outs);
+  free (files);
+  free (fds);
+  free (pres);
+
+  return ok;
+}
+
+/*
+ * merge_indexes
+ * @binary
+ * @params: merges params->merge_inputs into params->merge_file
+ */
+static bool
+merge_indexes (char   *binary,
+               Params *params)
+{
+  FILE **inputs = calloc (params->n_merge_inputs + 1, sizeof (FILE *));
+  Output *out;
+  size_t bad = 0;
+  int fd = -1;
+  bool ok = true;
+
+  for (size_t i = 0; i < params->n_merge_inputs && ok; i++)
+    {
+      inputs[i] = fopen (params->merge_inputs[i], "r");
+      if (inputs[i] == NULL)
+        {
+          fprintf (stderr, "%s: %s: No such file or directory\n",
+                   binary, params->merge_inputs[i]);
+          ok = false;
+        }
+    }
+
+  if (ok)
+    {
+      fd = open (params->merge_file, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+      if (fd < 0)
+        {
+          fprintf (stderr, "%s: %s: cannot open\n", binary, params->merge_file);
+          ok = false;
+        }
+    }
+
+  if (ok)
+    {
+      out = output_new (fd);
+      ok = index_merge (out, inputs, params->n_merge_inputs, &bad);
+      if (!ok)
+        fprintf (stderr, "%s: %s: not a valid index\n", binary, params->merge_inputs[bad]);
+
+      ok = output_free (out) && ok;
+      close (fd);
+
+      if (!ok)
+        unlink (params->merge_file);
+    }
+
+  for (size_t i = 0; i < params->n_merge_inputs; i++)
+    {
+      if (inputs[i] != NULL)
+        fclose (inputs[i]);
+    }
+  free (inputs);
+
+  return ok;
+}
+
+/*
+ * convert_tar
+ * @binary
+ * @params: params->tar; reads params->i_file or stdin, writes
+ *          params->o_file or stdout
+ * @exceeded: set to the limit a member hit, or LIMIT_NONE
+ */
+static bool
+convert_tar (char   *binary,
+             Params *params,
+             Limit  *exceeded)
+{
+  const char *i_file = params->i_file ? params->i_file : "/dev/stdin";
+  const char *error = NULL;
+  MDFile *in;
+  Output *out;
+  int fd = STDOUT_FILENO;
+  bool ok;
+
+  /* a .tar.gz or .tar.zst is read through the same decoders */
+  in = input_open (i_file, &error);
+  if (in == NULL)
+    {
+      fprintf (stderr, "%s: %s: %s\n", binary, i_file, error);
+      return false;
+    }
+
+  if (params->o_file != NULL)
+    fd = open (params->o_file, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+
+  if (fd < 0)
+    {
+      fprintf (stderr, "%s: %s: cannot open\n", binary, params->o_file);
+      fclose (in);
+      return false;
+    }
+
+  out = output_new (fd);
+  ok = tar_convert (in, out, params, binary, exceeded, &error);
+  if (!ok)
+    fprintf (stderr, "%s: %s: %s\n", binary, i_file, error);
+
+  stats_add (STATS_COUNTER_BYTES_OUT, output_get_bytes (out));
+  if (!output_free (out) && ok)
+    {
+      fprintf (stderr, "%s: %s: write failed\n", binary,
+               params->o_file ? params->o_file : "stdout");
+      ok = false;
+    }
+
+  if (*exceeded != LIMIT_NONE)
+    {
+      fprintf (stderr, "%s: %s: %s limit exceeded\n",
+               binary, i_file, limit_name (*exceeded));
+    }
+
+  if (fd != STDOUT_FILENO)
+    {
+      close (fd);
+
+      if (!ok || *exceeded != LIMIT_NONE)
+        unlink (params->o_file);
+    }
+
+  fclose (in);
+
+  return ok;
+}
+
+/*
+ * serve_preview
+ * @binary
+ * @params: params->preview_port; serves params->i_file or the current
+ *          directory
+ */
+static bool
+serve_preview (char   *binary,
+               Params *params)
+{
+  const char *root = params->i_file ? params->i_file : ".";
+  const char *error = NULL;
+  struct stat st;
+
+  if (stat (root, &st) != 0 || !S_ISDIR (st.st_mode))
+    {
+      fprintf (stderr, "%s: %s: not a directory\n", binary, root);
+      return false;
+    }
+
+  if (!preview_serve (root, params->preview_port, params, binary, &error))
+    {
+      fprintf (stderr, "%s: port %d: %s\n", binary, params->preview_port, error);
+      return false;
+    }
+
+  return true;
+}
+
+/*
+ * convert_ndjson
+ * @binary
+ * @params: params->ndjson; reads params->i_file or stdin, writes
+ *          params->o_file or stdout
+ *
+ * a request that hits a limit is answered with an error; the others
+ * are still converted
+ */
+static bool
+convert_ndjson (char   *binary,
+                Params *params)
+{
+  const char *error = NULL;
+  FILE *in = stdin;
+  Output *out;
+  int fd = STDOUT_FILENO;
+  bool ok;
+
+  /* not input_open (): requests are answered before the next ones
+   * arrive, and a decoder would wait for a full buffer */
+  if (params->i_file != NULL)
+    in = fopen (params->i_file, "r");
+
+  if (in == NULL)
+    {
+      fprintf (stderr, "%s: %s: %s\n", binary, params->i_file, strerror (errno));
+      return false;
+    }
+
+  if (params->o_file != NULL)
+    fd = open (params->o_file, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+
+  if (fd < 0)
+    {
+      fprintf (stderr, "%s: %s: cannot open\n", binary, params->o_file);
+      if (in != stdin)
+        fclose (in);
+      return false;
+    }
+
+  out = output_new (fd);
+  ok = ndjson_convert (in, out, params, &error);
+  if (!ok)
+    fprintf (stderr, "%s: %s: %s\n", binary,
+             params->i_file ? params->i_file : "stdin", error);
+
+  stats_add (STATS_COUNTER_BYTES_OUT, output_get_bytes (out));
+  if (!output_free (out) && ok)
+    {
+      fprintf (stderr, "%s: %s: write failed\n", binary,
+               params->o_file ? params->o_file : "stdout");
+      ok = false;
+    }
+
+  if (fd != STDOUT_FILENO)
+    close (fd);
+  if (in != stdin)
+    fclose (in);
+
+  return ok;
+}
+
+/*
+ * emit_ast
+ * @binary
+ * @ast_file: "-" for stdout
+ * @md: parsed doc
+ */
+static bool
+emit_ast (char       *binary,
+          const char *ast_file,
+          MD         *md)
+{
+  Output *out;
+  int fd;
+  bool ok;
+
+  if (strcmp (ast_file, "-") == 0)
+    fd = STDOUT_FILENO;
+  else
+    fd = open (ast_file, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+
+  if (fd < 0)
+    {
+      fprintf (stderr, "%s: %s: cannot open\n", binary, ast_file);
+      return false;
+    }
+
+  out = output_new (fd);
+  ok = ast_write (md, out);
+  stats_add (STATS_COUNTER_BYTES_OUT, output_get_bytes (out));
+  ok = output_free (out) && ok;
+
+  if (fd != STDOUT_FILENO)
+    {
+      close (fd);
+
+      if (!ok)
+        unlink (ast_file);
+    }
+
+  if (!ok)
+    fprintf (stderr, "%s: %s: write failed\n", binary, ast_file);
+
+  return ok;
+}
+
+/*
+ * read_file
+ * @file: e.g. a pipe, which can't be mapped
+ * @len: set to the number of bytes read
+ */
+static char *
+read_file (MDFile *file,
+           size_t *len)
+{
+  size_t size = 1 << 16;
+  char *buf = malloc (size);
+  size_t n;
+
+  *len = 0;
+  while ((n = fread (buf + *len, 1, size - *len, file)) > 0)
+    {
+      *len += n;
+      if (*len == size)
+        buf = realloc (buf, size <<= 1);
+    }
+
+  return buf;
+}
+
+/*
+ * warn_invalid
+ * @binary
+ * @file: of @md
+ * @md: parsed doc
+ */
+static void
+warn_invalid (char       *binary,
+              const char *file,
+              MD         *md)
+{
+  for (size_t i = 0; i < md->n_invalid && i < MD_MAX_INVALID_OFFSETS; i++)
+    {
+      fprintf (stderr, "%s: %s: warning: invalid UTF-8 at byte offset %zu\n",
+               binary, file, md->invalid_offsets[i]);
+    }
+
+  if (md->n_invalid > MD_MAX_INVALID_OFFSETS)
+    {
+      fprintf (stderr, "%s: %s: warning: %zu more invalid UTF-8 sequences\n",
+               binary, file, md->n_invalid - MD_MAX_INVALID_OFFSETS);
+    }
+}
+
 int
 main (int   argc,
       char *argv[])
 {
   Params *params = NULL;
   MDFile *file = NULL;
+  Book *book = NULL;
   MD *md = NULL;
   HTML *html = NULL;
+  StatsTimer timer;
+  TraceSpan span;
+  struct stat st;
+  void *map = MAP_FAILED;
+  char *buf = NULL;
+  size_t buf_len = 0;
+  const char *error = NULL;
+  const char *i_file;
+  Limit exceeded = LIMIT_NONE;
+  int status = 0;
 
   params = params_parse (argc, argv);
 
@@ -70,6 +622,8 @@ main (int   argc,
       return 1;
     }
 
+  i_file = params->i_file;
+
   if (params->help)
     {
       print_usage (argv[0]);
@@ -82,26 +636,277 @@ main (int   argc,
       return 0;
     }
 
-  file = fopen (params->i_file, "r");
-  if (file == NULL)
+  if (params->merge_file != NULL)
+    {
+      status = merge_indexes (argv[0], params) ? 0 : 1;
+      params_free (params);
+      return status;
+    }
+
+  if (params->train_file != NULL)
+    {
+      if (!compress_train_dict (params->train_file, params->train_inputs,
+                                params->n_train_inputs, &error))
+        {
+          fprintf (stderr, "%s: %s: %s\n", argv[0], params->train_file, error);
+          status = 1;
+        }
+
+      params_free (params);
+      return status;
+    }
+
+  for (int i = 0; i < N_COMPRESS_CODECS; i++)
     {
-      fprintf (stderr, "%s: %s: No such file or directory\n",
-               argv[0], params->i_file);
+      if (params->compress_levels[i] != 0 && !compress_supported (i))
+        {
+          fprintf (stderr, "%s: %s: built without support for it\n",
+                   argv[0], compress_name (i));
+          return 1;
+        }
+    }
+
+  if (!compress_open (params->zstd_dict))
+    {
+      fprintf (stderr, "%s: %s: cannot read dictionary\n", argv[0], params->zstd_dict);
       return 1;
     }
 
+  if (params->stats != STATS_FORMAT_NONE)
+    stats_enable ();
+
   uuid_init ();
 
-  md = parse_md (file);
+  if (params->trace_file != NULL && !trace_open (params->trace_file))
+    {
+      fprintf (stderr, "%s: %s: cannot open trace file\n",
+               argv[0], params->trace_file);
+      return 1;
+    }
+
+  for (int i = LIMIT_NONE + 1; i < N_LIMITS; i++)
+    limit_set (i, params->limits[i]);
+
+  if (params->n_check_inputs != 0)
+    {
+      size_t n_problems;
+      bool limited;
+
+      /* a file that hits a limit is reported among the problems */
+      n_problems = check_files (params->check_inputs, params->n_check_inputs,
+                                params->jobs, stdout, &limited);
 
-  html = html_from_md (md, params);
-  flush_html (html);
+      trace_close ();
+      stats_print (stderr, params->stats);
+      params_free (params);
+
+      if (limited)
+        return LIMIT_EXIT_CODE;
+
+      return n_problems != 0 ? 1 : 0;
+    }
+
+  /* image paths are relative to the HTML doc */
+  if (params->image_sizes)
+    {
+      const char *o_file = params->o_file ? params->o_file : "index.html";
+      const char *slash = strrchr (o_file, '/');
+      char *dir;
+
+      if (slash == NULL)
+        dir = strdup (".");
+      else if (slash == o_file)
+        dir = strdup ("/");
+      else
+        dir = strndup (o_file, slash - o_file);
+
+      image_open (dir, params->image_cache);
+      free (dir);
+    }
+
+  /* read here so that a missing stylesheet is an error, not a <link> */
+  if (params->inline_css)
+    {
+      size_t len;
+
+      css_open (params->css_cache);
+      if (css_inline (params->css_file, &len) == NULL)
+        {
+          fprintf (stderr, "%s: %s: cannot read stylesheet\n",
+                   argv[0], params->css_file);
+          return 1;
+        }
+    }
+
+  /* compiled once; every doc of the run is written from it */
+  if (params->template_file != NULL &&
+      template_get (params->template_file, &error) == NULL)
+    {
+      fprintf (stderr, "%s: %s: %s\n", argv[0], params->template_file, error);
+      return 1;
+    }
+
+  if (params->tar || params->ndjson || params->preview_port >= 0)
+    {
+      if (params->tar)
+        status = convert_tar (argv[0], params, &exceeded) ? 0 : 1;
+      else if (params->ndjson)
+        status = convert_ndjson (argv[0], params) ? 0 : 1;
+      else
+        status = serve_preview (argv[0], params) ? 0 : 1;
+
+      css_close ();
+      template_close ();
+      compress_close ();
+      trace_close ();
+      stats_print (stderr, params->stats);
+      params_free (params);
+
+      return exceeded != LIMIT_NONE ? LIMIT_EXIT_CODE : status;
+    }
+
+  if (params->n_book_inputs != 0)
+    {
+      size_t bad = 0;
+
+      /* chapters are parsed concurrently, each timed as a parse */
+      book = book_parse (params->book_inputs, params->n_book_inputs,
+                         params->jobs, &bad, &error);
+      if (book == NULL)
+        {
+          fprintf (stderr, "%s: %s: %s\n", argv[0], params->book_inputs[bad], error);
+          return 1;
+        }
+
+      for (size_t i = 0; i < params->n_book_inputs; i++)
+        warn_invalid (argv[0], params->book_inputs[i], book_chapter (book, i));
+
+      md = book_merge (book);
+      i_file = params->o_file ? params->o_file : "index.html";
+    }
+  else
+    {
+      /* gzip and zstd input is decompressed while it's parsed */
+      file = input_open (params->i_file, &error);
+      if (file == NULL)
+        {
+          fprintf (stderr, "%s: %s: %s\n", argv[0], params->i_file, error);
+          return 1;
+        }
+
+      stats_timer_start (&timer);
+      trace_begin (&span);
+
+      /* map regular files so verbatim code blocks need not be copied */
+      if (fstat (fileno (file), &st) == 0 && S_ISREG (st.st_mode) && st.st_size > 0)
+        map = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno (file), 0);
+
+      if (params->from_ast)
+        {
+          if (map == MAP_FAILED)
+            buf = read_file (file, &buf_len);
+
+          if (input_error (file) != NULL)
+            {
+              fprintf (stderr, "%s: %s: %s\n", argv[0], params->i_file, input_error (file));
+              return 1;
+            }
+
+          md = map != MAP_FAILED ? ast_load (map, st.st_size, &error)
+                                 : ast_load (buf, buf_len, &error);
+          if (md == NULL)
+            {
+              fprintf (stderr, "%s: %s: %s\n", argv[0], params->i_file, error);
+              return 1;
+            }
+        }
+      else if (map != MAP_FAILED)
+        md = parse_md_buffer (map, st.st_size);
+      else
+        md = parse_md (file);
+
+      /* don't render what was read of a corrupt file as if it was the doc */
+      if (input_error (file) != NULL)
+        {
+          fprintf (stderr, "%s: %s: %s\n", argv[0], params->i_file, input_error (file));
+          return 1;
+        }
+
+      trace_end (&span, params->from_ast ? "ast_load" : "parse_md");
+      stats_timer_stop (&timer, STATS_STAGE_PARSE);
+
+      warn_invalid (argv[0], params->i_file, md);
+    }
+
+  stats_count_md (md);
+
+  /* a limit hit while parsing leaves a partial doc; don't render it */
+  if (md->limits.exceeded == LIMIT_NONE &&
+      (params->ast_file != NULL || params->n_formats != 0 || params->index_file != NULL))
+    {
+      /* walked straight from the doc */
+      stats_timer_start (&timer);
+      trace_begin (&span);
+      if (params->ast_file != NULL)
+        status = emit_ast (argv[0], params->ast_file, md) ? 0 : 1;
+      else
+        status = render_formats (argv[0], params, md) ? 0 : 1;
+      trace_end (&span, "flush_html");
+      stats_timer_stop (&timer, STATS_STAGE_FLUSH);
+    }
+  else if (md->limits.exceeded == LIMIT_NONE)
+    {
+      stats_timer_start (&timer);
+      trace_begin (&span);
+      html = html_from_md (md, params);
+      trace_end (&span, "html_from_md");
+      stats_timer_stop (&timer, STATS_STAGE_HTML);
+
+      stats_timer_start (&timer);
+      trace_begin (&span);
+      if (!flush_html (html))
+        {
+          fprintf (stderr, "%s: %s: cannot write it or a compressed copy\n",
+                   argv[0], html->file_name);
+          status = 1;
+        }
+      trace_end (&span, "flush_html");
+      stats_timer_stop (&timer, STATS_STAGE_FLUSH);
+
+      html_free (html);
+    }
+
+  exceeded = md->limits.exceeded;
+  if (exceeded != LIMIT_NONE)
+    {
+      fprintf (stderr, "%s: %s: %s limit exceeded\n",
+               argv[0], i_file, limit_name (exceeded));
+    }
 
   /* free */
-  html_free (html);
-  md_free (md);
+  if (book != NULL)
+    book_free (book);
+  else
+    md_free (md);
+
+  if (map != MAP_FAILED)
+    munmap (map, st.st_size);
+  free (buf);
+  if (file != NULL)
+    fclose (file);
+
+  if (!image_close ())
+    {
+      fprintf (stderr, "%s: %s: warning: cannot write image cache\n",
+               argv[0], params->image_cache);
+    }
+
+  css_close ();
+  template_close ();
+  compress_close ();
+  trace_close ();
+  stats_print (stderr, params->stats);
   params_free (params);
-  fclose (file);
 
-  return 0;
+  return exceeded != LIMIT_NONE ? LIMIT_EXIT_CODE : status;
 }
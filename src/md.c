@@ -19,6 +19,8 @@
  */
 
 #include "md.h"
+#include "utf8.h"
+#include "limit.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -77,9 +79,14 @@ md_init (MD **md)
       return;
     }
 
-  (*md)->n_lines = -1;
+  (*md)->n_lines = 0;
+  (*md)->n_bytes = 0;
+  (*md)->n_invalid = 0;
+  (*md)->open_fence = 0;
   (*md)->elements = NULL;
+  (*md)->unit_block = NULL;
   (*md)->notes = footnotes_new ();
+  limit_state_init (&(*md)->limits);
 }
 
 /*
@@ -91,7 +98,7 @@ static void
 md_unit_init (MDUnit **unit)
 {
   *unit = (MDUnit *) malloc (sizeof (MDUnit));
-  memset (*unit, 0, sizeof(unit));
+  memset (*unit, 0, sizeof (MDUnit));
 
   // malloc fails
   if (*unit == NULL)
@@ -102,8 +109,12 @@ md_unit_init (MDUnit **unit)
 
   (*unit)->type = UNIT_TYPE_NONE;
   (*unit)->content = NULL;
+  (*unit)->content_len = 0;
+  (*unit)->borrowed = false;
   (*unit)->uri = NULL;
   (*unit)->lang = LANG_NONE;
+  (*unit)->line = 0;
+  (*unit)->part = 0;
   (*unit)->next = NULL;
 }
 
@@ -113,7 +124,7 @@ extract_footnote (char  *line,
                   char **note)
 {
   char *start, *end;
-  int len = 0;
+  size_t len = 0;
 
   start = line + 2;
   end = strstr (start, "]:");
@@ -131,6 +142,8 @@ extract_footnote (char  *line,
 
   start = end + 2;
   end = strchr (start, '\n');
+  if (end == NULL)
+    end = start + strlen (start);
 
   len = end - start;
   if (len != 0)
@@ -141,15 +154,16 @@ extract_footnote (char  *line,
 }
 
 static void
-add_footnote (MD   *md,
-              char *line)
+add_footnote (MD     *md,
+              char   *line,
+              size_t  line_no)
 {
   char *identifier = NULL;
   char *note = NULL;
 
   extract_footnote (line, &identifier, &note);
 
-  footnotes_add (md->notes, identifier, note);
+  footnotes_add (md->notes, identifier, note)->line = line_no;
 
   if (identifier)
     free (identifier);
@@ -161,7 +175,7 @@ add_footnote (MD   *md,
  *
  * UNIT_TYPE_NONE: empty line
  */
-static UnitType
+UnitType
 find_md_unit_type (char *line)
 {
   /* empty line */
@@ -294,10 +308,524 @@ find_code_block_lang (char *line)
   return lang;
 }
 
+static void
+validate_line (MD         *md,
+               const char *line,
+               size_t      len)
+{
+  size_t offset = 0;
+
+  while ((offset += utf8_validate (line + offset, len - offset)) < len)
+    {
+      if (md->n_invalid < MD_MAX_INVALID_OFFSETS)
+        md->invalid_offsets[md->n_invalid] = md->n_bytes + offset;
+
+      md->n_invalid++;
+      offset++;
+    }
+}
+
+/*
+ * @LineReader
+ *
+ * hands out one NUL-terminated line at a time, either from a FILE
+ * or from an in-memory (usually mmap()ed) buffer
+ */
+typedef struct {
+  MDFile     *file;
+
+  const char *buf;
+  size_t      buf_len;
+  size_t      pos;
+
+  /* current line */
+  char       *line;
+  size_t      size;
+  size_t      line_no;
+
+  size_t      max_line;  /* LIMIT_LINE_LENGTH, 0 if unlimited */
+} LineReader;
+
+/*
+ * file_getline
+ *
+ * getline () that gives up after reader->max_line bytes, so that a
+ * single huge line can't eat up memory; the caller sees a line that is
+ * one byte over the limit
+ */
+static ssize_t
+file_getline (LineReader *reader)
+{
+  size_t n = 0;
+  int c;
+
+  while ((c = getc_unlocked (reader->file)) != EOF)
+    {
+      if (n + 2 > reader->size)
+        {
+          reader->size = reader->size ? reader->size * 2 : 128;
+          reader->line = realloc (reader->line, reader->size);
+        }
+
+      reader->line[n++] = c;
+
+      if (c == '\n' || n > reader->max_line)
+        break;
+    }
+
+  if (n == 0)
+    return -1;
+
+  reader->line[n] = '\0';
+
+  return n;
+}
+
+static ssize_t
+buffer_getline (LineReader *reader)
+{
+  const char *start, *newline;
+  size_t n;
+
+  if (reader->pos >= reader->buf_len)
+    return -1;
+
+  start = reader->buf + reader->pos;
+  newline = memchr (start, '\n', reader->buf_len - reader->pos);
+
+  n = newline ? (size_t) (newline - start) + 1
+              : reader->buf_len - reader->pos;
+
+  /* same as file_getline (), don't copy more than is needed to fail */
+  if (reader->max_line != 0 && n > reader->max_line + 1)
+    n = reader->max_line + 1;
+
+  if (n + 1 > reader->size)
+    {
+      reader->size = n + 1;
+      reader->line = realloc (reader->line, reader->size);
+    }
+
+  memcpy (reader->line, start, n);
+  reader->line[n] = '\0';
+  reader->pos += n;
+
+  return n;
+}
+
+/*
+ * normalize_line
+ * @reader: reader->line holds @read bytes of raw input
+ * @md: records input size and malformed UTF-8
+ * @read: length of the line
+ *
+ * input normalization:
+ *  1. a leading UTF-8 BOM is dropped
+ *  2. CRLF line endings become LF
+ *  3. malformed UTF-8 is recorded (and passed through)
+ *
+ * returns the normalized length or -1 once a limit is hit
+ */
+static ssize_t
+normalize_line (LineReader *reader,
+                MD         *md,
+                ssize_t     read)
+{
+  char *line;
+  size_t len;
+
+  line = reader->line;
+  reader->line_no++;
+
+  len = read - (line[read - 1] == '\n');
+  if (!limit_check (&md->limits, LIMIT_LINE_LENGTH, len) ||
+      !limit_check (&md->limits, LIMIT_INPUT_BYTES, md->n_bytes + read))
+    return -1;
+
+  if (md->n_bytes == 0 &&
+      read >= UTF8_BOM_LEN &&
+      memcmp (line, UTF8_BOM, UTF8_BOM_LEN) == 0)
+    {
+      read -= UTF8_BOM_LEN;
+      memmove (line, line + UTF8_BOM_LEN, read + 1);
+      md->n_bytes += UTF8_BOM_LEN;
+    }
+
+  validate_line (md, line, read);
+  md->n_bytes += read;
+
+  if (read >= 2 && line[read - 2] == '\r' && line[read - 1] == '\n')
+    {
+      line[read - 2] = '\n';
+      line[--read] = '\0';
+    }
+  else if (read >= 1 && line[read - 1] == '\r')
+    {
+      /* last line without a newline */
+      line[--read] = '\0';
+    }
+
+  return read;
+}
+
+/*
+ * read_line
+ * @reader: input
+ * @md
+ *
+ * reads and normalizes the next line into reader->line
+ *
+ * returns the normalized length or -1 at EOF or once a limit is hit
+ */
+static ssize_t
+read_line (LineReader *reader,
+           MD         *md)
+{
+  ssize_t read;
+
+  if (md->limits.exceeded != LIMIT_NONE || !limit_check_time (&md->limits))
+    return -1;
+
+  if (reader->file != NULL && reader->max_line != 0)
+    read = file_getline (reader);
+  else if (reader->file != NULL)
+    read = getline (&reader->line, &reader->size, reader->file);
+  else
+    read = buffer_getline (reader);
+
+  if (read == -1)
+    return -1;
+
+  return normalize_line (reader, md, read);
+}
+
+/*
+ * borrow_code_block
+ * @reader: buffer input, positioned right after the opening fence
+ * @md
+ * @unit: code block
+ *
+ * points @unit at the code block body inside the input buffer instead
+ * of copying it; the body starts at the newline ending the fence line,
+ * same as a copied one
+ *
+ * returns false (and consumes nothing) if the body needs normalizing
+ */
+static bool
+borrow_code_block (LineReader *reader,
+                   MD         *md,
+                   MDUnit     *unit)
+{
+  const char *body, *ptr, *end;
+  size_t n_lines = 0;
+  size_t len;
+
+  if (reader->pos == 0 || reader->buf[reader->pos - 1] != '\n' ||
+      (reader->pos >= 2 && reader->buf[reader->pos - 2] == '\r'))
+    return false;
+
+  body = ptr = reader->buf + reader->pos;
+  end = reader->buf + reader->buf_len;
+
+  while (ptr < end)
+    {
+      const char *newline;
+
+      if (end - ptr >= 3 && IS_CODE_BLOCK_BOUND (ptr))
+        break;
+
+      newline = memchr (ptr, '\n', end - ptr);
+
+      /* let read_line () report the limit */
+      if (reader->max_line != 0 &&
+          (size_t) ((newline ? newline : end) - ptr) > reader->max_line)
+        return false;
+
+      ptr = newline ? newline + 1 : end;
+      n_lines++;
+    }
+
+  len = ptr - body;
+
+  if (memchr (body, '\r', len) != NULL ||
+      (limit_get (LIMIT_INPUT_BYTES) != 0 &&
+       md->n_bytes + len > limit_get (LIMIT_INPUT_BYTES)))
+    return false;
+
+  validate_line (md, body, len);
+  md->n_bytes += len;
+  reader->pos += len;
+  reader->line_no += n_lines;
+
+  unit->content = (char *) body - 1;
+  unit->content_len = len + 1;
+  unit->borrowed = true;
+
+  if (ptr == end)
+    md->open_fence = unit->line;
+
+  /* closing fence */
+  read_line (reader, md);
+
+  return true;
+}
+
+/*
+ * @MDParser
+ *
+ * line at a time parser state; lines are pulled from a LineReader by
+ * parse_md () and parse_md_buffer (), or put together from pushed
+ * chunks by md_parser_feed ()
+ */
+struct MDParser {
+  LineReader  reader;   /* reader.pos is the partial line when pushed */
+  MD         *md;
+
+  MDUnit     *tail;        /* last unit in md->elements */
+  MDUnit     *code_block;  /* open code block; appended once closed */
+  size_t      code_size;   /* allocated for code_block->content */
+};
+
+static void
+append_unit (MDParser *parser,
+             MDUnit   *unit)
+{
+  if (parser->tail == NULL)
+    parser->md->elements = unit;
+  else
+    parser->tail->next = unit;
+
+  parser->tail = unit;
+  parser->md->n_lines++;
+}
+
+static void
+open_code_block (MDParser *parser,
+                 MDUnit   *unit)
+{
+  parser->code_size = 256;
+
+  unit->content = malloc (sizeof (char) * parser->code_size);
+  unit->content[0] = '\n'; /* add a newline */
+  unit->content_len = 1;
+
+  parser->code_block = unit;
+}
+
+static void
+append_code_line (MDParser   *parser,
+                  const char *line,
+                  size_t      len)
+{
+  MDUnit *unit = parser->code_block;
+
+  while (unit->content_len + len >= parser->code_size)
+    {
+      parser->code_size <<= 1;
+      unit->content = realloc (unit->content, sizeof (char) * parser->code_size);
+    }
+
+  memcpy (&unit->content[unit->content_len], line, len);
+  unit->content_len += len;
+}
+
+static void
+close_code_block (MDParser *parser)
+{
+  MDUnit *unit = parser->code_block;
+
+  unit->content[unit->content_len] = '\0';
+  parser->code_block = NULL;
+
+  append_unit (parser, unit);
+}
+
+/*
+ * parse_line
+ * @parser
+ * @read: length of the normalized line in parser->reader.line
+ */
+static void
+parse_line (MDParser *parser,
+            size_t    read)
+{
+  LineReader *reader = &parser->reader;
+  MD *md = parser->md;
+  char *line = reader->line;
+  MDUnit *unit = NULL;
+
+  if (parser->code_block != NULL)
+    {
+      if (find_md_unit_type (line) == UNIT_TYPE_CODE_BLOCK_BOUND)
+        close_code_block (parser);
+      else
+        append_code_line (parser, line, read);
+
+      return;
+    }
+
+  md_unit_init (&unit);
+
+  unit->type = find_md_unit_type (line);
+  unit->line = reader->line_no;
+
+  if (unit->type != UNIT_TYPE_FOOTNOTE &&
+      !limit_check (&md->limits, LIMIT_UNITS, md->n_lines + 1))
+    {
+      free (unit);
+      return;
+    }
+
+  if (unit->type == UNIT_TYPE_CODE_BLOCK_BOUND)
+    {
+      unit->lang = find_code_block_lang (line);
+      unit->type = UNIT_TYPE_CODE_BLOCK;
+    }
+
+  if (unit->type == UNIT_TYPE_CODE_BLOCK)
+    {
+      /* highlighters need a private, NUL-terminated copy */
+      bool verbatim = unit->lang == LANG_NONE || unit->lang == LANG_HTML;
+
+      if (reader->buf && verbatim && borrow_code_block (reader, md, unit))
+        append_unit (parser, unit);
+      else
+        open_code_block (parser, unit);
+    }
+  else if (unit->type == UNIT_TYPE_FOOTNOTE)
+    {
+      if (limit_check (&md->limits, LIMIT_FOOTNOTES, footnotes_get_count (md->notes) + 1))
+        add_footnote (md, line, unit->line);
+
+      free (unit);
+    }
+  else
+    {
+      char *content = NULL;
+
+      content = find_md_content (line, unit->type);
+      if (content != NULL)
+        {
+          unit->content = remove_trailing_new_line (strdup (content));
+          unit->content_len = strlen (unit->content);
+        }
+
+      append_unit (parser, unit);
+    }
+}
+
+static void
+parser_init (MDParser *parser)
+{
+  memset (parser, 0, sizeof (MDParser));
+
+  md_init (&parser->md);
+  parser->reader.max_line = limit_get (LIMIT_LINE_LENGTH);
+}
+
+static void
+parser_finish (MDParser *parser)
+{
+  /* unclosed code block runs to the end of the doc */
+  if (parser->code_block != NULL)
+    {
+      parser->md->open_fence = parser->code_block->line;
+      close_code_block (parser);
+    }
+
+  free (parser->reader.line);
+  parser->reader.line = NULL;
+}
+
+static MD *
+parse_lines (MDParser *parser)
+{
+  ssize_t read;
+
+  /* read file line by line; stops early once a limit is hit */
+  while ((read = read_line (&parser->reader, parser->md)) != -1)
+    parse_line (parser, read);
+
+  parser_finish (parser);
+
+  return parser->md;
+}
+
+/*
+ * pushed input
+ */
+
+static void
+parse_pushed_line (MDParser *parser)
+{
+  LineReader *reader = &parser->reader;
+  ssize_t read;
+
+  read = reader->pos;
+  reader->pos = 0;
+  reader->line[read] = '\0';
+
+  if (!limit_check_time (&parser->md->limits))
+    return;
+
+  read = normalize_line (reader, parser->md, read);
+  if (read != -1)
+    parse_line (parser, read);
+}
+
+static void
+push_bytes (LineReader *reader,
+            const char *buf,
+            size_t      len)
+{
+  if (reader->pos + len + 1 > reader->size)
+    {
+      while (reader->pos + len + 1 > reader->size)
+        reader->size = reader->size ? reader->size * 2 : 128;
+
+      reader->line = realloc (reader->line, reader->size);
+    }
+
+  memcpy (reader->line + reader->pos, buf, len);
+  reader->pos += len;
+}
+
 /*
  * Public functions
  */
 
+const char *
+md_unit_type_name (UnitType type)
+{
+  static const char *names[] = {
+    [UNIT_TYPE_H1]               = "h1",
+    [UNIT_TYPE_H2]               = "h2",
+    [UNIT_TYPE_H3]               = "h3",
+    [UNIT_TYPE_BULLET]           = "bullet",
+    [UNIT_TYPE_QUOTE]            = "quote",
+    [UNIT_TYPE_CODE_BLOCK]       = "code_block",
+    [UNIT_TYPE_CODE_BLOCK_BOUND] = "code_block_bound",
+    [UNIT_TYPE_TEXT]             = "text",
+    [UNIT_TYPE_FOOTNOTE]         = "footnote",
+    [UNIT_TYPE_NONE]             = "blank",
+  };
+
+  return names[type];
+}
+
+const char *
+md_lang_name (Lang lang)
+{
+  static const char *names[] = {
+    [LANG_C]    = "c",
+    [LANG_DIFF] = "diff",
+    [LANG_HTML] = "html",
+    [LANG_NONE] = "none",
+  };
+
+  return names[lang];
+}
+
 /*
  * parse_md:
  * @file: markdown file as input
@@ -307,92 +835,209 @@ find_code_block_lang (char *line)
 MD*
 parse_md (MDFile *file)
 {
-  uint n_lines = 0;
-  char *line = NULL;
-  size_t len = 0;
-  size_t read;
-  MD *md = NULL;
-  MDUnit *next = NULL;
+  MDParser parser;
 
   return_val_if_null (file);
 
-  md_init (&md);
+  parser_init (&parser);
+  parser.reader.file = file;
+
+  return parse_lines (&parser);
+}
+
+/*
+ * parse_md_buffer:
+ * @buf: markdown document, e.g. a memory mapped file
+ * @len: size of @buf
+ *
+ * same as parse_md (), but verbatim code blocks point into @buf
+ * (see MDUnit.borrowed), so it has to outlive the MD and HTML docs
+ */
+MD*
+parse_md_buffer (const char *buf,
+                 size_t      len)
+{
+  MDParser parser;
+
+  return_val_if_null (buf);
 
-  /* read file line by line */
-  while ((read = getline (&line, &len, file) != -1))
+  parser_init (&parser);
+  parser.reader.buf = buf;
+  parser.reader.buf_len = len;
+
+  return parse_lines (&parser);
+}
+
+/*
+ * md_parser_new
+ *
+ * parser for input that arrives in pieces, see md_parser_feed ()
+ */
+MDParser *
+md_parser_new (void)
+{
+  MDParser *parser;
+
+  parser = malloc (sizeof (MDParser));
+  parser_init (parser);
+
+  return parser;
+}
+
+/*
+ * md_parser_feed
+ * @parser
+ * @buf: next piece of the document; may end anywhere, even in the
+ *       middle of a line or a UTF-8 sequence
+ * @len: size of @buf
+ *
+ * parses every line completed by @buf; the rest is kept for the next
+ * call.  Finished units can be taken with md_parser_next_unit ()
+ *
+ * returns false once a limit is hit
+ */
+bool
+md_parser_feed (MDParser   *parser,
+                const char *buf,
+                size_t      len)
+{
+  LineReader *reader = &parser->reader;
+  LimitState *limits = &parser->md->limits;
+
+  while (len > 0 && limits->exceeded == LIMIT_NONE)
     {
-      MDUnit *unit = NULL;
+      const char *newline;
+      size_t n;
 
-      md_unit_init (&unit);
+      newline = memchr (buf, '\n', len);
+      n = newline ? (size_t) (newline - buf) + 1 : len;
 
-      unit->type = find_md_unit_type (line);
+      push_bytes (reader, buf, n);
+      buf += n;
+      len -= n;
 
-      if (unit->type == UNIT_TYPE_CODE_BLOCK_BOUND)
-        {
-          unit->lang = find_code_block_lang (line);
-          unit->type = UNIT_TYPE_CODE_BLOCK;
-        }
+      if (newline != NULL)
+        parse_pushed_line (parser);
+      else if (reader->max_line != 0 && reader->pos > reader->max_line)
+        limit_check (limits, LIMIT_LINE_LENGTH, reader->pos);
+    }
 
-      if (unit->type == UNIT_TYPE_CODE_BLOCK)
-        {
-          size_t buf_size = 256;
-          size_t count = 1;
-          char *buf;
+  return limits->exceeded == LIMIT_NONE;
+}
 
-          buf = malloc (sizeof (char) * buf_size);
-          buf[0] = '\n'; /* add a newline */
+/*
+ * md_parser_finish
+ * @parser
+ *
+ * parses the last line, if it had no newline, and closes an open code
+ * block
+ *
+ * returns the parsed doc; it stays owned by @parser
+ */
+MD *
+md_parser_finish (MDParser *parser)
+{
+  if (parser->reader.pos > 0 && parser->md->limits.exceeded == LIMIT_NONE)
+    parse_pushed_line (parser);
 
-          while ((read = getline (&line, &len, file)) != -1UL)
-            {
-              if (find_md_unit_type (line) == UNIT_TYPE_CODE_BLOCK_BOUND)
-                break;
+  parser_finish (parser);
 
-              if (count + read >= buf_size)
-                {
-                  buf_size <<= 1;
-                  buf = realloc (buf, sizeof (char) * buf_size);
-                }
+  return parser->md;
+}
 
-              memcpy (&buf[count], line, read);
-              count += read;
-            }
+MD *
+md_parser_get_md (MDParser *parser)
+{
+  return parser->md;
+}
 
-          buf[count] = '\0';
-          unit->content = buf;
-        }
-      else if (unit->type == UNIT_TYPE_FOOTNOTE)
-        {
-          add_footnote (md, line);
-          free (unit);
-          continue;
-        }
-      else
-        {
-          char *content = NULL;
+/*
+ * md_parser_next_unit
+ * @parser
+ *
+ * takes the oldest finished unit out of the doc; the caller owns it
+ * (and its content) from then on
+ *
+ * returns NULL if no unit is finished yet
+ */
+MDUnit *
+md_parser_next_unit (MDParser *parser)
+{
+  MDUnit *unit = parser->md->elements;
 
-          content = find_md_content (line, unit->type);
-          if (content != NULL)
-            unit->content = remove_trailing_new_line (strdup (content));
-        }
+  if (unit == NULL)
+    return NULL;
 
-      /* Append to md->elements */
-      if (next == NULL)
-        {
-          md->elements = unit;
-          next = unit;
-        }
-      else
+  parser->md->elements = unit->next;
+  if (unit == parser->tail)
+    parser->tail = NULL;
+
+  unit->next = NULL;
+
+  return unit;
+}
+
+void
+md_parser_free (MDParser *parser)
+{
+  if (parser->code_block != NULL)
+    {
+      free (parser->code_block->content);
+      free (parser->code_block);
+    }
+
+  free (parser->reader.line);
+  md_free (parser->md);
+  free (parser);
+}
+
+/*
+ * md_concat
+ * @parts: parsed docs, in order; taken over and freed
+ * @n_parts
+ *
+ * one doc of the units of @parts, e.g. the chapters of a book.  Units
+ * remember their part, and footnote identifiers are resolved within it;
+ * the notes are numbered through.  @parts must not be loaded with
+ * ast_load ()
+ */
+MD *
+md_concat (MD     **parts,
+           size_t   n_parts)
+{
+  MDUnit **tail;
+  MD *md;
+
+  md_init (&md);
+  tail = &md->elements;
+
+  for (size_t i = 0; i < n_parts; i++)
+    {
+      MD *part = parts[i];
+
+      *tail = part->elements;
+      for (MDUnit *unit = part->elements; unit != NULL; unit = unit->next)
         {
-          next->next = unit;
-          next = unit;
+          unit->part = i;
+          tail = &unit->next;
         }
 
-      n_lines++;
-    }
+      /* invalid UTF-8 is reported for each part, by its own offsets */
+      md->n_lines += part->n_lines;
+      md->n_bytes += part->n_bytes;
 
-  md->n_lines = n_lines;
+      /* one doc: a limit hit by a part is the doc's, and its time
+       * counts from the part parsed first */
+      if (md->limits.exceeded == LIMIT_NONE)
+        md->limits.exceeded = part->limits.exceeded;
+      if (part->limits.start_ms < md->limits.start_ms)
+        md->limits.start_ms = part->limits.start_ms;
+
+      footnotes_merge (md->notes, part->notes, i);
+      footnotes_free (part->notes);
+      free (part);
+    }
 
-  free (line);
   return md;
 }
 
@@ -406,15 +1051,19 @@ md_free (MD *md)
   while (unit != NULL)
     {
       next = unit->next;
-      /* free (unit->content); */
-      /* HTML takes ownership of the content */
+      /* NULL once html_from_md () took it */
+      if (unit->content != NULL && !unit->borrowed)
+        free (unit->content);
       if (unit->uri != NULL)
         free (unit->uri);
 
-      free (unit);
+      if (md->unit_block == NULL)
+        free (unit);
       unit = next;
     }
 
+  free (md->unit_block);
+
   footnotes_free (md->notes);
   free (md);
 }
@@ -0,0 +1,237 @@
+/* md2html.c
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+
+#include "md2html.h"
+#include "css.h"
+#include "html.h"
+#include "limit.h"
+#include "md.h"
+#include "template.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define INITIAL_PENDING_SIZE 16
+
+struct MD2HTML {
+  MDParser *parser;
+  HTML     *html;      /* options and footnotes; holds no units */
+  Output   *out;
+
+  bool      begun;     /* document head written */
+  HTMLUnit *prev;      /* last written unit */
+
+  /* parsed units that aren't written yet */
+  HTMLUnit **pending;
+  size_t     n_pending;
+  size_t     pending_size;
+};
+
+/*
+ * md2html_new
+ * @options: NULL for the defaults (document template, no stylesheet)
+ * @func: receives the HTML
+ * @user_data: passed to @func
+ * @error: set when NULL is returned
+ *
+ * returns NULL if the template can't be compiled or the stylesheet to
+ * inline can't be read, rather than falling back to the defaults
+ */
+MD2HTML *
+md2html_new (const MD2HTMLOptions *options,
+             MD2HTMLFunc           func,
+             void                 *user_data,
+             const char          **error)
+{
+  MD2HTML *ctx;
+  Params params = { 0 };
+
+  params.document = true;
+
+  if (options != NULL)
+    {
+      params.title = (char *) options->title;
+      params.css_file = (char *) options->stylesheet;
+      params.inline_css = options->inline_css;
+      params.document = options->document;
+      params.template_file = (char *) options->template_file;
+      params.minify = options->minify;
+    }
+
+  if (params.template_file != NULL && params.document &&
+      template_get (params.template_file, error) == NULL)
+    return NULL;
+
+  if (params.css_file != NULL && params.inline_css)
+    {
+      size_t len;
+
+      if (css_inline (params.css_file, &len) == NULL)
+        {
+          *error = "cannot read stylesheet";
+          return NULL;
+        }
+    }
+
+  ctx = calloc (1, sizeof (MD2HTML));
+
+  ctx->parser = md_parser_new ();
+  ctx->html = html_new (&params, md_parser_get_md (ctx->parser));
+  ctx->out = output_new_func (func, user_data);
+
+  return ctx;
+}
+
+static void
+take_units (MD2HTML *ctx)
+{
+  MDUnit *md_unit;
+
+  while ((md_unit = md_parser_next_unit (ctx->parser)) != NULL)
+    {
+      if (ctx->n_pending == ctx->pending_size)
+        {
+          ctx->pending_size = ctx->pending_size ? ctx->pending_size << 1
+                                                : INITIAL_PENDING_SIZE;
+          ctx->pending = realloc (ctx->pending,
+                                  sizeof (HTMLUnit *) * ctx->pending_size);
+        }
+
+      /* the content moves to the HTML unit */
+      ctx->pending[ctx->n_pending++] = html_unit_new (md_unit);
+      free (md_unit);
+    }
+}
+
+/*
+ * write_ready
+ * @ctx
+ * @finished: the whole doc is parsed; write everything
+ */
+static void
+write_ready (MD2HTML *ctx,
+             bool     finished)
+{
+  size_t i;
+
+  for (i = 0; i < ctx->n_pending; i++)
+    {
+      HTMLUnit *unit = ctx->pending[i];
+      HTMLUnit *next = i + 1 < ctx->n_pending ? ctx->pending[i + 1] : NULL;
+
+      if (ctx->html->limits->exceeded != LIMIT_NONE || !limit_check_time (ctx->html->limits))
+        break;
+
+      if (!finished &&
+          (next == NULL || !html_unit_is_resolved (unit, ctx->html->notes)))
+        break;
+
+      if (!ctx->begun)
+        {
+          html_write_begin (ctx->out, ctx->html, unit);
+          ctx->begun = true;
+        }
+
+      html_write_unit (ctx->out, ctx->html, ctx->prev, unit, next);
+
+      if (ctx->prev != NULL)
+        html_unit_free (ctx->prev);
+      ctx->prev = unit;
+
+      limit_check (ctx->html->limits, LIMIT_OUTPUT_BYTES, output_get_bytes (ctx->out));
+    }
+
+  /* pending is NULL until the first unit */
+  if (i > 0)
+    {
+      ctx->n_pending -= i;
+      memmove (ctx->pending, ctx->pending + i, sizeof (HTMLUnit *) * ctx->n_pending);
+    }
+
+  output_flush (ctx->out);
+}
+
+/*
+ * md2html_feed
+ * @ctx
+ * @buf: next piece of the doc; may end anywhere
+ * @len: size of @buf
+ *
+ * writes out the blocks that are complete
+ *
+ * returns false once a limit is hit; the output is incomplete then
+ */
+bool
+md2html_feed (MD2HTML    *ctx,
+              const char *buf,
+              size_t      len)
+{
+  md_parser_feed (ctx->parser, buf, len);
+
+  take_units (ctx);
+  write_ready (ctx, false);
+
+  return ctx->html->limits->exceeded == LIMIT_NONE;
+}
+
+/*
+ * md2html_finish
+ * @ctx
+ *
+ * ends the doc: writes the blocks held back and the footnotes
+ *
+ * returns false if a limit was hit
+ */
+bool
+md2html_finish (MD2HTML *ctx)
+{
+  md_parser_finish (ctx->parser);
+
+  take_units (ctx);
+  write_ready (ctx, true);
+
+  if (ctx->html->limits->exceeded != LIMIT_NONE)
+    return false;
+
+  if (!ctx->begun)
+    html_write_begin (ctx->out, ctx->html, NULL);
+
+  html_write_end (ctx->out, ctx->html);
+  output_flush (ctx->out);
+
+  return limit_check (ctx->html->limits, LIMIT_OUTPUT_BYTES, output_get_bytes (ctx->out));
+}
+
+void
+md2html_free (MD2HTML *ctx)
+{
+  for (size_t i = 0; i < ctx->n_pending; i++)
+    html_unit_free (ctx->pending[i]);
+
+  if (ctx->prev != NULL)
+    html_unit_free (ctx->prev);
+
+  free (ctx->pending);
+  output_free (ctx->out);
+  html_free (ctx->html);
+  md_parser_free (ctx->parser);
+  free (ctx);
+}
@@ -0,0 +1,996 @@
+/* ndjson.c
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "ndjson.h"
+#include "html.h"
+#include "limit.h"
+#include "stats.h"
+#include "strbuf.h"
+#include "trace.h"
+#include "utf8.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+/* requests in flight per worker: waiting, being converted or answered */
+#define NDJSON_JOBS_PER_WORKER 4
+
+/* buffers grown past this by a big doc aren't kept for the next one */
+#define NDJSON_KEEP_MAX (1 << 20)
+
+/* nesting of the values that are skipped */
+#define NDJSON_MAX_DEPTH 64
+
+typedef struct {
+  const char *pos;
+  const char *end;
+  const char *error;
+  char message[128];  /* error, when it names something */
+} JsonReader;
+
+/*
+ * @NdjsonJob
+ *
+ * a request and its response; jobs go back to a free list once
+ * answered, and their buffers are reused for the next request
+ */
+typedef struct NdjsonJob {
+  StrBuf id;         /* raw JSON of the id; empty for null */
+  StrBuf md;         /* decoded markdown */
+  StrBuf title;      /* decoded options.title */
+  StrBuf key;        /* object key being read */
+  StrBuf html;
+  StrBuf response;   /* one line */
+
+  bool title_set;    /* options.title given: title, or none if null */
+  bool null_title;
+  bool document;
+  bool minify;
+
+  struct timespec queued;
+
+  struct NdjsonJob *next;  /* waiting, or free */
+} NdjsonJob;
+
+typedef struct {
+  Output *out;
+  Params *params;
+
+  pthread_mutex_t lock;
+  pthread_cond_t  queued;    /* there is a job to convert, or closing */
+  pthread_cond_t  freed;     /* a job is back on the free list */
+
+  NdjsonJob *head;           /* waiting, oldest first */
+  NdjsonJob *tail;
+  NdjsonJob *free_jobs;
+  size_t     n_jobs;         /* allocated */
+  size_t     max_jobs;
+  bool       closing;
+
+  pthread_mutex_t out_lock;  /* responses go out whole */
+} Ndjson;
+
+/*
+ * requests
+ */
+static bool
+fail (JsonReader *json,
+      const char *error)
+{
+  if (json->error == NULL)
+    json->error = error;
+
+  return false;
+}
+
+static void
+skip_space (JsonReader *json)
+{
+  while (json->pos < json->end &&
+         (*json->pos == ' ' || *json->pos == '\t' ||
+          *json->pos == '\n' || *json->pos == '\r'))
+    json->pos++;
+}
+
+/* consumes @c if it comes next */
+static bool
+next_is (JsonReader *json,
+         char        c)
+{
+  skip_space (json);
+
+  if (json->pos == json->end || *json->pos != c)
+    return false;
+
+  json->pos++;
+
+  return true;
+}
+
+static bool
+expect (JsonReader *json,
+        char        c)
+{
+  return next_is (json, c) || fail (json, "malformed JSON");
+}
+
+static bool
+read_literal (JsonReader *json,
+              const char *literal)
+{
+  size_t len = strlen (literal);
+
+  if ((size_t) (json->end - json->pos) < len || memcmp (json->pos, literal, len) != 0)
+    return fail (json, "malformed JSON");
+
+  json->pos += len;
+
+  return true;
+}
+
+static bool
+skip_digits (JsonReader *json)
+{
+  const char *start = json->pos;
+
+  while (json->pos < json->end && *json->pos >= '0' && *json->pos <= '9')
+    json->pos++;
+
+  return json->pos != start;
+}
+
+/* -? (0 | [1-9][0-9]*) (. [0-9]+)? ([eE] [+-]? [0-9]+)? */
+static bool
+read_number (JsonReader *json)
+{
+  if (json->pos < json->end && *json->pos == '-')
+    json->pos++;
+
+  if (json->pos < json->end && *json->pos == '0')
+    json->pos++;
+  else if (!skip_digits (json))
+    return fail (json, "malformed JSON");
+
+  if (json->pos < json->end && *json->pos == '.')
+    {
+      json->pos++;
+      if (!skip_digits (json))
+        return fail (json, "malformed JSON");
+    }
+
+  if (json->pos < json->end && (*json->pos == 'e' || *json->pos == 'E'))
+    {
+      json->pos++;
+      if (json->pos < json->end && (*json->pos == '+' || *json->pos == '-'))
+        json->pos++;
+      if (!skip_digits (json))
+        return fail (json, "malformed JSON");
+    }
+
+  return true;
+}
+
+static bool
+read_hex4 (JsonReader *json,
+           unsigned   *value)
+{
+  unsigned code = 0;
+
+  if (json->end - json->pos < 4)
+    return false;
+
+  for (int i = 0; i < 4; i++)
+    {
+      char c = json->pos[i];
+
+      if (c >= '0' && c <= '9')
+        code = code << 4 | (c - '0');
+      else if (c >= 'a' && c <= 'f')
+        code = code << 4 | (c - 'a' + 10);
+      else if (c >= 'A' && c <= 'F')
+        code = code << 4 | (c - 'A' + 10);
+      else
+        return false;
+    }
+
+  json->pos += 4;
+  *value = code;
+
+  return true;
+}
+
+static void
+append_utf8 (StrBuf   *buf,
+             unsigned  code)
+{
+  char s[4];
+  size_t n;
+
+  if (code < 0x80)
+    {
+      s[0] = code;
+      n = 1;
+    }
+  else if (code < 0x800)
+    {
+      s[0] = 0xC0 | code >> 6;
+      s[1] = 0x80 | (code & 0x3F);
+      n = 2;
+    }
+  else if (code < 0x10000)
+    {
+      s[0] = 0xE0 | code >> 12;
+      s[1] = 0x80 | (code >> 6 & 0x3F);
+      s[2] = 0x80 | (code & 0x3F);
+      n = 3;
+    }
+  else
+    {
+      s[0] = 0xF0 | code >> 18;
+      s[1] = 0x80 | (code >> 12 & 0x3F);
+      s[2] = 0x80 | (code >> 6 & 0x3F);
+      s[3] = 0x80 | (code & 0x3F);
+      n = 4;
+    }
+
+  strbuf_append_len (buf, s, n);
+}
+
+/*
+ * read_unicode_escape
+ * @json: right after \u
+ *
+ * returns the code point; unpaired surrogates and NUL, which would end
+ * the markdown early, become U+FFFD
+ */
+static bool
+read_unicode_escape (JsonReader *json,
+                     unsigned   *code)
+{
+  if (!read_hex4 (json, code))
+    return fail (json, "invalid escape in string");
+
+  if (*code >= 0xD800 && *code <= 0xDBFF)
+    {
+      const char *low_start = json->pos;
+      unsigned low;
+
+      if (json->end - json->pos >= 2 && json->pos[0] == '\\' && json->pos[1] == 'u')
+        {
+          json->pos += 2;
+          if (read_hex4 (json, &low) && low >= 0xDC00 && low <= 0xDFFF)
+            {
+              *code = 0x10000 + ((*code - 0xD800) << 10) + (low - 0xDC00);
+              return true;
+            }
+        }
+
+      /* read it again on its own */
+      json->pos = low_start;
+      *code = 0xFFFD;
+    }
+  else if ((*code >= 0xDC00 && *code <= 0xDFFF) || *code == 0)
+    {
+      *code = 0xFFFD;
+    }
+
+  return true;
+}
+
+/*
+ * read_string
+ * @json
+ * @buf: gets the decoded string; NULL to skip it
+ */
+static bool
+read_string (JsonReader *json,
+             StrBuf     *buf)
+{
+  if (!next_is (json, '"'))
+    return fail (json, "expected a string");
+
+  while (true)
+    {
+      const char *run = json->pos;
+      unsigned code;
+      char c;
+
+      while (json->pos < json->end && *json->pos != '"' && *json->pos != '\\' &&
+             (unsigned char) *json->pos >= 0x20)
+        json->pos++;
+
+      if (buf != NULL)
+        strbuf_append_len (buf, run, json->pos - run);
+
+      if (json->pos == json->end)
+        return fail (json, "unterminated string");
+
+      c = *json->pos++;
+      if (c == '"')
+        return true;
+      else if (c != '\\')
+        return fail (json, "control character in string");
+
+      if (json->pos == json->end)
+        return fail (json, "unterminated string");
+
+      switch (c = *json->pos++)
+        {
+          case '"':
+          case '\\':
+          case '/':
+            break;
+          case 'b':
+            c = '\b';
+            break;
+          case 'f':
+            c = '\f';
+            break;
+          case 'n':
+            c = '\n';
+            break;
+          case 'r':
+            c = '\r';
+            break;
+          case 't':
+            c = '\t';
+            break;
+          case 'u':
+            if (!read_unicode_escape (json, &code))
+              return false;
+            if (buf != NULL)
+              append_utf8 (buf, code);
+            continue;
+          default:
+            return fail (json, "invalid escape in string");
+        }
+
+      if (buf != NULL)
+        strbuf_append_c (buf, c);
+    }
+}
+
+static bool
+skip_value (JsonReader *json,
+            int         depth)
+{
+  skip_space (json);
+
+  if (json->pos == json->end)
+    return fail (json, "malformed JSON");
+  if (depth > NDJSON_MAX_DEPTH)
+    return fail (json, "JSON nested too deep");
+
+  switch (*json->pos)
+    {
+      case '"':
+        return read_string (json, NULL);
+      case '{':
+      case '[':
+        {
+          char close = *json->pos++ == '{' ? '}' : ']';
+
+          if (next_is (json, close))
+            return true;
+
+          do
+            {
+              if (close == '}' && (!read_string (json, NULL) || !expect (json, ':')))
+                return false;
+              if (!skip_value (json, depth + 1))
+                return false;
+            }
+          while (next_is (json, ','));
+
+          return expect (json, close);
+        }
+      case 't':
+        return read_literal (json, "true");
+      case 'f':
+        return read_literal (json, "false");
+      case 'n':
+        return read_literal (json, "null");
+      default:
+        return read_number (json);
+    }
+}
+
+static bool
+read_bool (JsonReader *json,
+           bool       *value)
+{
+  skip_space (json);
+
+  if (json->pos < json->end && *json->pos == 't')
+    *value = true;
+  else if (json->pos < json->end && *json->pos == 'f')
+    *value = false;
+  else
+    return fail (json, "expected true or false");
+
+  return read_literal (json, *value ? "true" : "false");
+}
+
+/* keeps the buffer for the next request, unless a big doc grew it */
+static void
+reuse_buf (StrBuf *buf)
+{
+  if (buf->size > NDJSON_KEEP_MAX)
+    {
+      strbuf_free (buf);
+      strbuf_init (buf, 0);
+    }
+
+  buf->len = 0;
+  buf->str[0] = '\0';
+}
+
+static bool
+read_options (JsonReader *json,
+              NdjsonJob  *job)
+{
+  if (!expect (json, '{'))
+    return false;
+  if (next_is (json, '}'))
+    return true;
+
+  do
+    {
+      reuse_buf (&job->key);
+      if (!read_string (json, &job->key) || !expect (json, ':'))
+        return false;
+
+      if (strcmp (job->key.str, "title") == 0)
+        {
+          skip_space (json);
+          reuse_buf (&job->title);
+          job->title_set = true;
+          job->null_title = json->pos < json->end && *json->pos == 'n';
+
+          if (job->null_title ? !read_literal (json, "null")
+                              : !read_string (json, &job->title))
+            return false;
+        }
+      else if (strcmp (job->key.str, "document") == 0)
+        {
+          if (!read_bool (json, &job->document))
+            return false;
+        }
+      else if (strcmp (job->key.str, "minify") == 0)
+        {
+          if (!read_bool (json, &job->minify))
+            return false;
+        }
+      else
+        {
+          /* unlike other keys: a typo would change the output silently */
+          snprintf (json->message, sizeof (json->message), "unknown option '%.64s'",
+                    job->key.str);
+          return fail (json, json->message);
+        }
+    }
+  while (next_is (json, ','));
+
+  return expect (json, '}');
+}
+
+/*
+ * read_request
+ * @json: over one line
+ * @job: gets the request
+ * @params: defaults of the options
+ *
+ * keys other than id, markdown and options are ignored
+ */
+static bool
+read_request (JsonReader *json,
+              NdjsonJob  *job,
+              Params     *params)
+{
+  bool has_md = false;
+
+  reuse_buf (&job->id);
+  job->title_set = job->null_title = false;
+  job->document = params->document;
+  job->minify = params->minify;
+
+  if (!expect (json, '{'))
+    return false;
+
+  if (!next_is (json, '}'))
+    {
+      do
+        {
+          reuse_buf (&job->key);
+          if (!read_string (json, &job->key) || !expect (json, ':'))
+            return false;
+
+          if (strcmp (job->key.str, "id") == 0)
+            {
+              const char *start;
+
+              skip_space (json);
+              start = json->pos;
+              if (!skip_value (json, 0))
+                return false;
+
+              reuse_buf (&job->id);
+              strbuf_append_len (&job->id, start, json->pos - start);
+            }
+          else if (strcmp (job->key.str, "markdown") == 0)
+            {
+              reuse_buf (&job->md);
+              if (!read_string (json, &job->md))
+                return false;
+              has_md = true;
+            }
+          else if (strcmp (job->key.str, "options") == 0)
+            {
+              if (!read_options (json, job))
+                return false;
+            }
+          else if (!skip_value (json, 0))
+            {
+              return false;
+            }
+        }
+      while (next_is (json, ','));
+
+      if (!expect (json, '}'))
+        return false;
+    }
+
+  skip_space (json);
+  if (json->pos != json->end)
+    return fail (json, "malformed JSON");
+
+  return has_md || fail (json, "no markdown");
+}
+
+/*
+ * responses
+ */
+static void
+append_json_string (StrBuf     *buf,
+                    const char *str,
+                    size_t      len)
+{
+  static const char hex[] = "0123456789abcdef";
+  size_t i = 0;
+
+  strbuf_grow (buf, len + 2);
+  strbuf_append_c (buf, '"');
+
+  while (i < len)
+    {
+      size_t run = i;
+      unsigned char c;
+
+      while (i < len && (c = str[i]) >= 0x20 && c < 0x80 && c != '"' && c != '\\')
+        i++;
+
+      strbuf_append_len (buf, str + run, i - run);
+      if (i == len)
+        break;
+
+      c = str[i];
+      if (c >= 0x80)
+        {
+          size_t n = utf8_sequence_length (str + i, len - i);
+
+          /* the response has to be UTF-8 */
+          if (n == 0)
+            {
+              strbuf_append (buf, "\\ufffd");
+              n = 1;
+            }
+          else
+            {
+              strbuf_append_len (buf, str + i, n);
+            }
+
+          i += n;
+          continue;
+        }
+
+      switch (c)
+        {
+          case '"':
+            strbuf_append (buf, "\\\"");
+            break;
+          case '\\':
+            strbuf_append (buf, "\\\\");
+            break;
+          case '\n':
+            strbuf_append (buf, "\\n");
+            break;
+          case '\t':
+            strbuf_append (buf, "\\t");
+            break;
+          case '\r':
+            strbuf_append (buf, "\\r");
+            break;
+          default:
+            {
+              char escape[] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF] };
+
+              strbuf_append_len (buf, escape, sizeof (escape));
+            }
+            break;
+        }
+
+      i++;
+    }
+
+  strbuf_append_c (buf, '"');
+}
+
+static void
+begin_response (NdjsonJob *job)
+{
+  reuse_buf (&job->response);
+
+  strbuf_append (&job->response, "{\"id\":");
+  if (job->id.len != 0)
+    strbuf_append_len (&job->response, job->id.str, job->id.len);
+  else
+    strbuf_append (&job->response, "null");
+}
+
+static void
+error_response (NdjsonJob  *job,
+                const char *error)
+{
+  begin_response (job);
+  strbuf_append (&job->response, ",\"error\":");
+  append_json_string (&job->response, error, strlen (error));
+  strbuf_append (&job->response, "}\n");
+}
+
+static double
+elapsed_ms (const struct timespec *from,
+            const struct timespec *to)
+{
+  return (to->tv_sec - from->tv_sec) * 1e3 + (to->tv_nsec - from->tv_nsec) / 1e6;
+}
+
+/*
+ * conversion
+ */
+static void
+append_html (const char *buf,
+             size_t      len,
+             void       *user_data)
+{
+  strbuf_append_len (user_data, buf, len);
+}
+
+/* runs on a worker */
+static void
+convert_job (Ndjson    *ndjson,
+             NdjsonJob *job)
+{
+  Params params = *ndjson->params;
+  struct timespec start, parsed, rendered;
+  char timing[128];
+  StatsTimer timer;
+  TraceSpan span;
+  Limit limit;
+  MD *md;
+
+  clock_gettime (CLOCK_MONOTONIC, &start);
+
+  params.document = job->document;
+  params.minify = job->minify;
+  if (job->title_set)
+    params.title = job->null_title ? NULL : job->title.str;
+
+  stats_timer_start (&timer);
+  trace_begin (&span);
+  md = parse_md_buffer (job->md.str, job->md.len);
+  trace_end (&span, "parse_md");
+  stats_timer_stop (&timer, STATS_STAGE_PARSE);
+  stats_count_md (md);
+
+  clock_gettime (CLOCK_MONOTONIC, &parsed);
+
+  reuse_buf (&job->html);
+
+  if (md->limits.exceeded == LIMIT_NONE)
+    {
+      HTML *html;
+      Output *out;
+
+      stats_timer_start (&timer);
+      trace_begin (&span);
+      html = html_from_md (md, &params);
+      trace_end (&span, "html_from_md");
+      stats_timer_stop (&timer, STATS_STAGE_HTML);
+
+      stats_timer_start (&timer);
+      trace_begin (&span);
+      out = output_new_func (append_html, &job->html);
+      html_write (html, out);
+      output_free (out);
+      trace_end (&span, "flush_html");
+      stats_timer_stop (&timer, STATS_STAGE_FLUSH);
+
+      html_free (html);
+    }
+
+  limit = md->limits.exceeded;
+
+  /* units may point into the markdown */
+  md_free (md);
+
+  clock_gettime (CLOCK_MONOTONIC, &rendered);
+
+  /* only this request fails; the stream goes on */
+  if (limit != LIMIT_NONE)
+    {
+      char error[64];
+
+      snprintf (error, sizeof (error), "%s limit exceeded", limit_name (limit));
+      error_response (job, error);
+      return;
+    }
+
+  begin_response (job);
+  strbuf_append (&job->response, ",\"html\":");
+  append_json_string (&job->response, job->html.str, job->html.len);
+
+  snprintf (timing, sizeof (timing),
+            ",\"timing_ms\":{\"queue\":%.3f,\"parse\":%.3f,\"render\":%.3f}}\n",
+            elapsed_ms (&job->queued, &start), elapsed_ms (&start, &parsed),
+            elapsed_ms (&parsed, &rendered));
+  strbuf_append (&job->response, timing);
+}
+
+static void
+respond (Ndjson    *ndjson,
+         NdjsonJob *job)
+{
+  bool idle;
+
+  pthread_mutex_lock (&ndjson->lock);
+  idle = ndjson->head == NULL;
+  pthread_mutex_unlock (&ndjson->lock);
+
+  /* while requests wait, whoever answers the last of them flushes */
+  pthread_mutex_lock (&ndjson->out_lock);
+  output_write (ndjson->out, job->response.str, job->response.len);
+  if (idle)
+    output_flush (ndjson->out);
+  pthread_mutex_unlock (&ndjson->out_lock);
+}
+
+static void
+release_job (Ndjson    *ndjson,
+             NdjsonJob *job)
+{
+  pthread_mutex_lock (&ndjson->lock);
+  job->next = ndjson->free_jobs;
+  ndjson->free_jobs = job;
+  pthread_cond_signal (&ndjson->freed);
+  pthread_mutex_unlock (&ndjson->lock);
+}
+
+static void *
+worker (void *user_data)
+{
+  Ndjson *ndjson = user_data;
+
+  pthread_mutex_lock (&ndjson->lock);
+
+  while (true)
+    {
+      NdjsonJob *job;
+
+      while (ndjson->head == NULL && !ndjson->closing)
+        pthread_cond_wait (&ndjson->queued, &ndjson->lock);
+
+      job = ndjson->head;
+      if (job == NULL)
+        break;
+
+      ndjson->head = job->next;
+      if (ndjson->head == NULL)
+        ndjson->tail = NULL;
+
+      pthread_mutex_unlock (&ndjson->lock);
+      convert_job (ndjson, job);
+      respond (ndjson, job);
+      release_job (ndjson, job);
+      pthread_mutex_lock (&ndjson->lock);
+    }
+
+  pthread_mutex_unlock (&ndjson->lock);
+
+  return NULL;
+}
+
+/* waits until fewer than max_jobs requests are in flight */
+static NdjsonJob *
+get_job (Ndjson *ndjson)
+{
+  NdjsonJob *job;
+
+  pthread_mutex_lock (&ndjson->lock);
+
+  while (ndjson->free_jobs == NULL && ndjson->n_jobs == ndjson->max_jobs)
+    pthread_cond_wait (&ndjson->freed, &ndjson->lock);
+
+  job = ndjson->free_jobs;
+  if (job != NULL)
+    ndjson->free_jobs = job->next;
+  else
+    ndjson->n_jobs++;
+
+  pthread_mutex_unlock (&ndjson->lock);
+
+  if (job == NULL)
+    {
+      job = calloc (1, sizeof (NdjsonJob));
+      strbuf_init (&job->id, 0);
+      strbuf_init (&job->md, 0);
+      strbuf_init (&job->title, 0);
+      strbuf_init (&job->key, 0);
+      strbuf_init (&job->html, 0);
+      strbuf_init (&job->response, 0);
+    }
+
+  return job;
+}
+
+static void
+queue_job (Ndjson    *ndjson,
+           NdjsonJob *job)
+{
+  pthread_mutex_lock (&ndjson->lock);
+
+  job->next = NULL;
+  if (ndjson->tail != NULL)
+    ndjson->tail->next = job;
+  else
+    ndjson->head = job;
+  ndjson->tail = job;
+
+  pthread_cond_signal (&ndjson->queued);
+  pthread_mutex_unlock (&ndjson->lock);
+}
+
+static void
+job_free (NdjsonJob *job)
+{
+  strbuf_free (&job->id);
+  strbuf_free (&job->md);
+  strbuf_free (&job->title);
+  strbuf_free (&job->key);
+  strbuf_free (&job->html);
+  strbuf_free (&job->response);
+  free (job);
+}
+
+/*
+ * ndjson_convert
+ * @in: requests, a line each
+ * @out: gets the responses
+ * @params: defaults of the request options, and params->jobs
+ * @error: set when false is returned
+ *
+ * requests are converted by params->jobs threads (online CPUs if 0);
+ * reading waits while a few per thread are in flight.  A request that
+ * can't be read gets an error response.  Limits apply to each request,
+ * with its own clock; one that exceeds a limit gets an error response too
+ */
+bool
+ndjson_convert (FILE        *in,
+                Output      *out,
+                Params      *params,
+                const char **error)
+{
+  Ndjson ndjson = {
+    .out = out,
+    .params = params,
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .queued = PTHREAD_COND_INITIALIZER,
+    .freed = PTHREAD_COND_INITIALIZER,
+    .out_lock = PTHREAD_MUTEX_INITIALIZER,
+  };
+  size_t n_workers = params->jobs;
+  pthread_t *workers;
+  char *line = NULL;
+  size_t line_size = 0;
+  ssize_t len;
+  bool ok = true;
+
+  if (n_workers == 0)
+    {
+      long n = sysconf (_SC_NPROCESSORS_ONLN);
+
+      n_workers = n > 0 ? (size_t) n : 1;
+    }
+
+  ndjson.max_jobs = n_workers * NDJSON_JOBS_PER_WORKER;
+
+  workers = calloc (n_workers, sizeof (pthread_t));
+  for (size_t i = 0; i < n_workers; i++)
+    pthread_create (&workers[i], NULL, worker, &ndjson);
+
+  while ((len = getline (&line, &line_size, in)) != -1)
+    {
+      JsonReader json = { .pos = line, .end = line + len };
+      NdjsonJob *job;
+
+      /* blank lines aren't requests */
+      if (strspn (line, " \t\r\n") == (size_t) len)
+        continue;
+
+      job = get_job (&ndjson);
+      clock_gettime (CLOCK_MONOTONIC, &job->queued);
+
+      if (read_request (&json, job, params))
+        {
+          queue_job (&ndjson, job);
+        }
+      else
+        {
+          error_response (job, json.error);
+          respond (&ndjson, job);
+          release_job (&ndjson, job);
+        }
+    }
+
+  if (ferror (in))
+    {
+      *error = strerror (errno);
+      ok = false;
+    }
+
+  pthread_mutex_lock (&ndjson.lock);
+  ndjson.closing = true;
+  pthread_cond_broadcast (&ndjson.queued);
+  pthread_mutex_unlock (&ndjson.lock);
+
+  for (size_t i = 0; i < n_workers; i++)
+    pthread_join (workers[i], NULL);
+
+  while (ndjson.free_jobs != NULL)
+    {
+      NdjsonJob *job = ndjson.free_jobs;
+
+      ndjson.free_jobs = job->next;
+      job_free (job);
+    }
+
+  pthread_mutex_destroy (&ndjson.lock);
+  pthread_cond_destroy (&ndjson.queued);
+  pthread_cond_destroy (&ndjson.freed);
+  pthread_mutex_destroy (&ndjson.out_lock);
+  free (workers);
+  free (line);
+
+  return ok;
+}
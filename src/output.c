@@ -0,0 +1,334 @@
+/* output.c
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "output.h"
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#define OUTPUT_CHUNK_SIZE (64 * 1024)
+#define OUTPUT_MAX_IOV    64
+
+/* shorter regions are cheaper to copy than to give their own iovec */
+#define OUTPUT_REF_MIN    4096
+
+#define OUTPUT_MAX_TEES   4
+
+struct Output {
+  int fd;
+
+  /* instead of fd */
+  OutputFunc  func;
+  void       *user_data;
+
+  /* see the flushed bytes too, see output_tee () */
+  struct {
+    OutputFunc  func;
+    void       *user_data;
+  } tees[OUTPUT_MAX_TEES];
+  int n_tees;
+
+  /* copied bytes */
+  char   *chunk;
+  size_t  chunk_len;
+
+  /* pending batch; points into chunk or into caller memory */
+  struct iovec iov[OUTPUT_MAX_IOV];
+  int n_iov;
+
+  size_t n_bytes; /* total bytes accepted */
+  bool   error;
+};
+
+
+Output *
+output_new (int fd)
+{
+  Output *out;
+
+  out = calloc (1, sizeof (Output));
+
+  out->fd = fd;
+  out->chunk = malloc (OUTPUT_CHUNK_SIZE);
+  out->chunk_len = 0;
+  out->n_iov = 0;
+  out->n_bytes = 0;
+  out->error = false;
+
+  return out;
+}
+
+/*
+ * output_new_func
+ * @func: receives every flushed region, in order
+ * @user_data: passed to @func
+ *
+ * same as output_new (), but hands the bytes to @func instead of
+ * writing them to a file descriptor
+ */
+Output *
+output_new_func (OutputFunc  func,
+                 void       *user_data)
+{
+  Output *out;
+
+  out = output_new (-1);
+  out->func = func;
+  out->user_data = user_data;
+
+  return out;
+}
+
+/*
+ * output_tee
+ * @out
+ * @func: also receives every flushed region, in order, e.g. an encoder
+ * @user_data: passed to @func
+ *
+ * at most OUTPUT_MAX_TEES; returns false if there are that many already
+ */
+bool
+output_tee (Output     *out,
+            OutputFunc  func,
+            void       *user_data)
+{
+  if (out->n_tees == OUTPUT_MAX_TEES)
+    return false;
+
+  out->tees[out->n_tees].func = func;
+  out->tees[out->n_tees].user_data = user_data;
+  out->n_tees++;
+
+  return true;
+}
+
+/*
+ * output_flush
+ * @out
+ *
+ * writes the pending batch; referenced memory may be released afterwards
+ */
+bool
+output_flush (Output *out)
+{
+  struct iovec *iov = out->iov;
+  int n_iov = out->n_iov;
+
+  /* before writev (), which may move the iovecs */
+  for (int t = 0; t < out->n_tees; t++)
+    {
+      for (int i = 0; i < n_iov; i++)
+        out->tees[t].func (iov[i].iov_base, iov[i].iov_len, out->tees[t].user_data);
+    }
+
+  if (out->func != NULL)
+    {
+      for (int i = 0; i < n_iov; i++)
+        out->func (iov[i].iov_base, iov[i].iov_len, out->user_data);
+
+      n_iov = 0;
+    }
+
+  while (n_iov > 0 && !out->error)
+    {
+      ssize_t written;
+
+      written = writev (out->fd, iov, n_iov);
+
+      if (written < 0)
+        {
+          if (errno != EINTR)
+            out->error = true;
+          continue;
+        }
+
+      /* skip what made it out; partial writes resume mid-iovec */
+      while (n_iov > 0 && (size_t) written >= iov->iov_len)
+        {
+          written -= iov->iov_len;
+          iov++;
+          n_iov--;
+        }
+
+      if (n_iov > 0)
+        {
+          iov->iov_base = (char *) iov->iov_base + written;
+          iov->iov_len -= written;
+        }
+    }
+
+  out->n_iov = 0;
+  out->chunk_len = 0;
+
+  return !out->error;
+}
+
+/*
+ * output_write_ref
+ * @out
+ * @str: must stay valid until the next output_flush ()
+ * @len
+ *
+ * queues @str without copying it
+ */
+void
+output_write_ref (Output     *out,
+                  const char *str,
+                  size_t      len)
+{
+  if (len < OUTPUT_REF_MIN)
+    {
+      output_write (out, str, len);
+      return;
+    }
+
+  if (out->n_iov == OUTPUT_MAX_IOV)
+    output_flush (out);
+
+  out->iov[out->n_iov].iov_base = (void *) str;
+  out->iov[out->n_iov].iov_len = len;
+  out->n_iov++;
+
+  out->n_bytes += len;
+}
+
+/*
+ * output_write
+ * @out
+ * @str: may be released once this returns
+ * @len
+ */
+void
+output_write (Output     *out,
+              const char *str,
+              size_t      len)
+{
+  if (len >= OUTPUT_REF_MIN)
+    {
+      /* big enough to skip the copy, but it has to go out now */
+      output_write_ref (out, str, len);
+      output_flush (out);
+      return;
+    }
+
+  while (len > 0)
+    {
+      struct iovec *last = NULL;
+      bool extend = false;
+      size_t n;
+
+      if (out->n_iov > 0)
+        {
+          last = &out->iov[out->n_iov - 1];
+          extend = (char *) last->iov_base + last->iov_len == out->chunk + out->chunk_len;
+        }
+
+      if (out->chunk_len == OUTPUT_CHUNK_SIZE ||
+          (!extend && out->n_iov == OUTPUT_MAX_IOV))
+        {
+          output_flush (out);
+          extend = false;
+        }
+
+      n = OUTPUT_CHUNK_SIZE - out->chunk_len;
+      if (n > len)
+        n = len;
+
+      memcpy (out->chunk + out->chunk_len, str, n);
+
+      if (extend)
+        {
+          last->iov_len += n;
+        }
+      else
+        {
+          out->iov[out->n_iov].iov_base = out->chunk + out->chunk_len;
+          out->iov[out->n_iov].iov_len = n;
+          out->n_iov++;
+        }
+
+      out->chunk_len += n;
+      out->n_bytes += n;
+      str += n;
+      len -= n;
+    }
+}
+
+void
+output_printf (Output     *out,
+               const char *format,
+               ...)
+{
+  char buf[512];
+  char *str = buf;
+  va_list args;
+  int len;
+
+  va_start (args, format);
+  len = vsnprintf (buf, sizeof (buf), format, args);
+  va_end (args);
+
+  if (len < 0)
+    return;
+
+  if ((size_t) len >= sizeof (buf))
+    {
+      str = malloc (len + 1);
+
+      va_start (args, format);
+      vsnprintf (str, len + 1, format, args);
+      va_end (args);
+    }
+
+  output_write (out, str, len);
+
+  if (str != buf)
+    free (str);
+}
+
+size_t
+output_get_bytes (Output *out)
+{
+  return out->n_bytes;
+}
+
+/*
+ * output_free
+ * @out
+ *
+ * flushes and releases @out; returns false if any write failed
+ */
+bool
+output_free (Output *out)
+{
+  bool ret;
+
+  ret = output_flush (out);
+
+  free (out->chunk);
+  free (out);
+
+  return ret;
+}
@@ -31,6 +31,36 @@ params_init (Params **params)
   *params = (Params*) malloc (sizeof(Params));
 
   (*params)->document = true;
+  (*params)->template_file = NULL;
+  (*params)->minify = false;
+  (*params)->stats = STATS_FORMAT_NONE;
+  (*params)->trace_file = NULL;
+  memset ((*params)->limits, 0, sizeof ((*params)->limits));
+  (*params)->formats = NULL;
+  (*params)->n_formats = 0;
+  (*params)->ast_file = NULL;
+  (*params)->from_ast = false;
+  (*params)->index_file = NULL;
+  (*params)->image_sizes = false;
+  (*params)->image_cache = NULL;
+  (*params)->inline_css = false;
+  (*params)->css_cache = NULL;
+  memset ((*params)->compress_levels, 0, sizeof ((*params)->compress_levels));
+  (*params)->zstd_dict = NULL;
+  (*params)->tar = false;
+  (*params)->ndjson = false;
+  (*params)->preview_port = -1;
+  (*params)->jobs = 0;
+  (*params)->book_inputs = NULL;
+  (*params)->n_book_inputs = 0;
+  (*params)->check_inputs = NULL;
+  (*params)->n_check_inputs = 0;
+  (*params)->merge_file = NULL;
+  (*params)->merge_inputs = NULL;
+  (*params)->n_merge_inputs = 0;
+  (*params)->train_file = NULL;
+  (*params)->train_inputs = NULL;
+  (*params)->n_train_inputs = 0;
   (*params)->version = false;
   (*params)->help = false;
   (*params)->error = NULL;
@@ -45,7 +75,38 @@ params_parse (int   argc,
   char *o_file = NULL;
   char *title = NULL;
   char *css_file = NULL;
+  bool inline_css = false;
+  char *css_cache = NULL;
+  char *trace_file = NULL;
   bool document = true;
+  char *template_file = NULL;
+  bool minify = false;
+  StatsFormat stats = STATS_FORMAT_NONE;
+  uint64_t limits[N_LIMITS] = {};
+  bool limited = false;
+  char **formats = NULL;
+  size_t n_formats = 0;
+  char *ast_file = NULL;
+  bool from_ast = false;
+  char *index_file = NULL;
+  bool image_sizes = false;
+  char *image_cache = NULL;
+  int compress_levels[N_COMPRESS_CODECS] = {};
+  char *zstd_dict = NULL;
+  bool tar = false;
+  bool ndjson = false;
+  int preview_port = -1;
+  size_t jobs = 0;
+  char **book_inputs = NULL;
+  size_t n_book_inputs = 0;
+  char **check_inputs = NULL;
+  size_t n_check_inputs = 0;
+  char *merge_file = NULL;
+  char **merge_inputs = NULL;
+  size_t n_merge_inputs = 0;
+  char *train_file = NULL;
+  char **train_inputs = NULL;
+  size_t n_train_inputs = 0;
   bool help = false;
   bool version = false;
   char error[1000] = {};
@@ -110,6 +171,276 @@ params_parse (int   argc,
         {
           document = false;
         }
+      else if (strcmp (argv[i], "--template") == 0)
+        {
+          if (argv[i + 1] != NULL)
+            {
+              template_file = strdup (argv[++i]);
+            }
+          else
+            {
+              sprintf (error, "operand missing after '%s'", argv[i]);
+              break;
+            }
+        }
+      else if (strcmp (argv[i], "--minify") == 0)
+        {
+          minify = true;
+        }
+      else if (strcmp (argv[i], "--stats") == 0)
+        {
+          stats = STATS_FORMAT_TEXT;
+        }
+      else if (strcmp (argv[i], "--stats=json") == 0)
+        {
+          stats = STATS_FORMAT_JSON;
+        }
+      else if (strcmp (argv[i], "--trace") == 0)
+        {
+          if (argv[i + 1] != NULL)
+            {
+              trace_file = strdup (argv[++i]);
+            }
+          else
+            {
+              sprintf (error, "operand missing after '%s'", argv[i]);
+              break;
+            }
+        }
+      else if (strcmp (argv[i], "--limit") == 0)
+        {
+          Limit limit;
+          uint64_t value;
+
+          if (argv[i + 1] == NULL)
+            {
+              sprintf (error, "operand missing after '%s'", argv[i]);
+              break;
+            }
+          else if (!limit_parse (argv[++i], &limit, &value))
+            {
+              snprintf (error, sizeof (error), "invalid limit '%s'", argv[i]);
+              break;
+            }
+
+          limits[limit] = value;
+          limited = true;
+        }
+      else if ((strcmp (argv[i], "-f") == 0) ||
+               (strcmp (argv[i], "--format") == 0))
+        {
+          if (argv[i + 1] != NULL)
+            {
+              formats = realloc (formats, sizeof (char *) * (n_formats + 1));
+              formats[n_formats++] = strdup (argv[++i]);
+            }
+          else
+            {
+              sprintf (error, "operand missing after '%s'", argv[i]);
+              break;
+            }
+        }
+      else if (strcmp (argv[i], "--emit-ast") == 0)
+        {
+          if (argv[i + 1] != NULL)
+            {
+              ast_file = strdup (argv[++i]);
+            }
+          else
+            {
+              sprintf (error, "operand missing after '%s'", argv[i]);
+              break;
+            }
+        }
+      else if (strcmp (argv[i], "--from-ast") == 0)
+        {
+          from_ast = true;
+        }
+      else if (strcmp (argv[i], "--index") == 0)
+        {
+          if (argv[i + 1] != NULL)
+            {
+              index_file = strdup (argv[++i]);
+            }
+          else
+            {
+              sprintf (error, "operand missing after '%s'", argv[i]);
+              break;
+            }
+        }
+      else if (strcmp (argv[i], "--image-sizes") == 0)
+        {
+          image_sizes = true;
+        }
+      else if (strcmp (argv[i], "--image-cache") == 0)
+        {
+          if (argv[i + 1] != NULL)
+            {
+              image_sizes = true;
+              image_cache = strdup (argv[++i]);
+            }
+          else
+            {
+              sprintf (error, "operand missing after '%s'", argv[i]);
+              break;
+            }
+        }
+      else if ((strcmp (argv[i], "-z") == 0) ||
+               (strcmp (argv[i], "--compress") == 0))
+        {
+          CompressCodec codec;
+          int level;
+
+          if (argv[i + 1] == NULL)
+            {
+              sprintf (error, "operand missing after '%s'", argv[i]);
+              break;
+            }
+          else if (!compress_parse (argv[++i], &codec, &level))
+            {
+              snprintf (error, sizeof (error), "invalid compression '%s'", argv[i]);
+              break;
+            }
+
+          compress_levels[codec] = level;
+        }
+      else if (strcmp (argv[i], "--zstd-dict") == 0)
+        {
+          if (argv[i + 1] != NULL)
+            {
+              zstd_dict = strdup (argv[++i]);
+            }
+          else
+            {
+              sprintf (error, "operand missing after '%s'", argv[i]);
+              break;
+            }
+        }
+      else if (strcmp (argv[i], "--tar") == 0)
+        {
+          tar = true;
+        }
+      else if (strcmp (argv[i], "--ndjson") == 0)
+        {
+          ndjson = true;
+        }
+      else if (strcmp (argv[i], "--preview-server") == 0)
+        {
+          char *end = NULL;
+          long port;
+
+          if (argv[i + 1] == NULL)
+            {
+              sprintf (error, "operand missing after '%s'", argv[i]);
+              break;
+            }
+
+          port = strtol (argv[++i], &end, 10);
+          if (end == argv[i] || *end != '\0' || port < 0 || port > 65535)
+            {
+              snprintf (error, sizeof (error), "invalid port '%s'", argv[i]);
+              break;
+            }
+
+          preview_port = port;
+        }
+      else if ((strcmp (argv[i], "-j") == 0) ||
+               (strcmp (argv[i], "--jobs") == 0))
+        {
+          char *end = NULL;
+
+          if (argv[i + 1] == NULL)
+            {
+              sprintf (error, "operand missing after '%s'", argv[i]);
+              break;
+            }
+
+          jobs = strtoul (argv[++i], &end, 10);
+          if (end == argv[i] || *end != '\0' || jobs == 0 || jobs > 1024)
+            {
+              snprintf (error, sizeof (error), "invalid number of jobs '%s'", argv[i]);
+              break;
+            }
+        }
+      else if (strcmp (argv[i], "--book") == 0)
+        {
+          if (argv[i + 1] == NULL)
+            {
+              sprintf (error, "operand missing after '%s'", argv[i]);
+              break;
+            }
+
+          /* the rest of the arguments are the chapters */
+          for (i++; i < argc; i++)
+            {
+              book_inputs = realloc (book_inputs, sizeof (char *) * (n_book_inputs + 1));
+              book_inputs[n_book_inputs++] = strdup (argv[i]);
+            }
+        }
+      else if (strcmp (argv[i], "--check") == 0)
+        {
+          if (argv[i + 1] == NULL)
+            {
+              sprintf (error, "operand missing after '%s'", argv[i]);
+              break;
+            }
+
+          /* the rest of the arguments are the files to check */
+          for (i++; i < argc; i++)
+            {
+              check_inputs = realloc (check_inputs, sizeof (char *) * (n_check_inputs + 1));
+              check_inputs[n_check_inputs++] = strdup (argv[i]);
+            }
+        }
+      else if (strcmp (argv[i], "--train-zstd-dict") == 0)
+        {
+          if (argv[i + 1] == NULL)
+            {
+              sprintf (error, "operand missing after '%s'", argv[i]);
+              break;
+            }
+
+          /* the rest of the arguments are the samples */
+          train_file = strdup (argv[++i]);
+          for (i++; i < argc; i++)
+            {
+              train_inputs = realloc (train_inputs, sizeof (char *) * (n_train_inputs + 1));
+              train_inputs[n_train_inputs++] = strdup (argv[i]);
+            }
+        }
+      else if (strcmp (argv[i], "--merge-index") == 0)
+        {
+          if (argv[i + 1] == NULL)
+            {
+              sprintf (error, "operand missing after '%s'", argv[i]);
+              break;
+            }
+
+          /* the rest of the arguments are the indexes to merge */
+          merge_file = strdup (argv[++i]);
+          for (i++; i < argc; i++)
+            {
+              merge_inputs = realloc (merge_inputs, sizeof (char *) * (n_merge_inputs + 1));
+              merge_inputs[n_merge_inputs++] = strdup (argv[i]);
+            }
+        }
+      else if (strcmp (argv[i], "--inline-css") == 0)
+        {
+          inline_css = true;
+        }
+      else if (strcmp (argv[i], "--css-cache") == 0)
+        {
+          if (argv[i + 1] != NULL)
+            {
+              inline_css = true;
+              css_cache = strdup (argv[++i]);
+            }
+          else
+            {
+              sprintf (error, "operand missing after '%s'", argv[i]);
+              break;
+            }
+        }
       else if ((strcmp (argv[i], "-s") == 0) ||
                (strcmp (argv[i], "--stylesheet") == 0))
         {
@@ -120,8 +451,38 @@ params_parse (int   argc,
         }
     }
 
-  if (help == false && version == false && i_file == NULL)
+  if (help == false && version == false && merge_file == NULL &&
+      train_file == NULL && !tar && !ndjson && preview_port < 0 &&
+      n_book_inputs == 0 && n_check_inputs == 0 && i_file == NULL)
     sprintf (error, "missing input file");
+  else if (error[0] == '\0' && n_check_inputs != 0 &&
+           (i_file != NULL || o_file != NULL || tar || n_formats != 0 ||
+            from_ast || ast_file != NULL || index_file != NULL ||
+            compress_levels[COMPRESS_GZIP] != 0 || compress_levels[COMPRESS_ZSTD] != 0))
+    sprintf (error, "'--check' writes nothing; it doesn't go with -i, -o, -f, -z, --tar, --index or the AST options");
+  else if (error[0] == '\0' && n_book_inputs != 0 &&
+           (i_file != NULL || tar || from_ast || ast_file != NULL))
+    sprintf (error, "'--book' doesn't go with -i, --tar, --from-ast or --emit-ast");
+  else if (error[0] == '\0' && tar &&
+           (n_formats != 0 || ast_file != NULL || from_ast || index_file != NULL ||
+            image_sizes || compress_levels[COMPRESS_GZIP] != 0 ||
+            compress_levels[COMPRESS_ZSTD] != 0))
+    sprintf (error, "'--tar' only writes HTML members");
+  else if (error[0] == '\0' && ndjson &&
+           (tar || n_book_inputs != 0 || n_check_inputs != 0 || n_formats != 0 ||
+            ast_file != NULL || from_ast || index_file != NULL || image_sizes ||
+            compress_levels[COMPRESS_GZIP] != 0 || compress_levels[COMPRESS_ZSTD] != 0))
+    sprintf (error, "'--ndjson' only answers with HTML");
+  else if (error[0] == '\0' && preview_port >= 0 &&
+           (o_file != NULL || tar || ndjson || n_book_inputs != 0 || n_check_inputs != 0 ||
+            n_formats != 0 || ast_file != NULL || from_ast || index_file != NULL ||
+            image_sizes || compress_levels[COMPRESS_GZIP] != 0 ||
+            compress_levels[COMPRESS_ZSTD] != 0 || limited))
+    sprintf (error, "'--preview-server' only renders pages; it doesn't go with -o or '--limit'");
+  else if (error[0] == '\0' && inline_css && css_file == NULL)
+    sprintf (error, "'--inline-css' needs a stylesheet");
+  else if (error[0] == '\0' && template_file != NULL && !document)
+    sprintf (error, "'--template' wraps the document; it doesn't go with '-d'");
 
   if (error[0] == '\0')
     {
@@ -129,7 +490,37 @@ params_parse (int   argc,
       params->o_file = o_file;
       params->title = title;
       params->css_file = css_file;
+      params->inline_css = inline_css;
+      params->css_cache = css_cache;
       params->document = document;
+      params->template_file = template_file;
+      params->minify = minify;
+      params->stats = stats;
+      params->trace_file = trace_file;
+      memcpy (params->limits, limits, sizeof (limits));
+      params->formats = formats;
+      params->n_formats = n_formats;
+      params->ast_file = ast_file;
+      params->from_ast = from_ast;
+      params->index_file = index_file;
+      params->image_sizes = image_sizes;
+      params->image_cache = image_cache;
+      memcpy (params->compress_levels, compress_levels, sizeof (compress_levels));
+      params->zstd_dict = zstd_dict;
+      params->tar = tar;
+      params->ndjson = ndjson;
+      params->preview_port = preview_port;
+      params->jobs = jobs;
+      params->book_inputs = book_inputs;
+      params->n_book_inputs = n_book_inputs;
+      params->check_inputs = check_inputs;
+      params->n_check_inputs = n_check_inputs;
+      params->merge_file = merge_file;
+      params->merge_inputs = merge_inputs;
+      params->n_merge_inputs = n_merge_inputs;
+      params->train_file = train_file;
+      params->train_inputs = train_inputs;
+      params->n_train_inputs = n_train_inputs;
       params->version = version;
       params->help = help;
     }
@@ -149,10 +540,48 @@ void params_free (Params *params)
     free (params->o_file);
   if (params->title != NULL)
     free (params->title);
+  if (params->template_file != NULL)
+    free (params->template_file);
   if (params->css_file != NULL)
     free (params->css_file);
+  if (params->css_cache != NULL)
+    free (params->css_cache);
+  if (params->trace_file != NULL)
+    free (params->trace_file);
+  if (params->ast_file != NULL)
+    free (params->ast_file);
+  if (params->index_file != NULL)
+    free (params->index_file);
+  if (params->image_cache != NULL)
+    free (params->image_cache);
+  if (params->zstd_dict != NULL)
+    free (params->zstd_dict);
+  if (params->merge_file != NULL)
+    free (params->merge_file);
+  if (params->train_file != NULL)
+    free (params->train_file);
   if (params->error != NULL)
     free (params->error);
 
+  for (size_t i = 0; i < params->n_formats; i++)
+    free (params->formats[i]);
+  free (params->formats);
+
+  for (size_t i = 0; i < params->n_merge_inputs; i++)
+    free (params->merge_inputs[i]);
+  free (params->merge_inputs);
+
+  for (size_t i = 0; i < params->n_train_inputs; i++)
+    free (params->train_inputs[i]);
+  free (params->train_inputs);
+
+  for (size_t i = 0; i < params->n_book_inputs; i++)
+    free (params->book_inputs[i]);
+  free (params->book_inputs);
+
+  for (size_t i = 0; i < params->n_check_inputs; i++)
+    free (params->check_inputs[i]);
+  free (params->check_inputs);
+
   free (params);
 }
@@ -0,0 +1,1305 @@
+/* preview.c
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#define _GNU_SOURCE
+
+#include "preview.h"
+#include "hash.h"
+#include "html.h"
+#include "stats.h"
+#include "strbuf.h"
+#include "trace.h"
+#include "url.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+/* request line and headers */
+#define PREVIEW_HEAD_MAX (16 * 1024)
+
+/* rendered pages kept; bigger pages aren't cached */
+#define PREVIEW_CACHE_MAX (64 << 20)
+
+/* hash buckets of the cache, a power of 2 */
+#define PREVIEW_BUCKETS 1024
+
+/* open connections; more are closed right away */
+#define PREVIEW_MAX_CONNS 256
+
+/*
+ * @Page
+ *
+ * a rendered page; it stays alive while it is being sent, even if it's
+ * evicted meanwhile
+ */
+typedef struct Page {
+  char *path;
+  uint64_t hash;
+  struct timespec mtime;
+  off_t size;
+
+  StrBuf html;
+  _Atomic size_t refs; /* the cache holds one while it's in */
+
+  struct Page *prev; /* LRU, most recently used first */
+  struct Page *next;
+  struct Page *chain;
+} Page;
+
+typedef enum {
+  TARGET_PAGE,       /* markdown, rendered */
+  TARGET_FILE,       /* sent as it is */
+} TargetType;
+
+/*
+ * @Conn
+ *
+ * a client connection; it belongs to the loop while it waits for a
+ * request, and to a worker while one is being answered there
+ */
+typedef struct Conn {
+  int fd;
+  StrBuf in;         /* bytes read and not consumed yet */
+  bool keep_alive;
+  bool no_body;      /* HEAD request */
+
+  /* the request being answered */
+  TargetType type;
+  StrBuf path;       /* the file */
+  struct stat st;
+  char etag[64];
+  char if_none_match[256];
+  struct timespec start;
+
+  struct Conn *next; /* waiting for a worker, or done */
+} Conn;
+
+typedef struct {
+  const char *root;
+  Params *params;
+  int listen_fd;
+  int wake[2];       /* workers hand connections back through it */
+
+  pthread_mutex_t lock;
+  pthread_cond_t queued;
+  Conn *head;        /* waiting for a worker, oldest first */
+  Conn *tail;
+  Conn *done;        /* answered by a worker, back to the loop */
+  bool closing;
+  _Atomic size_t n_conns;
+
+  pthread_mutex_t cache_lock;
+  Page *buckets[PREVIEW_BUCKETS];
+  Page *lru_head;
+  Page *lru_tail;
+  size_t cache_bytes;
+} Server;
+
+static volatile sig_atomic_t stopping;
+static int stop_fd = -1;
+
+static void
+on_signal (int signum)
+{
+  (void) signum;
+
+  stopping = 1;
+  if (write (stop_fd, "", 1) < 0)
+    return;
+}
+
+static double
+elapsed_ms (const struct timespec *from)
+{
+  struct timespec now;
+
+  clock_gettime (CLOCK_MONOTONIC, &now);
+
+  return (now.tv_sec - from->tv_sec) * 1e3 + (now.tv_nsec - from->tv_nsec) / 1e6;
+}
+
+/*
+ * cache
+ */
+static void
+page_unref (Page *page)
+{
+  if (atomic_fetch_sub (&page->refs, 1) != 1)
+    return;
+
+  free (page->path);
+  strbuf_free (&page->html);
+  free (page);
+}
+
+/* with cache_lock held */
+static void
+cache_remove (Server *server,
+              Page   *page)
+{
+  Page **link = &server->buckets[page->hash & (PREVIEW_BUCKETS - 1)];
+
+  while (*link != page)
+    link = &(*link)->chain;
+  *link = page->chain;
+
+  if (page->prev != NULL)
+    page->prev->next = page->next;
+  else
+    server->lru_head = page->next;
+  if (page->next != NULL)
+    page->next->prev = page->prev;
+  else
+    server->lru_tail = page->prev;
+
+  server->cache_bytes -= page->html.len;
+  page_unref (page);
+}
+
+/*
+ * cache_lookup
+ * @server
+ * @path
+ * @st: of @path now
+ *
+ * returns the page rendered from @path as it is now, with a reference
+ * taken, or NULL
+ */
+static Page *
+cache_lookup (Server      *server,
+              const char  *path,
+              struct stat *st)
+{
+  uint64_t hash = hash_str (HASH_INIT, path);
+  Page *page;
+
+  pthread_mutex_lock (&server->cache_lock);
+
+  for (page = server->buckets[hash & (PREVIEW_BUCKETS - 1)]; page != NULL; page = page->chain)
+    {
+      if (page->hash == hash && strcmp (page->path, path) == 0)
+        break;
+    }
+
+  if (page != NULL &&
+      (page->mtime.tv_sec != st->st_mtim.tv_sec ||
+       page->mtime.tv_nsec != st->st_mtim.tv_nsec || page->size != st->st_size))
+    {
+      /* edited since */
+      cache_remove (server, page);
+      page = NULL;
+    }
+
+  if (page != NULL)
+    {
+      /* to the front */
+      if (page->prev != NULL)
+        {
+          page->prev->next = page->next;
+          if (page->next != NULL)
+            page->next->prev = page->prev;
+          else
+            server->lru_tail = page->prev;
+
+          page->prev = NULL;
+          page->next = server->lru_head;
+          server->lru_head->prev = page;
+          server->lru_head = page;
+        }
+
+      page->refs++;
+    }
+
+  pthread_mutex_unlock (&server->cache_lock);
+
+  return page;
+}
+
+/* takes a reference to @page, unless it's too big to keep */
+static void
+cache_insert (Server *server,
+              Page   *page)
+{
+  Page **bucket = &server->buckets[page->hash & (PREVIEW_BUCKETS - 1)];
+
+  if (page->html.len > PREVIEW_CACHE_MAX / 4)
+    return;
+
+  pthread_mutex_lock (&server->cache_lock);
+
+  /* rendered twice at the same time; the newer one stays */
+  for (Page *old = *bucket; old != NULL; old = old->chain)
+    {
+      if (old->hash == page->hash && strcmp (old->path, page->path) == 0)
+        {
+          cache_remove (server, old);
+          break;
+        }
+    }
+
+  page->refs++;
+  page->chain = *bucket;
+  *bucket = page;
+
+  page->prev = NULL;
+  page->next = server->lru_head;
+  if (server->lru_head != NULL)
+    server->lru_head->prev = page;
+  else
+    server->lru_tail = page;
+  server->lru_head = page;
+
+  server->cache_bytes += page->html.len;
+  while (server->cache_bytes > PREVIEW_CACHE_MAX)
+    cache_remove (server, server->lru_tail);
+
+  pthread_mutex_unlock (&server->cache_lock);
+}
+
+static void
+cache_free (Server *server)
+{
+  while (server->lru_head != NULL)
+    cache_remove (server, server->lru_head);
+}
+
+/*
+ * responses
+ */
+static bool
+send_all (int         fd,
+          const char *buf,
+          size_t      len,
+          int         flags)
+{
+  while (len > 0)
+    {
+      ssize_t n = send (fd, buf, len, flags | MSG_NOSIGNAL);
+
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        return false;
+
+      buf += n;
+      len -= n;
+    }
+
+  return true;
+}
+
+static void
+header_printf (StrBuf     *buf,
+               const char *format,
+               ...)
+{
+  char line[512];
+  va_list args;
+  int len;
+
+  va_start (args, format);
+  len = vsnprintf (line, sizeof (line), format, args);
+  va_end (args);
+
+  if (len > 0)
+    strbuf_append_len (buf, line, (size_t) len < sizeof (line) ? (size_t) len : sizeof (line) - 1);
+}
+
+static void
+begin_headers (StrBuf     *buf,
+               Conn       *conn,
+               int         status,
+               const char *reason)
+{
+  buf->len = 0;
+  buf->str[0] = '\0';
+
+  header_printf (buf, "HTTP/1.1 %d %s\r\n", status, reason);
+  if (!conn->keep_alive)
+    strbuf_append (buf, "Connection: close\r\n");
+}
+
+/* headers and body in one go, so they don't wait on each other's ACK */
+static bool
+send_response (Conn       *conn,
+               StrBuf     *headers,
+               const char *body,
+               size_t      len)
+{
+  struct iovec iov[2] = {
+    { headers->str, headers->len },
+    { (char *) body, conn->no_body ? 0 : len },
+  };
+  struct msghdr msg = { .msg_iov = iov, .msg_iovlen = 2 };
+  size_t total = iov[0].iov_len + iov[1].iov_len;
+  ssize_t n;
+
+  n = sendmsg (conn->fd, &msg, MSG_NOSIGNAL);
+  if (n < 0 && errno != EINTR)
+    return false;
+  if (n < 0)
+    n = 0;
+  if ((size_t) n == total)
+    return true;
+
+  /* the rest, piece by piece */
+  if ((size_t) n < iov[0].iov_len)
+    {
+      if (!send_all (conn->fd, headers->str + n, headers->len - n, 0))
+        return false;
+      n = 0;
+    }
+  else
+    {
+      n -= iov[0].iov_len;
+    }
+
+  return send_all (conn->fd, body + n, iov[1].iov_len - n, 0);
+}
+
+static bool
+send_error (Conn       *conn,
+            int         status,
+            const char *reason)
+{
+  StrBuf headers;
+  char body[64];
+  bool ok;
+
+  snprintf (body, sizeof (body), "%d %s\n", status, reason);
+
+  strbuf_init (&headers, 256);
+  begin_headers (&headers, conn, status, reason);
+  if (status == 405)
+    strbuf_append (&headers, "Allow: GET, HEAD\r\n");
+  header_printf (&headers, "Content-Type: text/plain; charset=utf-8\r\n"
+                 "Content-Length: %zu\r\n\r\n", strlen (body));
+
+  ok = send_response (conn, &headers, body, strlen (body));
+  strbuf_free (&headers);
+
+  return ok;
+}
+
+static bool
+send_redirect (Conn       *conn,
+               const char *location,
+               size_t      len)
+{
+  StrBuf headers;
+  bool ok;
+
+  strbuf_init (&headers, 256);
+  begin_headers (&headers, conn, 301, "Moved Permanently");
+  strbuf_append (&headers, "Location: ");
+  strbuf_append_len (&headers, location, len);
+  strbuf_append (&headers, "/\r\nContent-Length: 0\r\n\r\n");
+
+  ok = send_response (conn, &headers, NULL, 0);
+  strbuf_free (&headers);
+
+  return ok;
+}
+
+/*
+ * send_ok
+ * @conn
+ * @type: Content-Type
+ * @len: of the body
+ * @timing: Server-Timing metric
+ * @headers: gets the headers, which are sent if @body isn't NULL
+ * @body
+ */
+static bool
+send_ok (Conn       *conn,
+         const char *type,
+         size_t      len,
+         const char *timing,
+         StrBuf     *headers,
+         const char *body)
+{
+  begin_headers (headers, conn, 200, "OK");
+  header_printf (headers,
+                 "Content-Type: %s\r\n"
+                 "Content-Length: %zu\r\n"
+                 "ETag: %s\r\n"
+                 "Cache-Control: no-cache\r\n"
+                 "Server-Timing: %s;dur=%.3f\r\n\r\n",
+                 type, len, conn->etag, timing, elapsed_ms (&conn->start));
+
+  return body == NULL || send_response (conn, headers, body, len);
+}
+
+static bool
+send_not_modified (Conn *conn)
+{
+  StrBuf headers;
+  bool ok;
+
+  strbuf_init (&headers, 256);
+  begin_headers (&headers, conn, 304, "Not Modified");
+  header_printf (&headers,
+                 "ETag: %s\r\n"
+                 "Cache-Control: no-cache\r\n"
+                 "Server-Timing: etag;dur=%.3f\r\n\r\n",
+                 conn->etag, elapsed_ms (&conn->start));
+
+  ok = send_response (conn, &headers, NULL, 0);
+  strbuf_free (&headers);
+
+  return ok;
+}
+
+static bool
+send_page (Conn       *conn,
+           Page       *page,
+           const char *timing)
+{
+  StrBuf headers;
+  bool ok;
+
+  strbuf_init (&headers, 256);
+  ok = send_ok (conn, "text/html; charset=utf-8", page->html.len, timing, &headers,
+                page->html.str);
+  strbuf_free (&headers);
+
+  return ok;
+}
+
+static const char *
+content_type (const char *path)
+{
+  static const struct {
+    const char *ext;
+    const char *type;
+  } types[] = {
+    { ".html", "text/html; charset=utf-8" },
+    { ".htm",  "text/html; charset=utf-8" },
+    { ".css",  "text/css; charset=utf-8" },
+    { ".js",   "text/javascript; charset=utf-8" },
+    { ".json", "application/json" },
+    { ".txt",  "text/plain; charset=utf-8" },
+    { ".svg",  "image/svg+xml" },
+    { ".png",  "image/png" },
+    { ".jpg",  "image/jpeg" },
+    { ".jpeg", "image/jpeg" },
+    { ".gif",  "image/gif" },
+    { ".webp", "image/webp" },
+    { ".ico",  "image/x-icon" },
+    { ".pdf",  "application/pdf" },
+  };
+  const char *ext = strrchr (path, '.');
+
+  if (ext != NULL && strchr (ext, '/') == NULL)
+    {
+      for (size_t i = 0; i < sizeof (types) / sizeof (types[0]); i++)
+        {
+          if (strcasecmp (ext, types[i].ext) == 0)
+            return types[i].type;
+        }
+    }
+
+  return "application/octet-stream";
+}
+
+/*
+ * workers
+ */
+static void
+append_html (const char *buf,
+             size_t      len,
+             void       *user_data)
+{
+  strbuf_append_len (user_data, buf, len);
+}
+
+/* runs on a worker */
+static Page *
+render_page (Server *server,
+             Conn   *conn)
+{
+  StatsTimer timer;
+  TraceSpan span;
+  Page *page;
+  HTML *html;
+  Output *out;
+  void *map = NULL;
+  MD *md;
+  int fd;
+
+  fd = open (conn->path.str, O_RDONLY);
+  if (fd < 0)
+    return NULL;
+
+  if (conn->st.st_size > 0)
+    {
+      map = mmap (NULL, conn->st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (map == MAP_FAILED)
+        {
+          close (fd);
+          return NULL;
+        }
+    }
+
+  stats_timer_start (&timer);
+  trace_begin (&span);
+  md = parse_md_buffer (map != NULL ? map : "", conn->st.st_size);
+  trace_end (&span, "parse_md");
+  stats_timer_stop (&timer, STATS_STAGE_PARSE);
+  stats_count_md (md);
+
+  page = calloc (1, sizeof (Page));
+  page->path = strdup (conn->path.str);
+  page->hash = hash_str (HASH_INIT, page->path);
+  page->mtime = conn->st.st_mtim;
+  page->size = conn->st.st_size;
+  page->refs = 1;
+  strbuf_init (&page->html, conn->st.st_size + 4096);
+
+  stats_timer_start (&timer);
+  trace_begin (&span);
+  html = html_from_md (md, server->params);
+  trace_end (&span, "html_from_md");
+  stats_timer_stop (&timer, STATS_STAGE_HTML);
+
+  stats_timer_start (&timer);
+  trace_begin (&span);
+  out = output_new_func (append_html, &page->html);
+  html_write (html, out);
+  output_free (out);
+  trace_end (&span, "flush_html");
+  stats_timer_stop (&timer, STATS_STAGE_FLUSH);
+
+  html_free (html);
+
+  /* units may point into the mapping */
+  md_free (md);
+  if (map != NULL)
+    munmap (map, conn->st.st_size);
+  close (fd);
+
+  return page;
+}
+
+/* runs on a worker */
+static bool
+serve_page (Server *server,
+            Conn   *conn)
+{
+  Page *page;
+  bool ok;
+
+  page = render_page (server, conn);
+  if (page == NULL)
+    return send_error (conn, 500, "Internal Server Error");
+
+  cache_insert (server, page);
+  ok = send_page (conn, page, "render");
+  page_unref (page);
+
+  return ok;
+}
+
+/* runs on a worker */
+static bool
+serve_file (Conn *conn)
+{
+  StrBuf headers;
+  off_t offset = 0;
+  bool ok;
+  int fd;
+
+  fd = open (conn->path.str, O_RDONLY);
+  if (fd < 0)
+    return send_error (conn, 404, "Not Found");
+
+  strbuf_init (&headers, 256);
+  send_ok (conn, content_type (conn->path.str), conn->st.st_size, "file", &headers, NULL);
+
+  /* the body follows in the same segments */
+  ok = send_all (conn->fd, headers.str, headers.len, conn->no_body ? 0 : MSG_MORE);
+  while (ok && !conn->no_body && offset < conn->st.st_size)
+    {
+      ssize_t n = sendfile (conn->fd, fd, &offset, conn->st.st_size - offset);
+
+      if (n < 0 && errno == EINTR)
+        continue;
+
+      /* shorter than it was, e.g. being written */
+      ok = n > 0;
+    }
+
+  strbuf_free (&headers);
+  close (fd);
+
+  return ok;
+}
+
+static void
+close_conn (Server *server,
+            Conn   *conn)
+{
+  close (conn->fd);
+  strbuf_free (&conn->in);
+  strbuf_free (&conn->path);
+  free (conn);
+
+  atomic_fetch_sub (&server->n_conns, 1);
+}
+
+static void
+wake_loop (Server *server)
+{
+  /* the pipe can't fill up: the loop has fewer connections to take back */
+  if (write (server->wake[1], "", 1) < 0)
+    return;
+}
+
+static void *
+worker (void *user_data)
+{
+  Server *server = user_data;
+
+  pthread_mutex_lock (&server->lock);
+
+  while (true)
+    {
+      Conn *conn;
+      bool ok;
+
+      while (server->head == NULL && !server->closing)
+        pthread_cond_wait (&server->queued, &server->lock);
+
+      conn = server->head;
+      if (conn == NULL)
+        break;
+
+      server->head = conn->next;
+      if (server->head == NULL)
+        server->tail = NULL;
+
+      pthread_mutex_unlock (&server->lock);
+
+      if (conn->type == TARGET_PAGE)
+        ok = serve_page (server, conn);
+      else
+        ok = serve_file (conn);
+
+      pthread_mutex_lock (&server->lock);
+
+      if (ok && conn->keep_alive && !server->closing)
+        {
+          conn->next = server->done;
+          server->done = conn;
+          wake_loop (server);
+        }
+      else
+        {
+          close_conn (server, conn);
+        }
+    }
+
+  pthread_mutex_unlock (&server->lock);
+
+  return NULL;
+}
+
+/*
+ * requests
+ */
+
+/* @name: with the colon */
+static const char *
+header_value (const char *line,
+              const char *name)
+{
+  size_t len = strlen (name);
+
+  if (strncasecmp (line, name, len) != 0)
+    return NULL;
+
+  line += len;
+  while (*line == ' ' || *line == '\t')
+    line++;
+
+  return line;
+}
+
+/*
+ * resolve_target
+ * @server
+ * @conn: conn->path gets the file
+ * @target: request target
+ * @len
+ *
+ * foo.md and foo.html render foo.md, a directory its index.md or
+ * README.md; other files are sent as they are.  Returns the status, 0
+ * if the file is found
+ */
+static int
+resolve_target (Server     *server,
+                Conn       *conn,
+                const char *target,
+                size_t      len)
+{
+  static const char *indexes[] = { "index.md", "README.md" };
+  StrBuf *path = &conn->path;
+  size_t end = 0;
+  size_t start;
+  ssize_t n;
+
+  while (end < len && target[end] != '?' && target[end] != '#')
+    end++;
+
+  if (end == 0 || target[0] != '/')
+    return 400;
+
+  path->len = 0;
+  strbuf_append (path, server->root);
+  start = path->len;
+
+  strbuf_grow (path, end);
+  if ((n = url_decode (path->str + path->len, target, end)) < 0)
+    return 400;
+  path->len += n;
+
+  /* nothing above the root */
+  for (const char *dots = path->str + start; (dots = strstr (dots, "/..")) != NULL; dots += 3)
+    {
+      if (dots[3] == '/' || dots[3] == '\0')
+        return 404;
+    }
+
+  if (stat (path->str, &conn->st) != 0)
+    {
+      size_t n = path->len;
+
+      if (n - start < 5 || strcmp (path->str + n - 5, ".html") != 0)
+        return 404;
+
+      path->len -= 5;
+      strbuf_append (path, ".md");
+      if (stat (path->str, &conn->st) != 0)
+        return 404;
+    }
+
+  if (S_ISDIR (conn->st.st_mode))
+    {
+      size_t dir_len;
+
+      /* for relative links in the page */
+      if (path->str[path->len - 1] != '/')
+        return send_redirect (conn, target, end) ? 301 : -1;
+
+      dir_len = path->len;
+      for (size_t i = 0; i < sizeof (indexes) / sizeof (indexes[0]); i++)
+        {
+          path->len = dir_len;
+          strbuf_append (path, indexes[i]);
+          if (stat (path->str, &conn->st) == 0 && S_ISREG (conn->st.st_mode))
+            break;
+        }
+    }
+
+  if (!S_ISREG (conn->st.st_mode))
+    return 404;
+
+  conn->type = path->len >= 3 && strcmp (path->str + path->len - 3, ".md") == 0
+               ? TARGET_PAGE : TARGET_FILE;
+
+  /* weak: footnote ids differ from one rendering to the next */
+  snprintf (conn->etag, sizeof (conn->etag), "W/\"%lx-%lx-%lx-%c\"",
+            (unsigned long) conn->st.st_mtim.tv_sec, (unsigned long) conn->st.st_mtim.tv_nsec,
+            (unsigned long) conn->st.st_size, conn->type == TARGET_PAGE ? 'p' : 'f');
+
+  return 0;
+}
+
+/*
+ * read_request
+ * @server
+ * @conn: conn->in starts with a whole request head
+ * @len: of the head
+ *
+ * returns the status to answer with, 0 if the target is found, or -1 if
+ * it was answered and the connection is to be closed
+ */
+static int
+read_request (Server *server,
+              Conn   *conn,
+              size_t  len)
+{
+  char *head = conn->in.str;
+  char *line, *next, *target, *version;
+  int status;
+
+  head[len - 2] = '\0';
+  conn->if_none_match[0] = '\0';
+
+  next = strstr (head, "\r\n");
+  *next = '\0';
+  line = head;
+
+  target = strchr (line, ' ');
+  version = target ? strchr (target + 1, ' ') : NULL;
+  if (version == NULL)
+    {
+      conn->keep_alive = false;
+      return 400;
+    }
+  *target++ = '\0';
+  *version++ = '\0';
+
+  conn->keep_alive = strcmp (version, "HTTP/1.1") == 0;
+  if (!conn->keep_alive && strcmp (version, "HTTP/1.0") != 0)
+    return 400;
+
+  for (line = next + 2; *line != '\0'; line = next + 2)
+    {
+      const char *value;
+
+      next = strstr (line, "\r\n");
+      *next = '\0';
+
+      if ((value = header_value (line, "Connection:")) != NULL)
+        {
+          if (strcasecmp (value, "close") == 0)
+            conn->keep_alive = false;
+          else if (strcasecmp (value, "keep-alive") == 0)
+            conn->keep_alive = true;
+        }
+      else if ((value = header_value (line, "If-None-Match:")) != NULL)
+        {
+          snprintf (conn->if_none_match, sizeof (conn->if_none_match), "%s", value);
+        }
+      else if ((value = header_value (line, "Content-Length:")) != NULL ||
+               (value = header_value (line, "Transfer-Encoding:")) != NULL)
+        {
+          /* bodies aren't read, so the next request can't be found */
+          if (strcmp (value, "0") != 0)
+            {
+              conn->keep_alive = false;
+              return 400;
+            }
+        }
+    }
+
+  conn->no_body = strcmp (head, "HEAD") == 0;
+  if (!conn->no_body && strcmp (head, "GET") != 0)
+    return 405;
+
+  status = resolve_target (server, conn, target, strlen (target));
+
+  return status == 301 ? (conn->keep_alive ? 301 : -1) : status;
+}
+
+static bool
+etag_matches (Conn *conn)
+{
+  /* weak comparison: W/ doesn't matter */
+  const char *tag = strchr (conn->etag, '"');
+
+  return strcmp (conn->if_none_match, "*") == 0 ||
+         strstr (conn->if_none_match, tag) != NULL;
+}
+
+static void
+queue_conn (Server *server,
+            Conn   *conn)
+{
+  pthread_mutex_lock (&server->lock);
+
+  conn->next = NULL;
+  if (server->tail != NULL)
+    server->tail->next = conn;
+  else
+    server->head = conn;
+  server->tail = conn;
+
+  pthread_cond_signal (&server->queued);
+  pthread_mutex_unlock (&server->lock);
+}
+
+static const char *
+reason_phrase (int status)
+{
+  switch (status)
+    {
+      case 400:
+        return "Bad Request";
+      case 404:
+        return "Not Found";
+      case 405:
+        return "Method Not Allowed";
+      case 431:
+        return "Request Header Fields Too Large";
+      default:
+        return "Internal Server Error";
+    }
+}
+
+/*
+ * serve_buffered
+ * @server
+ * @conn: owned by the loop
+ *
+ * answers the requests read on @conn, until it needs more input or a
+ * worker.  Returns false once @conn is closed or handed to a worker
+ */
+static bool
+serve_buffered (Server *server,
+                Conn   *conn)
+{
+  while (true)
+    {
+      char *end = memmem (conn->in.str, conn->in.len, "\r\n\r\n", 4);
+      size_t len;
+      Page *page;
+      bool ok = true;
+      int status;
+
+      if (end == NULL)
+        {
+          if (conn->in.len <= PREVIEW_HEAD_MAX)
+            return true;
+
+          conn->keep_alive = false;
+          send_error (conn, 431, reason_phrase (431));
+          close_conn (server, conn);
+          return false;
+        }
+
+      clock_gettime (CLOCK_MONOTONIC, &conn->start);
+
+      len = end + 4 - conn->in.str;
+      status = read_request (server, conn, len);
+
+      /* the next request, if there is one, moves up */
+      memmove (conn->in.str, conn->in.str + len, conn->in.len - len + 1);
+      conn->in.len -= len;
+
+      if (status == 0 && etag_matches (conn))
+        {
+          ok = send_not_modified (conn);
+        }
+      else if (status == 0)
+        {
+          if (conn->type == TARGET_PAGE &&
+              (page = cache_lookup (server, conn->path.str, &conn->st)) != NULL)
+            {
+              ok = send_page (conn, page, "cache");
+              page_unref (page);
+            }
+          else
+            {
+              queue_conn (server, conn);
+              return false;
+            }
+        }
+      else if (status > 0 && status != 301)
+        {
+          ok = send_error (conn, status, reason_phrase (status));
+        }
+
+      if (!ok || status < 0 || !conn->keep_alive)
+        {
+          close_conn (server, conn);
+          return false;
+        }
+    }
+}
+
+static bool
+open_listener (Server      *server,
+               int          port,
+               const char **error)
+{
+  struct sockaddr_in addr = {
+    .sin_family = AF_INET,
+    .sin_port = htons (port),
+    .sin_addr.s_addr = htonl (INADDR_LOOPBACK),
+  };
+  int one = 1;
+
+  server->listen_fd = socket (AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (server->listen_fd < 0)
+    {
+      *error = strerror (errno);
+      return false;
+    }
+
+  setsockopt (server->listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof (one));
+
+  if (bind (server->listen_fd, (struct sockaddr *) &addr, sizeof (addr)) != 0 ||
+      listen (server->listen_fd, 64) != 0)
+    {
+      *error = strerror (errno);
+      close (server->listen_fd);
+      return false;
+    }
+
+  return true;
+}
+
+static int
+bound_port (int fd)
+{
+  struct sockaddr_in addr;
+  socklen_t len = sizeof (addr);
+
+  if (getsockname (fd, (struct sockaddr *) &addr, &len) != 0)
+    return -1;
+
+  return ntohs (addr.sin_port);
+}
+
+static void
+accept_conn (Server  *server,
+             Conn  ***conns,
+             size_t  *n_conns)
+{
+  int one = 1;
+  Conn *conn;
+  int fd;
+
+  fd = accept4 (server->listen_fd, NULL, NULL, SOCK_CLOEXEC);
+  if (fd < 0)
+    return;
+
+  if (atomic_load (&server->n_conns) >= PREVIEW_MAX_CONNS)
+    {
+      close (fd);
+      return;
+    }
+
+  setsockopt (fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof (one));
+
+  conn = calloc (1, sizeof (Conn));
+  conn->fd = fd;
+  strbuf_init (&conn->in, 1024);
+  strbuf_init (&conn->path, 256);
+  atomic_fetch_add (&server->n_conns, 1);
+
+  *conns = realloc (*conns, sizeof (Conn *) * (*n_conns + 1));
+  (*conns)[(*n_conns)++] = conn;
+}
+
+/* returns false if @conn is closed or handed to a worker */
+static bool
+read_conn (Server *server,
+           Conn   *conn)
+{
+  ssize_t n;
+
+  strbuf_grow (&conn->in, 4096);
+  n = recv (conn->fd, conn->in.str + conn->in.len, conn->in.size - conn->in.len - 1, 0);
+  if (n < 0 && errno == EINTR)
+    return true;
+  if (n <= 0)
+    {
+      close_conn (server, conn);
+      return false;
+    }
+
+  conn->in.len += n;
+  conn->in.str[conn->in.len] = '\0';
+
+  return serve_buffered (server, conn);
+}
+
+/*
+ * preview_serve
+ * @root: directory served
+ * @port: on localhost; 0 picks a free one
+ * @params: rendering options, and params->jobs
+ * @binary: prefixes the address, printed once listening
+ * @error: set when false is returned
+ *
+ * serves until SIGINT or SIGTERM
+ */
+bool
+preview_serve (const char  *root,
+               int          port,
+               Params      *params,
+               const char  *binary,
+               const char **error)
+{
+  Server server = {
+    .root = root,
+    .params = params,
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .queued = PTHREAD_COND_INITIALIZER,
+    .cache_lock = PTHREAD_MUTEX_INITIALIZER,
+  };
+  struct sigaction action = { .sa_handler = on_signal };
+  size_t n_workers = params->jobs;
+  pthread_t *workers;
+  sigset_t signals, old_signals;
+  Conn **conns = NULL;
+  size_t n_conns = 0;
+  struct pollfd *fds = NULL;
+
+  if (!open_listener (&server, port, error))
+    return false;
+
+  if (pipe2 (server.wake, O_CLOEXEC) != 0)
+    {
+      *error = strerror (errno);
+      close (server.listen_fd);
+      return false;
+    }
+
+  if (n_workers == 0)
+    {
+      long n = sysconf (_SC_NPROCESSORS_ONLN);
+
+      n_workers = n > 0 ? (size_t) n : 1;
+    }
+
+  /* signals go to the loop, which stops the workers */
+  sigemptyset (&signals);
+  sigaddset (&signals, SIGINT);
+  sigaddset (&signals, SIGTERM);
+  pthread_sigmask (SIG_BLOCK, &signals, &old_signals);
+
+  workers = calloc (n_workers, sizeof (pthread_t));
+  for (size_t i = 0; i < n_workers; i++)
+    pthread_create (&workers[i], NULL, worker, &server);
+
+  stop_fd = server.wake[1];
+  sigaction (SIGINT, &action, NULL);
+  sigaction (SIGTERM, &action, NULL);
+  pthread_sigmask (SIG_SETMASK, &old_signals, NULL);
+
+  fprintf (stderr, "%s: serving %s at http://127.0.0.1:%d/\n",
+           binary, root, bound_port (server.listen_fd));
+
+  while (!stopping)
+    {
+      size_t n_fds = 2 + n_conns;
+      size_t kept = 0;
+
+      fds = realloc (fds, sizeof (struct pollfd) * n_fds);
+      fds[0] = (struct pollfd) { .fd = server.listen_fd, .events = POLLIN };
+      fds[1] = (struct pollfd) { .fd = server.wake[0], .events = POLLIN };
+      for (size_t i = 0; i < n_conns; i++)
+        fds[2 + i] = (struct pollfd) { .fd = conns[i]->fd, .events = POLLIN };
+
+      if (poll (fds, n_fds, -1) < 0)
+        continue;
+
+      /* waiting connections first, they're before the new ones */
+      for (size_t i = 0; i < n_conns; i++)
+        {
+          if (fds[2 + i].revents == 0 || read_conn (&server, conns[i]))
+            conns[kept++] = conns[i];
+        }
+      n_conns = kept;
+
+      if (fds[1].revents & POLLIN)
+        {
+          char drain[256];
+          Conn *done;
+
+          if (read (server.wake[0], drain, sizeof (drain)) < 0)
+            continue;
+
+          pthread_mutex_lock (&server.lock);
+          done = server.done;
+          server.done = NULL;
+          pthread_mutex_unlock (&server.lock);
+
+          while (done != NULL)
+            {
+              Conn *conn = done;
+
+              done = conn->next;
+              if (serve_buffered (&server, conn))
+                {
+                  conns = realloc (conns, sizeof (Conn *) * (n_conns + 1));
+                  conns[n_conns++] = conn;
+                }
+            }
+        }
+
+      if (fds[0].revents & POLLIN)
+        accept_conn (&server, &conns, &n_conns);
+    }
+
+  pthread_mutex_lock (&server.lock);
+  server.closing = true;
+  pthread_cond_broadcast (&server.queued);
+  pthread_mutex_unlock (&server.lock);
+
+  for (size_t i = 0; i < n_workers; i++)
+    pthread_join (workers[i], NULL);
+
+  /* handed back after the loop stopped, or never picked up */
+  for (Conn *conn = server.done, *next; conn != NULL; conn = next)
+    {
+      next = conn->next;
+      close_conn (&server, conn);
+    }
+  for (Conn *conn = server.head, *next; conn != NULL; conn = next)
+    {
+      next = conn->next;
+      close_conn (&server, conn);
+    }
+  for (size_t i = 0; i < n_conns; i++)
+    close_conn (&server, conns[i]);
+
+  cache_free (&server);
+
+  stop_fd = -1;
+  signal (SIGINT, SIG_DFL);
+  signal (SIGTERM, SIG_DFL);
+
+  close (server.listen_fd);
+  close (server.wake[0]);
+  close (server.wake[1]);
+  pthread_mutex_destroy (&server.lock);
+  pthread_cond_destroy (&server.queued);
+  pthread_mutex_destroy (&server.cache_lock);
+  free (workers);
+  free (conns);
+  free (fds);
+
+  return true;
+}
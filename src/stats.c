@@ -0,0 +1,274 @@
+/* stats.c
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "stats.h"
+#include "footnotes.h"
+
+#include <stdatomic.h>
+#include <sys/resource.h>
+#include <time.h>
+
+bool stats_enabled = false;
+
+static struct {
+  _Atomic uint64_t calls;
+  _Atomic uint64_t wall_ns;
+  _Atomic uint64_t cpu_ns;
+} stages[N_STATS_STAGES];
+
+static _Atomic uint64_t counters[N_STATS_COUNTERS];
+
+static _Atomic uint64_t units[UNIT_TYPE_NONE + 1];
+
+/*
+ * Keep order in-sync with stats.h
+ */
+static const char *stage_names[N_STATS_STAGES] = {
+  [STATS_STAGE_PARSE]     = "parse_md",
+  [STATS_STAGE_DECOMPRESS] = "decompress",
+  [STATS_STAGE_HTML]      = "html_from_md",
+  [STATS_STAGE_FLUSH]     = "flush_html",
+  [STATS_STAGE_FORMAT]    = "format_text",
+  [STATS_STAGE_HIGHLIGHT + LANG_C]    = "syntax_highlight (c)",
+  [STATS_STAGE_HIGHLIGHT + LANG_DIFF] = "syntax_highlight (diff)",
+  [STATS_STAGE_HIGHLIGHT + LANG_HTML] = "syntax_highlight (html)",
+  [STATS_STAGE_FOOTNOTES] = "footnotes",
+  [STATS_STAGE_COMPRESS]  = "compress",
+};
+
+static const char *counter_names[N_STATS_COUNTERS] = {
+  [STATS_COUNTER_BYTES_IN]    = "bytes_in",
+  [STATS_COUNTER_BYTES_OUT]   = "bytes_out",
+  [STATS_COUNTER_ALLOCS]      = "allocations",
+  [STATS_COUNTER_ALLOC_BYTES] = "allocated_bytes",
+  [STATS_COUNTER_COMPRESSED_IN] = "compressed_bytes_in",
+  [STATS_COUNTER_DECOMPRESSED]  = "decompressed_bytes",
+};
+
+static uint64_t
+clock_ns (clockid_t clock)
+{
+  struct timespec ts;
+
+  clock_gettime (clock, &ts);
+
+  return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void
+stats_enable (void)
+{
+  stats_enabled = true;
+}
+
+void
+stats_timer_start_ (StatsTimer *timer)
+{
+  timer->wall_ns = clock_ns (CLOCK_MONOTONIC);
+  timer->cpu_ns = clock_ns (CLOCK_THREAD_CPUTIME_ID);
+}
+
+void
+stats_timer_stop_ (StatsTimer *timer,
+                   StatsStage  stage)
+{
+  uint64_t wall, cpu;
+
+  wall = clock_ns (CLOCK_MONOTONIC) - timer->wall_ns;
+  cpu = clock_ns (CLOCK_THREAD_CPUTIME_ID) - timer->cpu_ns;
+
+  atomic_fetch_add_explicit (&stages[stage].calls, 1, memory_order_relaxed);
+  atomic_fetch_add_explicit (&stages[stage].wall_ns, wall, memory_order_relaxed);
+  atomic_fetch_add_explicit (&stages[stage].cpu_ns, cpu, memory_order_relaxed);
+}
+
+uint64_t
+stats_get (StatsCounter counter)
+{
+  return atomic_load_explicit (&counters[counter], memory_order_relaxed);
+}
+
+void
+stats_add (StatsCounter counter,
+           uint64_t     value)
+{
+  if (stats_enabled)
+    atomic_fetch_add_explicit (&counters[counter], value, memory_order_relaxed);
+}
+
+/*
+ * stats_count_md
+ * @md: parsed document
+ *
+ * tallies units by type; footnote definitions live in md->notes
+ */
+void
+stats_count_md (MD *md)
+{
+  if (!stats_enabled)
+    return;
+
+  for (MDUnit *unit = md->elements; unit != NULL; unit = unit->next)
+    atomic_fetch_add_explicit (&units[unit->type], 1, memory_order_relaxed);
+
+  atomic_fetch_add_explicit (&units[UNIT_TYPE_FOOTNOTE],
+                             footnotes_get_count (md->notes),
+                             memory_order_relaxed);
+
+  stats_add (STATS_COUNTER_BYTES_IN, md->n_bytes);
+}
+
+static long
+peak_rss_kib (void)
+{
+  struct rusage usage;
+
+  if (getrusage (RUSAGE_SELF, &usage) != 0)
+    return 0;
+
+  /* kilobytes on Linux */
+  return usage.ru_maxrss;
+}
+
+/* time spent in a stage is also counted in the one it's nested in */
+static bool
+stage_is_nested (int stage)
+{
+  return stage == STATS_STAGE_DECOMPRESS || stage > STATS_STAGE_FLUSH;
+}
+
+/* MB/s of wall time in @stage */
+static double
+throughput (uint64_t   bytes,
+            StatsStage stage)
+{
+  return stages[stage].wall_ns ? bytes * 1e3 / stages[stage].wall_ns : 0;
+}
+
+static void
+print_text (FILE *file)
+{
+  fprintf (file, "%-28s %8s %12s %12s\n", "stage", "calls", "wall (ms)", "cpu (ms)");
+
+  for (int i = 0; i < N_STATS_STAGES; i++)
+    {
+      bool nested = stage_is_nested (i);
+
+      if (stages[i].calls == 0)
+        continue;
+
+      fprintf (file, "%s%-*s %8lu %12.3f %12.3f\n",
+               nested ? "  " : "", nested ? 26 : 28, stage_names[i],
+               (unsigned long) stages[i].calls,
+               stages[i].wall_ns / 1e6, stages[i].cpu_ns / 1e6);
+    }
+
+  fprintf (file, "\nunits:");
+  for (int i = 0; i <= UNIT_TYPE_NONE; i++)
+    {
+      if (units[i] != 0)
+        fprintf (file, " %s %lu", md_unit_type_name (i), (unsigned long) units[i]);
+    }
+  fprintf (file, "\n");
+
+  for (int i = 0; i < N_STATS_COUNTERS; i++)
+    {
+      /* only meaningful with compressed input */
+      if (i >= STATS_COUNTER_COMPRESSED_IN && counters[i] == 0)
+        continue;
+
+      fprintf (file, "%s: %lu\n", counter_names[i], (unsigned long) counters[i]);
+    }
+
+  if (stages[STATS_STAGE_DECOMPRESS].calls != 0)
+    {
+      fprintf (file, "decompress_mb_s: in %.1f out %.1f\n",
+               throughput (counters[STATS_COUNTER_COMPRESSED_IN], STATS_STAGE_DECOMPRESS),
+               throughput (counters[STATS_COUNTER_DECOMPRESSED], STATS_STAGE_DECOMPRESS));
+    }
+
+  fprintf (file, "peak_rss_kib: %ld\n", peak_rss_kib ());
+}
+
+static void
+print_json (FILE *file)
+{
+  bool first = true;
+
+  fprintf (file, "{\"stages\":{");
+  for (int i = 0; i < N_STATS_STAGES; i++)
+    {
+      if (stages[i].calls == 0)
+        continue;
+
+      fprintf (file, "%s\"%s\":{\"calls\":%lu,\"wall_ms\":%.3f,\"cpu_ms\":%.3f}",
+               first ? "" : ",", stage_names[i],
+               (unsigned long) stages[i].calls,
+               stages[i].wall_ns / 1e6, stages[i].cpu_ns / 1e6);
+      first = false;
+    }
+
+  fprintf (file, "},\"units\":{");
+  first = true;
+  for (int i = 0; i <= UNIT_TYPE_NONE; i++)
+    {
+      if (units[i] == 0)
+        continue;
+
+      fprintf (file, "%s\"%s\":%lu", first ? "" : ",",
+               md_unit_type_name (i), (unsigned long) units[i]);
+      first = false;
+    }
+  fprintf (file, "}");
+
+  for (int i = 0; i < N_STATS_COUNTERS; i++)
+    {
+      if (i >= STATS_COUNTER_COMPRESSED_IN && counters[i] == 0)
+        continue;
+
+      fprintf (file, ",\"%s\":%lu", counter_names[i], (unsigned long) counters[i]);
+    }
+
+  if (stages[STATS_STAGE_DECOMPRESS].calls != 0)
+    {
+      fprintf (file, ",\"decompress_mb_s\":{\"in\":%.1f,\"out\":%.1f}",
+               throughput (counters[STATS_COUNTER_COMPRESSED_IN], STATS_STAGE_DECOMPRESS),
+               throughput (counters[STATS_COUNTER_DECOMPRESSED], STATS_STAGE_DECOMPRESS));
+    }
+
+  fprintf (file, ",\"peak_rss_kib\":%ld}\n", peak_rss_kib ());
+}
+
+void
+stats_print (FILE        *file,
+             StatsFormat  format)
+{
+  switch (format)
+    {
+      case STATS_FORMAT_TEXT:
+        print_text (file);
+        break;
+      case STATS_FORMAT_JSON:
+        print_json (file);
+        break;
+      default:
+        break;
+    }
+}
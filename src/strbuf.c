@@ -0,0 +1,85 @@
+/* strbuf.c
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "strbuf.h"
+
+#include <stdlib.h>
+
+
+void
+strbuf_init (StrBuf *buf,
+             size_t  size)
+{
+  if (size == 0)
+    size = 1;
+
+  buf->str = malloc (size);
+  buf->str[0] = '\0';
+  buf->len = 0;
+  buf->size = size;
+}
+
+/*
+ * strbuf_grow
+ * @buf
+ * @extra: bytes about to be appended
+ *
+ * makes room for @extra bytes and the terminating NUL
+ */
+void
+strbuf_grow (StrBuf *buf,
+             size_t  extra)
+{
+  size_t size = buf->size;
+
+  while (buf->len + extra >= size)
+    size <<= 1;
+
+  if (size != buf->size)
+    {
+      buf->str = realloc (buf->str, size);
+      buf->size = size;
+    }
+}
+
+/*
+ * strbuf_steal
+ *
+ * gives ownership of the string to the caller
+ */
+char *
+strbuf_steal (StrBuf *buf)
+{
+  char *str = buf->str;
+
+  buf->str = NULL;
+  buf->len = buf->size = 0;
+
+  return str;
+}
+
+void
+strbuf_free (StrBuf *buf)
+{
+  free (buf->str);
+
+  buf->str = NULL;
+  buf->len = buf->size = 0;
+}
@@ -21,6 +21,8 @@
 #include "lang.h"
 #include "syntax.h"
 #include "xml.h"
+#include "strbuf.h"
+#include "search.h"
 
 #include <stdio.h>
 #include <ctype.h>
@@ -51,8 +53,6 @@ struct keywords_set {
   struct keyword *keywords;
 };
 
-const int font_tag_size = 30; /* pre-calculated */
-
 /**
  * C programming language
  **/
@@ -272,164 +272,124 @@ get_number_length (char *str)
   return size;
 }
 
-static size_t
-extract_number (char   *str,
-                char   *buf)
+static bool
+is_unescaped (const char *match)
 {
-  size_t size;
-
-  size = get_number_length (str);
-
-  if (size != 0)
-    {
-      strncpy (buf, str, size);
-    }
-
-  return size;
+  return !isescape_sequence ((char *) match - 1);
 }
 
 static size_t
 extract_text (char   *start,
-              char   *buf,
-              size_t  buf_len,
-              char   *pattern)
+              Search *search)
 {
   size_t size = 0;
   char *needle;
 
-  needle = start;
-
-  do {
-    needle = strstr (needle + 1, pattern);
+  /* the closing pattern can't be the opening character itself */
+  needle = search_find (search, start + 1);
 
-    /* skip escape sequences */
-    if (needle && !isescape_sequence (needle - 1))
-       break;
+  if (needle != NULL)
+    size = needle - start + strlen (search->pattern);
 
-  } while (needle != NULL);
+  return size;
+}
 
-  if (needle != NULL)
-    {
-      size = needle - start + strlen (pattern);
+static void
+append_font (StrBuf     *buf,
+             const char *color,
+             const char *str,
+             size_t      len,
+             bool        sanitize)
+{
+  strbuf_append (buf, "<font color=\"");
+  strbuf_append (buf, color);
+  strbuf_append (buf, "\">");
 
-      xml_sanitize_strcpy (buf, start, size);
-    }
+  if (sanitize)
+    xml_sanitize_append (buf, str, len);
+  else
+    strbuf_append_len (buf, str, len);
 
-  return size;
+  strbuf_append (buf, "</font>");
 }
 
 static char *
 highlight_keywords (char                 *codeblk,
                     struct keywords_set **set,
-                    int                   n_keyword_types)
+                    size_t                n_keyword_types)
 {
-  int size = 1000;
-  int count = 0;
-  char *highlighted = NULL;
+  StrBuf highlighted;
   char *ptr = NULL;
-  struct keyword string;
+  Search dquote, squote, comment_end;
 
-  highlighted = malloc (sizeof (char) * size);
+  strbuf_init (&highlighted, 1000);
+
+  search_init (&dquote, "\"", is_unescaped);
+  search_init (&squote, "\'", is_unescaped);
+  search_init (&comment_end, "*/", is_unescaped);
 
   ptr = codeblk;
 
   while (*ptr != '\0')
     {
-      int i;
-      int len = 0;
+      size_t size = 0;
+      const char *color = NULL;
+      bool sanitize = false;
       struct keyword *match = NULL;
-      char buf[30000] = { 0 }; /* FIXME */
-      bool advance_ptr = true;
 
       if (STRING_CHAR_TOKEN (*ptr))
         {
-          size_t size;
-          char *pattern;
+          Search *search;
 
           if (STRING_TOKEN (*ptr))
             {
-              pattern = "\"";
+              search = &dquote;
             }
           else
             {
-              pattern = "\'";
+              search = &squote;
             }
 
-          size = extract_text (ptr, buf, sizeof (buf), pattern);
-
-          if (size != 0)
-            {
-              string.str = buf;
-              string.color = "#6A1B9A";
-
-              match = &string;
-              ptr += size;
-              len = size;
-              advance_ptr = false;
-            }
+          size = extract_text (ptr, search);
+          color = "#6A1B9A";
+          sanitize = true;
         }
       else if (MULTI_LINE_COMMENT_TOKEN (ptr))
         {
-          size_t size;
-
-          size = extract_text (ptr, buf, sizeof (buf), "*/");
-
-          if (size != 0)
-            {
-              string.str = buf;
-              string.color = "#006400";
-
-              match = &string;
-              ptr += size;
-              len = size;
-              advance_ptr = false;
-            }
+          size = extract_text (ptr, &comment_end);
+          color = "#006400";
+          sanitize = true;
         }
       else if (SINGLE_LINE_COMMENT_TOKEN (ptr))
         {
-          size_t size;
           char *newline;
 
           newline = strchr (ptr + 2, '\n');
-          size = newline - ptr;
-
-          strncpy (buf, ptr, size);
-          buf[size] = '\0';
-
-          string.str = buf;
-          string.color = "#006400";
-
-          match = &string;
-          ptr += size;
-          len = size;
-          advance_ptr = false;
+          size = newline ? (size_t) (newline - ptr) : strlen (ptr);
+          color = "#006400";
         }
       else if (NUMBER_TOKEN (*ptr)
                && !isalpha (* (ptr - 1)))
         {
-          size_t size;
-
-          size = extract_number (ptr, buf);
+          size = get_number_length (ptr);
+          color = "#9A4EA2";
+        }
 
-          if (size != 0)
-            {
-              string.str = buf;
-              string.color = "#9A4EA2";
+      if (size != 0)
+        {
+          append_font (&highlighted, color, ptr, size, sanitize);
+          ptr += size;
 
-              match = &string;
-              ptr += size;
-              len = size;
-              advance_ptr = false;
-            }
+          continue;
         }
 
-      for (i = 0; i < n_keyword_types && !match; i++)
+      for (size_t i = 0; i < n_keyword_types && !match; i++)
         {
           struct keyword *type;
 
           type = set[i]->keywords;
 
-          for (int j = 0; type[j].str != NULL; j++)
+          for (size_t j = 0; type[j].str != NULL; j++)
             {
               const char *keyword;
               size_t keyword_len;
@@ -443,8 +403,7 @@ highlight_keywords (char                 *codeblk,
                       && !__isalnum (* (ptr + keyword_len)))
                     {
                       match = &type[j];
-                      len = keyword_len;
-                      i = n_keyword_types;
+                      size = keyword_len;
                       break;
                     }
                 }
@@ -453,39 +412,12 @@ highlight_keywords (char                 *codeblk,
 
       if (match != NULL)
         {
-          char *cpy;
-          const char *strs[5] = {
-            "<font color=\"", NULL, "\">",
-            NULL,
-            "</font>"
-          };
-
-          if (count + font_tag_size + len >= size - 1)
-            {
-              size <<= 1;
-
-              highlighted = realloc (highlighted, size);
-            }
-
-          strs[1] = match->color;
-          strs[3] = match->str;
-
-          cpy = &highlighted[count];
-
-          for (int i = 0; i < 5; i++)
-            {
-              strcpy (cpy, strs[i]);
-              cpy += strlen (strs[i]);
-              count += strlen (strs[i]);
-            }
-
-          if (advance_ptr)
-            ptr += strlen (match->str);
+          append_font (&highlighted, match->color, match->str, size, false);
+          ptr += size;
         }
       else /* Not a keyword */
         {
-          size_t len, str_size = 0;
-          static int max_xml_char_size = 20; /* subject to change */
+          size_t str_size = 0;
           char *str = ptr;
 
           if (isalpha (*str))
@@ -498,24 +430,12 @@ highlight_keywords (char                 *codeblk,
               str_size = 1;
             }
 
-          if (count + str_size * max_xml_char_size >= size - 1)
-            {
-              size <<= 1;
-
-              highlighted = realloc (highlighted, size);
-            }
-
-          len = xml_sanitize_strcpy (&highlighted[count],
-                                     ptr, str_size);
-
-          count += len;
+          xml_sanitize_append (&highlighted, ptr, str_size);
           ptr += str_size;
         }
     }
 
-  highlighted[count] = '\0';
-
-  return highlighted;
+  return strbuf_steal (&highlighted);
 }
 
 /* DIFF */
@@ -548,70 +468,33 @@ diff_keyword (char        *line,
 static char *
 highlight_diff (char *diffblk)
 {
-  size_t size = 1000, count = 0;
-  char *highlighted = NULL;
+  StrBuf highlighted;
   char *token = NULL;
-  char *cpy;
-  const char *strs[5] = {
-    "<font color=\"", NULL, "\">",
-    NULL,
-    "</font>"
-  };
+  char *save = NULL;
 
-  highlighted = malloc (sizeof (char) * size);
+  strbuf_init (&highlighted, 1000);
 
-  token = strtok (diffblk, "\n");
+  /* blocks are highlighted concurrently in --tar mode */
+  token = strtok_r (diffblk, "\n", &save);
 
   while (token != NULL)
     {
+      const char *color;
       size_t len;
 
       len = strlen (token);
 
-      /* I hate doing this;
-       * Implement a string data structure */
-      if (2 * len + count + font_tag_size >= size)
-        {
-          size <<= 1;
-
-          highlighted = realloc (highlighted, size);
-        }
-
-      if (diff_keyword (token, &strs[1]))
-        {
-          cpy = &highlighted[count];
-
-          for (int i = 0; i < 5; i++)
-            {
-              if (i != 3)
-                {
-                  cpy = stpcpy (cpy, strs[i]);
-                  count += strlen (strs[i]);
-                }
-              else
-                {
-                  size_t write;
-
-                  write = xml_sanitize_strcpy (cpy,
-                                               token, len);
-                  cpy += write;
-                  count += write;
-                }
-            }
-        }
+      if (diff_keyword (token, &color))
+        append_font (&highlighted, color, token, len, true);
       else
-        {
-          count += xml_sanitize_strcpy (&highlighted[count], token, len);
-        }
+        xml_sanitize_append (&highlighted, token, len);
 
-      highlighted[count++] = '\n';
+      strbuf_append_c (&highlighted, '\n');
 
-      token = strtok (NULL, "\n");
+      token = strtok_r (NULL, "\n", &save);
     }
 
-  highlighted[count] = '\0';
-
-  return highlighted;
+  return strbuf_steal (&highlighted);
 }
 
 char *
@@ -619,7 +502,7 @@ syntax_highlight (char *codeblk,
                   Lang  lang)
 {
   char *highlighted = NULL;
-  int n_types;
+  size_t n_types;
 
   switch (lang)
     {
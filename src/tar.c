@@ -0,0 +1,892 @@
+/* tar.c
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "tar.h"
+#include "html.h"
+#include "strbuf.h"
+#include "stats.h"
+#include "trace.h"
+#include "limit.h"
+#include "input.h"
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define TAR_BLOCK_SIZE 512
+
+/* members up to this size wait in the queue, bigger ones are streamed */
+#define TAR_QUEUE_MAX (1 << 20)
+
+/* jobs in flight per worker */
+#define TAR_JOBS_PER_WORKER 4
+
+/* longest pax or GNU long name header that is read */
+#define TAR_META_MAX (1 << 20)
+
+/* size field: 11 octal digits */
+#define TAR_SIZE_MAX 077777777777ULL
+
+/* POSIX ustar header */
+typedef struct {
+  char name[100];
+  char mode[8];
+  char uid[8];
+  char gid[8];
+  char size[12];
+  char mtime[12];
+  char chksum[8];
+  char typeflag;
+  char linkname[100];
+  char magic[6];
+  char version[2];
+  char uname[32];
+  char gname[32];
+  char devmajor[8];
+  char devminor[8];
+  char prefix[155];
+  char pad[12];
+} TarHeader;
+
+_Static_assert (sizeof (TarHeader) == TAR_BLOCK_SIZE, "tar header is a block");
+
+/*
+ * @TarJob
+ *
+ * a member on its way out; members to convert are done once a worker
+ * has rendered them, the others are done as soon as they are read
+ */
+typedef struct {
+  TarHeader header; /* of the .md member */
+  char *name;       /* its full name */
+  char *md;         /* its content, until converted */
+  size_t md_len;
+
+  StrBuf head;      /* header blocks */
+  StrBuf body;      /* content, padded unless pad says otherwise */
+  size_t pad;
+
+  size_t n_invalid;
+  bool convert;
+  bool done;
+} TarJob;
+
+typedef struct {
+  Output *out;
+  Params *params;
+  const char *binary;
+
+  pthread_mutex_t lock;
+  pthread_cond_t  queued;    /* there is a job to convert, or closing */
+  pthread_cond_t  converted;
+
+  /* jobs [head, tail) in input order; workers take them from next */
+  TarJob **ring;
+  size_t   ring_size;
+  size_t   head;
+  size_t   next;
+  size_t   tail;
+  bool     closing;
+
+  /* first limit a member hit; the stream stops there */
+  _Atomic Limit exceeded;
+} Tar;
+
+static const char zeros[TAR_BLOCK_SIZE];
+
+/*
+ * headers
+ */
+static uint64_t
+parse_number (const char *field,
+              size_t      len)
+{
+  uint64_t value = 0;
+  size_t i = 0;
+
+  /* GNU base-256, for values that don't fit in octal */
+  if ((unsigned char) field[0] & 0x80)
+    {
+      value = (unsigned char) field[0] & 0x3f;
+      for (i = 1; i < len; i++)
+        value = (value << 8) | (unsigned char) field[i];
+
+      return value;
+    }
+
+  while (i < len && field[i] == ' ')
+    i++;
+
+  for (; i < len && field[i] >= '0' && field[i] <= '7'; i++)
+    value = (value << 3) | (uint64_t) (field[i] - '0');
+
+  return value;
+}
+
+static unsigned
+header_checksum (const TarHeader *header)
+{
+  const unsigned char *p = (const unsigned char *) header;
+  unsigned sum = 0;
+
+  for (size_t i = 0; i < TAR_BLOCK_SIZE; i++)
+    {
+      if (i >= offsetof (TarHeader, chksum) &&
+          i < offsetof (TarHeader, chksum) + sizeof (header->chksum))
+        sum += ' ';
+      else
+        sum += p[i];
+    }
+
+  return sum;
+}
+
+static bool
+header_valid (const TarHeader *header)
+{
+  return parse_number (header->chksum, sizeof (header->chksum)) == header_checksum (header);
+}
+
+static bool
+header_is_zero (const TarHeader *header)
+{
+  return memcmp (header, zeros, TAR_BLOCK_SIZE) == 0;
+}
+
+/* links, devices, dirs and fifos have no data blocks */
+static bool
+has_data (char typeflag)
+{
+  return typeflag < '1' || typeflag > '6';
+}
+
+static size_t
+padding (uint64_t size)
+{
+  return (TAR_BLOCK_SIZE - size % TAR_BLOCK_SIZE) % TAR_BLOCK_SIZE;
+}
+
+static void
+set_octal (char     *field,
+           size_t    len,
+           uint64_t  value)
+{
+  char buf[32];
+
+  snprintf (buf, sizeof (buf), "%0*" PRIo64, (int) len - 1, value);
+  memcpy (field, buf, len);
+}
+
+static void
+set_checksum (TarHeader *header)
+{
+  snprintf (header->chksum, sizeof (header->chksum), "%06o", header_checksum (header));
+  header->chksum[7] = ' ';
+}
+
+/* "LEN key=value\n", where LEN counts itself */
+static void
+append_pax_record (StrBuf     *buf,
+                   const char *key,
+                   const char *value)
+{
+  size_t len = strlen (key) + strlen (value) + 3;
+  size_t total = len;
+  char prefix[32];
+  int digits;
+
+  /* settles in a couple of rounds */
+  while ((digits = snprintf (prefix, sizeof (prefix), "%zu", total)) + len != total)
+    total = len + digits;
+
+  strbuf_append (buf, prefix);
+  strbuf_append_c (buf, ' ');
+  strbuf_append (buf, key);
+  strbuf_append_c (buf, '=');
+  strbuf_append (buf, value);
+  strbuf_append_c (buf, '\n');
+}
+
+/*
+ * parse_pax
+ * @data: pax extended header records
+ * @path: set to the path record, if any
+ * @size: set to the size record, if any
+ */
+static void
+parse_pax (const StrBuf  *data,
+           char         **path,
+           uint64_t      *size)
+{
+  size_t i = 0;
+
+  while (i < data->len)
+    {
+      const char *record = data->str + i;
+      const char *key, *eq, *end;
+      size_t len = 0;
+      size_t j = 0;
+
+      while (i + j < data->len && record[j] >= '0' && record[j] <= '9')
+        len = len * 10 + (size_t) (record[j++] - '0');
+
+      if (j == 0 || record[j] != ' ' || len <= j || len > data->len - i)
+        break;
+
+      key = record + j + 1;
+      end = record + len - 1;
+      eq = memchr (key, '=', (size_t) (end - key));
+
+      if (eq != NULL && eq - key == 4 && memcmp (key, "path", 4) == 0)
+        {
+          free (*path);
+          *path = strndup (eq + 1, (size_t) (end - eq - 1));
+        }
+      else if (eq != NULL && eq - key == 4 && memcmp (key, "size", 4) == 0)
+        {
+          *size = strtoull (eq + 1, NULL, 10);
+        }
+
+      i += len;
+    }
+}
+
+/* prefix/name of a ustar header, name alone otherwise */
+static char *
+header_name (const TarHeader *header)
+{
+  size_t name_len = strnlen (header->name, sizeof (header->name));
+  size_t prefix_len = 0;
+  char *name;
+
+  if (memcmp (header->magic, "ustar", 6) == 0)
+    prefix_len = strnlen (header->prefix, sizeof (header->prefix));
+
+  if (prefix_len == 0)
+    return strndup (header->name, name_len);
+
+  name = malloc (prefix_len + name_len + 2);
+  memcpy (name, header->prefix, prefix_len);
+  name[prefix_len] = '/';
+  memcpy (name + prefix_len + 1, header->name, name_len);
+  name[prefix_len + name_len + 1] = '\0';
+
+  return name;
+}
+
+static bool
+is_markdown (const TarHeader *header,
+             const char      *name)
+{
+  size_t len = strlen (name);
+
+  return (header->typeflag == '0' || header->typeflag == '\0' || header->typeflag == '7') &&
+         len > 3 && strcmp (name + len - 3, ".md") == 0;
+}
+
+/* puts @name in the ustar fields; false if it doesn't fit */
+static bool
+set_name (TarHeader  *header,
+          const char *name)
+{
+  size_t len = strlen (name);
+
+  if (len <= sizeof (header->name))
+    {
+      memcpy (header->name, name, len);
+      return true;
+    }
+
+  /* split at a '/' into prefix and name */
+  for (size_t i = 1; i < len && i <= sizeof (header->prefix); i++)
+    {
+      if (name[i] == '/' && len - i - 1 <= sizeof (header->name) && len - i - 1 > 0)
+        {
+          memcpy (header->prefix, name, i);
+          memcpy (header->name, name + i + 1, len - i - 1);
+          return true;
+        }
+    }
+
+  return false;
+}
+
+/*
+ * build_header
+ * @job: converted
+ *
+ * header of the .html member, after the one of the .md member: same
+ * mode, owner and mtime.  Names that don't fit and sizes over 8 GiB go
+ * in a pax extended header
+ */
+static void
+build_header (TarJob *job)
+{
+  TarHeader header = job->header;
+  size_t len = strlen (job->name);
+  char *name = malloc (len + 3);
+  StrBuf pax;
+
+  memcpy (name, job->name, len - 3);
+  strcpy (name + len - 3, ".html");
+
+  memset (header.name, 0, sizeof (header.name));
+  memset (header.linkname, 0, sizeof (header.linkname));
+  memset (header.prefix, 0, sizeof (header.prefix));
+  memset (header.pad, 0, sizeof (header.pad));
+  memcpy (header.magic, "ustar", 6);
+  memcpy (header.version, "00", 2);
+  header.typeflag = '0';
+
+  strbuf_init (&pax, 0);
+
+  /* readers without pax support get the name cut short */
+  if (!set_name (&header, name))
+    {
+      append_pax_record (&pax, "path", name);
+      memcpy (header.name, name, sizeof (header.name));
+    }
+
+  if (job->body.len > TAR_SIZE_MAX)
+    {
+      char size[32];
+
+      snprintf (size, sizeof (size), "%zu", job->body.len);
+      append_pax_record (&pax, "size", size);
+      set_octal (header.size, sizeof (header.size), 0);
+    }
+  else
+    {
+      set_octal (header.size, sizeof (header.size), job->body.len);
+    }
+
+  if (pax.len > 0)
+    {
+      TarHeader pax_header = header;
+      const char *base = strrchr (name, '/');
+
+      memset (pax_header.name, 0, sizeof (pax_header.name));
+      snprintf (pax_header.name, sizeof (pax_header.name), "PaxHeaders/%.88s",
+                base != NULL ? base + 1 : name);
+      pax_header.typeflag = 'x';
+      set_octal (pax_header.size, sizeof (pax_header.size), pax.len);
+      set_checksum (&pax_header);
+
+      strbuf_append_len (&job->head, (const char *) &pax_header, TAR_BLOCK_SIZE);
+      strbuf_append_len (&job->head, pax.str, pax.len);
+      strbuf_append_len (&job->head, zeros, padding (pax.len));
+    }
+
+  set_checksum (&header);
+  strbuf_append_len (&job->head, (const char *) &header, TAR_BLOCK_SIZE);
+  job->pad = padding (job->body.len);
+
+  strbuf_free (&pax);
+  free (name);
+}
+
+/*
+ * conversion
+ */
+static void
+append_body (const char *buf,
+             size_t      len,
+             void       *user_data)
+{
+  strbuf_append_len (user_data, buf, len);
+}
+
+/* runs on a worker */
+static void
+convert_job (Tar    *tar,
+             TarJob *job)
+{
+  StatsTimer timer;
+  TraceSpan span;
+  MD *md;
+
+  /* the stream stops at the first limit anyway */
+  if (atomic_load (&tar->exceeded) != LIMIT_NONE)
+    return;
+
+  stats_timer_start (&timer);
+  trace_begin (&span);
+  md = parse_md_buffer (job->md, job->md_len);
+  trace_end (&span, "parse_md");
+  stats_timer_stop (&timer, STATS_STAGE_PARSE);
+  stats_count_md (md);
+
+  job->n_invalid = md->n_invalid;
+
+  if (md->limits.exceeded == LIMIT_NONE)
+    {
+      HTML *html;
+      Output *out;
+
+      stats_timer_start (&timer);
+      trace_begin (&span);
+      html = html_from_md (md, tar->params);
+      trace_end (&span, "html_from_md");
+      stats_timer_stop (&timer, STATS_STAGE_HTML);
+
+      stats_timer_start (&timer);
+      trace_begin (&span);
+      out = output_new_func (append_body, &job->body);
+      html_write (html, out);
+      output_free (out);
+      trace_end (&span, "flush_html");
+      stats_timer_stop (&timer, STATS_STAGE_FLUSH);
+
+      html_free (html);
+    }
+
+  /* each member is a conversion of its own, limits included */
+  if (md->limits.exceeded != LIMIT_NONE)
+    {
+      Limit none = LIMIT_NONE;
+
+      atomic_compare_exchange_strong (&tar->exceeded, &none, md->limits.exceeded);
+    }
+
+  /* units may point into the markdown */
+  md_free (md);
+  free (job->md);
+  job->md = NULL;
+
+  build_header (job);
+}
+
+static void *
+worker (void *user_data)
+{
+  Tar *tar = user_data;
+
+  pthread_mutex_lock (&tar->lock);
+
+  while (true)
+    {
+      TarJob *job;
+
+      while (tar->next == tar->tail && !tar->closing)
+        pthread_cond_wait (&tar->queued, &tar->lock);
+
+      if (tar->next == tar->tail)
+        break;
+
+      job = tar->ring[tar->next++ % tar->ring_size];
+      if (!job->convert)
+        continue;
+
+      pthread_mutex_unlock (&tar->lock);
+      convert_job (tar, job);
+      pthread_mutex_lock (&tar->lock);
+
+      job->done = true;
+      pthread_cond_broadcast (&tar->converted);
+    }
+
+  pthread_mutex_unlock (&tar->lock);
+
+  return NULL;
+}
+
+static TarJob *
+job_new (void)
+{
+  TarJob *job = calloc (1, sizeof (TarJob));
+
+  strbuf_init (&job->head, TAR_BLOCK_SIZE);
+  strbuf_init (&job->body, 0);
+
+  return job;
+}
+
+static void
+job_free (TarJob *job)
+{
+  free (job->name);
+  free (job->md);
+  strbuf_free (&job->head);
+  strbuf_free (&job->body);
+  free (job);
+}
+
+/*
+ * write_jobs
+ * @tar
+ * @wait: for jobs that are still being converted; else only the done
+ *        ones at the head of the queue go out
+ * @keep: jobs that may stay queued
+ */
+static void
+write_jobs (Tar    *tar,
+            bool    wait,
+            size_t  keep)
+{
+  pthread_mutex_lock (&tar->lock);
+
+  while (tar->tail - tar->head > keep)
+    {
+      TarJob *job = tar->ring[tar->head % tar->ring_size];
+
+      if (!job->done && !wait)
+        break;
+
+      while (!job->done)
+        pthread_cond_wait (&tar->converted, &tar->lock);
+
+      pthread_mutex_unlock (&tar->lock);
+
+      if (job->convert && job->n_invalid > 0)
+        {
+          fprintf (stderr, "%s: %s: warning: %zu invalid UTF-8 sequences\n",
+                   tar->binary, job->name, job->n_invalid);
+        }
+
+      if (atomic_load (&tar->exceeded) == LIMIT_NONE)
+        {
+          output_write (tar->out, job->head.str, job->head.len);
+          output_write (tar->out, job->body.str, job->body.len);
+          output_write (tar->out, zeros, job->pad);
+        }
+
+      job_free (job);
+
+      pthread_mutex_lock (&tar->lock);
+
+      tar->head++;
+      if (tar->next < tar->head)
+        tar->next = tar->head;
+    }
+
+  pthread_mutex_unlock (&tar->lock);
+}
+
+static void
+queue_job (Tar    *tar,
+           TarJob *job)
+{
+  /* room for it */
+  write_jobs (tar, true, tar->ring_size - 1);
+
+  pthread_mutex_lock (&tar->lock);
+  tar->ring[tar->tail++ % tar->ring_size] = job;
+  if (job->convert)
+    pthread_cond_signal (&tar->queued);
+  pthread_mutex_unlock (&tar->lock);
+}
+
+/* reads @len bytes onto @buf, a piece at a time so a bogus size fails early */
+static bool
+read_data (MDFile   *in,
+           StrBuf   *buf,
+           uint64_t  len)
+{
+  while (len > 0)
+    {
+      size_t n = len < (1 << 16) ? len : (1 << 16);
+      size_t read;
+
+      strbuf_grow (buf, n);
+      read = fread (buf->str + buf->len, 1, n, in);
+      buf->len += read;
+      buf->str[buf->len] = '\0';
+
+      if (read != n)
+        return false;
+
+      len -= n;
+    }
+
+  return true;
+}
+
+/* copies @len bytes from @in to the output as they are read */
+static bool
+stream_data (Tar      *tar,
+             MDFile   *in,
+             uint64_t  len)
+{
+  char buf[1 << 16];
+
+  while (len > 0)
+    {
+      size_t n = len < sizeof (buf) ? len : sizeof (buf);
+
+      if (fread (buf, 1, n, in) != n)
+        return false;
+
+      output_write (tar->out, buf, n);
+      len -= n;
+    }
+
+  return true;
+}
+
+/*
+ * read_members
+ * @tar
+ * @in
+ * @error: set when false is returned
+ *
+ * reads the stream up to its end-of-archive blocks (or the end of the
+ * input) and queues a job for every member
+ */
+static bool
+read_members (Tar         *tar,
+              MDFile      *in,
+              const char **error)
+{
+  StrBuf meta;        /* pax and GNU long name headers of the next member */
+  StrBuf data;
+  char *long_name = NULL;
+  char *pax_path = NULL;
+  uint64_t pax_size = UINT64_MAX;
+  bool ok = true;
+
+  strbuf_init (&meta, TAR_BLOCK_SIZE);
+  strbuf_init (&data, 0);
+
+  while (atomic_load (&tar->exceeded) == LIMIT_NONE)
+    {
+      TarHeader header;
+      TarJob *job;
+      char *name;
+      uint64_t size;
+      size_t n;
+
+      n = fread (&header, 1, TAR_BLOCK_SIZE, in);
+      if (n == 0 && meta.len == 0)
+        break;
+
+      if (n != TAR_BLOCK_SIZE)
+        {
+          *error = "truncated tar stream";
+          ok = false;
+          break;
+        }
+
+      if (header_is_zero (&header))
+        break;
+
+      if (!header_valid (&header))
+        {
+          *error = "not a tar stream";
+          ok = false;
+          break;
+        }
+
+      size = parse_number (header.size, sizeof (header.size));
+
+      if (header.typeflag == 'x' || header.typeflag == 'L' || header.typeflag == 'K')
+        {
+          data.len = 0;
+
+          if (size > TAR_META_MAX ||
+              !read_data (in, &data, size + padding (size)))
+            {
+              *error = size > TAR_META_MAX ? "extended header too long"
+                                           : "truncated tar stream";
+              ok = false;
+              break;
+            }
+
+          strbuf_append_len (&meta, (const char *) &header, TAR_BLOCK_SIZE);
+          strbuf_append_len (&meta, data.str, data.len);
+
+          data.len = size;
+          if (header.typeflag == 'x')
+            parse_pax (&data, &pax_path, &pax_size);
+          else if (header.typeflag == 'L')
+            {
+              free (long_name);
+              long_name = strndup (data.str, size);
+            }
+
+          continue;
+        }
+
+      if (pax_size != UINT64_MAX)
+        size = pax_size;
+      if (!has_data (header.typeflag))
+        size = 0;
+
+      name = pax_path ? strdup (pax_path)
+                      : long_name ? strdup (long_name) : header_name (&header);
+      job = NULL;
+
+      if (is_markdown (&header, name))
+        {
+          StrBuf md;
+
+          /* the extended headers are rebuilt for the .html member */
+          job = job_new ();
+          job->header = header;
+          job->name = name;
+          job->convert = true;
+
+          strbuf_init (&md, 0);
+          ok = read_data (in, &md, size);
+          job->md_len = md.len;
+          job->md = strbuf_steal (&md);
+
+          data.len = 0;
+          ok = ok && read_data (in, &data, padding (size));
+        }
+      else if (meta.len + TAR_BLOCK_SIZE + size <= TAR_QUEUE_MAX)
+        {
+          job = job_new ();
+          job->name = name;
+          job->done = true;
+
+          strbuf_append_len (&job->head, meta.str, meta.len);
+          strbuf_append_len (&job->head, (const char *) &header, TAR_BLOCK_SIZE);
+          ok = read_data (in, &job->body, size + padding (size));
+        }
+      else
+        {
+          /* too big to hold on to; everything before it goes out first */
+          free (name);
+          write_jobs (tar, true, 0);
+
+          output_write (tar->out, meta.str, meta.len);
+          output_write (tar->out, (const char *) &header, TAR_BLOCK_SIZE);
+          ok = stream_data (tar, in, size + padding (size));
+        }
+
+      if (!ok)
+        {
+          if (job != NULL)
+            job_free (job);
+
+          *error = "truncated tar stream";
+          break;
+        }
+
+      if (job != NULL)
+        queue_job (tar, job);
+
+      meta.len = 0;
+      free (long_name);
+      free (pax_path);
+      long_name = pax_path = NULL;
+      pax_size = UINT64_MAX;
+
+      write_jobs (tar, false, 0);
+    }
+
+  free (long_name);
+  free (pax_path);
+  strbuf_free (&meta);
+  strbuf_free (&data);
+
+  return ok;
+}
+
+/*
+ * tar_convert
+ * @in: tar stream, read once from start to end
+ * @out: gets the converted stream
+ * @params: rendering options, and params->jobs
+ * @binary: prefixes warnings about members
+ * @exceeded: set to the limit a member hit, or LIMIT_NONE
+ * @error: set when false is returned
+ *
+ * .md members are converted by params->jobs threads (online CPUs if 0)
+ * while the stream is read; at most a few jobs per thread are held in
+ * memory.  Limits apply to each member, with its own clock; the stream
+ * stops early, without the end-of-archive blocks, at the first member
+ * that exceeds one
+ */
+bool
+tar_convert (MDFile      *in,
+             Output      *out,
+             Params      *params,
+             const char  *binary,
+             Limit       *exceeded,
+             const char **error)
+{
+  Tar tar = {
+    .out = out,
+    .params = params,
+    .binary = binary,
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .queued = PTHREAD_COND_INITIALIZER,
+    .converted = PTHREAD_COND_INITIALIZER,
+  };
+  size_t n_workers = params->jobs;
+  pthread_t *workers;
+  bool ok;
+
+  if (n_workers == 0)
+    {
+      long n = sysconf (_SC_NPROCESSORS_ONLN);
+
+      n_workers = n > 0 ? (size_t) n : 1;
+    }
+
+  tar.ring_size = n_workers * TAR_JOBS_PER_WORKER;
+  tar.ring = calloc (tar.ring_size, sizeof (TarJob *));
+
+  workers = calloc (n_workers, sizeof (pthread_t));
+  for (size_t i = 0; i < n_workers; i++)
+    pthread_create (&workers[i], NULL, worker, &tar);
+
+  ok = read_members (&tar, in, error);
+
+  /* e.g. a corrupt .tar.gz, which reads as a truncated stream */
+  if (input_error (in) != NULL)
+    {
+      *error = input_error (in);
+      ok = false;
+    }
+
+  /* what was read in full still goes out, e.g. before a truncation */
+  write_jobs (&tar, true, 0);
+
+  pthread_mutex_lock (&tar.lock);
+  tar.closing = true;
+  pthread_cond_broadcast (&tar.queued);
+  pthread_mutex_unlock (&tar.lock);
+
+  for (size_t i = 0; i < n_workers; i++)
+    pthread_join (workers[i], NULL);
+
+  *exceeded = atomic_load (&tar.exceeded);
+  if (ok && *exceeded == LIMIT_NONE)
+    {
+      output_write (out, zeros, TAR_BLOCK_SIZE);
+      output_write (out, zeros, TAR_BLOCK_SIZE);
+    }
+
+  pthread_mutex_destroy (&tar.lock);
+  pthread_cond_destroy (&tar.queued);
+  pthread_cond_destroy (&tar.converted);
+  free (workers);
+  free (tar.ring);
+
+  return ok;
+}
@@ -0,0 +1,297 @@
+/* template.c
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#define _GNU_SOURCE
+
+#include "template.h"
+#include "strbuf.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* longer {{...}} aren't ours, whatever the spaces */
+#define TEMPLATE_MAX_NAME 64
+
+static const char *slot_names[] = {
+  [TEMPLATE_SLOT_TITLE]      = "title",
+  [TEMPLATE_SLOT_STYLESHEET] = "stylesheet",
+  [TEMPLATE_SLOT_CONTENT]    = "content",
+  [TEMPLATE_SLOT_FOOTNOTES]  = "footnotes",
+};
+
+/* compiled templates of this run, by path */
+typedef struct TemplateEntry {
+  char *path;
+  Template *template;
+
+  struct TemplateEntry *next;
+} TemplateEntry;
+
+static struct {
+  pthread_mutex_t lock;
+  TemplateEntry *entries;
+} cache = {
+  .lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+/*
+ * find_slot
+ * @name: between "{{" and "}}"; spaces around it are allowed
+ * @len
+ *
+ * returns TEMPLATE_SLOT_NONE if @name isn't a placeholder
+ */
+static TemplateSlot
+find_slot (const char *name,
+           size_t      len)
+{
+  if (len > TEMPLATE_MAX_NAME)
+    return TEMPLATE_SLOT_NONE;
+
+  while (len > 0 && *name == ' ')
+    {
+      name++;
+      len--;
+    }
+
+  while (len > 0 && name[len - 1] == ' ')
+    len--;
+
+  for (int i = 0; i < TEMPLATE_SLOT_NONE; i++)
+    {
+      if (strlen (slot_names[i]) == len && memcmp (slot_names[i], name, len) == 0)
+        return i;
+    }
+
+  return TEMPLATE_SLOT_NONE;
+}
+
+static void
+add_segment (Template     *template,
+             const char   *text,
+             size_t        len,
+             TemplateSlot  slot)
+{
+  template->segments = realloc (template->segments,
+                                sizeof (TemplateSegment) * (template->n_segments + 1));
+  template->segments[template->n_segments++] = (TemplateSegment) {
+    .text = text,
+    .len = len,
+    .slot = slot,
+  };
+}
+
+/*
+ * template_compile
+ * @source: the template
+ * @len
+ * @error: set when NULL is returned
+ *
+ * splits @source into segments; there must be one {{content}}, and
+ * {{footnotes}} can only follow it, as the notes are numbered while
+ * the content is written
+ */
+Template *
+template_compile (const char  *source,
+                  size_t       len,
+                  const char **error)
+{
+  Template *template = calloc (1, sizeof (Template));
+  const char *close = NULL;
+  size_t n_content = 0;
+  size_t start = 0;
+  size_t i = 0;
+  char *text;
+
+  template->source = malloc (len + 1);
+  memcpy (template->source, source, len);
+  template->source[len] = '\0';
+  text = template->source;
+
+  while (i + 1 < len)
+    {
+      const char *open = memmem (text + i, len - i, "{{", 2);
+      TemplateSlot slot;
+
+      if (open == NULL)
+        break;
+
+      /* still the next one after a "{{" that wasn't ours */
+      if (close == NULL || close < open + 2)
+        close = memmem (open + 2, len - (open + 2 - text), "}}", 2);
+      if (close == NULL)
+        break;
+
+      slot = find_slot (open + 2, close - open - 2);
+      if (slot == TEMPLATE_SLOT_NONE)
+        {
+          /* not ours, e.g. another template language; left as it is */
+          i = open + 1 - text;
+          continue;
+        }
+
+      if (slot == TEMPLATE_SLOT_CONTENT)
+        {
+          template->content = template->n_segments;
+          n_content++;
+        }
+      else if (slot == TEMPLATE_SLOT_FOOTNOTES)
+        {
+          if (n_content == 0 || template->has_footnotes)
+            {
+              *error = n_content == 0 ? "{{footnotes}} comes before {{content}}"
+                                      : "{{footnotes}} is given twice";
+              template_free (template);
+              return NULL;
+            }
+
+          template->has_footnotes = true;
+        }
+
+      add_segment (template, text + start, open - text - start, slot);
+      start = i = close + 2 - text;
+    }
+
+  add_segment (template, text + start, len - start, TEMPLATE_SLOT_NONE);
+
+  if (n_content != 1)
+    {
+      *error = n_content == 0 ? "no {{content}} placeholder"
+                              : "{{content}} is given twice";
+      template_free (template);
+      return NULL;
+    }
+
+  return template;
+}
+
+void
+template_free (Template *template)
+{
+  free (template->source);
+  free (template->segments);
+  free (template);
+}
+
+static char *
+read_template (const char  *path,
+               size_t      *len,
+               const char **error)
+{
+  FILE *file = fopen (path, "r");
+  StrBuf buf;
+  char chunk[1 << 14];
+  size_t n;
+
+  if (file == NULL)
+    {
+      *error = strerror (errno);
+      return NULL;
+    }
+
+  strbuf_init (&buf, sizeof (chunk));
+  while ((n = fread (chunk, 1, sizeof (chunk), file)) > 0)
+    strbuf_append_len (&buf, chunk, n);
+
+  if (ferror (file))
+    {
+      *error = "read failed";
+      strbuf_free (&buf);
+      fclose (file);
+      return NULL;
+    }
+
+  fclose (file);
+  *len = buf.len;
+
+  return strbuf_steal (&buf);
+}
+
+/*
+ * template_get
+ * @path: template file
+ * @error: set when NULL is returned
+ *
+ * compiles @path the first time it's asked for; the result is kept
+ * until template_close ()
+ */
+const Template *
+template_get (const char  *path,
+              const char **error)
+{
+  TemplateEntry *entry;
+  Template *template = NULL;
+  char *source;
+  size_t len = 0;
+
+  pthread_mutex_lock (&cache.lock);
+
+  for (entry = cache.entries; entry != NULL; entry = entry->next)
+    {
+      if (strcmp (entry->path, path) == 0)
+        {
+          template = entry->template;
+          break;
+        }
+    }
+
+  if (template == NULL)
+    {
+      source = read_template (path, &len, error);
+      if (source != NULL)
+        template = template_compile (source, len, error);
+      free (source);
+
+      if (template != NULL)
+        {
+          entry = calloc (1, sizeof (TemplateEntry));
+          entry->path = strdup (path);
+          entry->template = template;
+          entry->next = cache.entries;
+          cache.entries = entry;
+        }
+    }
+
+  pthread_mutex_unlock (&cache.lock);
+
+  return template;
+}
+
+void
+template_close (void)
+{
+  TemplateEntry *next;
+
+  pthread_mutex_lock (&cache.lock);
+
+  for (TemplateEntry *entry = cache.entries; entry != NULL; entry = next)
+    {
+      next = entry->next;
+      template_free (entry->template);
+      free (entry->path);
+      free (entry);
+    }
+  cache.entries = NULL;
+
+  pthread_mutex_unlock (&cache.lock);
+}
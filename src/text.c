@@ -0,0 +1,321 @@
+/* text.c
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "backend.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * plain text and ANSI terminal backends
+ *
+ * both keep the line structure of the markdown; ANSI adds SGR escape
+ * sequences where plain text has none
+ */
+
+#define SGR_RESET "\033[0m"
+
+typedef struct {
+  Output     *out;
+  bool        ansi;
+
+  const char *style;     /* SGR of the current block, restored after spans */
+  bool        at_bol;    /* nothing written on the current line yet */
+} TextBackend;
+
+#define REPLACEMENT "\xef\xbf\xbd"
+
+/* C0 and C1 controls but tab and newline, and DEL: a terminal would act
+ * on them, and the document could move the cursor or set its own SGR */
+static size_t
+control_len (const unsigned char *str,
+             size_t               len)
+{
+  if ((str[0] < 0x20 && str[0] != '\t' && str[0] != '\n') || str[0] == 0x7f)
+    return 1;
+  if (str[0] == 0xc2 && len > 1 && str[1] >= 0x80 && str[1] <= 0x9f)
+    return 2;
+  return 0;
+}
+
+static void
+text_write (TextBackend *backend,
+            const char  *str,
+            size_t       len)
+{
+  const unsigned char *ustr = (const unsigned char *) str;
+  size_t start = 0;
+
+  if (len == 0)
+    return;
+
+  /* only ANSI goes to a terminal; plain text is kept as it is */
+  for (size_t i = 0; backend->ansi && i < len;)
+    {
+      size_t n = control_len (ustr + i, len - i);
+
+      if (n == 0)
+        {
+          i++;
+          continue;
+        }
+
+      output_write (backend->out, str + start, i - start);
+      output_write (backend->out, REPLACEMENT, strlen (REPLACEMENT));
+      i += n;
+      start = i;
+    }
+
+  output_write (backend->out, str + start, len - start);
+  backend->at_bol = str[len - 1] == '\n';
+}
+
+static void
+text_write_str (TextBackend *backend,
+                const char  *str)
+{
+  text_write (backend, str, strlen (str));
+}
+
+/* escape sequences don't count as text */
+static void
+text_write_sgr (TextBackend *backend,
+                const char  *sgr)
+{
+  if (backend->ansi && sgr != NULL)
+    output_write (backend->out, sgr, strlen (sgr));
+}
+
+static void *
+text_new (Output *out,
+          Params *params,
+          MD     *md)
+{
+  TextBackend *backend;
+
+  (void) params;
+  (void) md;
+
+  backend = calloc (1, sizeof (TextBackend));
+  backend->out = out;
+  backend->at_bol = true;
+
+  return backend;
+}
+
+static void *
+ansi_new (Output *out,
+          Params *params,
+          MD     *md)
+{
+  TextBackend *backend;
+
+  backend = text_new (out, params, md);
+  backend->ansi = true;
+
+  return backend;
+}
+
+static const char *
+block_style (BlockType type)
+{
+  switch (type)
+    {
+      case BLOCK_TYPE_H1:
+        return "\033[1;4m";
+      case BLOCK_TYPE_H2:
+      case BLOCK_TYPE_H3:
+        return "\033[1m";
+      case BLOCK_TYPE_QUOTE:
+        return "\033[3m";
+      case BLOCK_TYPE_CODE:
+        return "\033[36m";
+      case BLOCK_TYPE_FOOTNOTE:
+        return "\033[2m";
+      default:
+        return NULL;
+    }
+}
+
+static void
+text_enter_block (const MDBlock *block,
+                  void          *user_data)
+{
+  TextBackend *backend = user_data;
+
+  switch (block->type)
+    {
+      case BLOCK_TYPE_LIST_ITEM:
+        text_write_str (backend, backend->ansi ? "  • " : "- ");
+        break;
+      case BLOCK_TYPE_QUOTE:
+        text_write_str (backend, backend->ansi ? "│ " : "> ");
+        break;
+      case BLOCK_TYPE_FOOTNOTES:
+        text_write_str (backend, "\n");
+        break;
+      case BLOCK_TYPE_FOOTNOTE:
+        {
+          char index[32];
+
+          snprintf (index, sizeof (index), "[%zu] ", block->note->index);
+          text_write_str (backend, index);
+        }
+        break;
+      default:
+        break;
+    }
+
+  backend->style = block_style (block->type);
+  text_write_sgr (backend, backend->style);
+}
+
+static void
+text_leave_block (const MDBlock *block,
+                  void          *user_data)
+{
+  TextBackend *backend = user_data;
+
+  if (backend->style != NULL)
+    text_write_sgr (backend, SGR_RESET);
+  backend->style = NULL;
+
+  switch (block->type)
+    {
+      case BLOCK_TYPE_LIST:
+      case BLOCK_TYPE_FOOTNOTES:
+        break;
+      case BLOCK_TYPE_CODE:
+        /* the body ends with a newline unless the fence was unclosed */
+        if (!backend->at_bol)
+          text_write_str (backend, "\n");
+        break;
+      default:
+        text_write_str (backend, "\n");
+        break;
+    }
+}
+
+static void
+text_enter_span (const MDSpan *span,
+                 void         *user_data)
+{
+  TextBackend *backend = user_data;
+
+  switch (span->type)
+    {
+      case SPAN_TYPE_EM:
+        text_write_sgr (backend, "\033[3m");
+        break;
+      case SPAN_TYPE_STRONG:
+        text_write_sgr (backend, "\033[1m");
+        break;
+      case SPAN_TYPE_STRONG_EM:
+        text_write_sgr (backend, "\033[1;3m");
+        break;
+      case SPAN_TYPE_CODE:
+        text_write_sgr (backend, "\033[36m");
+        break;
+      case SPAN_TYPE_LINK:
+        text_write_sgr (backend, "\033[4;34m");
+        break;
+      case SPAN_TYPE_IMAGE:
+        text_write_str (backend, "[image: ");
+        break;
+      case SPAN_TYPE_FOOTNOTE_REF:
+        {
+          char index[32];
+
+          if (span->ref != NULL)
+            snprintf (index, sizeof (index), "[%zu]", span->ref->index);
+          else
+            snprintf (index, sizeof (index), "[?]");
+
+          text_write_sgr (backend, "\033[33m");
+          text_write_str (backend, index);
+        }
+        break;
+    }
+}
+
+static void
+text_leave_span (const MDSpan *span,
+                 void         *user_data)
+{
+  TextBackend *backend = user_data;
+
+  if (span->type == SPAN_TYPE_IMAGE)
+    {
+      text_write_str (backend, "]");
+      return;
+    }
+
+  /* spans don't nest; back to the block's style */
+  text_write_sgr (backend, SGR_RESET);
+  text_write_sgr (backend, backend->style);
+
+  if (span->type == SPAN_TYPE_LINK)
+    {
+      text_write_str (backend, " (");
+      text_write (backend, span->href, span->href_len);
+      text_write_str (backend, ")");
+    }
+}
+
+static void
+text_text (const char *text,
+           size_t      len,
+           void       *user_data)
+{
+  text_write (user_data, text, len);
+}
+
+static void
+text_finish (void *state)
+{
+  free (state);
+}
+
+const Backend backend_text = {
+  .name = "text",
+  .events = {
+    .enter_block = text_enter_block,
+    .leave_block = text_leave_block,
+    .enter_span  = text_enter_span,
+    .leave_span  = text_leave_span,
+    .text        = text_text,
+  },
+  .new = text_new,
+  .finish = text_finish,
+};
+
+const Backend backend_ansi = {
+  .name = "ansi",
+  .events = {
+    .enter_block = text_enter_block,
+    .leave_block = text_leave_block,
+    .enter_span  = text_enter_span,
+    .leave_span  = text_leave_span,
+    .text        = text_text,
+  },
+  .new = ansi_new,
+  .finish = text_finish,
+};
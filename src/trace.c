@@ -0,0 +1,196 @@
+/* trace.c
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#define _GNU_SOURCE
+
+#include "trace.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define INITIAL_EVENTS_SIZE 1024
+
+typedef struct {
+  const char *name;
+  const char *type;
+  const char *lang;
+  size_t      line;
+  uint64_t    start_ns;
+  uint64_t    dur_ns;
+  pid_t       tid;
+} TraceEvent;
+
+bool trace_enabled = false;
+
+static struct {
+  FILE *file;
+  uint64_t origin_ns;
+
+  pthread_mutex_t lock;
+  size_t n_events;
+  size_t events_size;
+  TraceEvent *events;
+} trace = {
+  .lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static _Thread_local pid_t thread_id = 0;
+
+uint64_t
+trace_now_ (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/*
+ * trace_open
+ * @file_name: where trace_close () writes the timeline
+ *
+ * enables tracing
+ */
+bool
+trace_open (const char *file_name)
+{
+  trace.file = fopen (file_name, "w");
+  if (trace.file == NULL)
+    return false;
+
+  trace.origin_ns = trace_now_ ();
+  trace_enabled = true;
+
+  return true;
+}
+
+void
+trace_end_ (TraceSpan  *span,
+            const char *name,
+            const char *type,
+            const char *lang,
+            size_t      line)
+{
+  TraceEvent *event;
+  uint64_t end_ns;
+
+  end_ns = trace_now_ ();
+
+  if (thread_id == 0)
+    thread_id = gettid ();
+
+  pthread_mutex_lock (&trace.lock);
+
+  if (trace.n_events == trace.events_size)
+    {
+      trace.events_size = trace.events_size ? trace.events_size << 1
+                                            : INITIAL_EVENTS_SIZE;
+      trace.events = realloc (trace.events,
+                              sizeof (TraceEvent) * trace.events_size);
+    }
+
+  event = &trace.events[trace.n_events++];
+
+  event->name = name;
+  event->type = type;
+  event->lang = lang;
+  event->line = line;
+  event->start_ns = span->start_ns;
+  event->dur_ns = end_ns - span->start_ns;
+  event->tid = thread_id;
+
+  pthread_mutex_unlock (&trace.lock);
+}
+
+static void
+write_event (FILE       *file,
+             TraceEvent *event,
+             pid_t       pid)
+{
+  bool first = true;
+
+  fprintf (file,
+           "{\"name\":\"%s\",\"cat\":\"md2html\",\"ph\":\"X\","
+           "\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d,\"args\":{",
+           event->name,
+           (event->start_ns - trace.origin_ns) / 1e3, event->dur_ns / 1e3,
+           pid, event->tid);
+
+  if (event->type)
+    {
+      fprintf (file, "\"type\":\"%s\"", event->type);
+      first = false;
+    }
+
+  if (event->lang)
+    {
+      fprintf (file, "%s\"lang\":\"%s\"", first ? "" : ",", event->lang);
+      first = false;
+    }
+
+  if (event->line)
+    fprintf (file, "%s\"line\":%zu", first ? "" : ",", event->line);
+
+  fprintf (file, "}}");
+}
+
+/*
+ * trace_close
+ *
+ * writes the collected spans as a Chrome trace-event JSON file
+ */
+bool
+trace_close (void)
+{
+  pid_t pid = getpid ();
+  bool ret;
+
+  if (trace.file == NULL)
+    return true;
+
+  trace_enabled = false;
+
+  fprintf (trace.file,
+           "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+           "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,"
+           "\"args\":{\"name\":\"md2html\"}}", pid);
+
+  for (size_t i = 0; i < trace.n_events; i++)
+    {
+      fprintf (trace.file, ",\n");
+      write_event (trace.file, &trace.events[i], pid);
+    }
+
+  fprintf (trace.file, "\n]}\n");
+
+  ret = fclose (trace.file) == 0;
+
+  free (trace.events);
+  trace.events = NULL;
+  trace.n_events = trace.events_size = 0;
+  trace.file = NULL;
+
+  return ret;
+}
@@ -0,0 +1,69 @@
+/* url.c
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "url.h"
+
+static int
+hex_value (char c)
+{
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+/*
+ * url_decode
+ * @dest: room for @n bytes and a NUL
+ * @src: part of a URL, e.g. a relative path
+ * @n
+ *
+ * copies @src to @dest with its %XX escapes decoded; a '%' that isn't
+ * followed by two hex digits is copied as it is.  Returns the length of
+ * @dest, or -1 if an escape stands for a NUL, which no path can hold
+ */
+ssize_t
+url_decode (char       *dest,
+            const char *src,
+            size_t      n)
+{
+  size_t len = 0;
+
+  for (size_t i = 0; i < n; i++)
+    {
+      char c = src[i];
+
+      if (c == '%' && i + 2 < n && hex_value (src[i + 1]) >= 0 && hex_value (src[i + 2]) >= 0)
+        {
+          c = hex_value (src[i + 1]) << 4 | hex_value (src[i + 2]);
+          if (c == '\0')
+            return -1;
+          i += 2;
+        }
+
+      dest[len++] = c;
+    }
+  dest[len] = '\0';
+
+  return len;
+}
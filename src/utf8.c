@@ -0,0 +1,136 @@
+/* utf8.c
+ *
+ * Copyright 2025 Tanmay Patil <tanmaynpatil105@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "utf8.h"
+
+#include <stdint.h>
+#include <string.h>
+
+/* high bit of every byte in a 64-bit word */
+#define HIGH_BITS 0x8080808080808080ULL
+
+#define IS_CONTINUATION(c) (((c) & 0xC0) == 0x80)
+
+/*
+ * utf8_sequence_length
+ * @buf: start of a non-ASCII sequence
+ * @len: bytes available
+ *
+ * returns the length of the well-formed sequence at @buf,
+ * or 0 if it is malformed (overlong, surrogate, > U+10FFFF, truncated)
+ */
+size_t
+utf8_sequence_length (const char *buf,
+                      size_t      len)
+{
+  const unsigned char *s = (const unsigned char *) buf;
+  size_t n;
+
+  if (s[0] < 0x80)
+    return 1;
+  else if (s[0] >= 0xC2 && s[0] <= 0xDF)
+    n = 2;
+  else if (s[0] >= 0xE0 && s[0] <= 0xEF)
+    n = 3;
+  else if (s[0] >= 0xF0 && s[0] <= 0xF4)
+    n = 4;
+  else
+    return 0;
+
+  if (len < n)
+    return 0;
+
+  /* the second byte carries the overlong/surrogate/range restrictions */
+  switch (s[0])
+    {
+      case 0xE0:
+        if (s[1] < 0xA0 || s[1] > 0xBF) return 0;
+        break;
+      case 0xED:
+        if (s[1] < 0x80 || s[1] > 0x9F) return 0;
+        break;
+      case 0xF0:
+        if (s[1] < 0x90 || s[1] > 0xBF) return 0;
+        break;
+      case 0xF4:
+        if (s[1] < 0x80 || s[1] > 0x8F) return 0;
+        break;
+      default:
+        if (!IS_CONTINUATION (s[1])) return 0;
+        break;
+    }
+
+  for (size_t i = 2; i < n; i++)
+    {
+      if (!IS_CONTINUATION (s[i]))
+        return 0;
+    }
+
+  return n;
+}
+
+/*
+ * utf8_validate
+ * @buf: input bytes
+ * @len: number of bytes
+ *
+ * returns the offset of the first malformed sequence,
+ * or @len if the whole buffer is valid UTF-8
+ *
+ * ASCII runs are skipped a word at a time
+ */
+size_t
+utf8_validate (const char *buf,
+               size_t      len)
+{
+  size_t i = 0;
+
+  while (i < len)
+    {
+      size_t n;
+
+      while (i + 2 * sizeof (uint64_t) <= len)
+        {
+          uint64_t a, b;
+
+          memcpy (&a, buf + i, sizeof (a));
+          memcpy (&b, buf + i + sizeof (a), sizeof (b));
+
+          if ((a | b) & HIGH_BITS)
+            break;
+
+          i += 2 * sizeof (uint64_t);
+        }
+
+      while (i < len && (unsigned char) buf[i] < 0x80)
+        i++;
+
+      if (i == len)
+        break;
+
+      n = utf8_sequence_length (buf + i, len - i);
+      if (n == 0)
+        return i;
+
+      i += n;
+    }
+
+  return len;
+}
@@ -108,3 +108,37 @@ xml_sanitize_strcpy (char   *dest,
 
   return len;
 }
+
+/*
+ * xml_sanitize_append
+ * @buf: destination
+ * @src: raw text
+ * @n: bytes of @src to append
+ *
+ * same as xml_sanitize_strcpy, but grows @buf as needed and copies
+ * runs of plain characters at once
+ */
+void
+xml_sanitize_append (StrBuf     *buf,
+                     const char *src,
+                     size_t      n)
+{
+  const char *end = src + n;
+
+  while (src < end)
+    {
+      const char *run = src;
+      const char *repl = NULL;
+
+      while (src < end && (repl = xml_char_replace (*src)) == NULL)
+        src++;
+
+      strbuf_append_len (buf, run, src - run);
+
+      if (src < end)
+        {
+          strbuf_append (buf, repl);
+          src++;
+        }
+    }
+}